@@ -0,0 +1,65 @@
+/*
+ * Native HAL: Adafruit ADS1115
+ *
+ * Conversions return the per-channel value set with nativeSetAdc().
+ * Continuous mode (startADCReading) converts the selected channel; its
+ * results are not recorded for replay, since a task reads them. ALERT/RDY
+ * never fires natively.
+ */
+
+#ifndef NATIVE_ADAFRUIT_ADS1X15_H
+#define NATIVE_ADAFRUIT_ADS1X15_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#define ADS1X15_ADDRESS 0x48
+
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_0 0x4000
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_1 0x5000
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_2 0x6000
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_3 0x7000
+
+#define RATE_ADS1115_8SPS   0x0000
+#define RATE_ADS1115_16SPS  0x0020
+#define RATE_ADS1115_32SPS  0x0040
+#define RATE_ADS1115_64SPS  0x0060
+#define RATE_ADS1115_128SPS 0x0080
+#define RATE_ADS1115_250SPS 0x00A0
+#define RATE_ADS1115_475SPS 0x00C0
+#define RATE_ADS1115_860SPS 0x00E0
+
+typedef enum {
+    GAIN_TWOTHIRDS = 0x0000,
+    GAIN_ONE = 0x0200,
+    GAIN_TWO = 0x0400,
+    GAIN_FOUR = 0x0600,
+    GAIN_EIGHT = 0x0800,
+    GAIN_SIXTEEN = 0x0A00
+} adsGain_t;
+
+class Adafruit_ADS1115 {
+public:
+    bool begin(uint8_t address = ADS1X15_ADDRESS, TwoWire* wire = &Wire) {
+        (void)address; (void)wire;
+        return true;
+    }
+
+    void setGain(adsGain_t gain) { _gain = gain; }
+    adsGain_t getGain() { return _gain; }
+    void setDataRate(uint16_t rate) { _rate = rate; }
+    uint16_t getDataRate() { return _rate; }
+
+    int16_t readADC_SingleEnded(uint8_t channel);
+    void startADCReading(uint16_t mux, bool continuous) { _channel = (mux >> 12) & 3; (void)continuous; }
+    bool conversionComplete() { return true; }
+    int16_t getLastConversionResults();
+    float computeVolts(int16_t counts);
+
+private:
+    adsGain_t _gain = GAIN_TWOTHIRDS;
+    uint16_t _rate = RATE_ADS1115_128SPS;
+    uint8_t _channel = 0;
+};
+
+#endif // NATIVE_ADAFRUIT_ADS1X15_H
@@ -0,0 +1,210 @@
+/*
+ * =====================================================
+ * NATIVE HAL FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Host (Linux) stand-ins for the Arduino core and the board libraries,
+ * so main.cpp builds unchanged in [env:native] and can be run under
+ * perf, valgrind or gdb.
+ *
+ * What is real and what is faked:
+ * - Timing: millis()/delay() use the host clock
+ * - Display: Arduino_GFX draws into an 800x480 RGB565 framebuffer
+ *   (ASCII uses the classic 5x7 font; see Arduino_GFX_Library.h)
+ * - Network: WiFi always connects; WiFiClient/HTTPClient are plain TCP
+ *   sockets, so point the endpoints at tools/mock_services.py
+ * - Preferences: key=value file (NATIVE_PREFS, default .native_prefs)
+ * - Touch, ADS1115, analogRead: values injected via native_hal.h
+ * - FastLED, Wire, WebServer, DNSServer, Update: accept and count calls
+ *
+ * Runtime knobs (environment variables):
+ *   NATIVE_RUN_MS      stop after this many ms of loop() (default: forever)
+ *   NATIVE_FRAME_DUMP  write the framebuffer to this .ppm on exit
+ *   NATIVE_EPOCH       fake wall-clock start (unix seconds) for time()
+ *   NATIVE_PREFS       Preferences file
+ *   NATIVE_RECORD      log every external input to this file
+ *   NATIVE_REPLAY      replay such a log under a virtual clock
+ *   NATIVE_TRACE       per-loop() host cost trace (see native_main.cpp)
+ */
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <cmath>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+#include "esp_heap_caps.h"
+
+using std::min;
+using std::max;
+using std::abs;
+using std::isinf;
+using std::isnan;
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef unsigned int word;
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ============================================================
+// GPIO
+// ============================================================
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+
+// ============================================================
+// TIMING & MATH
+// ============================================================
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// ESP32 core SNTP helpers
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// ============================================================
+// MEMORY
+// ============================================================
+
+inline bool psramFound() { return true; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+inline void* ps_calloc(size_t n, size_t size) { return calloc(n, size); }
+inline void* ps_realloc(void* p, size_t size) { return realloc(p, size); }
+
+class EspClass {
+public:
+    uint32_t getHeapSize() { return 320 * 1024; }
+    uint32_t getFreeHeap() { return heap_caps_get_free_size(MALLOC_CAP_INTERNAL); }
+    uint32_t getMinFreeHeap() { return getFreeHeap(); }
+    uint32_t getMaxAllocHeap() { return heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL); }
+    uint32_t getPsramSize() { return 8 * 1024 * 1024; }
+    uint32_t getFreePsram() { return heap_caps_get_free_size(MALLOC_CAP_SPIRAM); }
+    uint32_t getFreeSketchSpace() { return 6 * 1024 * 1024; }
+    uint32_t getSketchSize();  // NATIVE_RUNNING_IMAGE's size, else 1.5 MB
+    String getSketchMD5();     // Its MD5, empty without one
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getCycleCount() { return (uint32_t)(micros() * 240UL); }  // Nominal 240 MHz
+    const char* getChipModel() { return "native"; }
+    void restart();
+};
+
+extern EspClass ESP;
+
+// ============================================================
+// TASKS
+// ============================================================
+
+// One FreeRTOS task per host thread; delays in tasks are real sleeps
+// (the virtual replay clock belongs to loop()). See native_tasks.cpp.
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef struct NativeQueue* QueueHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdFAIL              0
+#define pdPASS              1
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define tskIDLE_PRIORITY    0
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static thread_local char self;
+    return &self;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);  // nullptr (the calling task) only
+void vTaskDelay(TickType_t ticks);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken);
+#define portYIELD_FROM_ISR() do {} while (0)
+
+// ============================================================
+// SERIAL
+// ============================================================
+
+// stdout for output, non-blocking stdin for input
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void flush() override;
+    using Print::write;
+
+    operator bool() const { return true; }
+
+private:
+    int _peeked = -1;
+};
+
+extern HardwareSerial Serial;
+
+// Sketch entry points, called by the native main()
+void setup();
+void loop();
+
+#endif // NATIVE_ARDUINO_H
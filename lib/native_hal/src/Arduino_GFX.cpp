@@ -0,0 +1,326 @@
+#include "Arduino_GFX_Library.h"
+#include "native_hal.h"
+
+// Classic 5x7 font, ASCII 0x20-0x7E, one byte per column (LSB at top)
+static const uint8_t font5x7[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00},
+    {0x00, 0x40, 0x34, 0x00, 0x00}, {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, {0x3E, 0x41, 0x5D, 0x59, 0x4E},
+    {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x73}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x26, 0x49, 0x49, 0x49, 0x32}, {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40},
+    {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, {0x38, 0x44, 0x44, 0x28, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00},
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0xFC, 0x18, 0x24, 0x24, 0x18},
+    {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24},
+    {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x77, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},
+};
+
+static Arduino_GFX* nativeDisplay = nullptr;
+
+// Counts a primitive only when called from outside the library
+class CallScope {
+public:
+    CallScope(uint8_t& depth, uint32_t& counter) : _depth(depth) {
+        if (_depth++ == 0) counter++;
+    }
+    ~CallScope() { _depth--; }
+
+private:
+    uint8_t& _depth;
+};
+
+#define COUNT_CALL(name) CallScope scope(_depth, _calls.name)
+
+Arduino_GFX::Arduino_GFX(int16_t w, int16_t h) :
+    _width(w),
+    _height(h),
+    _fb((uint16_t*)calloc((size_t)w * h, sizeof(uint16_t))),
+    _pixelsWritten(0),
+    _calls(),
+    _depth(0),
+    _cursorX(0),
+    _cursorY(0),
+    _textColor(0xFFFF),
+    _textBg(0xFFFF),
+    _textSizeX(1),
+    _textSizeY(1),
+    _wrap(true) {
+    nativeDisplay = this;
+}
+
+Arduino_GFX::~Arduino_GFX() {
+    if (nativeDisplay == this) nativeDisplay = nullptr;
+    free(_fb);
+}
+
+bool Arduino_GFX::begin(int32_t speed) {
+    (void)speed;
+    return _fb != nullptr;
+}
+
+// ============================================================
+// PRIMITIVES
+// ============================================================
+
+void Arduino_GFX::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    COUNT_CALL(pixel);
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+    _fb[(int32_t)y * _width + x] = color;
+    _pixelsWritten++;
+}
+
+void Arduino_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    COUNT_CALL(fillRect);
+    if (w < 0) { x += w + 1; w = -w; }
+    if (h < 0) { y += h + 1; h = -h; }
+    int32_t x0 = max<int32_t>(x, 0), y0 = max<int32_t>(y, 0);
+    int32_t x1 = min<int32_t>((int32_t)x + w, _width), y1 = min<int32_t>((int32_t)y + h, _height);
+    if (x0 >= x1 || y0 >= y1) return;
+    for (int32_t row = y0; row < y1; row++) {
+        uint16_t* p = _fb + row * _width + x0;
+        for (int32_t col = x0; col < x1; col++) *p++ = color;
+    }
+    _pixelsWritten += (uint32_t)((x1 - x0) * (y1 - y0));
+}
+
+void Arduino_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    COUNT_CALL(hline);
+    fillRect(x, y, w, 1, color);
+}
+
+void Arduino_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    COUNT_CALL(vline);
+    fillRect(x, y, 1, h, color);
+}
+
+void Arduino_GFX::fillScreen(uint16_t color) {
+    COUNT_CALL(fillRect);
+    fillRect(0, 0, _width, _height, color);
+}
+
+void Arduino_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    COUNT_CALL(rect);
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Arduino_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    COUNT_CALL(line);
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) { std::swap(x0, y0); std::swap(x1, y1); }
+    if (x0 > x1) { std::swap(x0, x1); std::swap(y0, y1); }
+    int16_t dx = x1 - x0, dy = abs(y1 - y0);
+    int16_t err = dx / 2;
+    int16_t ystep = (y0 < y1) ? 1 : -1;
+    for (; x0 <= x1; x0++) {
+        if (steep) drawPixel(y0, x0, color);
+        else drawPixel(x0, y0, color);
+        err -= dy;
+        if (err < 0) { y0 += ystep; err += dx; }
+    }
+}
+
+void Arduino_GFX::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    COUNT_CALL(circle);
+    int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r;
+    drawPixel(x0, y0 + r, color);
+    drawPixel(x0, y0 - r, color);
+    drawPixel(x0 + r, y0, color);
+    drawPixel(x0 - r, y0, color);
+    while (x < y) {
+        if (f >= 0) { y--; ddFy += 2; f += ddFy; }
+        x++;
+        ddFx += 2;
+        f += ddFx;
+        drawPixel(x0 + x, y0 + y, color);
+        drawPixel(x0 - x, y0 + y, color);
+        drawPixel(x0 + x, y0 - y, color);
+        drawPixel(x0 - x, y0 - y, color);
+        drawPixel(x0 + y, y0 + x, color);
+        drawPixel(x0 - y, y0 + x, color);
+        drawPixel(x0 + y, y0 - x, color);
+        drawPixel(x0 - y, y0 - x, color);
+    }
+}
+
+void Arduino_GFX::drawCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, uint16_t color) {
+    int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r;
+    while (x < y) {
+        if (f >= 0) { y--; ddFy += 2; f += ddFy; }
+        x++;
+        ddFx += 2;
+        f += ddFx;
+        if (corners & 0x4) { drawPixel(x0 + x, y0 + y, color); drawPixel(x0 + y, y0 + x, color); }
+        if (corners & 0x2) { drawPixel(x0 + x, y0 - y, color); drawPixel(x0 + y, y0 - x, color); }
+        if (corners & 0x8) { drawPixel(x0 - y, y0 + x, color); drawPixel(x0 - x, y0 + y, color); }
+        if (corners & 0x1) { drawPixel(x0 - y, y0 - x, color); drawPixel(x0 - x, y0 - y, color); }
+    }
+}
+
+void Arduino_GFX::fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta,
+                                   uint16_t color) {
+    int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r;
+    int16_t px = x, py = y;
+    delta++;  // Avoid some +1's in the loop
+    while (x < y) {
+        if (f >= 0) { y--; ddFy += 2; f += ddFy; }
+        x++;
+        ddFx += 2;
+        f += ddFx;
+        // These checks avoid double-drawing certain lines
+        if (x < (y + 1)) {
+            if (corners & 1) drawFastVLine(x0 + x, y0 - y, 2 * y + delta, color);
+            if (corners & 2) drawFastVLine(x0 - x, y0 - y, 2 * y + delta, color);
+        }
+        if (y != py) {
+            if (corners & 1) drawFastVLine(x0 + py, y0 - px, 2 * px + delta, color);
+            if (corners & 2) drawFastVLine(x0 - py, y0 - px, 2 * px + delta, color);
+            py = y;
+        }
+        px = x;
+    }
+}
+
+void Arduino_GFX::fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    COUNT_CALL(fillCircle);
+    drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+    fillCircleHelper(x0, y0, r, 3, 0, color);
+}
+
+void Arduino_GFX::drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color) {
+    COUNT_CALL(roundRect);
+    int16_t maxR = ((w < h) ? w : h) / 2;
+    if (r > maxR) r = maxR;
+    drawFastHLine(x + r, y, w - 2 * r, color);
+    drawFastHLine(x + r, y + h - 1, w - 2 * r, color);
+    drawFastVLine(x, y + r, h - 2 * r, color);
+    drawFastVLine(x + w - 1, y + r, h - 2 * r, color);
+    drawCircleHelper(x + r, y + r, r, 1, color);
+    drawCircleHelper(x + w - r - 1, y + r, r, 2, color);
+    drawCircleHelper(x + w - r - 1, y + h - r - 1, r, 4, color);
+    drawCircleHelper(x + r, y + h - r - 1, r, 8, color);
+}
+
+void Arduino_GFX::fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color) {
+    COUNT_CALL(fillRoundRect);
+    int16_t maxR = ((w < h) ? w : h) / 2;
+    if (r > maxR) r = maxR;
+    fillRect(x + r, y, w - 2 * r, h, color);
+    fillCircleHelper(x + w - r - 1, y + r, r, 1, h - 2 * r - 1, color);
+    fillCircleHelper(x + r, y + r, r, 2, h - 2 * r - 1, color);
+}
+
+void Arduino_GFX::draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h) {
+    COUNT_CALL(bitmap);
+    for (int16_t row = 0; row < h; row++) {
+        int32_t py = (int32_t)y + row;
+        if (py < 0 || py >= _height) continue;
+        for (int16_t col = 0; col < w; col++) {
+            int32_t px = (int32_t)x + col;
+            if (px < 0 || px >= _width) continue;
+            _fb[py * _width + px] = bitmap[(int32_t)row * w + col];
+            _pixelsWritten++;
+        }
+    }
+}
+
+// ============================================================
+// TEXT
+// ============================================================
+
+void Arduino_GFX::drawChar(int16_t x, int16_t y, unsigned char c) {
+    bool opaque = _textBg != _textColor;
+    bool known = c >= 0x20 && c <= 0x7E;
+
+    for (int8_t col = 0; col < 6; col++) {
+        uint8_t bits = 0;
+        if (col < 5) {
+            if (known) bits = font5x7[c - 0x20][col];
+            else bits = (col == 0 || col == 4) ? 0x7F : 0x41;  // Outlined cell
+        }
+        for (int8_t row = 0; row < 8; row++, bits >>= 1) {
+            if (bits & 1) {
+                fillRect(x + col * _textSizeX, y + row * _textSizeY, _textSizeX, _textSizeY, _textColor);
+            } else if (opaque) {
+                fillRect(x + col * _textSizeX, y + row * _textSizeY, _textSizeX, _textSizeY, _textBg);
+            }
+        }
+    }
+}
+
+size_t Arduino_GFX::write(uint8_t c) {
+    COUNT_CALL(chars);
+    if (c == '\n') {
+        _cursorX = 0;
+        _cursorY += 8 * _textSizeY;
+    } else if (c != '\r') {
+        if (_wrap && (_cursorX + 6 * _textSizeX) > _width) {
+            _cursorX = 0;
+            _cursorY += 8 * _textSizeY;
+        }
+        drawChar(_cursorX, _cursorY, c);
+        _cursorX += 6 * _textSizeX;
+    }
+    return 1;
+}
+
+// ============================================================
+// NATIVE HOOKS
+// ============================================================
+
+uint16_t* nativeFramebuffer() {
+    return nativeDisplay ? nativeDisplay->framebuffer() : nullptr;
+}
+
+int nativeFramebufferWidth() {
+    return nativeDisplay ? nativeDisplay->width() : 0;
+}
+
+int nativeFramebufferHeight() {
+    return nativeDisplay ? nativeDisplay->height() : 0;
+}
+
+// Binary PPM (P6), RGB565 expanded to 8 bits per channel
+bool nativeWriteFramebuffer(const char* ppmPath) {
+    uint16_t* fb = nativeFramebuffer();
+    if (!fb) return false;
+    FILE* f = fopen(ppmPath, "wb");
+    if (!f) return false;
+
+    int w = nativeFramebufferWidth(), h = nativeFramebufferHeight();
+    fprintf(f, "P6\n%d %d\n255\n", w, h);
+    for (int i = 0; i < w * h; i++) {
+        uint16_t p = fb[i];
+        uint8_t rgb[3] = {
+            (uint8_t)(((p >> 11) & 0x1F) * 255 / 31),
+            (uint8_t)(((p >> 5) & 0x3F) * 255 / 63),
+            (uint8_t)((p & 0x1F) * 255 / 31),
+        };
+        fwrite(rgb, 1, 3, f);
+    }
+    return fclose(f) == 0;
+}
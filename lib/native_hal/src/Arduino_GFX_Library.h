@@ -0,0 +1,136 @@
+/*
+ * Native HAL: Arduino_GFX
+ *
+ * Arduino_RGB_Display backed by an in-memory RGB565 framebuffer, with
+ * the Adafruit-GFX primitives the firmware uses (same algorithms, so
+ * rounded rects and circles land on the same pixels as on the panel).
+ *
+ * Text uses the classic 5x7 font for ASCII. Bytes outside 0x20-0x7E
+ * (UTF-8 emoji, cp437) are drawn as an outlined cell.
+ *
+ * pixelsWritten() counts framebuffer writes and callCounts() counts the
+ * primitive calls made by the caller (nested calls, e.g. the lines inside
+ * drawRect, are not counted), for draw-cost comparisons.
+ */
+
+#ifndef NATIVE_ARDUINO_GFX_LIBRARY_H
+#define NATIVE_ARDUINO_GFX_LIBRARY_H
+
+#include "Arduino.h"
+
+#define RGB565_BLACK 0x0000
+#define RGB565_WHITE 0xFFFF
+
+// Calls made from outside the library, per primitive
+struct GfxCallCounts {
+    uint32_t pixel;
+    uint32_t hline;
+    uint32_t vline;
+    uint32_t line;
+    uint32_t rect;
+    uint32_t fillRect;
+    uint32_t circle;
+    uint32_t fillCircle;
+    uint32_t roundRect;
+    uint32_t fillRoundRect;
+    uint32_t bitmap;
+    uint32_t chars;
+
+    uint32_t total() const {
+        return pixel + hline + vline + line + rect + fillRect + circle + fillCircle +
+               roundRect + fillRoundRect + bitmap + chars;
+    }
+};
+
+class Arduino_GFX : public Print {
+public:
+    Arduino_GFX(int16_t w, int16_t h);
+    virtual ~Arduino_GFX();
+
+    bool begin(int32_t speed = 0);
+
+    // ---------- Primitives ----------
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color);
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void fillScreen(uint16_t color);
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+    void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+    void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color);
+    void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color);
+    void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h);
+
+    uint16_t color565(uint8_t r, uint8_t g, uint8_t b) {
+        return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+
+    // ---------- Text ----------
+
+    void setCursor(int16_t x, int16_t y) { _cursorX = x; _cursorY = y; }
+    void setTextColor(uint16_t c) { _textColor = _textBg = c; }
+    void setTextColor(uint16_t c, uint16_t bg) { _textColor = c; _textBg = bg; }
+    void setTextSize(uint8_t s) { setTextSize(s, s); }
+    void setTextSize(uint8_t sx, uint8_t sy) { _textSizeX = sx ? sx : 1; _textSizeY = sy ? sy : 1; }
+    void setTextWrap(bool w) { _wrap = w; }
+    int16_t getCursorX() const { return _cursorX; }
+    int16_t getCursorY() const { return _cursorY; }
+
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    // ---------- Geometry / framebuffer ----------
+
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+    uint16_t* framebuffer() { return _fb; }
+    uint32_t pixelsWritten() const { return _pixelsWritten; }
+    const GfxCallCounts& callCounts() const { return _calls; }
+    void resetCounters() {
+        _pixelsWritten = 0;
+        _calls = GfxCallCounts();
+    }
+
+protected:
+    int16_t _width;
+    int16_t _height;
+    uint16_t* _fb;
+    uint32_t _pixelsWritten;
+    GfxCallCounts _calls;
+    uint8_t _depth;  // Nesting level of primitive calls, only 0 is counted
+
+    int16_t _cursorX;
+    int16_t _cursorY;
+    uint16_t _textColor;
+    uint16_t _textBg;
+    uint8_t _textSizeX;
+    uint8_t _textSizeY;
+    bool _wrap;
+
+    void drawChar(int16_t x, int16_t y, unsigned char c);
+    void drawCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, uint16_t color);
+    void fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta, uint16_t color);
+};
+
+// Panel timing is irrelevant off-device; accept the same constructor arguments
+class Arduino_ESP32RGBPanel {
+public:
+    template <typename... Args>
+    Arduino_ESP32RGBPanel(Args...) {}
+};
+
+class Arduino_RGB_Display : public Arduino_GFX {
+public:
+    Arduino_RGB_Display(int16_t w, int16_t h, Arduino_ESP32RGBPanel* panel, uint8_t rotation = 0,
+                        bool autoFlush = true)
+        : Arduino_GFX(w, h) {
+        (void)panel;
+        (void)rotation;
+        (void)autoFlush;
+    }
+};
+
+#endif // NATIVE_ARDUINO_GFX_LIBRARY_H
@@ -0,0 +1,20 @@
+/*
+ * Native HAL: DNSServer (captive portal), no-op
+ */
+
+#ifndef NATIVE_DNSSERVER_H
+#define NATIVE_DNSSERVER_H
+
+#include "Arduino.h"
+
+class DNSServer {
+public:
+    bool start(uint16_t port, const String& domainName, const IPAddress& resolvedIP) {
+        (void)port; (void)domainName; (void)resolvedIP;
+        return true;
+    }
+    void processNextRequest() {}
+    void stop() {}
+};
+
+#endif // NATIVE_DNSSERVER_H
@@ -0,0 +1,50 @@
+/*
+ * Native HAL: ESPmDNS
+ *
+ * Services are published to a file shared by every native process
+ * (NATIVE_MDNS_FILE, default /tmp/native_mdns) instead of multicast, so
+ * two builds on one machine can find each other. Addresses are always
+ * 127.0.0.1 and ports include NATIVE_PORT_OFFSET, like WebServer.
+ */
+
+#ifndef NATIVE_ESPMDNS_H
+#define NATIVE_ESPMDNS_H
+
+#include <vector>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class MDNSResponder {
+public:
+    bool begin(const char* hostName);
+    void end();
+
+    bool addService(const char* service, const char* proto, uint16_t port);
+    void addServiceTxt(const char* service, const char* proto, const char* key, const char* value);
+
+    // Results stay readable until the next query
+    int queryService(const char* service, const char* proto);
+    String hostname(int idx);
+    IPAddress IP(int idx);
+    uint16_t port(int idx);
+    bool hasTxt(int idx, const char* key);
+    String txt(int idx, const char* key);
+
+private:
+    struct Service {
+        String host;
+        String type;   // "_service._proto"
+        uint16_t port;
+        std::vector<std::pair<String, String>> txt;
+    };
+
+    String _hostname;
+    std::vector<Service> _own;
+    std::vector<Service> _results;
+
+    void publish();
+};
+
+extern MDNSResponder MDNS;
+
+#endif // NATIVE_ESPMDNS_H
@@ -0,0 +1,76 @@
+/*
+ * Native HAL: FastLED
+ *
+ * CRGB and the controller API; show() only counts frames.
+ */
+
+#ifndef NATIVE_FASTLED_H
+#define NATIVE_FASTLED_H
+
+#include <stdint.h>
+
+struct CRGB {
+    enum HTMLColorCode {
+        Black = 0x000000,
+        White = 0xFFFFFF,
+        Red = 0xFF0000,
+        Green = 0x008000,
+        Blue = 0x0000FF,
+        Cyan = 0x00FFFF,
+        Purple = 0x800080
+    };
+
+    uint8_t r, g, b;
+
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+    CRGB(uint32_t code) : r((code >> 16) & 0xFF), g((code >> 8) & 0xFF), b(code & 0xFF) {}
+    CRGB(HTMLColorCode code) : CRGB((uint32_t)code) {}
+
+    bool operator==(const CRGB& o) const { return r == o.r && g == o.g && b == o.b; }
+    bool operator!=(const CRGB& o) const { return !(*this == o); }
+};
+
+enum EOrder { RGB = 0012, RBG = 0021, GRB = 0102, GBR = 0120, BRG = 0201, BGR = 0210 };
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812B {};
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812 {};
+
+inline void fill_solid(CRGB* leds, int count, const CRGB& color) {
+    for (int i = 0; i < count; i++) leds[i] = color;
+}
+
+class CFastLED {
+public:
+    template <template <uint8_t, EOrder> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+    CFastLED& addLeds(CRGB* leds, int count) {
+        _leds = leds;
+        _count = count;
+        return *this;
+    }
+
+    void setBrightness(uint8_t brightness) { _brightness = brightness; }
+    uint8_t getBrightness() const { return _brightness; }
+    void show() { _frames++; }
+    void clear(bool writeData = false) {
+        if (_leds) fill_solid(_leds, _count, CRGB::Black);
+        if (writeData) show();
+    }
+
+    CRGB* leds() { return _leds; }
+    int size() const { return _count; }
+    unsigned long frames() const { return _frames; }
+
+private:
+    CRGB* _leds = nullptr;
+    int _count = 0;
+    uint8_t _brightness = 255;
+    unsigned long _frames = 0;
+};
+
+extern CFastLED FastLED;
+
+#endif // NATIVE_FASTLED_H
@@ -0,0 +1,192 @@
+#include "HTTPClient.h"
+
+#include <strings.h>
+
+static std::string lowerKey(const char* s) {
+    std::string k(s);
+    for (char& c : k) c = (char)tolower((unsigned char)c);
+    return k;
+}
+
+HTTPClient::HTTPClient() :
+    _client(nullptr),
+    _port(80),
+    _timeout(5000),
+    _connectTimeout(5000),
+    _userAgent("ESP32HTTPClient"),
+    _follow(HTTPC_DISABLE_FOLLOW_REDIRECTS),
+    _size(-1) {
+}
+
+HTTPClient::~HTTPClient() {
+    end();
+}
+
+bool HTTPClient::parseUrl(const String& url) {
+    int schemeEnd = url.indexOf("://");
+    if (schemeEnd < 0) return false;
+    String scheme = url.substring(0, schemeEnd);
+    _port = (scheme == "https") ? 443 : 80;
+
+    String rest = url.substring(schemeEnd + 3);
+    int slash = rest.indexOf('/');
+    String hostPort = slash >= 0 ? rest.substring(0, slash) : rest;
+    _path = slash >= 0 ? rest.substring(slash) : String("/");
+
+    int colon = hostPort.indexOf(':');
+    if (colon >= 0) {
+        _host = hostPort.substring(0, colon);
+        _port = (uint16_t)hostPort.substring(colon + 1).toInt();
+    } else {
+        _host = hostPort;
+    }
+    return _host.length() > 0;
+}
+
+bool HTTPClient::begin(String url) {
+    _client = &_ownClient;
+    return parseUrl(url);
+}
+
+bool HTTPClient::begin(WiFiClient& client, String url) {
+    _client = &client;
+    return parseUrl(url);
+}
+
+void HTTPClient::end() {
+    if (_client) _client->stop();
+    _requestHeaders.clear();
+    _responseHeaders.clear();
+    _size = -1;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+    _requestHeaders.push_back(std::make_pair(name, value));
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t count) {
+    _collect.clear();
+    for (size_t i = 0; i < count; i++) _collect.push_back(lowerKey(headerKeys[i]));
+}
+
+String HTTPClient::header(const char* name) {
+    auto it = _responseHeaders.find(lowerKey(name));
+    return it != _responseHeaders.end() ? it->second : String();
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+    return _responseHeaders.count(lowerKey(name)) > 0;
+}
+
+int HTTPClient::GET() {
+    return sendRequest("GET");
+}
+
+int HTTPClient::POST(const uint8_t* payload, size_t size) {
+    return sendRequest("POST", payload, size);
+}
+
+int HTTPClient::sendRequest(const char* type, const uint8_t* payload, size_t size) {
+    for (int redirects = 0; redirects < 10; redirects++) {
+        if (!_client) return HTTPC_ERROR_NOT_CONNECTED;
+        if (!_client->connect(_host.c_str(), _port, _connectTimeout)) return HTTPC_ERROR_CONNECTION_REFUSED;
+        static_cast<Stream*>(_client)->setTimeout(_timeout);
+
+        String req = String(type) + " " + _path + " HTTP/1.0\r\n";
+        req += "Host: " + _host;
+        if (_port != 80 && _port != 443) req += ":" + String((unsigned int)_port);
+        req += "\r\nUser-Agent: " + _userAgent + "\r\nConnection: close\r\n";
+        for (const auto& h : _requestHeaders) req += h.first + ": " + h.second + "\r\n";
+        if (payload) req += "Content-Length: " + String((unsigned int)size) + "\r\n";
+        req += "\r\n";
+
+        if (_client->write((const uint8_t*)req.c_str(), req.length()) != req.length()) {
+            return HTTPC_ERROR_SEND_HEADER_FAILED;
+        }
+        if (payload && size && _client->write(payload, size) != size) return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+
+        int code = readResponseHeaders();
+        bool redirect = code == 301 || code == 302 || code == 303 || code == 307 || code == 308;
+        bool follow = _follow == HTTPC_FORCE_FOLLOW_REDIRECTS ||
+                      (_follow == HTTPC_STRICT_FOLLOW_REDIRECTS && (!strcmp(type, "GET") || !strcmp(type, "HEAD")));
+        if (!redirect || !follow || !hasHeader("Location")) return code;
+
+        String location = header("Location");
+        _client->stop();
+        if (!parseUrl(location)) return code;
+    }
+    return HTTPC_ERROR_CONNECTION_LOST;
+}
+
+int HTTPClient::readResponseHeaders() {
+    _responseHeaders.clear();
+    _size = -1;
+
+    char line[512];
+    size_t len = _client->readBytesUntil('\n', line, sizeof(line) - 1);
+    line[len] = '\0';
+    int code = 0;
+    if (len == 0 || sscanf(line, "HTTP/%*d.%*d %d", &code) != 1) return HTTPC_ERROR_NO_HTTP_SERVER;
+
+    while (true) {
+        len = _client->readBytesUntil('\n', line, sizeof(line) - 1);
+        line[len] = '\0';
+        if (len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+        if (len == 0) break;
+
+        char* colon = strchr(line, ':');
+        if (!colon) continue;
+        *colon = '\0';
+        const char* value = colon + 1;
+        while (*value == ' ') value++;
+
+        std::string key = lowerKey(line);
+        if (key == "content-length") _size = atoi(value);
+        bool wanted = key == "location";
+        for (const auto& k : _collect) wanted |= (k == key);
+        if (wanted) _responseHeaders[key] = value;
+    }
+    return code;
+}
+
+String HTTPClient::getString() {
+    String body;
+    char buf[512];
+    int remaining = _size;
+    while (remaining != 0) {
+        size_t want = (remaining < 0 || remaining > (int)sizeof(buf)) ? sizeof(buf) : (size_t)remaining;
+        size_t n = _client->readBytes(buf, want);
+        if (n == 0) break;
+        body.concat(buf, n);
+        if (remaining > 0) remaining -= n;
+    }
+    return body;
+}
+
+int HTTPClient::writeToStream(Stream* stream) {
+    uint8_t buf[1024];
+    int total = 0;
+    int remaining = _size;
+    while (remaining != 0) {
+        size_t want = (remaining < 0 || remaining > (int)sizeof(buf)) ? sizeof(buf) : (size_t)remaining;
+        size_t n = _client->readBytes(buf, want);
+        if (n == 0) break;
+        if (stream->write(buf, n) != n) return HTTPC_ERROR_STREAM_WRITE;
+        total += n;
+        if (remaining > 0) remaining -= n;
+    }
+    return total;
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+        case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+        case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+        case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+        case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+        case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+        default: return String();
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * Native HAL: HTTPClient
+ *
+ * The ESP32 HTTPClient API over a plain TCP WiFiClient. Requests always
+ * go out as HTTP/1.0 with Connection: close, so bodies are never chunked
+ * and run to Content-Length or EOF. https:// URLs connect without TLS.
+ */
+
+#ifndef NATIVE_HTTPCLIENT_H
+#define NATIVE_HTTPCLIENT_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#define HTTP_CODE_OK                200
+#define HTTP_CODE_PARTIAL_CONTENT   206
+#define HTTP_CODE_NOT_MODIFIED      304
+#define HTTP_CODE_TOO_MANY_REQUESTS 429
+
+typedef enum {
+    HTTPC_DISABLE_FOLLOW_REDIRECTS,
+    HTTPC_STRICT_FOLLOW_REDIRECTS,
+    HTTPC_FORCE_FOLLOW_REDIRECTS
+} followRedirects_t;
+
+class HTTPClient {
+public:
+    HTTPClient();
+    ~HTTPClient();
+
+    bool begin(String url);
+    bool begin(WiFiClient& client, String url);
+    void end();
+
+    void setTimeout(uint16_t timeoutMs) { _timeout = timeoutMs; }
+    void setConnectTimeout(int32_t timeoutMs) { _connectTimeout = timeoutMs; }
+    void useHTTP10(bool use) { (void)use; }
+    void setReuse(bool reuse) { (void)reuse; }
+    void setUserAgent(const String& agent) { _userAgent = agent; }
+    void setFollowRedirects(followRedirects_t follow) { _follow = follow; }
+    void addHeader(const String& name, const String& value);
+    void collectHeaders(const char* headerKeys[], const size_t count);
+
+    int GET();
+    int POST(const uint8_t* payload, size_t size);
+    int POST(const String& payload) { return POST((const uint8_t*)payload.c_str(), payload.length()); }
+    int sendRequest(const char* type, const uint8_t* payload = nullptr, size_t size = 0);
+
+    int getSize() const { return _size; }
+    String header(const char* name);
+    bool hasHeader(const char* name);
+    String getLocation() { return header("Location"); }
+    WiFiClient& getStream() { return *_client; }
+    WiFiClient* getStreamPtr() { return _client; }
+    String getString();
+    int writeToStream(Stream* stream);
+
+    static String errorToString(int error);
+
+private:
+    WiFiClient* _client;
+    WiFiClient _ownClient;
+    String _host;
+    uint16_t _port;
+    String _path;
+    uint16_t _timeout;
+    int32_t _connectTimeout;
+    String _userAgent;
+    followRedirects_t _follow;
+    std::vector<std::pair<String, String>> _requestHeaders;
+    std::vector<std::string> _collect;
+    std::map<std::string, String> _responseHeaders;
+    int _size;
+
+    bool parseUrl(const String& url);
+    int readResponseHeaders();
+};
+
+#endif // NATIVE_HTTPCLIENT_H
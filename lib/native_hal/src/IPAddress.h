@@ -0,0 +1,34 @@
+/*
+ * Native HAL: IPAddress
+ */
+
+#ifndef NATIVE_IPADDRESS_H
+#define NATIVE_IPADDRESS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "Print.h"
+
+class IPAddress : public Printable {
+public:
+    IPAddress() : _bytes{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _bytes{a, b, c, d} {}
+
+    uint8_t operator[](int i) const { return _bytes[i]; }
+    uint8_t& operator[](int i) { return _bytes[i]; }
+
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+        return String(buf);
+    }
+
+    size_t printTo(Print& p) const override {
+        return p.print(toString());
+    }
+
+private:
+    uint8_t _bytes[4];
+};
+
+#endif // NATIVE_IPADDRESS_H
@@ -0,0 +1,68 @@
+/*
+ * Native HAL: LittleFS
+ *
+ * Paths map onto a host directory (NATIVE_FS, default .native_fs), so
+ * files survive between runs like the flash partition does. Only the
+ * calls the firmware makes: whole-file and in-place (r+) access.
+ */
+
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include <stdio.h>
+#include "Arduino.h"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File {
+public:
+    File(FILE* f = nullptr) : _f(f) {}
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    File(File&& other) : _f(other._f) { other._f = nullptr; }
+    File& operator=(File&& other) {
+        close();
+        _f = other._f;
+        other._f = nullptr;
+        return *this;
+    }
+    ~File() { close(); }
+
+    operator bool() const { return _f != nullptr; }
+    size_t read(uint8_t* buf, size_t len) { return _f ? fread(buf, 1, len, _f) : 0; }
+    size_t write(const uint8_t* buf, size_t len) { return _f ? fwrite(buf, 1, len, _f) : 0; }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) { return _f && fseek(_f, pos, mode) == 0; }
+    size_t position() const { return _f ? ftell(_f) : 0; }
+    size_t size() const;
+    void flush() { if (_f) fflush(_f); }
+    void close() {
+        if (_f) fclose(_f);
+        _f = nullptr;
+    }
+
+private:
+    FILE* _f;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    void end() {}
+
+    File open(const char* path, const char* mode = "r", bool create = false);
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool mkdir(const char* path);
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::LittleFSFS;
+
+extern LittleFSFS LittleFS;
+
+#endif // NATIVE_LITTLEFS_H
@@ -0,0 +1,29 @@
+/*
+ * Native HAL: MD5Builder
+ *
+ * Same interface as the core's MD5Builder (begin, add, calculate,
+ * then read the digest), over esp_rom_md5 like the real one.
+ */
+
+#ifndef NATIVE_MD5BUILDER_H
+#define NATIVE_MD5BUILDER_H
+
+#include "Arduino.h"
+#include "esp_rom_md5.h"
+
+class MD5Builder {
+public:
+    void begin();
+    void add(const uint8_t* data, size_t len);
+    void add(const char* data) { add((const uint8_t*)data, strlen(data)); }
+    void calculate();
+    void getBytes(uint8_t* output) const { memcpy(output, _digest, 16); }
+    void getChars(char* output) const;  // 33 bytes with the terminator
+    String toString() const;
+
+private:
+    md5_context_t _ctx;
+    uint8_t _digest[ESP_ROM_MD5_DIGEST_LEN];
+};
+
+#endif // NATIVE_MD5BUILDER_H
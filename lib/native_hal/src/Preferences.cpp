@@ -0,0 +1,126 @@
+#include "Preferences.h"
+
+#include <map>
+#include <string>
+
+// All namespaces share one file; loaded on first use
+static std::map<std::string, std::string> store;
+static bool storeLoaded = false;
+
+static const char* storePath() {
+    const char* path = getenv("NATIVE_PREFS");
+    return path ? path : ".native_prefs";
+}
+
+static void loadStore() {
+    if (storeLoaded) return;
+    storeLoaded = true;
+    FILE* f = fopen(storePath(), "r");
+    if (!f) return;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* eq = strchr(line, '=');
+        if (!eq || line[0] == '#') continue;
+        *eq = '\0';
+        store[line] = eq + 1;
+    }
+    fclose(f);
+}
+
+static bool saveStore() {
+    FILE* f = fopen(storePath(), "w");
+    if (!f) return false;
+    for (const auto& kv : store) fprintf(f, "%s=%s\n", kv.first.c_str(), kv.second.c_str());
+    return fclose(f) == 0;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition) {
+    (void)partition;
+    loadStore();
+    _ns = name;
+    _open = true;
+    _readOnly = readOnly;
+    return true;
+}
+
+static std::string fullKey(const String& ns, const char* key) {
+    return std::string(ns.c_str()) + "." + key;
+}
+
+bool Preferences::clear() {
+    if (!_open || _readOnly) return false;
+    std::string prefix = std::string(_ns.c_str()) + ".";
+    for (auto it = store.begin(); it != store.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) it = store.erase(it);
+        else ++it;
+    }
+    return saveStore();
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_open || _readOnly) return false;
+    store.erase(fullKey(_ns, key));
+    return saveStore();
+}
+
+bool Preferences::isKey(const char* key) {
+    return _open && store.count(fullKey(_ns, key)) > 0;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    if (!_open || _readOnly || strchr(value, '\n')) return 0;
+    store[fullKey(_ns, key)] = value;
+    return saveStore() ? strlen(value) : 0;
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    auto it = store.find(fullKey(_ns, key));
+    return (_open && it != store.end()) ? String(it->second) : defaultValue;
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+    auto it = store.find(fullKey(_ns, key));
+    if (!_open || it == store.end() || it->second.size() + 1 > maxLen) return 0;
+    memcpy(value, it->second.c_str(), it->second.size() + 1);
+    return it->second.size() + 1;
+}
+
+bool Preferences::putNumber(const char* key, int64_t value) {
+    if (!_open || _readOnly) return false;
+    store[fullKey(_ns, key)] = std::to_string(value);
+    return saveStore();
+}
+
+int64_t Preferences::getNumber(const char* key, int64_t def) {
+    auto it = store.find(fullKey(_ns, key));
+    return (_open && it != store.end()) ? strtoll(it->second.c_str(), nullptr, 10) : def;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!_open || _readOnly) return 0;
+    static const char hex[] = "0123456789abcdef";
+    std::string s;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = ((const uint8_t*)value)[i];
+        s += hex[b >> 4];
+        s += hex[b & 0xF];
+    }
+    store[fullKey(_ns, key)] = s;
+    return saveStore() ? len : 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    auto it = store.find(fullKey(_ns, key));
+    return (_open && it != store.end()) ? it->second.size() / 2 : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    size_t len = getBytesLength(key);
+    if (len == 0 || len > maxLen) return 0;
+    const std::string& s = store[fullKey(_ns, key)];
+    for (size_t i = 0; i < len; i++) {
+        ((uint8_t*)buf)[i] = (uint8_t)strtoul(s.substr(i * 2, 2).c_str(), nullptr, 16);
+    }
+    return len;
+}
@@ -0,0 +1,59 @@
+/*
+ * Native HAL: Preferences (NVS)
+ *
+ * Values live in a text file of "namespace.key=value" lines (path from
+ * NATIVE_PREFS, default .native_prefs), rewritten on every put. Numbers
+ * are stored in decimal, byte blobs in hex.
+ */
+
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false, const char* partition = nullptr);
+    void end() { _open = false; }
+
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putString(const char* key, const char* value);
+    size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+    String getString(const char* key, const String& defaultValue = String());
+    size_t getString(const char* key, char* value, size_t maxLen);
+
+    size_t putInt(const char* key, int32_t value) { return putNumber(key, value) ? 4 : 0; }
+    size_t putUInt(const char* key, uint32_t value) { return putNumber(key, value) ? 4 : 0; }
+    size_t putLong(const char* key, int32_t value) { return putNumber(key, value) ? 4 : 0; }
+    size_t putULong(const char* key, uint32_t value) { return putNumber(key, value) ? 4 : 0; }
+    size_t putLong64(const char* key, int64_t value) { return putNumber(key, value) ? 8 : 0; }
+    size_t putULong64(const char* key, uint64_t value) { return putNumber(key, (int64_t)value) ? 8 : 0; }
+    size_t putBool(const char* key, bool value) { return putNumber(key, value) ? 1 : 0; }
+    size_t putUChar(const char* key, uint8_t value) { return putNumber(key, value) ? 1 : 0; }
+
+    int32_t getInt(const char* key, int32_t def = 0) { return (int32_t)getNumber(key, def); }
+    uint32_t getUInt(const char* key, uint32_t def = 0) { return (uint32_t)getNumber(key, def); }
+    int32_t getLong(const char* key, int32_t def = 0) { return (int32_t)getNumber(key, def); }
+    uint32_t getULong(const char* key, uint32_t def = 0) { return (uint32_t)getNumber(key, def); }
+    int64_t getLong64(const char* key, int64_t def = 0) { return getNumber(key, def); }
+    uint64_t getULong64(const char* key, uint64_t def = 0) { return (uint64_t)getNumber(key, (int64_t)def); }
+    bool getBool(const char* key, bool def = false) { return getNumber(key, def) != 0; }
+    uint8_t getUChar(const char* key, uint8_t def = 0) { return (uint8_t)getNumber(key, def); }
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t getBytesLength(const char* key);
+
+private:
+    String _ns;
+    bool _open = false;
+    bool _readOnly = false;
+
+    bool putNumber(const char* key, int64_t value);
+    int64_t getNumber(const char* key, int64_t def);
+};
+
+#endif // NATIVE_PREFERENCES_H
@@ -0,0 +1,33 @@
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        if (!write(*buffer++)) break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char stackBuf[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(stackBuf)) return write((const uint8_t*)stackBuf, len);
+
+    char* buf = (char*)malloc(len + 1);
+    if (!buf) return 0;
+    va_start(args, format);
+    vsnprintf(buf, len + 1, format, args);
+    va_end(args);
+    size_t n = write((const uint8_t*)buf, len);
+    free(buf);
+    return n;
+}
@@ -0,0 +1,71 @@
+/*
+ * Native HAL: Print / Printable
+ *
+ * Byte sink with the ESP32 core's print()/println()/printf() overloads.
+ * Subclasses implement write(uint8_t) and optionally the buffer form.
+ */
+
+#ifndef NATIVE_PRINT_H
+#define NATIVE_PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) {
+        return str ? write((const uint8_t*)str, strlen(str)) : 0;
+    }
+    size_t write(const char* buffer, size_t size) {
+        return write((const uint8_t*)buffer, size);
+    }
+    virtual void flush() {}
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t print(const String& s) { return write(s.c_str(), s.length()); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(int v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(unsigned long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(long long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(unsigned long long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(double v, int digits = 2) { return print(String(v, (unsigned int)digits)); }
+    size_t print(const Printable& p) { return p.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& v) {
+        size_t n = print(v);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T& v, int format) {
+        size_t n = print(v, format);
+        return n + println();
+    }
+};
+
+#endif // NATIVE_PRINT_H
@@ -0,0 +1,80 @@
+#include "Stream.h"
+#include "Arduino.h"
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        delay(1);
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+int Stream::timedPeek() {
+    unsigned long start = millis();
+    do {
+        int c = peek();
+        if (c >= 0) return c;
+        delay(1);
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+// Advance the match index for one input byte, falling back to a fresh
+// match when the run breaks (targets here never repeat their prefix)
+static size_t matchStep(const char* s, size_t len, size_t index, char c) {
+    if (!s || len == 0) return 0;
+    if (s[index] == c) return index + 1;
+    return (s[0] == c) ? 1 : 0;
+}
+
+bool Stream::findUntil(const char* target, size_t targetLen, const char* terminator, size_t termLen) {
+    if (targetLen == 0) return true;
+    size_t targetIndex = 0;
+    size_t termIndex = 0;
+    int c;
+    while ((c = timedRead()) >= 0) {
+        targetIndex = matchStep(target, targetLen, targetIndex, (char)c);
+        if (targetIndex == targetLen) return true;
+        termIndex = matchStep(terminator, termLen, termIndex, (char)c);
+        if (termLen > 0 && termIndex == termLen) return false;
+    }
+    return false;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0 || c == terminator) break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String s;
+    int c;
+    while ((c = timedRead()) >= 0) s += (char)c;
+    return s;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String s;
+    int c;
+    while ((c = timedRead()) >= 0 && c != terminator) s += (char)c;
+    return s;
+}
@@ -0,0 +1,49 @@
+/*
+ * Native HAL: Stream
+ *
+ * Readable Print with the core's timed helpers (readBytes, find,
+ * findUntil, readBytesUntil). read() is non-blocking; the helpers poll it
+ * until the stream timeout (milliseconds) runs out.
+ */
+
+#ifndef NATIVE_STREAM_H
+#define NATIVE_STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+    Stream() : _timeout(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    bool find(const char* target) { return findUntil(target, nullptr); }
+    bool find(const char* target, size_t length) { return findUntil(target, length, nullptr, 0); }
+    bool findUntil(const char* target, const char* terminator) {
+        return findUntil(target, strlen(target), terminator, terminator ? strlen(terminator) : 0);
+    }
+    bool findUntil(const char* target, size_t targetLen, const char* terminator, size_t termLen);
+
+    virtual size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    size_t readBytesUntil(char terminator, char* buffer, size_t length);
+    size_t readBytesUntil(char terminator, uint8_t* buffer, size_t length) {
+        return readBytesUntil(terminator, (char*)buffer, length);
+    }
+
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long _timeout;
+
+    int timedRead();
+    int timedPeek();
+};
+
+#endif // NATIVE_STREAM_H
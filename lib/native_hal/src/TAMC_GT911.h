@@ -0,0 +1,41 @@
+/*
+ * Native HAL: TAMC_GT911 touch controller
+ *
+ * Reports a press injected with nativeTouch(rawX, rawY, ms) until it
+ * expires. Coordinates are raw panel values, as the firmware maps them.
+ */
+
+#ifndef NATIVE_TAMC_GT911_H
+#define NATIVE_TAMC_GT911_H
+
+#include "Arduino.h"
+
+#define ROTATION_LEFT      0
+#define ROTATION_INVERTED  1
+#define ROTATION_RIGHT     2
+#define ROTATION_NORMAL    3
+
+class TP_Point {
+public:
+    uint8_t id = 0;
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint8_t size = 0;
+};
+
+class TAMC_GT911 {
+public:
+    TAMC_GT911(uint8_t sda, uint8_t scl, uint8_t intPin, uint8_t rstPin, uint16_t width, uint16_t height) {
+        (void)sda; (void)scl; (void)intPin; (void)rstPin; (void)width; (void)height;
+    }
+
+    void begin(uint8_t address = 0x5D) { (void)address; }
+    void setRotation(uint8_t rotation) { (void)rotation; }
+    void read();
+
+    bool isTouched = false;
+    uint8_t touches = 0;
+    TP_Point points[5];
+};
+
+#endif // NATIVE_TAMC_GT911_H
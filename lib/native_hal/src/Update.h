@@ -0,0 +1,62 @@
+/*
+ * Native HAL: Update (OTA flash writer)
+ *
+ * Accepts the image and checks its length (and MD5, if one was set);
+ * with NATIVE_UPDATE_FILE set the bytes are also written there so they
+ * can be compared.
+ */
+
+#ifndef NATIVE_UPDATE_H
+#define NATIVE_UPDATE_H
+
+#include "Arduino.h"
+#include "MD5Builder.h"
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+#define UPDATE_ERROR_OK        0
+#define UPDATE_ERROR_WRITE     1
+#define UPDATE_ERROR_SIZE      4
+#define UPDATE_ERROR_STREAM    5
+#define UPDATE_ERROR_MD5       6
+#define UPDATE_ERROR_ABORT     8
+#define UPDATE_ERROR_BAD_ARGUMENT 9
+
+class UpdateClass {
+public:
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1,
+               uint8_t ledOn = LOW, const char* label = nullptr);
+    size_t write(uint8_t* data, size_t len);
+    size_t writeStream(Stream& data);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+    bool setMD5(const char* expectedMd5);  // 32 hex digits, checked by end()
+
+    bool isRunning() const { return _running; }
+    bool isFinished() const { return _finished; }
+    bool hasError() const { return _error != UPDATE_ERROR_OK; }
+    uint8_t getError() const { return _error; }
+    void clearError() { _error = UPDATE_ERROR_OK; }
+    const char* errorString() const;
+    void printError(Print& out) { out.println(errorString()); }
+
+    size_t size() const { return _size; }
+    size_t progress() const { return _progress; }
+    size_t remaining() const { return _size - _progress; }
+
+private:
+    size_t _size = 0;
+    size_t _progress = 0;
+    bool _running = false;
+    bool _finished = false;
+    uint8_t _error = UPDATE_ERROR_OK;
+    FILE* _file = nullptr;
+    char _expectedMd5[33] = {0};
+    MD5Builder _md5;
+};
+
+extern UpdateClass Update;
+
+#endif // NATIVE_UPDATE_H
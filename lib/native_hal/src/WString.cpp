@@ -0,0 +1,122 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char buf[72];
+    int i = sizeof(buf) - 1;
+    buf[i] = '\0';
+    do {
+        int digit = value % base;
+        buf[--i] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value > 0);
+    if (negative) buf[--i] = '-';
+    return std::string(buf + i);
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+    // Like the core, only base 10 prints a sign
+    if (base == 10 && value < 0) return formatInteger(0ULL - (unsigned long long)value, true, base);
+    return formatInteger((unsigned long long)value, false, base);
+}
+
+static std::string formatFloat(double value, unsigned int decimalPlaces) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    return std::string(buf);
+}
+
+String::String(unsigned char value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _s(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _s(formatFloat(value, decimalPlaces)) {}
+
+void String::getBytes(unsigned char* buf, unsigned int size, unsigned int index) const {
+    if (!buf || size == 0) return;
+    if (index >= _s.size()) {
+        buf[0] = 0;
+        return;
+    }
+    size_t n = _s.size() - index;
+    if (n > size - 1) n = size - 1;
+    memcpy(buf, _s.data() + index, n);
+    buf[n] = 0;
+}
+
+bool String::equalsIgnoreCase(const String& s) const {
+    return _s.size() == s._s.size() && strcasecmp(_s.c_str(), s._s.c_str()) == 0;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+    return offset + prefix._s.size() <= _s.size() &&
+           _s.compare(offset, prefix._s.size(), prefix._s) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    return suffix._s.size() <= _s.size() &&
+           _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int t = from;
+        from = to;
+        to = t;
+    }
+    if (from >= _s.size()) return String();
+    if (to > _s.size()) to = _s.size();
+    return String(_s.substr(from, to - from));
+}
+
+void String::replace(char find, char replace) {
+    for (char& c : _s) {
+        if (c == find) c = replace;
+    }
+}
+
+void String::replace(const String& find, const String& replace) {
+    if (find._s.empty()) return;
+    size_t pos = 0;
+    while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+        _s.replace(pos, find._s.size(), replace._s);
+        pos += replace._s.size();
+    }
+}
+
+void String::toLowerCase() {
+    for (char& c : _s) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+    for (char& c : _s) c = (char)toupper((unsigned char)c);
+}
+
+void String::trim() {
+    size_t start = 0;
+    while (start < _s.size() && isspace((unsigned char)_s[start])) start++;
+    size_t end = _s.size();
+    while (end > start && isspace((unsigned char)_s[end - 1])) end--;
+    _s = _s.substr(start, end - start);
+}
+
+long String::toInt() const {
+    return atol(_s.c_str());
+}
+
+float String::toFloat() const {
+    return (float)atof(_s.c_str());
+}
+
+double String::toDouble() const {
+    return atof(_s.c_str());
+}
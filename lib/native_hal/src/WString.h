@@ -0,0 +1,166 @@
+/*
+ * Native HAL: Arduino String
+ *
+ * Same interface as the ESP32 core's String (the parts this firmware and
+ * ArduinoJson use), stored in a std::string.
+ */
+
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <stddef.h>
+#include <string>
+
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const char* s, unsigned int len) : _s(s, len) {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String& operator=(const char* s) {
+        _s = s ? s : "";
+        return *this;
+    }
+
+    // ---------- Concatenation ----------
+
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool concat(const char* s) { if (s) _s += s; return s != nullptr; }
+    bool concat(const char* s, unsigned int len) { if (s) _s.append(s, len); return s != nullptr; }
+    bool concat(char c) { _s += c; return true; }
+    bool concat(unsigned char v) { return concat(String(v)); }
+    bool concat(int v) { return concat(String(v)); }
+    bool concat(unsigned int v) { return concat(String(v)); }
+    bool concat(long v) { return concat(String(v)); }
+    bool concat(unsigned long v) { return concat(String(v)); }
+    bool concat(long long v) { return concat(String(v)); }
+    bool concat(unsigned long long v) { return concat(String(v)); }
+    bool concat(float v) { return concat(String(v)); }
+    bool concat(double v) { return concat(String(v)); }
+
+    template <typename T>
+    String& operator+=(const T& v) {
+        concat(v);
+        return *this;
+    }
+
+    // ---------- Access ----------
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.length(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+
+    char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    void setCharAt(unsigned int i, char c) { if (i < _s.size()) _s[i] = c; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char& operator[](unsigned int i) { return _s[i]; }
+
+    void getBytes(unsigned char* buf, unsigned int size, unsigned int index = 0) const;
+    void toCharArray(char* buf, unsigned int size, unsigned int index = 0) const {
+        getBytes((unsigned char*)buf, size, index);
+    }
+
+    // ---------- Comparison ----------
+
+    int compareTo(const String& s) const { return _s.compare(s._s); }
+    bool equals(const String& s) const { return _s == s._s; }
+    bool equals(const char* s) const { return _s == (s ? s : ""); }
+    bool equalsIgnoreCase(const String& s) const;
+    bool startsWith(const String& prefix, unsigned int offset = 0) const;
+    bool endsWith(const String& suffix) const;
+
+    bool operator==(const String& s) const { return equals(s); }
+    bool operator==(const char* s) const { return equals(s); }
+    bool operator!=(const String& s) const { return !equals(s); }
+    bool operator!=(const char* s) const { return !equals(s); }
+    bool operator<(const String& s) const { return compareTo(s) < 0; }
+    bool operator>(const String& s) const { return compareTo(s) > 0; }
+
+    // ---------- Search ----------
+
+    int indexOf(char c, unsigned int from = 0) const { return find(_s.find(c, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return find(_s.find(s._s, from)); }
+    int lastIndexOf(char c) const { return find(_s.rfind(c)); }
+    int lastIndexOf(const String& s) const { return find(_s.rfind(s._s)); }
+    String substring(unsigned int from) const { return substring(from, length()); }
+    String substring(unsigned int from, unsigned int to) const;
+
+    // ---------- Modification ----------
+
+    void replace(char find, char replace);
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index) { if (index < _s.size()) _s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < _s.size()) _s.erase(index, count); }
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    // ---------- Conversion ----------
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    std::string _s;
+
+    static int find(size_t pos) {
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+};
+
+// Result type of operator+, as in the Arduino core (ArduinoJson adapts both)
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* s) : String(s) {}
+};
+
+inline StringSumHelper operator+(const String& a, const String& b) {
+    StringSumHelper r(a);
+    r.concat(b);
+    return r;
+}
+
+inline StringSumHelper operator+(const String& a, const char* b) {
+    StringSumHelper r(a);
+    r.concat(b);
+    return r;
+}
+
+inline StringSumHelper operator+(const char* a, const String& b) {
+    StringSumHelper r(a);
+    r.concat(b);
+    return r;
+}
+
+inline StringSumHelper operator+(const String& a, char b) {
+    StringSumHelper r(a);
+    r.concat(b);
+    return r;
+}
+
+template <typename T>
+inline StringSumHelper operator+(const String& a, T b) {
+    StringSumHelper r(a);
+    r.concat(b);
+    return r;
+}
+
+inline bool operator==(const char* a, const String& b) {
+    return b.equals(a);
+}
+
+#endif // NATIVE_WSTRING_H
@@ -0,0 +1,79 @@
+/*
+ * Native HAL: WebServer
+ *
+ * Small blocking-per-request HTTP server on localhost so handlers can be
+ * exercised with curl. Device port N listens on N + NATIVE_PORT_OFFSET
+ * (environment, default 8000), so port 80 becomes 8080.
+ */
+
+#ifndef NATIVE_WEBSERVER_H
+#define NATIVE_WEBSERVER_H
+
+#include <functional>
+#include <vector>
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+typedef enum { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS } HTTPMethod;
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit WebServer(int port = 80);
+    ~WebServer();
+
+    void begin();
+    void stop();
+    void handleClient();
+
+    void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler) { _notFound = handler; }
+
+    String uri() const { return _uri; }
+    HTTPMethod method() const { return _method; }
+    String arg(const String& name) const;
+    bool hasArg(const String& name) const;
+    int args() const { return (int)_args.size(); }
+
+    // Request headers to keep (others are skipped), read with header()
+    void collectHeaders(const char* headerKeys[], const size_t count);
+    String header(const String& name) const;
+    bool hasHeader(const String& name) const;
+
+    void setContentLength(size_t len) { _contentLength = len; }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void send(int code, const char* contentType = nullptr, const String& content = String());
+    void send(int code, const String& contentType, const String& content) {
+        send(code, contentType.c_str(), content);
+    }
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t size);
+    WiFiClient& client() { return _client; }
+
+private:
+    struct Route {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+    };
+
+    int _port;
+    int _listenFd;
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+    WiFiClient _client;
+    String _uri;
+    HTTPMethod _method;
+    std::vector<std::pair<String, String>> _args;
+    std::vector<std::pair<String, String>> _headers;
+    String _extraHeaders;
+    size_t _contentLength;
+
+    void parseArgs(const String& query);
+};
+
+#endif // NATIVE_WEBSERVER_H
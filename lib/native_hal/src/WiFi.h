@@ -0,0 +1,69 @@
+/*
+ * Native HAL: WiFi
+ *
+ * The station connects instantly to whatever SSID it is given and
+ * reports a steady signal; traffic goes through the host's network.
+ */
+
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include "esp_wifi.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t m) { _mode = m; return true; }
+    wifi_mode_t getMode() const { return _mode; }
+
+    wl_status_t begin(const char* ssid, const char* pass = nullptr) {
+        (void)pass;
+        _ssid = ssid ? ssid : "";
+        _status = WL_CONNECTED;
+        return _status;
+    }
+    bool disconnect(bool wifiOff = false) {
+        (void)wifiOff;
+        _status = WL_DISCONNECTED;
+        return true;
+    }
+    wl_status_t status() const { return _status; }
+    bool isConnected() const { return _status == WL_CONNECTED; }
+    bool setSleep(bool enable) { (void)enable; return true; }
+    bool setAutoReconnect(bool enable) { (void)enable; return true; }
+    bool setHostname(const char* name) { (void)name; return true; }
+
+    int8_t RSSI() const { return -55; }
+    String SSID() const { return _ssid; }
+    IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+    String macAddress() const { return String("02:00:00:00:00:01"); }
+
+    int16_t scanNetworks() { return 1; }
+    String SSID(uint8_t i) const { return i == 0 ? String("native") : String(); }
+
+    bool softAP(const char* ssid, const char* pass = nullptr) { (void)ssid; (void)pass; return true; }
+    IPAddress softAPIP() const { return IPAddress(192, 168, 4, 1); }
+    bool softAPdisconnect(bool wifiOff = false) { (void)wifiOff; return true; }
+
+private:
+    wifi_mode_t _mode = WIFI_OFF;
+    wl_status_t _status = WL_DISCONNECTED;
+    String _ssid;
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
@@ -0,0 +1,283 @@
+#include "WiFiClient.h"
+#include "native_replay.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define NATIVE_RX_BUFFER 2048
+
+#define NATIVE_REQUEST_LINE 200
+
+struct WiFiClient::Socket {
+    int fd = -1;
+    uint8_t rx[NATIVE_RX_BUFFER];
+    size_t rxPos = 0;
+    size_t rxLen = 0;
+    bool eof = false;
+
+    // Recording and replay
+    int logId = -1;             // Recorded connection, or bound replay connection
+    bool replay = false;        // No socket, bytes come from the log
+    bool newRequest = true;     // Next write starts a request
+    bool lineDone = false;
+    String host;
+    uint16_t port = 0;
+    char line[NATIVE_REQUEST_LINE + 1];
+    size_t lineLen = 0;
+
+    ~Socket() {
+        if (fd >= 0) close(fd);
+    }
+};
+
+WiFiClient::WiFiClient() {}
+
+int WiFiClient::fd() const {
+    return _sock ? _sock->fd : -1;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, 3000);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+
+    if (nativeInputMode() == NATIVE_INPUT_REPLAY) {
+        if (!nativeReplayCanConnect(host, port)) return 0;
+        _sock = std::make_shared<Socket>();
+        _sock->replay = true;
+        _sock->host = host;
+        _sock->port = port;
+        return 1;
+    }
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%u", port);
+    if (getaddrinfo(host, portStr, &hints, &res) != 0 || !res) return 0;
+
+    int fd = socket(res->ai_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        freeaddrinfo(res);
+        return 0;
+    }
+
+    // Non-blocking connect so the timeout applies
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int rc = ::connect(fd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc < 0 && errno == EINPROGRESS) {
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (poll(&pfd, 1, timeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+            rc = 0;
+        }
+    }
+    if (rc < 0) {
+        close(fd);
+        nativeRecordConnect(host, port, false);
+        return 0;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    _sock = std::make_shared<Socket>();
+    _sock->fd = fd;
+    if (nativeInputMode() == NATIVE_INPUT_RECORD) _sock->logId = nativeRecordConnect(host, port, true);
+    return 1;
+}
+
+void WiFiClient::attachSocket(int fd) {
+    stop();
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    _sock = std::make_shared<Socket>();
+    _sock->fd = fd;
+}
+
+size_t WiFiClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+// Requests are told apart by direction: a write after a read starts one.
+// Its first line identifies it in the log.
+void WiFiClient::noteRequest(const uint8_t* buf, size_t size) {
+    Socket& s = *_sock;
+    if (s.newRequest) {
+        s.newRequest = false;
+        s.lineDone = false;
+        s.lineLen = 0;
+    }
+    for (size_t i = 0; i < size && !s.lineDone; i++) {
+        char c = (char)buf[i];
+        if (c == '\r' || c == '\n' || s.lineLen == NATIVE_REQUEST_LINE) {
+            s.lineDone = true;
+        } else {
+            s.line[s.lineLen++] = c;
+        }
+    }
+    if (!s.lineDone) return;
+    s.line[s.lineLen] = '\0';
+    s.lineLen = 0;  // Logged once
+
+    if (!s.replay) {
+        nativeRecordRequest(s.logId, s.line);
+    } else if (s.logId < 0) {
+        s.logId = nativeReplayBind(s.host.c_str(), s.port, s.line);
+        if (s.logId < 0) s.eof = true;
+    } else {
+        nativeReplayRequest(s.logId, s.line);
+    }
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+    if (!_sock) return 0;
+    if ((_sock->logId >= 0 || _sock->replay) && (_sock->newRequest || _sock->lineLen > 0)) {
+        noteRequest(buf, size);
+    }
+    if (_sock->replay) return size;
+    if (_sock->fd < 0) return 0;
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(_sock->fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd pfd = {_sock->fd, POLLOUT, 0};
+            if (poll(&pfd, 1, (int)_timeout) <= 0) break;
+        } else {
+            break;
+        }
+    }
+    return sent;
+}
+
+// Refill the receive buffer if it is empty. Returns true if data is buffered.
+bool WiFiClient::fill(bool wait) {
+    if (!_sock) return false;
+    if (_sock->rxPos < _sock->rxLen) return true;
+    if (_sock->eof) return false;
+
+    if (_sock->replay) {
+        if (_sock->logId < 0) return false;
+        unsigned long start = millis();
+        while (true) {
+            bool eof;
+            unsigned long nextMs;
+            size_t n = nativeReplayRecv(_sock->logId, _sock->rx, sizeof(_sock->rx), eof, nextMs);
+            if (n > 0) {
+                _sock->rxPos = 0;
+                _sock->rxLen = n;
+                _sock->newRequest = true;
+                return true;
+            }
+            if (eof) _sock->eof = true;
+            if (eof || !wait) return false;
+
+            // Jump the virtual clock to the next arrival, within the timeout
+            unsigned long now = millis();
+            unsigned long deadline = start + _timeout;
+            if (nextMs == 0 || nextMs > deadline) {
+                if (deadline > now) delay(deadline - now);
+                return false;
+            }
+            if (nextMs > now) delay(nextMs - now);
+        }
+    }
+
+    if (_sock->fd < 0) return false;
+
+    if (wait) {
+        struct pollfd pfd = {_sock->fd, POLLIN, 0};
+        if (poll(&pfd, 1, (int)_timeout) <= 0) return false;
+    }
+    ssize_t n = recv(_sock->fd, _sock->rx, sizeof(_sock->rx), 0);
+    if (n > 0) {
+        _sock->rxPos = 0;
+        _sock->rxLen = n;
+        if (_sock->logId >= 0) {
+            nativeRecordRecv(_sock->logId, _sock->rx, n);
+            _sock->newRequest = true;
+        }
+        return true;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        _sock->eof = true;
+        if (_sock->logId >= 0) nativeRecordClose(_sock->logId);
+    }
+    return false;
+}
+
+int WiFiClient::available() {
+    if (!fill(false)) return 0;
+    return (int)(_sock->rxLen - _sock->rxPos);
+}
+
+int WiFiClient::read() {
+    if (!fill(false)) return -1;
+    return _sock->rx[_sock->rxPos++];
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+    if (!fill(false)) return -1;
+    size_t n = min(size, _sock->rxLen - _sock->rxPos);
+    memcpy(buf, _sock->rx + _sock->rxPos, n);
+    _sock->rxPos += n;
+    return (int)n;
+}
+
+// Blocks on the socket instead of polling read() like Stream does
+size_t WiFiClient::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && fill(true)) {
+        size_t n = min(length - count, _sock->rxLen - _sock->rxPos);
+        memcpy(buffer + count, _sock->rx + _sock->rxPos, n);
+        _sock->rxPos += n;
+        count += n;
+    }
+    return count;
+}
+
+int WiFiClient::peek() {
+    if (!fill(false)) return -1;
+    return _sock->rx[_sock->rxPos];
+}
+
+void WiFiClient::stop() {
+    _sock.reset();
+}
+
+uint8_t WiFiClient::connected() {
+    if (!_sock || (_sock->fd < 0 && !_sock->replay)) return 0;
+    if (_sock->rxPos < _sock->rxLen) return 1;
+    fill(false);
+    return !_sock->eof || _sock->rxPos < _sock->rxLen;
+}
+
+int WiFiClient::setTimeout(uint32_t seconds) {
+    Stream::setTimeout(seconds * 1000);
+    return 0;
+}
+
+int WiFiClient::setNoDelay(bool nodelay) {
+    if (!_sock || _sock->replay) return 0;
+    if (_sock->fd < 0) return -1;
+    int flag = nodelay ? 1 : 0;
+    return setsockopt(_sock->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
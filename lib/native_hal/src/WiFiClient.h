@@ -0,0 +1,68 @@
+/*
+ * Native HAL: WiFiClient
+ *
+ * Plain TCP socket with the ESP32 client API. Copies share the same
+ * connection, as on the device. setTimeout() takes seconds, like the
+ * ESP32 core's WiFiClient (Stream::setTimeout is milliseconds).
+ *
+ * Outgoing connections take part in input recording and replay (see
+ * native_replay.h); sockets accepted by WebServer do not.
+ */
+
+#ifndef NATIVE_WIFICLIENT_H
+#define NATIVE_WIFICLIENT_H
+
+#include <memory>
+#include "Arduino.h"
+
+class Client : public Stream {
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    using Stream::read;
+};
+
+class WiFiClient : public Client {
+public:
+    WiFiClient();
+    virtual ~WiFiClient() {}
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeoutMs);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    using Stream::readBytes;
+    void flush() override {}
+
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() { return connected(); }
+
+    int setTimeout(uint32_t seconds);
+    int setNoDelay(bool nodelay);
+    int fd() const;
+
+    // Native only: take over an accepted socket (used by WebServer)
+    void attachSocket(int fd);
+
+protected:
+    struct Socket;
+    std::shared_ptr<Socket> _sock;
+
+    bool fill(bool wait);
+    void noteRequest(const uint8_t* buf, size_t size);
+};
+
+#endif // NATIVE_WIFICLIENT_H
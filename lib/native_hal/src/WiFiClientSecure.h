@@ -0,0 +1,22 @@
+/*
+ * Native HAL: WiFiClientSecure
+ *
+ * No TLS off-device: this is the plain TCP client with the secure
+ * client's setup calls accepted and ignored. Run the mock services
+ * without --cert for native builds.
+ */
+
+#ifndef NATIVE_WIFICLIENTSECURE_H
+#define NATIVE_WIFICLIENTSECURE_H
+
+#include "WiFiClient.h"
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setInsecure() {}
+    void setCACert(const char* rootCA) { (void)rootCA; }
+    void setCACertBundle(const uint8_t* bundle) { (void)bundle; }
+    void setHandshakeTimeout(unsigned long seconds) { (void)seconds; }
+};
+
+#endif // NATIVE_WIFICLIENTSECURE_H
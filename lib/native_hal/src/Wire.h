@@ -0,0 +1,32 @@
+/*
+ * Native HAL: Wire (I2C)
+ *
+ * No bus; transactions succeed and reads return nothing.
+ */
+
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire : public Stream {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+        (void)sda; (void)scl; (void)frequency;
+        return true;
+    }
+    bool setClock(uint32_t frequency) { (void)frequency; return true; }
+    void beginTransmission(uint8_t address) { (void)address; }
+    uint8_t endTransmission(bool sendStop = true) { (void)sendStop; return 0; }
+    uint8_t requestFrom(uint8_t address, uint8_t quantity) { (void)address; (void)quantity; return 0; }
+
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_WIRE_H
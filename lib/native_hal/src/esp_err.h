@@ -0,0 +1,15 @@
+/*
+ * Native HAL: esp_err
+ */
+
+#ifndef NATIVE_ESP_ERR_H
+#define NATIVE_ESP_ERR_H
+
+typedef int esp_err_t;
+#define ESP_OK                 0
+#define ESP_FAIL               -1
+#define ESP_ERR_INVALID_ARG    0x102
+#define ESP_ERR_INVALID_SIZE   0x104
+#define ESP_ERR_NOT_FOUND      0x105
+
+#endif // NATIVE_ESP_ERR_H
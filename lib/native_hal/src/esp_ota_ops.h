@@ -0,0 +1,17 @@
+/*
+ * Native HAL: esp_ota_ops (partition lookup and the boot selection)
+ */
+
+#ifndef NATIVE_ESP_OTA_OPS_H
+#define NATIVE_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+#define ESP_ERR_OTA_VALIDATE_FAILED 0x1503
+
+const esp_partition_t* esp_ota_get_running_partition();
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* startFrom);
+// Fails unless the partition starts with an app image header
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition);
+
+#endif // NATIVE_ESP_OTA_OPS_H
@@ -0,0 +1,31 @@
+/*
+ * Native HAL: esp_partition
+ *
+ * Two app partitions: the running one, whose contents are the file
+ * named by NATIVE_RUNNING_IMAGE (empty if unset), standing in for the
+ * firmware the device booted; and the next OTA slot, kept in the file
+ * named by NATIVE_UPDATE_FILE so it survives restarts like flash does.
+ * Writes can only clear bits, as on NOR flash, so writing over data
+ * that was not erased first shows up as corruption.
+ */
+
+#ifndef NATIVE_ESP_PARTITION_H
+#define NATIVE_ESP_PARTITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct {
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t srcOffset, void* dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dstOffset, const void* src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
+
+#endif // NATIVE_ESP_PARTITION_H
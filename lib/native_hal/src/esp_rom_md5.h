@@ -0,0 +1,25 @@
+/*
+ * Native HAL: esp_rom_md5 (the ROM's MD5, as the core's MD5Builder uses)
+ *
+ * The context is a plain struct, so it can be copied or saved and the
+ * hash continued later. Implemented in native_md5.cpp.
+ */
+
+#ifndef NATIVE_ESP_ROM_MD5_H
+#define NATIVE_ESP_ROM_MD5_H
+
+#include <stdint.h>
+
+#define ESP_ROM_MD5_DIGEST_LEN 16
+
+typedef struct MD5Context {
+    uint32_t buf[4];
+    uint32_t bits[2];
+    uint8_t in[64];
+} md5_context_t;
+
+void esp_rom_md5_init(md5_context_t* context);
+void esp_rom_md5_update(md5_context_t* context, const void* buf, uint32_t len);
+void esp_rom_md5_final(uint8_t* digest, md5_context_t* context);
+
+#endif // NATIVE_ESP_ROM_MD5_H
@@ -0,0 +1,34 @@
+/*
+ * Native HAL: esp_wifi
+ */
+
+#ifndef NATIVE_ESP_WIFI_H
+#define NATIVE_ESP_WIFI_H
+
+#include <stdint.h>
+#include <string.h>
+#include "esp_err.h"
+
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t ssid[33];
+    uint8_t primary;
+    int8_t rssi;
+} wifi_ap_record_t;
+
+inline esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* ap) {
+    memset(ap, 0, sizeof(*ap));
+    strcpy((char*)ap->ssid, "native");
+    ap->primary = 6;
+    ap->rssi = -55;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    (void)type;
+    return ESP_OK;
+}
+
+#endif // NATIVE_ESP_WIFI_H
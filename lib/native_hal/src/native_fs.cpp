@@ -0,0 +1,47 @@
+#include "LittleFS.h"
+
+#include <string>
+#include <sys/stat.h>
+
+LittleFSFS LittleFS;
+
+static std::string hostPath(const char* path) {
+    const char* root = getenv("NATIVE_FS");
+    return std::string(root ? root : ".native_fs") + path;
+}
+
+size_t fs::File::size() const {
+    if (!_f) return 0;
+    struct stat st;
+    fflush(_f);
+    return fstat(fileno(_f), &st) == 0 ? st.st_size : 0;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail; (void)basePath; (void)maxOpenFiles; (void)partitionLabel;
+    std::string root = hostPath("");
+    ::mkdir(root.c_str(), 0755);
+    struct stat st;
+    return stat(root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+File LittleFSFS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    // Binary and in-place, as on flash
+    std::string m = mode;
+    if (m.find('b') == std::string::npos) m += "b";
+    return File(fopen(hostPath(path).c_str(), m.c_str()));
+}
+
+bool LittleFSFS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool LittleFSFS::remove(const char* path) {
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
@@ -0,0 +1,32 @@
+/*
+ * Native HAL: host-only hooks
+ *
+ * Inputs the real board would sample from hardware, plus access to the
+ * framebuffer and run control. Only available in [env:native]; guard
+ * uses in firmware code with #ifdef NATIVE_BUILD.
+ */
+
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <stdint.h>
+
+// ---------- Inputs ----------
+
+void nativeSetAnalog(uint8_t pin, uint16_t value);      // analogRead()
+void nativeSetAdc(uint8_t channel, int16_t value);      // ADS1115 readADC_*
+void nativeTouch(int rawX, int rawY, unsigned long ms); // GT911 press for 'ms'
+
+// ---------- Display ----------
+
+uint16_t* nativeFramebuffer();    // 800x480 RGB565, row-major
+int nativeFramebufferWidth();
+int nativeFramebufferHeight();
+bool nativeWriteFramebuffer(const char* ppmPath);
+
+// ---------- Run control ----------
+
+void nativeStop();                // Leave the loop() after this iteration
+unsigned long nativeLoopCount();
+
+#endif // NATIVE_HAL_H
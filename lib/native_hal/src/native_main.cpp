@@ -0,0 +1,305 @@
+/*
+ * Native HAL: core runtime
+ *
+ * main() runs setup() then loop() until NATIVE_RUN_MS expires, the
+ * replay log runs out, or the process gets SIGINT/SIGTERM, then writes
+ * NATIVE_FRAME_DUMP if set.
+ *
+ * NATIVE_TRACE=<file> logs "<millis> <host us>" for every loop() that
+ * took at least NATIVE_TRACE_MIN_US (default 200) of host time, and a
+ * histogram of loop() costs is printed on exit. Time spent in delay()
+ * is not part of the cost (live runs sleep there; replays don't).
+ */
+
+#include "Arduino.h"
+#include "native_hal.h"
+#include "native_replay.h"
+
+#include <malloc.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+EspClass ESP;
+HardwareSerial Serial;
+
+static const auto startTime = std::chrono::steady_clock::now();
+static volatile sig_atomic_t stopRequested = 0;
+static unsigned long loopCount = 0;
+static time_t fakeEpoch = 0;
+static uint64_t sleptUs = 0;  // Time spent in delay(), left out of loop() cost
+static uint16_t analogValues[64];
+
+// ============================================================
+// TIMING
+// ============================================================
+
+unsigned long millis() {
+    if (nativeInputMode() == NATIVE_INPUT_REPLAY) return (unsigned long)(nativeVirtualMicros() / 1000);
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros() {
+    if (nativeInputMode() == NATIVE_INPUT_REPLAY) return (unsigned long)nativeVirtualMicros();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Under replay, waiting only moves the virtual clock
+void delay(uint32_t ms) {
+    sleptUs += (uint64_t)ms * 1000;
+    if (nativeInputMode() == NATIVE_INPUT_REPLAY) return nativeVirtualAdvance((uint64_t)ms * 1000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    sleptUs += us;
+    if (nativeInputMode() == NATIVE_INPUT_REPLAY) return nativeVirtualAdvance(us);
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+// time() is linked with --wrap=time so NATIVE_EPOCH can pin the clock
+extern "C" time_t __real_time(time_t* t);
+
+extern "C" time_t __wrap_time(time_t* t) {
+    time_t now = fakeEpoch ? fakeEpoch + (time_t)(millis() / 1000) : __real_time(nullptr);
+    if (t) *t = now;
+    return now;
+}
+
+// Same TZ string the ESP32 core builds (POSIX offsets are west-positive)
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2, const char* server3) {
+    (void)server1;
+    (void)server2;
+    (void)server3;
+    long offset = -gmtOffsetSec;
+    char tz[40];
+    int n;
+    if (offset % 3600) {
+        n = snprintf(tz, sizeof(tz), "UTC%ld:%02u:%02u", offset / 3600,
+                     (unsigned)labs((offset % 3600) / 60), (unsigned)labs(offset % 60));
+    } else {
+        n = snprintf(tz, sizeof(tz), "UTC%ld", offset / 3600);
+    }
+    if (daylightOffsetSec != 3600) {
+        long dst = offset - daylightOffsetSec;
+        snprintf(tz + n, sizeof(tz) - n, "DST%ld:%02u:%02u", dst / 3600,
+                 (unsigned)labs((dst % 3600) / 60), (unsigned)labs(dst % 60));
+    } else if (daylightOffsetSec) {
+        snprintf(tz + n, sizeof(tz) - n, "DST");
+    }
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    (void)ms;
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return info->tm_year > (2016 - 1900);
+}
+
+// ============================================================
+// GPIO & MATH
+// ============================================================
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return HIGH; }
+void analogReadResolution(uint8_t) {}
+void attachInterrupt(uint8_t, void (*)(void), int) {}
+void attachInterruptArg(uint8_t, void (*)(void*), void*, int) {}
+void detachInterrupt(uint8_t) {}
+
+uint16_t analogRead(uint8_t pin) {
+    uint16_t value = pin < 64 ? analogValues[pin] : 0;
+    if (nativeInputMode() == NATIVE_INPUT_REPLAY) nativeReplayAnalog(pin, value);
+    else nativeRecordAnalog(pin, value);
+    return value;
+}
+
+void nativeSetAnalog(uint8_t pin, uint16_t value) {
+    if (pin < 64) analogValues[pin] = value;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    if (inMax == inMin) return outMin;
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+long random(long max) {
+    return max > 0 ? ::random() % max : 0;
+}
+
+long random(long min, long max) {
+    return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed) srandom(seed);
+}
+
+// ============================================================
+// MEMORY
+// ============================================================
+
+static size_t heapInUse() {
+    return mallinfo2().uordblks;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    size_t capacity = (caps & MALLOC_CAP_SPIRAM) ? NATIVE_PSRAM_HEAP : NATIVE_INTERNAL_HEAP;
+    size_t used = heapInUse();
+    return used < capacity ? capacity - used : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+void EspClass::restart() {
+    Serial.println("[NATIVE] ESP.restart()");
+    nativeStop();
+    exit(0);
+}
+
+// ============================================================
+// SERIAL
+// ============================================================
+
+int HardwareSerial::available() {
+    if (_peeked >= 0) return 1;
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    return (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) ? 1 : 0;
+}
+
+int HardwareSerial::read() {
+    if (_peeked >= 0) {
+        int c = _peeked;
+        _peeked = -1;
+        return c;
+    }
+    if (!available()) return -1;
+    unsigned char c;
+    return (::read(STDIN_FILENO, &c, 1) == 1) ? c : -1;
+}
+
+int HardwareSerial::peek() {
+    if (_peeked < 0) _peeked = read();
+    return _peeked;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+// ============================================================
+// RUN CONTROL
+// ============================================================
+
+void nativeStop() {
+    stopRequested = 1;
+}
+
+unsigned long nativeLoopCount() {
+    return loopCount;
+}
+
+static void onSignal(int) {
+    stopRequested = 1;
+}
+
+// ============================================================
+// LOOP COST TRACE
+// ============================================================
+
+static const unsigned long traceBucketUs[] = {100, 1000, 10000, 100000};
+static const int traceBuckets = sizeof(traceBucketUs) / sizeof(traceBucketUs[0]) + 1;
+static unsigned long traceCounts[traceBuckets];
+static unsigned long traceMaxUs = 0;
+static unsigned long traceMaxAt = 0;
+
+static void traceLoop(FILE* trace, unsigned long minUs, unsigned long at, unsigned long us) {
+    int b = 0;
+    while (b < traceBuckets - 1 && us >= traceBucketUs[b]) b++;
+    traceCounts[b]++;
+    if (us > traceMaxUs) {
+        traceMaxUs = us;
+        traceMaxAt = at;
+    }
+    if (trace && us >= minUs) fprintf(trace, "%lu %lu\n", at, us);
+}
+
+static void printTraceSummary(double hostMs) {
+    printf("[NATIVE] loop() cost: <100us %lu, <1ms %lu, <10ms %lu, <100ms %lu, >=100ms %lu\n",
+           traceCounts[0], traceCounts[1], traceCounts[2], traceCounts[3], traceCounts[4]);
+    printf("[NATIVE] Slowest loop() %lu us at %lu ms; %lu ms simulated in %.0f ms host time\n",
+           traceMaxUs, traceMaxAt, millis(), hostMs);
+}
+
+int main() {
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    const char* epoch = getenv("NATIVE_EPOCH");
+    if (epoch) fakeEpoch = (time_t)atoll(epoch);
+    const char* runMs = getenv("NATIVE_RUN_MS");
+    unsigned long limit = runMs ? strtoul(runMs, nullptr, 10) : 0;
+
+    nativeInputBegin();
+    bool replaying = nativeInputMode() == NATIVE_INPUT_REPLAY;
+    if (replaying) nativeReplayEpoch(fakeEpoch);
+
+    const char* tracePath = getenv("NATIVE_TRACE");
+    FILE* trace = tracePath ? fopen(tracePath, "w") : nullptr;
+    const char* traceMin = getenv("NATIVE_TRACE_MIN_US");
+    unsigned long traceMinUs = traceMin ? strtoul(traceMin, nullptr, 10) : 200;
+
+    auto hostStart = std::chrono::steady_clock::now();
+    setup();
+    unsigned long start = millis();
+    while (!stopRequested && (limit == 0 || millis() - start < limit) &&
+           (limit != 0 || !replaying || !nativeReplayFinished())) {
+        unsigned long at = millis();
+        uint64_t slept = sleptUs;
+        auto t0 = std::chrono::steady_clock::now();
+        loop();
+        int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        us -= (int64_t)(sleptUs - slept);
+        traceLoop(trace, traceMinUs, at, us > 0 ? (unsigned long)us : 0);
+        loopCount++;
+    }
+    double hostMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - hostStart).count();
+
+    const char* dump = getenv("NATIVE_FRAME_DUMP");
+    if (dump && !nativeWriteFramebuffer(dump)) {
+        fprintf(stderr, "[NATIVE] Could not write %s\n", dump);
+    }
+    if (trace) fclose(trace);
+    nativeInputEnd();
+    printf("[NATIVE] %lu loops in %lu ms\n", loopCount, millis() - start);
+    printTraceSummary(hostMs);
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Native HAL: esp_rom_md5 and MD5Builder (RFC 1321)
+ */
+
+#include "MD5Builder.h"
+#include "esp_rom_md5.h"
+
+// RFC 1321, one 64-byte block at a time
+static void transform(uint32_t state[4], const uint8_t block[64]) {
+    static const uint32_t K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+    };
+    static const uint8_t R[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = block[i * 4] | (block[i * 4 + 1] << 8) | (block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        switch (i / 16) {
+            case 0: f = (b & c) | (~b & d); g = i; break;
+            case 1: f = (d & b) | (~d & c); g = (5 * i + 1) % 16; break;
+            case 2: f = b ^ c ^ d; g = (3 * i + 5) % 16; break;
+            default: f = c ^ (b | ~d); g = (7 * i) % 16; break;
+        }
+        uint32_t rot = R[(i / 16) * 4 + i % 4];
+        uint32_t sum = a + f + K[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b += (sum << rot) | (sum >> (32 - rot));
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+// ============================================================
+// ESP_ROM_MD5
+// ============================================================
+
+void esp_rom_md5_init(md5_context_t* context) {
+    context->buf[0] = 0x67452301;
+    context->buf[1] = 0xEFCDAB89;
+    context->buf[2] = 0x98BADCFE;
+    context->buf[3] = 0x10325476;
+    context->bits[0] = context->bits[1] = 0;
+}
+
+void esp_rom_md5_update(md5_context_t* context, const void* buf, uint32_t len) {
+    const uint8_t* data = (const uint8_t*)buf;
+    uint64_t bytes = ((uint64_t)context->bits[1] << 29) | (context->bits[0] >> 3);
+    size_t used = bytes % 64;
+    bytes += len;
+    context->bits[0] = (uint32_t)(bytes << 3);
+    context->bits[1] = (uint32_t)(bytes >> 29);
+    while (len > 0) {
+        size_t n = min((size_t)64 - used, (size_t)len);
+        memcpy(context->in + used, data, n);
+        used += n;
+        data += n;
+        len -= n;
+        if (used == 64) {
+            transform(context->buf, context->in);
+            used = 0;
+        }
+    }
+}
+
+void esp_rom_md5_final(uint8_t* digest, md5_context_t* context) {
+    uint32_t bitsLo = context->bits[0], bitsHi = context->bits[1];
+    uint8_t pad[72] = {0x80};
+    size_t used = (bitsLo >> 3) % 64;
+    size_t padLen = (used < 56 ? 56 : 120) - used;
+    for (int i = 0; i < 4; i++) {
+        pad[padLen + i] = (uint8_t)(bitsLo >> (8 * i));
+        pad[padLen + 4 + i] = (uint8_t)(bitsHi >> (8 * i));
+    }
+    esp_rom_md5_update(context, pad, padLen + 8);
+    for (int i = 0; i < 16; i++) digest[i] = (uint8_t)(context->buf[i / 4] >> (8 * (i % 4)));
+}
+
+// ============================================================
+// MD5BUILDER
+// ============================================================
+
+void MD5Builder::begin() {
+    esp_rom_md5_init(&_ctx);
+}
+
+void MD5Builder::add(const uint8_t* data, size_t len) {
+    esp_rom_md5_update(&_ctx, data, len);
+}
+
+void MD5Builder::calculate() {
+    esp_rom_md5_final(_digest, &_ctx);
+}
+
+void MD5Builder::getChars(char* output) const {
+    for (int i = 0; i < 16; i++) snprintf(output + i * 2, 3, "%02x", _digest[i]);
+}
+
+String MD5Builder::toString() const {
+    char hex[33];
+    getChars(hex);
+    return String(hex);
+}
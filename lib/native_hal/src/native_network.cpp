@@ -0,0 +1,564 @@
+/*
+ * Native HAL: WiFi, Update, the app partitions, WebServer and mDNS
+ */
+
+#include "ESPmDNS.h"
+#include "MD5Builder.h"
+#include "Update.h"
+#include "WebServer.h"
+#include "WiFi.h"
+#include "esp_ota_ops.h"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+WiFiClass WiFi;
+UpdateClass Update;
+MDNSResponder MDNS;
+
+// ============================================================
+// UPDATE
+// ============================================================
+
+bool UpdateClass::begin(size_t size, int command, int ledPin, uint8_t ledOn, const char* label) {
+    (void)command; (void)ledPin; (void)ledOn; (void)label;
+    if (_running) abort();
+    if (size == 0 || size == UPDATE_SIZE_UNKNOWN) {
+        _error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+    _size = size;
+    _progress = 0;
+    _finished = false;
+    _error = UPDATE_ERROR_OK;
+    _running = true;
+    _md5.begin();
+    const char* path = getenv("NATIVE_UPDATE_FILE");
+    if (path) _file = fopen(path, "wb");
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+    if (!_running || hasError()) return 0;
+    if (_progress + len > _size) {
+        _error = UPDATE_ERROR_SIZE;
+        return 0;
+    }
+    if (_file && fwrite(data, 1, len, _file) != len) {
+        _error = UPDATE_ERROR_WRITE;
+        return 0;
+    }
+    _md5.add(data, len);
+    _progress += len;
+    return len;
+}
+
+size_t UpdateClass::writeStream(Stream& data) {
+    uint8_t buf[1024];
+    size_t total = 0;
+    while (remaining() > 0) {
+        size_t n = data.readBytes(buf, min(sizeof(buf), remaining()));
+        if (n == 0 || write(buf, n) != n) break;
+        total += n;
+    }
+    return total;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+    if (!_running) return false;
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+    _running = false;
+    if (hasError()) return false;
+    if (_progress != _size && !evenIfRemaining) {
+        _error = UPDATE_ERROR_ABORT;
+        return false;
+    }
+    if (_expectedMd5[0]) {
+        _md5.calculate();
+        bool match = strcasecmp(_md5.toString().c_str(), _expectedMd5) == 0;
+        _expectedMd5[0] = 0;
+        if (!match) {
+            _error = UPDATE_ERROR_MD5;
+            return false;
+        }
+    }
+    _finished = true;
+    return true;
+}
+
+void UpdateClass::abort() {
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+    _running = false;
+    _error = UPDATE_ERROR_ABORT;
+    _expectedMd5[0] = 0;
+}
+
+bool UpdateClass::setMD5(const char* expectedMd5) {
+    if (strlen(expectedMd5) != 32) return false;
+    memcpy(_expectedMd5, expectedMd5, 33);
+    return true;
+}
+
+const char* UpdateClass::errorString() const {
+    switch (_error) {
+        case UPDATE_ERROR_OK: return "No Error";
+        case UPDATE_ERROR_WRITE: return "Flash Write Failed";
+        case UPDATE_ERROR_SIZE: return "Bad Size Given";
+        case UPDATE_ERROR_STREAM: return "Stream Read Timeout";
+        case UPDATE_ERROR_MD5: return "MD5 Check Failed";
+        case UPDATE_ERROR_ABORT: return "Update Aborted";
+        default: return "Bad Argument";
+    }
+}
+
+// ============================================================
+// APP PARTITIONS
+// ============================================================
+
+// NATIVE_RUNNING_IMAGE, loaded on first use
+static const std::vector<uint8_t>& runningImage() {
+    static std::vector<uint8_t> image;
+    static bool loaded = false;
+    if (!loaded) {
+        loaded = true;
+        const char* path = getenv("NATIVE_RUNNING_IMAGE");
+        FILE* f = path ? fopen(path, "rb") : nullptr;
+        if (f) {
+            uint8_t buf[4096];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0) image.insert(image.end(), buf, buf + n);
+            fclose(f);
+        }
+    }
+    return image;
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+    static const esp_partition_t running = {0x10000, 0x600000, "app0"};
+    return &running;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* startFrom) {
+    (void)startFrom;
+    static const esp_partition_t next = {0x610000, 0x600000, "app1"};
+    return &next;
+}
+
+// NATIVE_UPDATE_FILE, opened (or created) on first use; null if unset
+static FILE* updateFile() {
+    static FILE* file = nullptr;
+    static bool opened = false;
+    if (!opened) {
+        opened = true;
+        const char* path = getenv("NATIVE_UPDATE_FILE");
+        if (path) {
+            file = fopen(path, "r+b");
+            if (!file) file = fopen(path, "w+b");
+        }
+    }
+    return file;
+}
+
+// Bytes of the update slot; past the end of the file reads as erased
+static void readUpdateFile(size_t offset, uint8_t* dst, size_t size) {
+    FILE* f = updateFile();
+    memset(dst, 0xFF, size);
+    if (f && fseek(f, (long)offset, SEEK_SET) == 0) fread(dst, 1, size, f);
+}
+
+static bool writeUpdateFile(size_t offset, const uint8_t* src, size_t size) {
+    FILE* f = updateFile();
+    if (!f) return true;  // Not kept: accept the write
+    return fseek(f, (long)offset, SEEK_SET) == 0 && fwrite(src, 1, size, f) == size && fflush(f) == 0;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t srcOffset, void* dst, size_t size) {
+    if (srcOffset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+    if (partition == esp_ota_get_next_update_partition(nullptr)) {
+        readUpdateFile(srcOffset, (uint8_t*)dst, size);
+        return ESP_OK;
+    }
+    if (partition != esp_ota_get_running_partition()) return ESP_ERR_INVALID_ARG;
+    // Past the image the partition reads as erased flash
+    const std::vector<uint8_t>& image = runningImage();
+    memset(dst, 0xFF, size);
+    if (srcOffset < image.size()) {
+        memcpy(dst, image.data() + srcOffset, min(size, image.size() - srcOffset));
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dstOffset, const void* src, size_t size) {
+    if (partition != esp_ota_get_next_update_partition(nullptr)) return ESP_ERR_INVALID_ARG;
+    if (dstOffset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+    // Programming only clears bits
+    std::vector<uint8_t> cells(size);
+    readUpdateFile(dstOffset, cells.data(), size);
+    for (size_t i = 0; i < size; i++) cells[i] &= ((const uint8_t*)src)[i];
+    return writeUpdateFile(dstOffset, cells.data(), size) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    if (partition != esp_ota_get_next_update_partition(nullptr)) return ESP_ERR_INVALID_ARG;
+    if (offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE) return ESP_ERR_INVALID_SIZE;
+    if (offset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+    std::vector<uint8_t> erased(size, 0xFF);
+    return writeUpdateFile(offset, erased.data(), size) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    if (partition != esp_ota_get_next_update_partition(nullptr)) return ESP_ERR_INVALID_ARG;
+    uint8_t magic;
+    readUpdateFile(0, &magic, 1);
+    return magic == 0xE9 ? ESP_OK : ESP_ERR_OTA_VALIDATE_FAILED;
+}
+
+uint32_t EspClass::getSketchSize() {
+    const std::vector<uint8_t>& image = runningImage();
+    return image.empty() ? 1536 * 1024 : (uint32_t)image.size();
+}
+
+String EspClass::getSketchMD5() {
+    const std::vector<uint8_t>& image = runningImage();
+    if (image.empty()) return String();
+    MD5Builder md5;
+    md5.begin();
+    md5.add(image.data(), image.size());
+    md5.calculate();
+    return md5.toString();
+}
+
+// ============================================================
+// WEBSERVER
+// ============================================================
+
+WebServer::WebServer(int port) :
+    _port(port),
+    _listenFd(-1),
+    _method(HTTP_ANY),
+    _contentLength(CONTENT_LENGTH_UNKNOWN) {
+}
+
+WebServer::~WebServer() {
+    stop();
+}
+
+void WebServer::begin() {
+    if (_listenFd >= 0) return;
+    const char* offsetEnv = getenv("NATIVE_PORT_OFFSET");
+    int port = _port + (offsetEnv ? atoi(offsetEnv) : 8000);
+
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(_listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(_listenFd, 4) < 0) {
+        Serial.printf("[NATIVE] WebServer could not listen on %d\n", port);
+        close(_listenFd);
+        _listenFd = -1;
+        return;
+    }
+    fcntl(_listenFd, F_SETFL, O_NONBLOCK);
+    Serial.printf("[NATIVE] WebServer on http://127.0.0.1:%d\n", port);
+}
+
+void WebServer::stop() {
+    if (_listenFd >= 0) close(_listenFd);
+    _listenFd = -1;
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler) {
+    _routes.push_back(Route{uri, method, handler});
+}
+
+static String urlDecode(const String& s) {
+    String out;
+    for (unsigned int i = 0; i < s.length(); i++) {
+        char c = s[i];
+        if (c == '+') {
+            out += ' ';
+        } else if (c == '%' && i + 2 < s.length()) {
+            char hex[3] = {s[i + 1], s[i + 2], 0};
+            out += (char)strtol(hex, nullptr, 16);
+            i += 2;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void WebServer::parseArgs(const String& query) {
+    int start = 0;
+    while (start < (int)query.length()) {
+        int amp = query.indexOf('&', start);
+        if (amp < 0) amp = query.length();
+        String pair = query.substring(start, amp);
+        int eq = pair.indexOf('=');
+        if (eq >= 0) _args.push_back(std::make_pair(urlDecode(pair.substring(0, eq)), urlDecode(pair.substring(eq + 1))));
+        else if (pair.length()) _args.push_back(std::make_pair(urlDecode(pair), String()));
+        start = amp + 1;
+    }
+}
+
+String WebServer::arg(const String& name) const {
+    for (const auto& a : _args) {
+        if (a.first == name) return a.second;
+    }
+    return String();
+}
+
+bool WebServer::hasArg(const String& name) const {
+    for (const auto& a : _args) {
+        if (a.first == name) return true;
+    }
+    return false;
+}
+
+void WebServer::handleClient() {
+    if (_listenFd < 0) return;
+    int fd = accept(_listenFd, nullptr, nullptr);
+    if (fd < 0) return;
+
+    _client.attachSocket(fd);
+    static_cast<Stream&>(_client).setTimeout(2000);
+    _args.clear();
+    for (auto& h : _headers) h.second = "";
+    _extraHeaders = "";
+    _contentLength = CONTENT_LENGTH_UNKNOWN;
+
+    String requestLine = _client.readStringUntil('\n');
+    int sp1 = requestLine.indexOf(' ');
+    int sp2 = requestLine.indexOf(' ', sp1 + 1);
+    if (sp1 < 0 || sp2 < 0) {
+        _client.stop();
+        return;
+    }
+    String method = requestLine.substring(0, sp1);
+    String target = requestLine.substring(sp1 + 1, sp2);
+    _method = method == "POST" ? HTTP_POST : method == "PUT" ? HTTP_PUT : method == "DELETE" ? HTTP_DELETE
+            : method == "HEAD" ? HTTP_HEAD : HTTP_GET;
+
+    int bodyLen = 0;
+    bool formBody = false;
+    while (true) {
+        String line = _client.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0) break;
+        String lower = line;
+        lower.toLowerCase();
+        if (lower.startsWith("content-length:")) bodyLen = line.substring(15).toInt();
+        if (lower.startsWith("content-type:") && lower.indexOf("x-www-form-urlencoded") >= 0) formBody = true;
+        int colon = line.indexOf(':');
+        for (auto& h : _headers) {
+            if (colon > 0 && line.substring(0, colon).equalsIgnoreCase(h.first)) {
+                h.second = line.substring(colon + 1);
+                h.second.trim();
+            }
+        }
+    }
+
+    int q = target.indexOf('?');
+    _uri = q >= 0 ? target.substring(0, q) : target;
+    if (q >= 0) parseArgs(target.substring(q + 1));
+    if (bodyLen > 0) {
+        String body;
+        char buf[512];
+        while ((int)body.length() < bodyLen) {
+            size_t n = _client.readBytes(buf, min((size_t)(bodyLen - body.length()), sizeof(buf)));
+            if (n == 0) break;
+            body.concat(buf, n);
+        }
+        if (formBody) parseArgs(body);
+        else _args.push_back(std::make_pair(String("plain"), body));
+    }
+
+    bool handled = false;
+    for (const auto& r : _routes) {
+        if (r.uri == _uri && (r.method == HTTP_ANY || r.method == _method)) {
+            r.handler();
+            handled = true;
+            break;
+        }
+    }
+    if (!handled) {
+        if (_notFound) _notFound();
+        else send(404, "text/plain", "Not found");
+    }
+    _client.stop();
+}
+
+void WebServer::collectHeaders(const char* headerKeys[], const size_t count) {
+    _headers.clear();
+    for (size_t i = 0; i < count; i++) _headers.push_back(std::make_pair(String(headerKeys[i]), String()));
+}
+
+String WebServer::header(const String& name) const {
+    for (const auto& h : _headers) {
+        if (h.first.equalsIgnoreCase(name)) return h.second;
+    }
+    return String();
+}
+
+bool WebServer::hasHeader(const String& name) const {
+    return header(name).length() > 0;
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+    String line = name + ": " + value + "\r\n";
+    _extraHeaders = first ? line + _extraHeaders : _extraHeaders + line;
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+    const char* reason = code == 200 ? " OK" : code == 206 ? " Partial Content" : " Status";
+    String head = "HTTP/1.1 " + String(code) + reason + "\r\n";
+    if (contentType) head += "Content-Type: " + String(contentType) + "\r\n";
+    // Unknown length with no body yet: the handler streams sendContent() until close
+    if (_contentLength != CONTENT_LENGTH_UNKNOWN) {
+        head += "Content-Length: " + String((unsigned long)_contentLength) + "\r\n";
+    } else if (content.length() > 0) {
+        head += "Content-Length: " + String(content.length()) + "\r\n";
+    }
+    head += _extraHeaders + "Connection: close\r\n\r\n";
+    _client.write((const uint8_t*)head.c_str(), head.length());
+    if (content.length()) sendContent(content);
+}
+
+void WebServer::sendContent(const char* content, size_t size) {
+    _client.write((const uint8_t*)content, size);
+}
+
+// ============================================================
+// MDNS
+// ============================================================
+
+static const char* mdnsFile() {
+    const char* path = getenv("NATIVE_MDNS_FILE");
+    return path ? path : "/tmp/native_mdns";
+}
+
+static int nativePort(int port) {
+    const char* offsetEnv = getenv("NATIVE_PORT_OFFSET");
+    return port + (offsetEnv ? atoi(offsetEnv) : 8000);
+}
+
+bool MDNSResponder::begin(const char* hostName) {
+    _hostname = hostName;
+    _own.clear();
+    publish();
+    return true;
+}
+
+void MDNSResponder::end() {
+    _own.clear();
+    publish();
+    _hostname = "";
+}
+
+bool MDNSResponder::addService(const char* service, const char* proto, uint16_t port) {
+    String type = String(service[0] == '_' ? "" : "_") + service + "._" + (proto[0] == '_' ? proto + 1 : proto);
+    _own.push_back(Service{_hostname, type, (uint16_t)nativePort(port), {}});
+    publish();
+    return true;
+}
+
+void MDNSResponder::addServiceTxt(const char* service, const char* proto, const char* key, const char* value) {
+    String type = String(service[0] == '_' ? "" : "_") + service + "._" + (proto[0] == '_' ? proto + 1 : proto);
+    for (auto& svc : _own) {
+        if (svc.type == type) svc.txt.push_back(std::make_pair(String(key), String(value)));
+    }
+    publish();
+}
+
+// One line per service: host, type, port, then key=value fields, tab-separated
+void MDNSResponder::publish() {
+    std::vector<String> keep;
+    FILE* f = fopen(mdnsFile(), "r");
+    char line[1024];
+    while (f && fgets(line, sizeof(line), f)) {
+        String entry(line);
+        if (!entry.startsWith(_hostname + "\t")) keep.push_back(entry);
+    }
+    if (f) fclose(f);
+
+    String tmp = String(mdnsFile()) + ".tmp";
+    f = fopen(tmp.c_str(), "w");
+    if (!f) return;
+    for (const auto& entry : keep) fputs(entry.c_str(), f);
+    for (const auto& svc : _own) {
+        fprintf(f, "%s\t%s\t%u", svc.host.c_str(), svc.type.c_str(), svc.port);
+        for (const auto& kv : svc.txt) fprintf(f, "\t%s=%s", kv.first.c_str(), kv.second.c_str());
+        fputc('\n', f);
+    }
+    fclose(f);
+    rename(tmp.c_str(), mdnsFile());
+}
+
+int MDNSResponder::queryService(const char* service, const char* proto) {
+    String type = String(service[0] == '_' ? "" : "_") + service + "._" + (proto[0] == '_' ? proto + 1 : proto);
+    _results.clear();
+    FILE* f = fopen(mdnsFile(), "r");
+    char line[1024];
+    while (f && fgets(line, sizeof(line), f)) {
+        String entry(line);
+        entry.trim();
+        std::vector<String> fields;
+        int start = 0;
+        while (start <= (int)entry.length()) {
+            int tab = entry.indexOf('\t', start);
+            if (tab < 0) tab = entry.length();
+            fields.push_back(entry.substring(start, tab));
+            start = tab + 1;
+        }
+        if (fields.size() < 3 || fields[1] != type) continue;
+        Service svc{fields[0], fields[1], (uint16_t)fields[2].toInt(), {}};
+        for (size_t i = 3; i < fields.size(); i++) {
+            int eq = fields[i].indexOf('=');
+            if (eq > 0) svc.txt.push_back(std::make_pair(fields[i].substring(0, eq), fields[i].substring(eq + 1)));
+        }
+        _results.push_back(svc);
+    }
+    if (f) fclose(f);
+    return (int)_results.size();
+}
+
+String MDNSResponder::hostname(int idx) {
+    return idx < (int)_results.size() ? _results[idx].host : String();
+}
+
+IPAddress MDNSResponder::IP(int idx) {
+    return idx < (int)_results.size() ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+uint16_t MDNSResponder::port(int idx) {
+    return idx < (int)_results.size() ? _results[idx].port : 0;
+}
+
+bool MDNSResponder::hasTxt(int idx, const char* key) {
+    if (idx >= (int)_results.size()) return false;
+    for (const auto& kv : _results[idx].txt) {
+        if (kv.first == key) return true;
+    }
+    return false;
+}
+
+String MDNSResponder::txt(int idx, const char* key) {
+    if (idx >= (int)_results.size()) return String();
+    for (const auto& kv : _results[idx].txt) {
+        if (kv.first == key) return kv.second;
+    }
+    return String();
+}
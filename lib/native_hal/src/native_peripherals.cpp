@@ -0,0 +1,76 @@
+/*
+ * Native HAL: touch, ADC, LEDs and I2C
+ */
+
+#include "Adafruit_ADS1X15.h"
+#include "FastLED.h"
+#include "TAMC_GT911.h"
+#include "Wire.h"
+#include "native_hal.h"
+#include "native_replay.h"
+
+CFastLED FastLED;
+TwoWire Wire;
+
+// ============================================================
+// TOUCH
+// ============================================================
+
+static int touchRawX = 0;
+static int touchRawY = 0;
+static unsigned long touchUntil = 0;
+
+void nativeTouch(int rawX, int rawY, unsigned long ms) {
+    touchRawX = rawX;
+    touchRawY = rawY;
+    touchUntil = millis() + ms;
+}
+
+void TAMC_GT911::read() {
+    bool touched = millis() < touchUntil;
+    int x = touchRawX, y = touchRawY;
+    if (nativeInputMode() == NATIVE_INPUT_REPLAY) nativeReplayTouch(touched, x, y);
+    else nativeRecordTouch(touched, x, y);
+
+    isTouched = touched;
+    touches = isTouched ? 1 : 0;
+    if (isTouched) {
+        points[0].x = (uint16_t)x;
+        points[0].y = (uint16_t)y;
+        points[0].size = 20;
+    }
+}
+
+// ============================================================
+// ADS1115
+// ============================================================
+
+static int16_t adcValues[4] = {8000, 8000, 8000, 8000};
+
+void nativeSetAdc(uint8_t channel, int16_t value) {
+    if (channel < 4) adcValues[channel] = value;
+}
+
+int16_t Adafruit_ADS1115::readADC_SingleEnded(uint8_t channel) {
+    int16_t value = channel < 4 ? adcValues[channel] : 0;
+    if (nativeInputMode() == NATIVE_INPUT_REPLAY) nativeReplayAdc(channel, value);
+    else nativeRecordAdc(channel, value);
+    return value;
+}
+
+int16_t Adafruit_ADS1115::getLastConversionResults() {
+    return adcValues[_channel];
+}
+
+float Adafruit_ADS1115::computeVolts(int16_t counts) {
+    float fsRange;
+    switch (_gain) {
+        case GAIN_TWOTHIRDS: fsRange = 6.144f; break;
+        case GAIN_ONE: fsRange = 4.096f; break;
+        case GAIN_TWO: fsRange = 2.048f; break;
+        case GAIN_FOUR: fsRange = 1.024f; break;
+        case GAIN_EIGHT: fsRange = 0.512f; break;
+        default: fsRange = 0.256f; break;
+    }
+    return counts * (fsRange / 32768.0f);
+}
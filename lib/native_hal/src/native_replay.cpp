@@ -0,0 +1,450 @@
+/*
+ * Native HAL: input recording and replay (see native_replay.h)
+ */
+
+#include "native_replay.h"
+#include "Arduino.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+static NativeInputMode inputMode = NATIVE_INPUT_LIVE;
+static std::mutex netLock;  // Sockets may be used from worker tasks (threads)
+static FILE* recordFile = nullptr;
+static uint64_t virtualUs = 0;
+
+// ============================================================
+// MODE
+// ============================================================
+
+static bool loadReplay(const char* path);
+
+void nativeInputBegin() {
+    srandom(1);  // random() is an input too: same sequence when recording and replaying
+
+    const char* replay = getenv("NATIVE_REPLAY");
+    const char* record = getenv("NATIVE_RECORD");
+
+    if (replay && *replay) {
+        if (!loadReplay(replay)) {
+            fprintf(stderr, "[NATIVE] Could not read replay log %s\n", replay);
+            exit(2);
+        }
+        inputMode = NATIVE_INPUT_REPLAY;
+    } else if (record && *record) {
+        recordFile = fopen(record, "w");
+        if (!recordFile) {
+            fprintf(stderr, "[NATIVE] Could not write %s\n", record);
+            exit(2);
+        }
+        fprintf(recordFile, "# friyay input log v1\n");
+        inputMode = NATIVE_INPUT_RECORD;
+        nativeRecordEpoch(time(nullptr));
+    }
+}
+
+void nativeInputEnd() {
+    if (recordFile) {
+        fprintf(recordFile, "%lu end\n", millis());
+        fclose(recordFile);
+        recordFile = nullptr;
+    }
+}
+
+NativeInputMode nativeInputMode() {
+    return inputMode;
+}
+
+uint64_t nativeVirtualMicros() {
+    return virtualUs;
+}
+
+void nativeVirtualAdvance(uint64_t us) {
+    virtualUs += us;
+}
+
+// ============================================================
+// RECORDING
+// ============================================================
+
+static int recordNextId = 0;
+
+// Sensor sources: the GT911, 4 ADS1115 channels, 64 analogRead pins.
+// Changes are logged with the index of the read that saw them, so a
+// replay hands each read the same value even if its timing drifts.
+#define SOURCE_TOUCH   0
+#define SOURCE_ADC     1
+#define SOURCE_ANALOG  5
+#define SOURCE_COUNT   (SOURCE_ANALOG + 64)
+
+static unsigned long readCount[SOURCE_COUNT];
+
+void nativeRecordTouch(bool touched, int rawX, int rawY) {
+    static bool lastTouched = false;
+    static int lastX = -1, lastY = -1;
+    unsigned long read = readCount[SOURCE_TOUCH]++;
+    if (!recordFile || (touched == lastTouched && (!touched || (rawX == lastX && rawY == lastY)))) return;
+    lastTouched = touched;
+    lastX = rawX;
+    lastY = rawY;
+    fprintf(recordFile, "%lu touch %d %d %d %lu\n", millis(), touched ? 1 : 0, rawX, rawY, read);
+}
+
+void nativeRecordAdc(uint8_t channel, int16_t value) {
+    static int32_t last[4] = {INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN};
+    if (channel >= 4) return;
+    unsigned long read = readCount[SOURCE_ADC + channel]++;
+    if (!recordFile || last[channel] == value) return;
+    last[channel] = value;
+    fprintf(recordFile, "%lu adc %u %d %lu\n", millis(), channel, value, read);
+}
+
+void nativeRecordAnalog(uint8_t pin, uint16_t value) {
+    static int32_t last[64];
+    static bool seen[64];
+    if (pin >= 64) return;
+    unsigned long read = readCount[SOURCE_ANALOG + pin]++;
+    if (!recordFile || (seen[pin] && last[pin] == value)) return;
+    seen[pin] = true;
+    last[pin] = value;
+    fprintf(recordFile, "%lu analog %u %u %lu\n", millis(), pin, value, read);
+}
+
+void nativeRecordEpoch(time_t epoch) {
+    if (!recordFile) return;
+    fprintf(recordFile, "%lu epoch %lld\n", millis(), (long long)epoch);
+}
+
+int nativeRecordConnect(const char* host, uint16_t port, bool ok) {
+    std::lock_guard<std::mutex> held(netLock);
+    int id = recordNextId++;
+    if (recordFile) fprintf(recordFile, "%lu conn %d %s %u %d\n", millis(), id, host, port, ok ? 1 : 0);
+    return id;
+}
+
+void nativeRecordRequest(int id, const char* line) {
+    std::lock_guard<std::mutex> held(netLock);
+    if (recordFile) fprintf(recordFile, "%lu req %d %s\n", millis(), id, line);
+}
+
+void nativeRecordRecv(int id, const uint8_t* data, size_t len) {
+    std::lock_guard<std::mutex> held(netLock);
+    if (!recordFile || len == 0) return;
+    fprintf(recordFile, "%lu recv %d ", millis(), id);
+    for (size_t i = 0; i < len; i++) fprintf(recordFile, "%02x", data[i]);
+    fputc('\n', recordFile);
+}
+
+void nativeRecordClose(int id) {
+    std::lock_guard<std::mutex> held(netLock);
+    if (recordFile) fprintf(recordFile, "%lu close %d\n", millis(), id);
+}
+
+// ============================================================
+// REPLAY
+// ============================================================
+
+struct ReplayEvent {
+    unsigned long ms;
+    long read;  // Read index it applies from, -1 to go by time
+    int value, x, y;
+};
+
+struct ReplayChunk {
+    unsigned long offsetMs;  // After the request was sent
+    std::string data;
+};
+
+// One request and the bytes that came back before the next one
+struct ReplayExchange {
+    std::string request;
+    unsigned long sentMs;
+    std::vector<ReplayChunk> chunks;
+};
+
+struct ReplayConn {
+    int id;
+    std::string host;
+    uint16_t port;
+    bool ok;
+    std::vector<ReplayExchange> exchanges;
+    long closeOffsetMs = -1;  // After the last request
+
+    // Replay state
+    bool used = false;
+    size_t exchange = 0;
+    unsigned long baseMs = 0;
+    size_t chunk = 0;
+    size_t pos = 0;
+};
+
+static std::vector<ReplayEvent> events[SOURCE_COUNT];
+static size_t eventCursor[SOURCE_COUNT];
+static bool sourceKnown[SOURCE_COUNT];
+static ReplayEvent sourceState[SOURCE_COUNT];
+static size_t eventTotal = 0;
+static std::vector<ReplayConn> conns;  // Indexed by id when recorded here
+static size_t firstUnused = 0;
+static unsigned long lastEventMs = 0;
+static long long replayEpoch = -1;
+static unsigned long replayEpochMs = 0;
+
+static ReplayConn* findConn(int id) {
+    if (id >= 0 && (size_t)id < conns.size() && conns[id].id == id) return &conns[id];
+    for (auto& c : conns) {
+        if (c.id == id) return &c;
+    }
+    return nullptr;
+}
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool loadReplay(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+
+    char* line = nullptr;
+    size_t cap = 0;
+    ssize_t len;
+    int lineNo = 0;
+    while ((len = getline(&line, &cap, f)) >= 0) {
+        lineNo++;
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (len == 0 || line[0] == '#') continue;
+
+        unsigned long ms;
+        char kind[8];
+        int consumed = 0;
+        if (sscanf(line, "%lu %7s %n", &ms, kind, &consumed) != 2) {
+            fprintf(stderr, "[NATIVE] Replay line %d unreadable\n", lineNo);
+            continue;
+        }
+        const char* rest = line + consumed;
+        if (ms > lastEventMs) lastEventMs = ms;
+
+        int a = 0, b = 0, c = 0;
+        long read = -1;
+        if (strcmp(kind, "epoch") == 0) {
+            replayEpoch = atoll(rest);
+            replayEpochMs = ms;
+        } else if (strcmp(kind, "end") == 0) {
+            // Only extends the run to the recorded length
+        } else if (strcmp(kind, "touch") == 0 && sscanf(rest, "%d %d %d %ld", &a, &b, &c, &read) >= 3) {
+            events[SOURCE_TOUCH].push_back({ms, read, a, b, c});
+            eventTotal++;
+        } else if (strcmp(kind, "adc") == 0 && sscanf(rest, "%d %d %ld", &a, &b, &read) >= 2 && a >= 0 && a < 4) {
+            events[SOURCE_ADC + a].push_back({ms, read, b, 0, 0});
+            eventTotal++;
+        } else if (strcmp(kind, "analog") == 0 && sscanf(rest, "%d %d %ld", &a, &b, &read) >= 2 && a >= 0 && a < 64) {
+            events[SOURCE_ANALOG + a].push_back({ms, read, b, 0, 0});
+            eventTotal++;
+        } else if (strcmp(kind, "conn") == 0) {
+            char host[128];
+            unsigned port;
+            int ok;
+            if (sscanf(rest, "%d %127s %u %d", &a, host, &port, &ok) == 4) {
+                ReplayConn conn;
+                conn.id = a;
+                conn.host = host;
+                conn.port = (uint16_t)port;
+                conn.ok = ok != 0;
+                conn.exchanges.push_back({"", ms, {}});  // Bytes before any request
+                conns.push_back(conn);
+            }
+        } else if (strcmp(kind, "req") == 0 || strcmp(kind, "recv") == 0 || strcmp(kind, "close") == 0) {
+            int n = 0;
+            ReplayConn* conn = sscanf(rest, "%d %n", &a, &n) >= 1 ? findConn(a) : nullptr;
+            if (!conn) {
+                fprintf(stderr, "[NATIVE] Replay line %d: unknown connection\n", lineNo);
+                continue;
+            }
+            ReplayExchange& last = conn->exchanges.back();
+            unsigned long offset = ms >= last.sentMs ? ms - last.sentMs : 0;
+            if (strcmp(kind, "req") == 0) {
+                if (conn->exchanges.size() == 1 && last.chunks.empty()) {
+                    last.request = rest + n;
+                    last.sentMs = ms;
+                } else {
+                    conn->exchanges.push_back({rest + n, ms, {}});
+                }
+            } else if (strcmp(kind, "close") == 0) {
+                conn->closeOffsetMs = (long)offset;
+            } else {
+                ReplayChunk chunk;
+                chunk.offsetMs = offset;
+                for (const char* p = rest + n; p[0] && p[1]; p += 2) {
+                    int hi = hexNibble(p[0]), lo = hexNibble(p[1]);
+                    if (hi < 0 || lo < 0) break;
+                    chunk.data.push_back((char)((hi << 4) | lo));
+                }
+                last.chunks.push_back(chunk);
+            }
+        } else {
+            fprintf(stderr, "[NATIVE] Replay line %d: unknown event '%s'\n", lineNo, kind);
+        }
+    }
+    free(line);
+    fclose(f);
+
+    printf("[NATIVE] Replaying %s: %zu input events, %zu connections, %lu ms\n", path, eventTotal,
+           conns.size(), lastEventMs);
+    return true;
+}
+
+bool nativeReplayFinished() {
+    return virtualUs / 1000 > lastEventMs;
+}
+
+// Apply the events due for this read of 'source'; false if none yet
+static bool replaySource(int source) {
+    unsigned long read = readCount[source]++;
+    unsigned long now = millis();
+    const std::vector<ReplayEvent>& list = events[source];
+    size_t& cursor = eventCursor[source];
+    while (cursor < list.size()) {
+        const ReplayEvent& e = list[cursor];
+        bool due = e.read >= 0 ? (unsigned long)e.read <= read : e.ms <= now;
+        if (!due) break;
+        sourceState[source] = e;
+        sourceKnown[source] = true;
+        cursor++;
+    }
+    return sourceKnown[source];
+}
+
+bool nativeReplayTouch(bool& touched, int& rawX, int& rawY) {
+    if (!replaySource(SOURCE_TOUCH)) return false;
+    const ReplayEvent& e = sourceState[SOURCE_TOUCH];
+    touched = e.value != 0;
+    rawX = e.x;
+    rawY = e.y;
+    return true;
+}
+
+bool nativeReplayAdc(uint8_t channel, int16_t& value) {
+    if (channel >= 4 || !replaySource(SOURCE_ADC + channel)) return false;
+    value = (int16_t)sourceState[SOURCE_ADC + channel].value;
+    return true;
+}
+
+bool nativeReplayAnalog(uint8_t pin, uint16_t& value) {
+    if (pin >= 64 || !replaySource(SOURCE_ANALOG + pin)) return false;
+    value = (uint16_t)sourceState[SOURCE_ANALOG + pin].value;
+    return true;
+}
+
+// Epoch at virtual time 0
+bool nativeReplayEpoch(time_t& epoch) {
+    if (replayEpoch < 0) return false;
+    epoch = (time_t)(replayEpoch - replayEpochMs / 1000);
+    return true;
+}
+
+bool nativeReplayCanConnect(const char* host, uint16_t port) {
+    std::lock_guard<std::mutex> held(netLock);
+    for (size_t i = firstUnused; i < conns.size(); i++) {
+        const ReplayConn& c = conns[i];
+        if (!c.used && c.ok && c.port == port && c.host == host) return true;
+    }
+    return false;
+}
+
+// How far ahead of the oldest unused connection a request is matched
+#define REPLAY_MATCH_WINDOW 64
+
+int nativeReplayBind(const char* host, uint16_t port, const char* line) {
+    std::lock_guard<std::mutex> held(netLock);
+    while (firstUnused < conns.size() && (conns[firstUnused].used || !conns[firstUnused].ok)) firstUnused++;
+
+    // Same request first, so reordered polls still get their own answer
+    ReplayConn* match = nullptr;
+    ReplayConn* fallback = nullptr;
+    size_t seen = 0;
+    for (size_t i = firstUnused; i < conns.size() && seen < REPLAY_MATCH_WINDOW; i++) {
+        ReplayConn& c = conns[i];
+        if (c.used || !c.ok || c.port != port || c.host != host) continue;
+        seen++;
+        if (!fallback) fallback = &c;
+        if (c.exchanges[0].request == line) {
+            match = &c;
+            break;
+        }
+    }
+    if (!match) match = fallback;
+    if (!match) {
+        printf("[NATIVE] Replay has no response left for %s:%u \"%s\"\n", host, port, line);
+        return -1;
+    }
+    if (match->exchanges[0].request != line) {
+        printf("[NATIVE] Replay diverged: sent \"%s\", log has \"%s\"\n", line,
+               match->exchanges[0].request.c_str());
+    }
+    match->used = true;
+    match->baseMs = millis();
+    return match->id;
+}
+
+void nativeReplayRequest(int id, const char* line) {
+    std::lock_guard<std::mutex> held(netLock);
+    ReplayConn* conn = findConn(id);
+    if (!conn) return;
+    if (conn->exchange + 1 >= conn->exchanges.size()) {
+        printf("[NATIVE] Replay has no response left on connection %d for \"%s\"\n", id, line);
+        conn->exchange = conn->exchanges.size();
+        return;
+    }
+    conn->exchange++;
+    conn->chunk = 0;
+    conn->pos = 0;
+    conn->baseMs = millis();
+    const std::string& logged = conn->exchanges[conn->exchange].request;
+    if (logged != line) {
+        printf("[NATIVE] Replay diverged: sent \"%s\", log has \"%s\"\n", line, logged.c_str());
+    }
+}
+
+size_t nativeReplayRecv(int id, uint8_t* buf, size_t size, bool& eof, unsigned long& nextMs) {
+    std::lock_guard<std::mutex> held(netLock);
+    eof = false;
+    nextMs = 0;
+    ReplayConn* conn = findConn(id);
+    if (!conn || conn->exchange >= conn->exchanges.size()) {
+        eof = true;
+        return 0;
+    }
+
+    unsigned long now = millis();
+    const std::vector<ReplayChunk>& chunks = conn->exchanges[conn->exchange].chunks;
+    size_t n = 0;
+    while (n < size && conn->chunk < chunks.size()) {
+        const ReplayChunk& chunk = chunks[conn->chunk];
+        if (conn->baseMs + chunk.offsetMs > now) {
+            nextMs = conn->baseMs + chunk.offsetMs;
+            return n;
+        }
+        size_t take = min(size - n, chunk.data.size() - conn->pos);
+        memcpy(buf + n, chunk.data.data() + conn->pos, take);
+        n += take;
+        conn->pos += take;
+        if (conn->pos == chunk.data.size()) {
+            conn->chunk++;
+            conn->pos = 0;
+        }
+    }
+    if (conn->chunk < chunks.size()) return n;
+
+    // Everything for this request delivered: the peer closes once the
+    // recorded close is due, if it came after the last request
+    if (conn->closeOffsetMs >= 0 && conn->exchange + 1 == conn->exchanges.size()) {
+        unsigned long closeMs = conn->baseMs + (unsigned long)conn->closeOffsetMs;
+        if (closeMs <= now) eof = n == 0;
+        else nextMs = closeMs;
+    }
+    return n;
+}
@@ -0,0 +1,85 @@
+/*
+ * Native HAL: input recording and replay (internal)
+ *
+ * NATIVE_RECORD=<file> logs every external input with its millis()
+ * timestamp: socket connects, requests and received bytes, GT911
+ * touch state, ADS1115 and analogRead values, and the wall clock.
+ *
+ * NATIVE_REPLAY=<file> feeds such a log back under a virtual clock:
+ * delay() advances time instantly, so the firmware runs as fast as the
+ * host can execute loop(). Replayed connections are matched to logged
+ * ones by request line (then by host:port, in order); each request on
+ * a connection gets the bytes that followed it in the log, with the
+ * recorded latency. The run ends after the last event unless
+ * NATIVE_RUN_MS says otherwise.
+ *
+ * Log format, one event per line ('#' starts a comment), so logs can
+ * also be written or edited by hand:
+ *   <ms> epoch <unix seconds>               wall clock at <ms>
+ *   <ms> touch <0|1> <rawX> <rawY> [read]   GT911 state change
+ *   <ms> adc <channel> <counts> [read]      ADS1115 value change
+ *   <ms> analog <pin> <value> [read]        analogRead() value change
+ *   <ms> conn <id> <host> <port> <ok>       connect attempt
+ *   <ms> req <id> <first line>              request sent (its first line)
+ *   <ms> recv <id> <hex bytes>              bytes received
+ *   <ms> close <id>                         peer closed
+ *   <ms> end                                recording stopped
+ *
+ * [read] is the index of the read (per sensor) that first saw the
+ * value; replay applies it from that read on, so values land on the
+ * same reads even when timing drifts. Without it, the value applies
+ * from <ms>.
+ */
+
+#ifndef NATIVE_REPLAY_H
+#define NATIVE_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+enum NativeInputMode {
+    NATIVE_INPUT_LIVE,
+    NATIVE_INPUT_RECORD,
+    NATIVE_INPUT_REPLAY,
+};
+
+void nativeInputBegin();  // Reads NATIVE_RECORD / NATIVE_REPLAY
+void nativeInputEnd();
+NativeInputMode nativeInputMode();
+
+// ---------- Virtual clock (replay only) ----------
+
+uint64_t nativeVirtualMicros();
+void nativeVirtualAdvance(uint64_t us);
+bool nativeReplayFinished();  // Virtual time is past the last event
+
+// ---------- Sensors and clock ----------
+
+void nativeRecordTouch(bool touched, int rawX, int rawY);
+void nativeRecordAdc(uint8_t channel, int16_t value);
+void nativeRecordAnalog(uint8_t pin, uint16_t value);
+void nativeRecordEpoch(time_t epoch);
+
+// Current replayed state; false if the log has no value yet
+bool nativeReplayTouch(bool& touched, int& rawX, int& rawY);
+bool nativeReplayAdc(uint8_t channel, int16_t& value);
+bool nativeReplayAnalog(uint8_t pin, uint16_t& value);
+bool nativeReplayEpoch(time_t& epoch);
+
+// ---------- Network ----------
+
+int nativeRecordConnect(const char* host, uint16_t port, bool ok);  // Returns the log id
+void nativeRecordRequest(int id, const char* line);
+void nativeRecordRecv(int id, const uint8_t* data, size_t len);
+void nativeRecordClose(int id);
+
+bool nativeReplayCanConnect(const char* host, uint16_t port);
+int nativeReplayBind(const char* host, uint16_t port, const char* line);  // -1 if none left
+void nativeReplayRequest(int id, const char* line);  // Next request on a bound connection
+
+// Bytes due by now; 'eof' once the recorded close is due. 'nextMs' is
+// the virtual time more data arrives (0 if nothing else is coming).
+size_t nativeReplayRecv(int id, uint8_t* buf, size_t size, bool& eof, unsigned long& nextMs);
+
+#endif // NATIVE_REPLAY_H
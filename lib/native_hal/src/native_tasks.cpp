@@ -0,0 +1,105 @@
+/*
+ * Native HAL: FreeRTOS tasks and queues
+ *
+ * Tasks are detached host threads, queues a mutex-guarded byte deque
+ * with FreeRTOS copy-in/copy-out semantics. Enough for firmware that
+ * hands buffers between a couple of worker tasks.
+ */
+
+#include "Arduino.h"
+
+#include <pthread.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct NativeQueue {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t itemSize;
+};
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+    (void)name;
+    (void)stackDepth;
+    (void)priority;
+    (void)core;
+    std::promise<TaskHandle_t> handle;
+    std::future<TaskHandle_t> started = handle.get_future();
+    std::thread([fn, arg, &handle] {
+        handle.set_value(xTaskGetCurrentTaskHandle());
+        fn(arg);
+    }).detach();
+    TaskHandle_t task = started.get();
+    if (created) *created = task;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task && task != xTaskGetCurrentTaskHandle()) {
+        fprintf(stderr, "[NATIVE] vTaskDelete of another task is not supported\n");
+        abort();
+    }
+    pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    NativeQueue* q = new NativeQueue();
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+// Waits for 'ready' up to 'wait' ticks (ms); false on timeout
+template <typename Pred>
+static bool waitFor(NativeQueue* q, std::unique_lock<std::mutex>& held, TickType_t wait, Pred ready) {
+    if (wait == portMAX_DELAY) {
+        q->changed.wait(held, ready);
+        return true;
+    }
+    return q->changed.wait_for(held, std::chrono::milliseconds(wait), ready);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> held(queue->lock);
+    if (!waitFor(queue, held, wait, [queue] { return queue->items.size() < queue->length; })) return pdFALSE;
+    const uint8_t* bytes = (const uint8_t*)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> held(queue->lock);
+    if (!waitFor(queue, held, wait, [queue] { return !queue->items.empty(); })) return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+// No interrupts fire natively; callable for completeness
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) {
+    if (woken) *woken = pdFALSE;
+    return xQueueSend(queue, item, 0);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> held(queue->lock);
+    return (UBaseType_t)queue->items.size();
+}
@@ -0,0 +1,75 @@
+/*
+ * Native HAL: ROM miniz inflater (tinfl)
+ *
+ * The subset of the ESP32 ROM's tinfl API that gzip_stream.h uses,
+ * backed by zlib's raw inflate (link with -lz). zlib keeps its own
+ * history, so the caller's circular window only receives the output.
+ */
+
+#ifndef NATIVE_ROM_MINIZ_H
+#define NATIVE_ROM_MINIZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+#define TINFL_FLAG_PARSE_ZLIB_HEADER             1
+#define TINFL_FLAG_HAS_MORE_INPUT                2
+#define TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF 4
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    int m_state;  // 0: zlib stream not set up yet
+    z_stream m_zlib;
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* in, size_t* inSize,
+                                     uint8_t* outStart, uint8_t* outNext, size_t* outSize,
+                                     uint32_t flags) {
+    (void)outStart;
+    if (r->m_state == 0) {
+        r->m_zlib = z_stream();
+        int bits = (flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? MAX_WBITS : -MAX_WBITS;
+        if (inflateInit2(&r->m_zlib, bits) != Z_OK) return TINFL_STATUS_FAILED;
+        r->m_state = 1;
+    }
+    if (r->m_state == 2) {
+        *inSize = 0;
+        *outSize = 0;
+        return TINFL_STATUS_DONE;
+    }
+
+    r->m_zlib.next_in = (Bytef*)in;
+    r->m_zlib.avail_in = (uInt)*inSize;
+    r->m_zlib.next_out = outNext;
+    r->m_zlib.avail_out = (uInt)*outSize;
+    int ret = inflate(&r->m_zlib, Z_NO_FLUSH);
+    *inSize -= r->m_zlib.avail_in;
+    *outSize -= r->m_zlib.avail_out;
+
+    if (ret == Z_STREAM_END) {
+        inflateEnd(&r->m_zlib);
+        r->m_state = 2;
+        return TINFL_STATUS_DONE;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        inflateEnd(&r->m_zlib);
+        r->m_state = 0;
+        return TINFL_STATUS_FAILED;
+    }
+    return r->m_zlib.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif // NATIVE_ROM_MINIZ_H
@@ -0,0 +1,249 @@
+/*
+ * =====================================================
+ * ADS1115 BACKGROUND SAMPLER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Scans the ADS1115 inputs round-robin in continuous-conversion mode so
+ * loop() never waits on a conversion or touches the I2C bus it shares
+ * with the GT911.
+ *
+ * Each scanned channel has its own input, gain, data rate and
+ * oversampling. The task selects a channel (one config write), throws
+ * away the first conversion while the mux settles, then sums 2^n
+ * conversions and decimates the sum to Q8 counts in integer arithmetic:
+ * n extra bits of sum buy n/2 bits of resolution against white noise.
+ *
+ * The ADS1115 pulses ALERT/RDY low after every conversion (the library
+ * sets the threshold registers for that in startADCReading()). The pin
+ * interrupt can't use Wire, so it only wakes the task on core 0, which
+ * reads the conversion register (one short I2C transaction). Finished
+ * readings go into a single-producer/single-consumer ring; loop() drains
+ * it into a fixed-point moving average per channel.
+ *
+ * If ALERT/RDY isn't wired the task times out each period and polls
+ * instead, at half the data rate.
+ *
+ * Usage:
+ * - begin(ads, channels, count, alertPin) after ads.begin(); the
+ *   AdsChannel table must outlive the sampler
+ * - read(slot, q8) or readMicrovolts(slot, uv) from loop(), slot being
+ *   the index in the table: false until that channel has a reading
+ * - samples()/dropped()/interruptDriven() for diagnostics
+ */
+
+#ifndef ADS_SAMPLER_H
+#define ADS_SAMPLER_H
+
+#include <Arduino.h>
+#include <Adafruit_ADS1X15.h>
+#include <atomic>
+#include "perf_stats.h"
+#include "trace_buffer.h"
+#include "async_log.h"
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define ADS_MAX_CHANNELS       4
+#define ADS_MAX_OVERSAMPLE     6      // 2^6 conversions; keeps the Q8 sum in 31 bits
+#define ADS_RING_SIZE          32     // Readings buffered for loop(); power of two
+#define ADS_FILTER_SHIFT       3      // Moving average weight 1/8 per reading
+#define ADS_TASK_STACK         3072
+#define ADS_TASK_PRIORITY      2      // Above the OTA tasks: a read is short
+#define ADS_TASK_CORE          0
+
+// One scanned input
+struct AdsChannel {
+    uint8_t input;        // A0-A3, single-ended
+    adsGain_t gain;       // Full scale for this input
+    uint16_t rate;        // RATE_ADS1115_*SPS
+    uint8_t oversample;   // Log2 of the conversions per reading
+};
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class AdsSampler {
+public:
+    AdsSampler() :
+        _ads(nullptr),
+        _channels(nullptr),
+        _count(0),
+        _ready(nullptr),
+        _head(0),
+        _tail(0),
+        _samples(0),
+        _dropped(0),
+        _interrupts(false) {
+        for (int i = 0; i < ADS_MAX_CHANNELS; i++) {
+            _filtered[i] = 0;
+            _primed[i] = false;
+        }
+    }
+
+    bool begin(Adafruit_ADS1115& ads, const AdsChannel* channels, uint8_t count, int alertPin) {
+        if (count == 0 || count > ADS_MAX_CHANNELS) return false;
+        for (uint8_t i = 0; i < count; i++) {
+            if (channels[i].input > 3 || channels[i].oversample > ADS_MAX_OVERSAMPLE) return false;
+        }
+        _ads = &ads;
+        _channels = channels;
+        _count = count;
+        _ready = xQueueCreate(1, sizeof(uint8_t));
+        if (!_ready) return false;
+
+        pinMode(alertPin, INPUT_PULLUP);  // ALERT/RDY is open-drain
+        attachInterruptArg(digitalPinToInterrupt(alertPin), onReady, this, FALLING);
+
+        xTaskCreatePinnedToCore(sampleTask, "ads", ADS_TASK_STACK, this, ADS_TASK_PRIORITY,
+                                nullptr, ADS_TASK_CORE);
+        uint32_t roundMs = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            roundMs += periodMs(channels[i].rate) * ((1u << channels[i].oversample) + 1);
+        }
+        LOG_I(LOG_SYS, "   ADS1115 scanning %u inputs, %lu ms per round, RDY on GPIO %d",
+              count, (unsigned long)roundMs, alertPin);
+        return true;
+    }
+
+    // loop() side: takes what the task has queued and returns the
+    // filtered reading of one slot in Q8 counts. No I2C.
+    bool read(uint8_t slot, int32_t& q8) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        uint32_t head = _head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            const Reading& r = _ring[tail % ADS_RING_SIZE];
+            if (!_primed[r.slot]) {
+                _filtered[r.slot] = r.q8;
+                _primed[r.slot] = true;
+            } else {
+                _filtered[r.slot] += (r.q8 - _filtered[r.slot]) >> ADS_FILTER_SHIFT;
+            }
+        }
+        _tail.store(tail, std::memory_order_release);
+        if (slot >= _count || !_primed[slot]) return false;
+        q8 = _filtered[slot];
+        return true;
+    }
+
+    // The same reading scaled by the slot's own full-scale range
+    bool readMicrovolts(uint8_t slot, int32_t& uv) {
+        int32_t q8;
+        if (!read(slot, q8)) return false;
+        // Full scale is +/-32768 counts, so Q8 counts span 2^23
+        uv = (int32_t)(((int64_t)q8 * fullScaleMicrovolts(_channels[slot].gain)) >> 23);
+        return true;
+    }
+
+    uint8_t channels() const { return _count; }
+    uint32_t samples() const { return _samples.load(); }
+    uint32_t dropped() const { return _dropped.load(); }
+    bool interruptDriven() const { return _interrupts.load(); }
+
+private:
+    struct Reading {
+        uint8_t slot;
+        int32_t q8;
+    };
+
+    Adafruit_ADS1115* _ads;
+    const AdsChannel* _channels;
+    uint8_t _count;
+    QueueHandle_t _ready;          // One token per RDY pulse
+    Reading _ring[ADS_RING_SIZE];
+    std::atomic<uint32_t> _head;   // Written by the task only
+    std::atomic<uint32_t> _tail;   // Written by loop() only
+    std::atomic<uint32_t> _samples;
+    std::atomic<uint32_t> _dropped;
+    std::atomic<bool> _interrupts;
+    int32_t _filtered[ADS_MAX_CHANNELS];  // Q8 counts, loop() only
+    bool _primed[ADS_MAX_CHANNELS];
+
+    static uint32_t periodMs(uint16_t rate) {
+        switch (rate) {
+            case RATE_ADS1115_8SPS: return 125;
+            case RATE_ADS1115_16SPS: return 63;
+            case RATE_ADS1115_32SPS: return 32;
+            case RATE_ADS1115_64SPS: return 16;
+            case RATE_ADS1115_128SPS: return 8;
+            case RATE_ADS1115_250SPS: return 4;
+            default: return 2;
+        }
+    }
+
+    static int32_t fullScaleMicrovolts(adsGain_t gain) {
+        switch (gain) {
+            case GAIN_TWOTHIRDS: return 6144000;
+            case GAIN_ONE: return 4096000;
+            case GAIN_TWO: return 2048000;
+            case GAIN_FOUR: return 1024000;
+            case GAIN_EIGHT: return 512000;
+            default: return 256000;
+        }
+    }
+
+    static void IRAM_ATTR onReady(void* arg) {
+        AdsSampler* self = (AdsSampler*)arg;
+        uint8_t token = 0;
+        BaseType_t woken = pdFALSE;
+        xQueueSendFromISR(self->_ready, &token, &woken);  // Full: a read is already due
+        if (woken) portYIELD_FROM_ISR();
+    }
+
+    static void sampleTask(void* arg) {
+        AdsSampler* self = (AdsSampler*)arg;
+        traceThreadName("ads");
+        self->run();
+    }
+
+    void run() {
+        static const uint16_t MUX[4] = {ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+                                        ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3};
+        for (uint8_t slot = 0;; slot = (slot + 1) % _count) {
+            const AdsChannel& ch = _channels[slot];
+            uint32_t waitMs = periodMs(ch.rate) * 2;
+            {
+                PERF_SCOPE(PERF_I2C_ADS);
+                _ads->setGain(ch.gain);
+                _ads->setDataRate(ch.rate);
+                _ads->startADCReading(MUX[ch.input], /*continuous=*/true);
+            }
+            uint8_t token;
+            xQueueReceive(_ready, &token, 0);  // RDY from the previous channel
+
+            // First conversion after the switch is discarded as settling
+            int32_t sum = 0;
+            int n = 1 << ch.oversample;
+            for (int i = -1; i < n; i++) {
+                // A missed or unwired RDY just turns this into a poll
+                if (xQueueReceive(_ready, &token, pdMS_TO_TICKS(waitMs)) == pdTRUE) {
+                    _interrupts = true;
+                }
+                int16_t sample;
+                {
+                    PERF_SCOPE(PERF_I2C_ADS);
+                    TRACE_BEGIN("sensors", "adsRead");
+                    sample = _ads->getLastConversionResults();
+                    TRACE_END("sensors", "adsRead");
+                }
+                if (i >= 0) sum += sample;
+            }
+            push(slot, (sum * 256) >> ch.oversample);  // Decimate to Q8 counts
+        }
+    }
+
+    void push(uint8_t slot, int32_t q8) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == ADS_RING_SIZE) {
+            _dropped++;  // loop() stalled for the whole ring; keep the older readings
+            return;
+        }
+        _ring[head % ADS_RING_SIZE] = {slot, q8};
+        _head.store(head + 1, std::memory_order_release);
+        _samples++;
+    }
+};
+
+#endif // ADS_SAMPLER_H
@@ -0,0 +1,114 @@
+/*
+ * =====================================================
+ * AIR QUALITY CALIBRATION FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Turns the sensor voltages into the two VU meter levels (10 = clean).
+ *
+ * AQI comes from the MQ135: its resistance Rs is worked out from the
+ * voltage across the module's load resistor and compared with R0, its
+ * resistance in clean air. R0 differs from part to part, so it is the
+ * per-unit baseline: calibrate() measures it, the caller keeps it in
+ * Preferences.
+ *
+ * CO2 comes from an NDIR sensor's analog output (MH-Z19 style, 0.4 V at
+ * 0 ppm to 2.0 V at full range) on units that have one. The voltage
+ * can't tell: an unconnected input floats to anything. So whether the
+ * sensor is fitted is per-unit configuration, like R0. Without one, CO2
+ * falls back to the MQ135's CO2 curve - the same gas reading, scored
+ * against the CO2 scale.
+ *
+ * Usage:
+ * - setR0(ohms) and setNdir(fitted) once, e.g. from Preferences
+ * - update(mq135Volts, co2Volts) per reading, then aqiLevel()/co2Level()
+ *   and co2Ppm()/ratio()/aqiTenths() for display and history
+ * - calibrate(mq135Volts) in clean outdoor air: returns the new R0
+ */
+
+#ifndef AIR_QUALITY_H
+#define AIR_QUALITY_H
+
+#include <Arduino.h>
+#include <math.h>
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+// MQ135 module
+#define MQ135_SUPPLY_V      5.0f
+#define MQ135_LOAD_OHMS     10000.0f
+#define MQ135_DEFAULT_R0    76630      // Ohms, until calibrated
+#define MQ135_CO2_A         116.6021f  // ppm = A * (Rs/R0)^-B, datasheet CO2 curve
+#define MQ135_CO2_B         2.769f
+#define MQ135_CLEAN_RATIO   0.64f      // Rs/R0 at ~400 ppm: level 10
+#define MQ135_DIRTY_RATIO   0.20f      // Level 0
+
+// NDIR CO2 analog output
+#define CO2_ZERO_V          0.4f
+#define CO2_SPAN_V          1.6f       // 0.4-2.0 V
+#define CO2_RANGE_PPM       5000.0f
+
+// CO2 meter scale
+#define CO2_OUTDOOR_PPM     400.0f     // Calibration reference
+#define CO2_GOOD_PPM        450.0f     // Level 10
+#define CO2_BAD_PPM         2000.0f    // Level 0
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class AirQuality {
+public:
+    AirQuality() : _r0(MQ135_DEFAULT_R0), _ratio(MQ135_CLEAN_RATIO), _co2Ppm(CO2_OUTDOOR_PPM), _ndir(false) {}
+
+    void setR0(uint32_t ohms) { _r0 = ohms ? ohms : MQ135_DEFAULT_R0; }
+    uint32_t r0() const { return _r0; }
+
+    // An NDIR sensor drives the CO2 input; otherwise co2Volts is ignored
+    void setNdir(bool fitted) { _ndir = fitted; }
+
+    void update(float mq135Volts, float co2Volts) {
+        _ratio = resistance(mq135Volts) / _r0;
+        if (_ndir) {
+            _co2Ppm = constrain((co2Volts - CO2_ZERO_V) / CO2_SPAN_V, 0.0f, 1.0f) * CO2_RANGE_PPM;
+        } else {
+            _co2Ppm = MQ135_CO2_A * powf(_ratio, -MQ135_CO2_B);
+        }
+    }
+
+    int aqiLevel() const { return (aqiTenths() + 5) / 10; }
+    int co2Level() const { return (tenths(-_co2Ppm, -CO2_BAD_PPM, -CO2_GOOD_PPM) + 5) / 10; }
+    int aqiTenths() const { return tenths(_ratio, MQ135_DIRTY_RATIO, MQ135_CLEAN_RATIO); }  // 0-100
+
+    float ratio() const { return _ratio; }
+    float co2Ppm() const { return _co2Ppm; }
+    bool hasNdir() const { return _ndir; }
+
+    // R0 that puts this reading on the curve at outdoor CO2
+    static uint32_t calibrate(float mq135Volts) {
+        float cleanRatio = powf(CO2_OUTDOOR_PPM / MQ135_CO2_A, -1.0f / MQ135_CO2_B);
+        return (uint32_t)(resistance(mq135Volts) / cleanRatio + 0.5f);
+    }
+
+private:
+    uint32_t _r0;
+    float _ratio;    // Rs/R0 at the last update
+    float _co2Ppm;
+    bool _ndir;      // CO2 from the NDIR sensor, not the MQ135 curve
+
+    // Rs from the divider: Vout = Vc * RL / (Rs + RL)
+    static float resistance(float volts) {
+        volts = constrain(volts, 0.01f, MQ135_SUPPLY_V);
+        return MQ135_LOAD_OHMS * (MQ135_SUPPLY_V - volts) / volts;
+    }
+
+    // 0 at 'worst', 100 at 'best', linear between. Clamped before the
+    // cast: a saturated MQ135 gives Rs = 0 and an infinite CO2 estimate.
+    static int tenths(float value, float worst, float best) {
+        float scaled = (value - worst) * 100.0f / (best - worst);
+        return (int)(constrain(scaled, 0.0f, 100.0f) + 0.5f);
+    }
+};
+
+#endif // AIR_QUALITY_H
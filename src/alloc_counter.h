@@ -0,0 +1,97 @@
+/*
+ * =====================================================
+ * HEAP ALLOCATION COUNTER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Counts malloc/calloc/realloc calls made by the loop() task, so
+ * hot paths can be shown to be allocation-free.
+ *
+ * Enabled only in the esp32s3_alloc environment, which builds with
+ * -DALLOC_COUNTER and links with --wrap=malloc,calloc,realloc so
+ * every allocation (Arduino String, new, libraries) passes through
+ * the wrappers below. In normal builds all calls compile to nothing.
+ *
+ * Usage:
+ * 1. allocCounterBegin() in setup() (binds to the loop task)
+ * 2. allocCounterLoopStart() at the top of loop()
+ * 3. allocCounterLoopEnd() at the bottom of loop(); logs a summary
+ *    every ALLOC_REPORT_INTERVAL ms
+ */
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <Arduino.h>
+
+#define ALLOC_REPORT_INTERVAL 10000  // Summary every 10 seconds
+
+#ifdef ALLOC_COUNTER
+
+static TaskHandle_t allocCounterTask = nullptr;
+static volatile uint32_t allocCount = 0;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    if (allocCounterTask && xTaskGetCurrentTaskHandle() == allocCounterTask) allocCount++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    if (allocCounterTask && xTaskGetCurrentTaskHandle() == allocCounterTask) allocCount++;
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (allocCounterTask && xTaskGetCurrentTaskHandle() == allocCounterTask) allocCount++;
+    return __real_realloc(ptr, size);
+}
+}
+
+static uint32_t allocLoopStartCount = 0;
+static uint32_t allocLoops = 0;
+static uint32_t allocLoopsWithAllocs = 0;
+static uint32_t allocMaxPerLoop = 0;
+static unsigned long allocLastReport = 0;
+
+inline void allocCounterBegin() {
+    allocCounterTask = xTaskGetCurrentTaskHandle();
+    Serial.println("[ALLOC] Counting loop() heap allocations");
+}
+
+inline void allocCounterLoopStart() {
+    allocLoopStartCount = allocCount;
+}
+
+inline void allocCounterLoopEnd() {
+    uint32_t n = allocCount - allocLoopStartCount;
+    allocLoops++;
+    if (n > 0) allocLoopsWithAllocs++;
+    if (n > allocMaxPerLoop) allocMaxPerLoop = n;
+
+    unsigned long now = millis();
+    if (now - allocLastReport >= ALLOC_REPORT_INTERVAL) {
+        // Printing happens after the count for this loop was taken
+        Serial.printf("[ALLOC] %lu loops, %lu allocated, max %lu allocs/loop\n",
+                      (unsigned long)allocLoops, (unsigned long)allocLoopsWithAllocs,
+                      (unsigned long)allocMaxPerLoop);
+        allocLastReport = now;
+        allocLoops = 0;
+        allocLoopsWithAllocs = 0;
+        allocMaxPerLoop = 0;
+        allocLoopStartCount = allocCount;
+    }
+}
+
+#else
+
+inline void allocCounterBegin() {}
+inline void allocCounterLoopStart() {}
+inline void allocCounterLoopEnd() {}
+
+#endif // ALLOC_COUNTER
+
+#endif // ALLOC_COUNTER_H
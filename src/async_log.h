@@ -0,0 +1,353 @@
+/*
+ * =====================================================
+ * DEFERRED LOGGER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Serial.printf formats and writes on the caller: at 115200 baud a line
+ * stalls it for milliseconds once the UART FIFO is full. LOG_* calls
+ * instead copy their arguments into a fixed-size binary record in a
+ * ring buffer and return; a low-priority task formats and writes them.
+ *
+ * A record is the format string's address (its ID: formats must be
+ * literals), severity, subsystem and the raw arguments. Integers are
+ * stored at their printf width, floats as double, strings are copied (and cut off
+ * to fit LOG_RECORD_SIZE); pass String as .c_str(). When the buffer
+ * is full new records are dropped and counted, never waited for.
+ *
+ * Levels are per subsystem and can be changed at runtime with
+ * asyncLog.setLevel() (/log in Telegram). Filtered calls cost one
+ * compare.
+ *
+ * Usage:
+ * 1. asyncLog.begin() first thing in setup()
+ * 2. LOG_I(LOG_OTA, "[OTA] Progress: %d%%", progress);  // No "\n"
+ *
+ * The native build formats inline, so output order stays deterministic
+ * for record/replay.
+ */
+
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <atomic>
+#include <type_traits>
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define LOG_SLOTS         256   // Records (power of two)
+#define LOG_RECORD_SIZE   64    // Bytes per record, header included
+#define LOG_LINE_MAX      192   // Longest formatted line
+#define LOG_FLUSH_MS      20    // Writer task poll interval
+#define LOG_TASK_STACK    4096
+#define LOG_TASK_CORE     0     // loop() runs on core 1
+
+enum LogLevel {
+    LOG_ERROR,
+    LOG_WARN,
+    LOG_INFO,
+    LOG_DEBUG,
+    LOG_LEVEL_COUNT
+};
+
+enum LogSubsystem {
+    LOG_SYS,
+    LOG_TOUCH,
+    LOG_UI,
+    LOG_NET,
+    LOG_TG,
+    LOG_MEDIA,
+    LOG_OTA,
+    LOG_SUBSYSTEM_COUNT
+};
+
+static const char* const LOG_LEVEL_NAMES[LOG_LEVEL_COUNT] = {"error", "warn", "info", "debug"};
+static const char* const LOG_SUBSYSTEM_NAMES[LOG_SUBSYSTEM_COUNT] = {
+    "sys", "touch", "ui", "net", "tg", "media", "ota",
+};
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class AsyncLog {
+public:
+    AsyncLog() : _slots(nullptr), _head(0), _tail(0), _dropped(0), _reportedDropped(0) {
+        for (int i = 0; i < LOG_SUBSYSTEM_COUNT; i++) _levels[i] = LOG_INFO;
+    }
+
+    void begin() {
+        _slots = (Record*)heap_caps_calloc(LOG_SLOTS, sizeof(Record), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!_slots) _slots = (Record*)calloc(LOG_SLOTS, sizeof(Record));
+#ifndef NATIVE_BUILD
+        xTaskCreatePinnedToCore(writerTask, "log", LOG_TASK_STACK, this, tskIDLE_PRIORITY + 1,
+                                nullptr, LOG_TASK_CORE);
+#endif
+    }
+
+    bool enabled(LogLevel level, LogSubsystem sub) const {
+        return level <= _levels[sub];
+    }
+
+    template <typename... Args>
+    void write(LogLevel level, LogSubsystem sub, const char* fmt, const Args&... args) {
+        if (!_slots) {
+            Serial.println(fmt);  // Before begin(): at least say something
+            return;
+        }
+
+        // Claim a slot unless the writer is a full lap behind
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        do {
+            if (head - _tail.load(std::memory_order_acquire) >= LOG_SLOTS) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        } while (!_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed));
+
+        Record& r = _slots[head & (LOG_SLOTS - 1)];
+        r.fmt = fmt;
+        r.level = (uint8_t)level;
+        r.sub = (uint8_t)sub;
+        r.len = 0;
+        pack(r, args...);
+        r.stamp.store(head + 1, std::memory_order_release);
+
+#ifdef NATIVE_BUILD
+        drain();
+#endif
+    }
+
+    void setLevel(LogSubsystem sub, LogLevel level) { _levels[sub] = (uint8_t)level; }
+    LogLevel level(LogSubsystem sub) const { return (LogLevel)_levels[sub]; }
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    // Name lookups for /log; -1 if unknown
+    static int subsystemIndex(const char* name, size_t len) {
+        return indexOf(LOG_SUBSYSTEM_NAMES, LOG_SUBSYSTEM_COUNT, name, len);
+    }
+    static int levelIndex(const char* name, size_t len) {
+        return indexOf(LOG_LEVEL_NAMES, LOG_LEVEL_COUNT, name, len);
+    }
+
+    // Formats and writes every complete record; writer task only
+    void drain() {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        while (true) {
+            Record& r = _slots[tail & (LOG_SLOTS - 1)];
+            if (r.stamp.load(std::memory_order_acquire) != tail + 1) break;  // Not yet written
+
+            char line[LOG_LINE_MAX];
+            size_t n = format(r, line, sizeof(line) - 1);
+            line[n++] = '\n';
+            Serial.write((const uint8_t*)line, n);
+
+            tail++;
+            _tail.store(tail, std::memory_order_release);
+        }
+
+        uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+        if (dropped != _reportedDropped) {
+            Serial.printf("[LOG] %lu messages dropped\n", (unsigned long)(dropped - _reportedDropped));
+            _reportedDropped = dropped;
+        }
+    }
+
+private:
+    struct Record {
+        std::atomic<uint32_t> stamp;  // Sequence + 1 once complete
+        const char* fmt;
+        uint8_t level;
+        uint8_t sub;
+        uint8_t len;  // Payload bytes used
+        uint8_t payload[LOG_RECORD_SIZE - 8 - sizeof(const char*)];
+    };
+
+    Record* _slots;
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _tail;
+    std::atomic<uint32_t> _dropped;
+    uint32_t _reportedDropped;
+    volatile uint8_t _levels[LOG_SUBSYSTEM_COUNT];
+
+#ifndef NATIVE_BUILD
+    static void writerTask(void* arg) {
+        AsyncLog* log = (AsyncLog*)arg;
+        while (true) {
+            log->drain();
+            vTaskDelay(pdMS_TO_TICKS(LOG_FLUSH_MS));
+        }
+    }
+#endif
+
+    static int indexOf(const char* const* names, int count, const char* name, size_t len) {
+        for (int i = 0; i < count; i++) {
+            if (strlen(names[i]) == len && strncasecmp(names[i], name, len) == 0) return i;
+        }
+        return -1;
+    }
+
+    // ---------- Packing (caller side) ----------
+
+    static void pack(Record& r) { (void)r; }
+
+    template <typename T, typename... Rest>
+    static void pack(Record& r, const T& first, const Rest&... rest) {
+        packOne(r, first);
+        pack(r, rest...);
+    }
+
+    static void packBytes(Record& r, const void* data, size_t len) {
+        if (r.len + len > sizeof(r.payload)) {
+            r.len = sizeof(r.payload);  // Out of room: later arguments read as missing
+            return;
+        }
+        memcpy(r.payload + r.len, data, len);
+        r.len += len;
+    }
+
+    template <typename T>
+    static void packOne(Record& r, const T& value) {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                      "LOG_* arguments must be numbers or C strings");
+        // Same widths as printf varargs: the formatter reads them back
+        // by length modifier, and logFormatCheck() keeps the two in step
+        if (std::is_floating_point<T>::value) {
+            double d = (double)value;
+            packBytes(r, &d, sizeof(d));
+        } else if (sizeof(T) > sizeof(int32_t)) {
+            int64_t v = (int64_t)value;
+            packBytes(r, &v, sizeof(v));
+        } else {
+            int32_t v = (int32_t)value;
+            packBytes(r, &v, sizeof(v));
+        }
+    }
+
+    static void packOne(Record& r, const char* s) {
+        if (!s) s = "(null)";
+        size_t room = sizeof(r.payload) - r.len;
+        if (room == 0) return;
+        size_t len = 0;
+        while (len < room - 1 && s[len]) {
+            r.payload[r.len + len] = s[len];
+            len++;
+        }
+        r.payload[r.len + len] = '\0';
+        r.len += len + 1;
+    }
+    static void packOne(Record& r, char* s) { packOne(r, (const char*)s); }
+    template <size_t N>
+    static void packOne(Record& r, const char (&s)[N]) { packOne(r, (const char*)s); }
+    template <size_t N>
+    static void packOne(Record& r, char (&s)[N]) { packOne(r, (const char*)s); }
+
+    // ---------- Formatting (writer side) ----------
+
+    // Walks the format and prints each conversion from the payload
+    static size_t format(const Record& r, char* out, size_t size) {
+        size_t n = 0;
+        size_t pos = 0;
+        const char* f = r.fmt;
+
+        while (*f && n < size) {
+            if (*f != '%') {
+                out[n++] = *f++;
+                continue;
+            }
+            if (f[1] == '%') {
+                out[n++] = '%';
+                f += 2;
+                continue;
+            }
+
+            // Copy flags/width/precision; the length modifier gives the
+            // stored integer width
+            char spec[16];
+            size_t s = 0;
+            spec[s++] = *f++;
+            while (*f && strchr("-+ #0123456789.", *f) && s < sizeof(spec) - 4) spec[s++] = *f++;
+            size_t width = sizeof(int32_t);
+            int longs = 0;
+            while (*f && strchr("hlLzjt", *f)) {
+                if (*f == 'l') width = ++longs > 1 ? sizeof(long long) : sizeof(long);
+                if (*f == 'z') width = sizeof(size_t);
+                if (*f == 'j') width = sizeof(intmax_t);
+                if (*f == 't') width = sizeof(ptrdiff_t);
+                f++;
+            }
+            char conv = *f;
+            if (!conv) break;
+            f++;
+
+            int written = 0;
+            size_t room = size - n + 1;  // snprintf counts the NUL
+            if (conv == 's') {
+                spec[s++] = 's';
+                spec[s] = '\0';
+                const char* str = pos < r.len ? (const char*)r.payload + pos : "?";
+                if (pos < r.len) pos += strlen(str) + 1;
+                written = snprintf(out + n, room, spec, str);
+            } else if (strchr("fFeEgGaA", conv)) {
+                if (pos + sizeof(double) > r.len) {
+                    written = snprintf(out + n, room, "?");
+                    n += min((size_t)written, size - n);
+                    continue;
+                }
+                double d;
+                memcpy(&d, r.payload + pos, sizeof(d));
+                pos += 8;
+                spec[s++] = conv;
+                spec[s] = '\0';
+                written = snprintf(out + n, room, spec, d);
+            } else if (pos + width > r.len) {
+                written = snprintf(out + n, room, "?");
+            } else {
+                int64_t v;
+                if (width == sizeof(int32_t)) {
+                    int32_t v32;
+                    memcpy(&v32, r.payload + pos, sizeof(v32));
+                    v = strchr("di", conv) ? (int64_t)v32 : (int64_t)(uint32_t)v32;
+                } else {
+                    memcpy(&v, r.payload + pos, sizeof(v));
+                }
+                pos += width;
+                if (conv == 'c') {
+                    spec[s++] = 'c';
+                    spec[s] = '\0';
+                    written = snprintf(out + n, room, spec, (int)v);
+                } else {
+                    spec[s++] = 'l';
+                    spec[s++] = 'l';
+                    spec[s++] = conv;
+                    spec[s] = '\0';
+                    written = snprintf(out + n, room, spec, (long long)v);
+                }
+            }
+            if (written > 0) n += min((size_t)written, size - n);
+        }
+        return n;
+    }
+};
+
+static AsyncLog asyncLog;
+
+// Never called: lets the compiler check LOG_* formats against arguments
+inline void logFormatCheck(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+inline void logFormatCheck(const char* fmt, ...) { (void)fmt; }
+
+#define LOG_AT(level, sub, fmt, ...)                                        \
+    do {                                                                    \
+        if (false) logFormatCheck(fmt, ##__VA_ARGS__);                      \
+        if (asyncLog.enabled(level, sub)) asyncLog.write(level, sub, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+#define LOG_E(sub, fmt, ...)  LOG_AT(LOG_ERROR, sub, fmt, ##__VA_ARGS__)
+#define LOG_W(sub, fmt, ...)  LOG_AT(LOG_WARN, sub, fmt, ##__VA_ARGS__)
+#define LOG_I(sub, fmt, ...)  LOG_AT(LOG_INFO, sub, fmt, ##__VA_ARGS__)
+#define LOG_D(sub, fmt, ...)  LOG_AT(LOG_DEBUG, sub, fmt, ##__VA_ARGS__)
+
+#endif // ASYNC_LOG_H
@@ -0,0 +1,162 @@
+/*
+ * =====================================================
+ * TELEGRAM COMMAND TABLE FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Table-driven dispatch for chat commands. Replaces the chain of
+ * toLowerCase() / indexOf() / == checks in checkTelegram().
+ *
+ * How it works:
+ * 1. splitCommand() views the message text in place: the first
+ *    word (minus any "@botname" suffix) and the trimmed remainder.
+ *    Nothing is copied or lowercased.
+ * 2. findCommand() binary-searches a sorted table of lowercase names
+ *    (commands and aliases like "in", "riding", "bail") with a
+ *    case-insensitive compare: O(log n), no allocation.
+ *    Entries flagged CMD_ANYWHERE ("/commit", "/uncommit") are also
+ *    found anywhere in the text by findCommandAnywhere(), a linear scan.
+ * 3. The handler gets a CommandContext with the chat id, the sender's
+ *    friend index and the argument view.
+ *
+ * The table must be sorted by name (byte order); COMMAND_TABLE_SORTED()
+ * checks that at compile time.
+ *
+ * Plain C++ with no Arduino dependencies.
+ */
+
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+// ============================================================
+// STRING VIEW
+// ============================================================
+
+// Non-owning view into a character buffer
+struct StrView {
+    const char* ptr;
+    size_t len;
+
+    StrView() : ptr(""), len(0) {}
+    StrView(const char* p, size_t n) : ptr(p), len(n) {}
+
+    bool empty() const {
+        return len == 0;
+    }
+
+    // Case-insensitive compare against a lowercase NUL-terminated name.
+    // Returns <0, 0, >0 like strcmp.
+    int compareNoCase(const char* name) const {
+        size_t i = 0;
+        for (; i < len && name[i]; i++) {
+            int a = tolower((unsigned char)ptr[i]);
+            int b = (unsigned char)name[i];
+            if (a != b) return a - b;
+        }
+        if (i < len) return 1;        // View is longer
+        return name[i] ? -1 : 0;      // Name is longer, or equal
+    }
+};
+
+inline bool isCommandSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Split "/cmd@botname  args..." into the command word and its arguments.
+// Leading/trailing whitespace is skipped; the text is not modified.
+inline StrView splitCommand(const char* text, StrView* args) {
+    while (isCommandSpace(*text)) text++;
+
+    const char* wordEnd = text;
+    while (*wordEnd && !isCommandSpace(*wordEnd)) wordEnd++;
+
+    // Group chats address commands as /cmd@botname
+    const char* nameEnd = text;
+    while (nameEnd < wordEnd && *nameEnd != '@') nameEnd++;
+    if (*text != '/') nameEnd = wordEnd;
+
+    if (args) {
+        const char* a = wordEnd;
+        while (isCommandSpace(*a)) a++;
+        const char* end = a + strlen(a);
+        while (end > a && isCommandSpace(end[-1])) end--;
+        *args = StrView(a, end - a);
+    }
+    return StrView(text, nameEnd - text);
+}
+
+// Case-insensitive search for a lowercase name anywhere in the text
+inline bool containsNoCase(const char* text, const char* name) {
+    for (; *text; text++) {
+        size_t i = 0;
+        while (name[i] && tolower((unsigned char)text[i]) == (unsigned char)name[i]) i++;
+        if (!name[i]) return true;
+    }
+    return false;
+}
+
+// ============================================================
+// COMMAND TABLE
+// ============================================================
+
+#define CMD_FRIENDS_ONLY   0x01  // Ignored unless the sender is in friends[]
+#define CMD_WHOLE_MESSAGE  0x02  // Must be the entire message ("in", not "in later")
+#define CMD_ANYWHERE       0x04  // Also found anywhere in the text ("see you there /commit")
+
+struct CommandContext {
+    int64_t chatId;
+    int friendIdx;   // -1 if the sender is not a friend
+    StrView args;
+};
+
+typedef void (*CommandHandler)(const CommandContext& ctx);
+
+struct CommandEntry {
+    const char* name;   // Lowercase, table sorted by this field
+    CommandHandler handler;
+    uint8_t flags;
+};
+
+// Binary search; returns nullptr if the word is not a command
+inline const CommandEntry* findCommand(const CommandEntry* table, size_t count, StrView word) {
+    if (word.empty()) return nullptr;
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int cmp = word.compareNoCase(table[mid].name);
+        if (cmp == 0) return &table[mid];
+        if (cmp < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return nullptr;
+}
+
+// Linear scan of the CMD_ANYWHERE entries, in table order
+inline const CommandEntry* findCommandAnywhere(const CommandEntry* table, size_t count, const char* text) {
+    for (size_t i = 0; i < count; i++) {
+        if ((table[i].flags & CMD_ANYWHERE) && containsNoCase(text, table[i].name)) return &table[i];
+    }
+    return nullptr;
+}
+
+// ---------- Compile-time sort check (C++11 constexpr recursion) ----------
+
+constexpr bool commandNameLess(const char* a, const char* b) {
+    return (*a == *b) ? (*a != '\0' && commandNameLess(a + 1, b + 1))
+                      : ((unsigned char)*a < (unsigned char)*b);
+}
+
+constexpr bool commandTableSorted(const CommandEntry* table, size_t count) {
+    return count < 2 || (commandNameLess(table[0].name, table[1].name) &&
+                         commandTableSorted(table + 1, count - 1));
+}
+
+#define COMMAND_TABLE_SORTED(table) \
+    static_assert(commandTableSorted(table, sizeof(table) / sizeof(table[0])), \
+                  #table " must be sorted by name")
+
+#endif // COMMAND_TABLE_H
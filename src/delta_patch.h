@@ -0,0 +1,175 @@
+/*
+ * =====================================================
+ * DELTA PATCH READER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Rebuilds a new firmware image from the running one and a downloaded
+ * patch made by tools/make_delta.py (format described there). Output
+ * comes out in order, so it streams straight into the OTA buffers; the
+ * old image is read from flash in small pieces as the patch asks.
+ *
+ * Usage:
+ * - begin(patch, readSource, ctx): 'patch' yields the decompressed
+ *   patch bytes; readSource(ctx, offset, buf, len) reads the old image
+ * - header() until it returns 1, then check sourceSize()/sourceMd5()
+ *   against the running image before writing anything
+ * - read(buf, len) like GzipStream::read: bytes, 0 = waiting, -1 = bad
+ */
+
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <Arduino.h>
+#include "gzip_stream.h"
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define DELTA_SOURCE_CHUNK  1024   // Old-image bytes read from flash at a time
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class DeltaPatch {
+public:
+    typedef bool (*SourceReader)(void* ctx, uint32_t offset, uint8_t* buf, size_t len);
+
+    DeltaPatch() : _patch(nullptr), _readSource(nullptr), _ctx(nullptr) { reset(); }
+
+    void begin(GzipStream* patch, SourceReader readSource, void* ctx) {
+        reset();
+        _patch = patch;
+        _readSource = readSource;
+        _ctx = ctx;
+    }
+
+    // 1 once the header is in, 0 while waiting for it, -1 if not a patch
+    int header() {
+        if (_failed) return -1;
+        if (_headerDone) return 1;
+        if (!fill(_fixed, HEADER_SIZE)) return _failed ? -1 : 0;
+        if (memcmp(_fixed, "FYD1", 4) != 0) {
+            _failed = true;
+            return -1;
+        }
+        _sourceSize = le32(_fixed + 4);
+        memcpy(_sourceMd5, _fixed + 8, 16);
+        _targetSize = le32(_fixed + 24);
+        _fixedLen = 0;
+        _headerDone = true;
+        return 1;
+    }
+
+    uint32_t sourceSize() const { return _sourceSize; }
+    uint32_t targetSize() const { return _targetSize; }
+    const uint8_t* sourceMd5() const { return _sourceMd5; }
+
+    int read(uint8_t* out, size_t len) {
+        if (header() != 1) return _failed ? -1 : 0;
+        size_t produced = 0;
+
+        while (produced < len && _produced < _targetSize) {
+            // Next record; the previous one's seek applies first
+            if (_diffLeft == 0 && _extraLeft == 0) {
+                if (!fill(_fixed, RECORD_SIZE)) {
+                    if (_failed) return -1;
+                    break;
+                }
+                _fixedLen = 0;
+                _srcPos += _seek;
+                _diffLeft = le32(_fixed);
+                _extraLeft = le32(_fixed + 4);
+                _seek = (int32_t)le32(_fixed + 8);
+                if ((uint64_t)_produced + _diffLeft + _extraLeft > _targetSize ||
+                    (int64_t)_srcPos < 0 || (uint64_t)_srcPos + _diffLeft > _sourceSize) {
+                    _failed = true;
+                    return -1;
+                }
+                continue;
+            }
+
+            uint8_t* dst = out + produced;
+            size_t want = len - produced;
+            want = min(want, (size_t)(_diffLeft > 0 ? min(_diffLeft, (uint32_t)DELTA_SOURCE_CHUNK) : _extraLeft));
+            int n = _patch->read(dst, want);
+            if (n < 0) {
+                _failed = true;
+                return -1;
+            }
+            if (n == 0) break;
+
+            if (_diffLeft > 0) {
+                // Add the old image under the patch bytes
+                uint8_t src[DELTA_SOURCE_CHUNK];
+                if (!_readSource(_ctx, (uint32_t)_srcPos, src, n)) {
+                    _failed = true;
+                    return -1;
+                }
+                for (int i = 0; i < n; i++) dst[i] += src[i];
+                _srcPos += n;
+                _diffLeft -= n;
+            } else {
+                _extraLeft -= n;
+            }
+            produced += n;
+            _produced += n;
+        }
+        return (int)produced;
+    }
+
+    // Every target byte has been produced
+    bool done() const { return _headerDone && _produced == _targetSize; }
+
+private:
+    static const size_t HEADER_SIZE = 28;
+    static const size_t RECORD_SIZE = 12;
+
+    GzipStream* _patch;
+    SourceReader _readSource;
+    void* _ctx;
+
+    uint8_t _fixed[HEADER_SIZE];  // Header or record being assembled
+    size_t _fixedLen;
+    bool _headerDone;
+    bool _failed;
+    uint32_t _sourceSize;
+    uint8_t _sourceMd5[16];
+    uint32_t _targetSize;
+    uint32_t _produced;
+    int64_t _srcPos;
+    uint32_t _diffLeft;
+    uint32_t _extraLeft;
+    int32_t _seek;
+
+    void reset() {
+        _fixedLen = 0;
+        _headerDone = false;
+        _failed = false;
+        _sourceSize = 0;
+        _targetSize = 0;
+        _produced = 0;
+        _srcPos = 0;
+        _diffLeft = 0;
+        _extraLeft = 0;
+        _seek = 0;
+    }
+
+    // Collects a fixed-size field across reads; true once complete
+    bool fill(uint8_t* buf, size_t size) {
+        while (_fixedLen < size) {
+            int n = _patch->read(buf + _fixedLen, size - _fixedLen);
+            if (n < 0) _failed = true;
+            if (n <= 0) return false;
+            _fixedLen += n;
+        }
+        return true;
+    }
+
+    static uint32_t le32(const uint8_t* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+};
+
+#endif // DELTA_PATCH_H
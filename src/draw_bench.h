@@ -0,0 +1,305 @@
+/*
+ * =====================================================
+ * DRAW BENCHMARK FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Renders each UI widget on its own into the native framebuffer and
+ * reports what it cost: pixels written, pixels actually changed,
+ * primitive calls and wall time. Every widget is checked against a
+ * golden image and against the last recorded baseline.
+ *
+ * Enabled only in the native_bench environment (-DDRAW_BENCH on top
+ * of [env:native]); main.cpp runs the cases from setup() and exits
+ * with the result, so it can gate a CI job.
+ *
+ * Files (in $DRAW_BENCH_DIR, default "bench"):
+ * - <case>.ppm    golden image (PPM, open with any image viewer);
+ *                 committed, since the framebuffer output is the same
+ *                 on every host
+ * - baseline.txt  "<case> <pixels> <calls> <us>" per line; not
+ *                 committed, since times are per machine
+ * Run with DRAW_BENCH_UPDATE=1 to (re)record both after an intended
+ * visual or performance change, and commit the new goldens. Without a
+ * baseline.txt (fresh checkout or CI runner) a run records one and
+ * still checks every image; see [env:native_bench] in platformio.ini.
+ *
+ * A case fails when its golden is missing or its image differs, when
+ * it writes more pixels or makes more calls than the baseline, or when
+ * its best time is more than DRAW_BENCH_MAX_SLOWDOWN percent slower.
+ * Times are host times: only compare baselines recorded on the same
+ * machine.
+ *
+ * Usage:
+ *   drawBench.begin(gfx);
+ *   drawBench.measure("name", prepareFn, drawFn);  // per case
+ *   exit(drawBench.finish());
+ */
+
+#ifndef DRAW_BENCH_H
+#define DRAW_BENCH_H
+
+#ifdef DRAW_BENCH
+
+#ifndef NATIVE_BUILD
+#error "DRAW_BENCH needs the native framebuffer, build it with -e native_bench"
+#endif
+
+#include <Arduino.h>
+#include <Arduino_GFX_Library.h>
+#include "native_hal.h"
+#include <sys/stat.h>
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define DRAW_BENCH_ITERATIONS    200  // Timed runs per case, best one counts
+#define DRAW_BENCH_MAX_SLOWDOWN  25   // Percent over baseline before failing
+#define DRAW_BENCH_SLACK_US      10   // Plus this, so tiny cases don't flap
+#define DRAW_BENCH_MAX_CASES     24
+#define DRAW_BENCH_NAME_LEN      24
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class DrawBench {
+public:
+    typedef void (*Step)();
+
+    DrawBench() :
+        _gfx(nullptr),
+        _before(nullptr),
+        _count(0),
+        _baselineCount(0),
+        _failures(0),
+        _update(false),
+        _recordBaseline(false) {
+        _dir[0] = '\0';
+    }
+
+    void begin(Arduino_GFX* gfx) {
+        _gfx = gfx;
+        _before = (uint16_t*)malloc((size_t)gfx->width() * gfx->height() * sizeof(uint16_t));
+
+        const char* dir = getenv("DRAW_BENCH_DIR");
+        snprintf(_dir, sizeof(_dir), "%s", dir ? dir : "bench");
+        const char* update = getenv("DRAW_BENCH_UPDATE");
+        _update = update && *update && *update != '0';
+        if (_update) mkdir(_dir, 0755);
+
+        _recordBaseline = !loadBaseline() || _update;
+        Serial.printf("[BENCH] %s goldens in %s/, %s baseline, %d timed runs per case\n",
+                      _update ? "Recording" : "Checking", _dir, _recordBaseline ? "recording the" : "checking the",
+                      DRAW_BENCH_ITERATIONS);
+        Serial.printf("[BENCH] %-18s %9s %9s %6s %9s %9s  %s\n",
+                      "case", "written", "changed", "calls", "best us", "Mpx/s", "result");
+    }
+
+    // 'prepare' sets the state the widget draws from and runs before
+    // every draw (untimed); the screen is cleared before the first one.
+    void measure(const char* name, Step prepare, Step draw) {
+        if (_count >= DRAW_BENCH_MAX_CASES) return;
+        Result& r = _results[_count++];
+        snprintf(r.name, sizeof(r.name), "%s", name);
+
+        int w = _gfx->width(), h = _gfx->height();
+        size_t pixels = (size_t)w * h;
+
+        // Single reference draw: counts and image
+        _gfx->fillScreen(RGB565_BLACK);
+        if (prepare) prepare();
+        memcpy(_before, _gfx->framebuffer(), pixels * sizeof(uint16_t));
+        _gfx->resetCounters();
+        draw();
+        r.written = _gfx->pixelsWritten();
+        r.calls = _gfx->callCounts().total();
+        r.changed = 0;
+        uint16_t* fb = _gfx->framebuffer();
+        for (size_t i = 0; i < pixels; i++) {
+            if (fb[i] != _before[i]) r.changed++;
+        }
+        long mismatch = checkGolden(r.name);
+
+        // Timed draws; the best run is the least disturbed by the host
+        r.bestUs = 0xFFFFFFFF;
+        for (int i = 0; i < DRAW_BENCH_ITERATIONS; i++) {
+            if (prepare) prepare();
+            unsigned long start = micros();
+            draw();
+            unsigned long us = micros() - start;
+            if (us < r.bestUs) r.bestUs = us;
+        }
+        if (r.bestUs == 0) r.bestUs = 1;
+
+        report(r, mismatch);
+    }
+
+    // Prints the summary, writes the baseline in update mode.
+    // Returns the process exit code: 0 when every case passed.
+    int finish() {
+        if (_recordBaseline) saveBaseline();
+        Serial.printf("[BENCH] %d cases, %d failed\n", _count, _failures);
+        if (_recordBaseline && !_update) {
+            Serial.printf("[BENCH] No baseline.txt in %s/ yet: recorded this machine's, next run checks it\n", _dir);
+        }
+        free(_before);
+        _before = nullptr;
+        return _failures ? 1 : 0;
+    }
+
+private:
+    struct Result {
+        char name[DRAW_BENCH_NAME_LEN];
+        uint32_t written;
+        uint32_t changed;
+        uint32_t calls;
+        uint32_t bestUs;
+    };
+
+    Arduino_GFX* _gfx;
+    uint16_t* _before;
+    char _dir[128];
+    Result _results[DRAW_BENCH_MAX_CASES];
+    Result _baseline[DRAW_BENCH_MAX_CASES];
+    int _count;
+    int _baselineCount;
+    int _failures;
+    bool _update;
+    bool _recordBaseline;  // No baseline.txt yet, or updating
+
+    void report(const Result& r, long mismatch) {
+        char verdict[96];
+        int n = 0;
+        verdict[0] = '\0';
+
+        if (mismatch < 0) {
+            n += snprintf(verdict + n, sizeof(verdict) - n, "NO GOLDEN ");
+        } else if (mismatch > 0) {
+            n += snprintf(verdict + n, sizeof(verdict) - n, "IMAGE %ld px ", mismatch);
+        }
+
+        const Result* base = _recordBaseline ? nullptr : findBaseline(r.name);
+        if (!base) {
+            if (!_recordBaseline) n += snprintf(verdict + n, sizeof(verdict) - n, "NO BASELINE ");
+        } else {
+            if (r.written > base->written) {
+                n += snprintf(verdict + n, sizeof(verdict) - n, "PIXELS +%lu ",
+                              (unsigned long)(r.written - base->written));
+            }
+            if (r.calls > base->calls) {
+                n += snprintf(verdict + n, sizeof(verdict) - n, "CALLS +%lu ",
+                              (unsigned long)(r.calls - base->calls));
+            }
+            uint64_t limit = (uint64_t)base->bestUs * (100 + DRAW_BENCH_MAX_SLOWDOWN) / 100 +
+                             DRAW_BENCH_SLACK_US;
+            if (r.bestUs > limit) {
+                n += snprintf(verdict + n, sizeof(verdict) - n, "SLOWER %lu->%lu us ",
+                              (unsigned long)base->bestUs, (unsigned long)r.bestUs);
+            }
+        }
+
+        // Every finding fails the run, except while recording
+        if (n > 0 && !_update) _failures++;
+        if (n == 0) snprintf(verdict, sizeof(verdict), _update ? "recorded" : "ok");
+
+        Serial.printf("[BENCH] %-18s %9lu %9lu %6lu %9lu %9.1f  %s\n", r.name,
+                      (unsigned long)r.written, (unsigned long)r.changed, (unsigned long)r.calls,
+                      (unsigned long)r.bestUs, (double)r.written / r.bestUs, verdict);
+    }
+
+    // ---------- Golden images ----------
+
+    // Pixels differing from the golden, or -1 if there is none.
+    // In update mode the current image becomes the golden.
+    long checkGolden(const char* name) {
+        char path[192];
+        snprintf(path, sizeof(path), "%s/%s.ppm", _dir, name);
+        if (_update) {
+            if (!nativeWriteFramebuffer(path)) {
+                Serial.printf("[BENCH] Could not write %s\n", path);
+            }
+            return 0;
+        }
+
+        FILE* f = fopen(path, "rb");
+        if (!f) return -1;
+        int w = 0, h = 0, maxVal = 0;
+        if (fscanf(f, "P6 %d %d %d", &w, &h, &maxVal) != 3 || fgetc(f) == EOF ||
+            w != _gfx->width() || h != _gfx->height() || maxVal != 255) {
+            fclose(f);
+            return (long)_gfx->width() * _gfx->height();  // Unreadable: all differ
+        }
+
+        // Compare in the 8-bit space nativeWriteFramebuffer() produces
+        long mismatch = 0;
+        uint16_t* fb = _gfx->framebuffer();
+        uint8_t rgb[3];
+        for (long i = 0; i < (long)w * h; i++) {
+            if (fread(rgb, 1, 3, f) != 3) {
+                mismatch += (long)w * h - i;
+                break;
+            }
+            uint16_t p = fb[i];
+            if (rgb[0] != ((p >> 11) & 0x1F) * 255 / 31 ||
+                rgb[1] != ((p >> 5) & 0x3F) * 255 / 63 ||
+                rgb[2] != (p & 0x1F) * 255 / 31) {
+                mismatch++;
+            }
+        }
+        fclose(f);
+        return mismatch;
+    }
+
+    // ---------- Baseline ----------
+
+    // False if there is no baseline.txt
+    bool loadBaseline() {
+        _baselineCount = 0;
+        char path[192];
+        snprintf(path, sizeof(path), "%s/baseline.txt", _dir);
+        FILE* f = fopen(path, "r");
+        if (!f) return false;
+
+        Result r;
+        unsigned long written, calls, us;
+        while (_baselineCount < DRAW_BENCH_MAX_CASES &&
+               fscanf(f, "%23s %lu %lu %lu", r.name, &written, &calls, &us) == 4) {
+            r.written = written;
+            r.calls = calls;
+            r.bestUs = us;
+            r.changed = 0;
+            _baseline[_baselineCount++] = r;
+        }
+        fclose(f);
+        return true;
+    }
+
+    void saveBaseline() {
+        char path[192];
+        snprintf(path, sizeof(path), "%s/baseline.txt", _dir);
+        FILE* f = fopen(path, "w");
+        if (!f) {
+            Serial.printf("[BENCH] Could not write %s\n", path);
+            return;
+        }
+        for (int i = 0; i < _count; i++) {
+            fprintf(f, "%s %lu %lu %lu\n", _results[i].name, (unsigned long)_results[i].written,
+                    (unsigned long)_results[i].calls, (unsigned long)_results[i].bestUs);
+        }
+        fclose(f);
+    }
+
+    const Result* findBaseline(const char* name) const {
+        for (int i = 0; i < _baselineCount; i++) {
+            if (strcmp(_baseline[i].name, name) == 0) return &_baseline[i];
+        }
+        return nullptr;
+    }
+};
+
+static DrawBench drawBench;
+
+#endif // DRAW_BENCH
+
+#endif // DRAW_BENCH_H
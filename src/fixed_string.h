@@ -0,0 +1,185 @@
+/*
+ * =====================================================
+ * FIXED-CAPACITY STRINGS FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Allocation-free text building for Telegram replies, status
+ * messages and the UI. Replaces Arduino String operator+ chains,
+ * which allocate (and fragment the heap) on every concatenation.
+ *
+ * - FixedString<N>: stack/global buffer of N bytes (incl. NUL).
+ *   Appends past the end are truncated and flagged, never allocate.
+ *   The cut falls on a UTF-8 code point boundary, so an emoji is
+ *   dropped whole rather than left as a broken lead byte.
+ * - utf8Trim(): the same boundary rule for plain char buffers
+ * - sanitizeMessage(): in-place filter to printable ASCII
+ * - Small C-string helpers (case-insensitive compare/search)
+ *
+ * Plain C++ with no Arduino dependencies.
+ *
+ * Usage:
+ *   FixedString<128> msg;
+ *   msg.appendf("%s is IN!", initials);
+ *   broadcast(msg.c_str());
+ */
+
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+// ============================================================
+// UTF-8
+// ============================================================
+
+// Length of s[0..len) without a trailing incomplete UTF-8 sequence
+inline size_t utf8Trim(const char* s, size_t len) {
+    size_t lead = len;
+    while (lead > 0 && len - lead < 4) {
+        unsigned char c = (unsigned char)s[--lead];
+        if ((c & 0xC0) == 0x80) continue;  // Continuation byte
+        size_t need = c < 0x80 ? 1 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+        return len - lead < need ? lead : len;
+    }
+    return len;
+}
+
+// ============================================================
+// FIXED STRING CLASS
+// ============================================================
+
+template <size_t N>
+class FixedString {
+public:
+    FixedString() {
+        clear();
+    }
+
+    explicit FixedString(const char* s) {
+        clear();
+        append(s);
+    }
+
+    void clear() {
+        _len = 0;
+        _buf[0] = '\0';
+        _truncated = false;
+    }
+
+    FixedString& append(const char* s) {
+        if (!s) return *this;
+        return append(s, strlen(s));
+    }
+
+    FixedString& append(const char* s, size_t n) {
+        if (_truncated) return *this;
+        size_t room = N - 1 - _len;
+        if (n > room) {
+            n = utf8Trim(s, room);
+            _truncated = true;
+        }
+        memcpy(_buf + _len, s, n);
+        _len += n;
+        _buf[_len] = '\0';
+        return *this;
+    }
+
+    FixedString& append(char c) {
+        if (_truncated) return *this;
+        if (_len < N - 1) {
+            _buf[_len++] = c;
+            _buf[_len] = '\0';
+        } else {
+            truncate();
+        }
+        return *this;
+    }
+
+    // printf-style append; output past capacity is truncated
+    FixedString& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (_truncated) return *this;
+        va_list args;
+        va_start(args, fmt);
+        size_t room = N - _len;
+        int n = vsnprintf(_buf + _len, room, fmt, args);
+        va_end(args);
+
+        if (n < 0) {
+            _buf[_len] = '\0';
+        } else if ((size_t)n >= room) {
+            _len = N - 1;
+            truncate();
+        } else {
+            _len += n;
+        }
+        return *this;
+    }
+
+    FixedString& operator+=(const char* s) {
+        return append(s);
+    }
+
+    FixedString& operator+=(char c) {
+        return append(c);
+    }
+
+    const char* c_str() const {
+        return _buf;
+    }
+
+    size_t length() const {
+        return _len;
+    }
+
+    bool isEmpty() const {
+        return _len == 0;
+    }
+
+    // True if any append was cut short; later appends are ignored
+    bool truncated() const {
+        return _truncated;
+    }
+
+    static size_t capacity() {
+        return N - 1;
+    }
+
+private:
+    char _buf[N];
+    size_t _len;
+    bool _truncated;
+
+    // Drops a code point the cut left incomplete
+    void truncate() {
+        _len = utf8Trim(_buf, _len);
+        _buf[_len] = '\0';
+        _truncated = true;
+    }
+};
+
+// ============================================================
+// C-STRING HELPERS
+// ============================================================
+
+// Keep printable ASCII plus CR/LF, in place. Returns the new length.
+inline size_t sanitizeMessage(char* msg) {
+    char* out = msg;
+    for (const char* in = msg; *in; in++) {
+        char c = *in;
+        if ((c >= 32 && c <= 126) || c == '\n' || c == '\r') *out++ = c;
+    }
+    *out = '\0';
+    return out - msg;
+}
+
+inline bool endsWithNoCase(const char* s, const char* suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    if (m > n) return false;
+    return strcasecmp(s + n - m, suffix) == 0;
+}
+
+#endif // FIXED_STRING_H
@@ -0,0 +1,342 @@
+/*
+ * =====================================================
+ * GIF PLAYER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Plays GIFs shared over Telegram in the album-art panel.
+ *
+ * How it works:
+ * 1. The downloaded GIF file (in PSRAM) is handed to start()
+ * 2. Each call to tick() (16ms animation tick) checks the frame
+ *    delay and, when due, decodes the next frame with AnimatedGIF
+ * 3. Frames are composited into a window-sized RGB565 canvas and
+ *    copied into a bounded PSRAM frame cache
+ * 4. Once the first loop is fully cached, the decoder and source
+ *    file are released and later loops just blit cached frames
+ * 5. If the cache budget runs out, playback keeps streaming from
+ *    the source file instead
+ *
+ * Decode, memory and tick-rate stats are logged after the first loop
+ * (cached or not) and again when playback stops.
+ *
+ * Only the visible window (clipped to the art area) is stored, so
+ * one cached frame is at most w*h*2 bytes regardless of GIF size.
+ *
+ * Usage:
+ * 1. Download the GIF into a ps_malloc() buffer
+ * 2. gifPlayer.start(gfx, buffer, len, x, y, w, h) - takes ownership
+ * 3. Call gifPlayer.tick(millis()) from the animation tick
+ * 4. Call gifPlayer.stop() before drawing anything else there
+ */
+
+#ifndef GIF_PLAYER_H
+#define GIF_PLAYER_H
+
+#include <Arduino.h>
+#include <Arduino_GFX_Library.h>
+#include <AnimatedGIF.h>
+#include <new>
+#include "async_log.h"
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define GIF_MAX_FILE_SIZE   2000000   // 2MB max downloaded GIF
+#define GIF_CACHE_BYTES     3000000   // 3MB PSRAM budget for decoded frames
+#define GIF_MAX_FRAMES      120       // Frame cache slots
+#define GIF_MIN_DELAY_MS    20        // Floor for 0/1-tick GIF delays
+#define GIF_DEFAULT_DELAY   100       // Used when a frame has no delay
+
+// ============================================================
+// GIF PLAYER CLASS
+// ============================================================
+
+class GifPlayer {
+public:
+    GifPlayer() :
+        _gfx(nullptr),
+        _gif(nullptr),
+        _file(nullptr),
+        _fileLen(0),
+        _canvas(nullptr),
+        _playing(false),
+        _fullyCached(false),
+        _cacheFull(false),
+        _frameCount(0),
+        _frameIndex(0),
+        _cacheBytes(0),
+        _nextFrameAt(0) {
+        memset(_frames, 0, sizeof(_frames));
+        memset(_delays, 0, sizeof(_delays));
+        resetStats();
+    }
+
+    // Start playing a GIF file into the window (x, y, w, h).
+    // Takes ownership of 'data' (must come from ps_malloc/malloc).
+    bool start(Arduino_GFX* gfx, uint8_t* data, int len, int x, int y, int w, int h) {
+        stop();
+
+        _gfx = gfx;
+        _file = data;
+        _fileLen = len;
+
+        void* mem = ps_malloc(sizeof(AnimatedGIF));
+        if (!mem) {
+            LOG_E(LOG_MEDIA, "[GIF] Error: no PSRAM for decoder");
+            stop();
+            return false;
+        }
+        _gif = new (mem) AnimatedGIF();
+        _gif->begin(GIF_PALETTE_RGB565_LE);
+
+        if (!_gif->open(_file, _fileLen, drawCallback)) {
+            LOG_E(LOG_MEDIA, "[GIF] Error: open failed (%d)", _gif->getLastError());
+            stop();
+            return false;
+        }
+
+        // Center the GIF canvas in the window, clipping what overflows
+        int cw = _gif->getCanvasWidth();
+        int ch = _gif->getCanvasHeight();
+        _viewW = min(cw, w);
+        _viewH = min(ch, h);
+        _viewX = x + (w - _viewW) / 2;
+        _viewY = y + (h - _viewH) / 2;
+        _srcX = max(0, (cw - w) / 2);
+        _srcY = max(0, (ch - h) / 2);
+
+        size_t canvasBytes = (size_t)_viewW * _viewH * sizeof(uint16_t);
+        _canvas = (uint16_t*)ps_malloc(canvasBytes);
+        if (!_canvas) {
+            LOG_E(LOG_MEDIA, "[GIF] Error: no PSRAM for canvas");
+            stop();
+            return false;
+        }
+        memset(_canvas, 0, canvasBytes);
+
+        LOG_I(LOG_MEDIA, "[GIF] %dx%d canvas, showing %dx%d, file %d bytes",
+              cw, ch, _viewW, _viewH, _fileLen);
+
+        resetStats();
+        _statStart = millis();
+        _playing = true;
+        _nextFrameAt = 0;
+        return true;
+    }
+
+    // Stop playback and release every buffer
+    void stop() {
+        if (_playing) printStats();
+        if (_gif) {
+            _gif->close();
+            _gif->~AnimatedGIF();
+            free(_gif);
+            _gif = nullptr;
+        }
+        if (_file) {
+            free(_file);
+            _file = nullptr;
+        }
+        if (_canvas) {
+            free(_canvas);
+            _canvas = nullptr;
+        }
+        for (int i = 0; i < _frameCount; i++) {
+            if (_frames[i]) free(_frames[i]);
+            _frames[i] = nullptr;
+        }
+        _frameCount = 0;
+        _frameIndex = 0;
+        _cacheBytes = 0;
+        _fileLen = 0;
+        _playing = false;
+        _fullyCached = false;
+        _cacheFull = false;
+    }
+
+    bool isPlaying() const {
+        return _playing;
+    }
+
+    // Advance playback; call from the 16ms animation tick.
+    // Frame changes land on tick boundaries.
+    void tick(unsigned long now) {
+        if (!_playing) return;
+        _ticks++;
+
+        if (_nextFrameAt != 0 && (long)(now - _nextFrameAt) < 0) return;
+
+        int delayMs = _fullyCached ? showCachedFrame() : decodeNextFrame();
+        if (delayMs < 0) {
+            stop();
+            return;
+        }
+        if (delayMs < GIF_MIN_DELAY_MS) delayMs = GIF_MIN_DELAY_MS;
+        _nextFrameAt = now + delayMs;
+    }
+
+    // Print decode, memory and pacing stats to Serial
+    void printStats() {
+        unsigned long elapsed = millis() - _statStart;
+        LOG_I(LOG_MEDIA, "[GIF] %d frames, decode avg %lu us, max %lu us",
+              _decodedFrames,
+              _decodedFrames ? _decodeTotalUs / _decodedFrames : 0,
+              _decodeMaxUs);
+        LOG_I(LOG_MEDIA, "[GIF] Cache %u bytes (%s), free PSRAM %u bytes",
+              (unsigned)_cacheBytes,
+              _fullyCached ? "full loop" : (_cacheFull ? "budget hit, streaming" : "filling"),
+              (unsigned)ESP.getFreePsram());
+        if (elapsed > 0) {
+            LOG_I(LOG_MEDIA, "[GIF] Animation tick rate %.1f Hz (target 62.5)",
+                  _ticks * 1000.0f / elapsed);
+        }
+    }
+
+private:
+    Arduino_GFX* _gfx;
+    AnimatedGIF* _gif;
+    uint8_t* _file;
+    int _fileLen;
+    uint16_t* _canvas;
+    int _viewX, _viewY, _viewW, _viewH;
+    int _srcX, _srcY;
+    bool _playing;
+    bool _fullyCached;
+    bool _cacheFull;
+    bool _looped;       // First loop finished (stats logged)
+    uint16_t* _frames[GIF_MAX_FRAMES];
+    uint16_t _delays[GIF_MAX_FRAMES];
+    int _frameCount;
+    int _frameIndex;
+    size_t _cacheBytes;
+    unsigned long _nextFrameAt;
+
+    // Stats
+    int _decodedFrames;
+    unsigned long _decodeTotalUs;
+    unsigned long _decodeMaxUs;
+    unsigned long _ticks;
+    unsigned long _statStart;
+
+    void resetStats() {
+        _decodedFrames = 0;
+        _decodeTotalUs = 0;
+        _decodeMaxUs = 0;
+        _ticks = 0;
+        _statStart = 0;
+        _looped = false;
+    }
+
+    // Decode one frame into the canvas, cache it and blit it.
+    // Returns the frame delay in ms, or -1 on error.
+    int decodeNextFrame() {
+        int delayMs = 0;
+        unsigned long t0 = micros();
+        int result = _gif->playFrame(false, &delayMs, this);
+        unsigned long us = micros() - t0;
+
+        if (result < 0) {
+            LOG_E(LOG_MEDIA, "[GIF] Decode error %d", _gif->getLastError());
+            return -1;
+        }
+
+        _decodedFrames++;
+        _decodeTotalUs += us;
+        if (us > _decodeMaxUs) _decodeMaxUs = us;
+        if (delayMs <= 0) delayMs = GIF_DEFAULT_DELAY;
+
+        blit(_canvas);
+        bool firstLoop = !_cacheFull && _frameCount == _frameIndex;
+        if (firstLoop) cacheFrame(delayMs);
+        _frameIndex++;
+
+        // Last frame of the loop
+        if (result == 0) {
+            if (!_cacheFull && _frameCount > 0) {
+                // Whole loop is cached: drop the decoder and the source file
+                _fullyCached = true;
+                _gif->close();
+                _gif->~AnimatedGIF();
+                free(_gif);
+                _gif = nullptr;
+                free(_file);
+                _file = nullptr;
+                free(_canvas);
+                _canvas = nullptr;
+            } else {
+                _gif->reset();
+            }
+            if (!_looped) printStats();
+            _looped = true;
+            _frameIndex = 0;
+        }
+
+        return delayMs;
+    }
+
+    int showCachedFrame() {
+        if (_frameCount == 0) return -1;
+        if (_frameIndex >= _frameCount) _frameIndex = 0;
+        blit(_frames[_frameIndex]);
+        return _delays[_frameIndex++];
+    }
+
+    void cacheFrame(int delayMs) {
+        size_t frameBytes = (size_t)_viewW * _viewH * sizeof(uint16_t);
+        if (_frameCount >= GIF_MAX_FRAMES || _cacheBytes + frameBytes > GIF_CACHE_BYTES) {
+            markCacheFull();
+            return;
+        }
+
+        uint16_t* frame = (uint16_t*)ps_malloc(frameBytes);
+        if (!frame) {
+            markCacheFull();
+            return;
+        }
+        memcpy(frame, _canvas, frameBytes);
+        _frames[_frameCount] = frame;
+        _delays[_frameCount] = (uint16_t)min(delayMs, 65535);
+        _frameCount++;
+        _cacheBytes += frameBytes;
+    }
+
+    // Too many frames to cache: free what we have and stream every loop
+    void markCacheFull() {
+        LOG_I(LOG_MEDIA, "[GIF] Cache budget hit after %d frames, streaming", _frameCount);
+        for (int i = 0; i < _frameCount; i++) {
+            free(_frames[i]);
+            _frames[i] = nullptr;
+        }
+        _frameCount = 0;
+        _cacheBytes = 0;
+        _cacheFull = true;
+    }
+
+    void blit(uint16_t* pixels) {
+        _gfx->draw16bitRGBBitmap(_viewX, _viewY, pixels, _viewW, _viewH);
+    }
+
+    // AnimatedGIF line callback: composite one line into the canvas.
+    // Transparent pixels keep the previous frame's content.
+    static void drawCallback(GIFDRAW* pDraw) {
+        GifPlayer* self = (GifPlayer*)pDraw->pUser;
+        int canvasY = pDraw->iY + pDraw->y - self->_srcY;
+        if (canvasY < 0 || canvasY >= self->_viewH) return;
+
+        uint16_t* dst = self->_canvas + canvasY * self->_viewW;
+        const uint8_t* src = pDraw->pPixels;
+        const uint16_t* palette = pDraw->pPalette;
+        int startX = pDraw->iX - self->_srcX;
+
+        for (int i = 0; i < pDraw->iWidth; i++) {
+            int cx = startX + i;
+            if (cx < 0 || cx >= self->_viewW) continue;
+            uint8_t idx = src[i];
+            if (pDraw->ucHasTransparency && idx == pDraw->ucTransparent) continue;
+            dst[cx] = palette[idx];
+        }
+    }
+};
+
+#endif // GIF_PLAYER_H
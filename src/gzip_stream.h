@@ -0,0 +1,243 @@
+/*
+ * =====================================================
+ * GZIP STREAM DECODER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Inflates a .gz download as it arrives, so a compressed firmware image
+ * can go straight into flash without being stored first.
+ *
+ * Uses the miniz inflater in the ESP32-S3 ROM (tinfl): no library, no
+ * flash cost. It needs a 32 KB history window plus ~11 KB of decoder
+ * state, allocated only while a download runs.
+ *
+ * Usage:
+ * - begin(stream) before reading; false if out of memory
+ * - read(buf, len) returns decompressed bytes, 0 if it is waiting for
+ *   the network, -1 if the data is corrupt
+ * - resume(stream) to carry on with a new connection that starts at
+ *   compressedBytes() (an HTTP Range request after a drop)
+ * - finish() after the last expected byte: checks the stream really
+ *   ends there and the gzip trailer's size matches
+ * - end() frees the buffers
+ *
+ * The gzip CRC is not checked here: the OTA path verifies the whole
+ * image against the MD5 declared in version.json instead.
+ */
+
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "rom/miniz.h"
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define GZIP_INPUT_SIZE  4096   // Compressed bytes buffered per network read
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class GzipStream {
+public:
+    GzipStream() : _stream(nullptr), _tinfl(nullptr), _window(nullptr), _input(nullptr) {
+        reset();
+    }
+
+    ~GzipStream() { end(); }
+
+    bool begin(Stream* stream) {
+        end();
+        // Internal RAM first: the window is read back constantly
+        _tinfl = (tinfl_decompressor*)allocate(sizeof(tinfl_decompressor));
+        _window = (uint8_t*)allocate(TINFL_LZ_DICT_SIZE);
+        _input = (uint8_t*)allocate(GZIP_INPUT_SIZE);
+        if (!_tinfl || !_window || !_input) {
+            end();
+            return false;
+        }
+        reset();
+        _stream = stream;
+        tinfl_init(_tinfl);
+        return true;
+    }
+
+    void end() {
+        heap_caps_free(_tinfl);
+        heap_caps_free(_window);
+        heap_caps_free(_input);
+        _tinfl = nullptr;
+        _window = nullptr;
+        _input = nullptr;
+        _stream = nullptr;
+    }
+
+    // Continues from a new stream; nothing buffered is lost
+    void resume(Stream* stream) { _stream = stream; }
+
+    // Up to 'len' decompressed bytes; 0 if no input is available yet
+    int read(uint8_t* out, size_t len) {
+        if (_failed) return -1;
+        size_t produced = 0;
+
+        while (produced < len) {
+            // Hand out what the last inflate step left in the window
+            if (_pendingLen > 0) {
+                size_t n = min(_pendingLen, len - produced);
+                memcpy(out + produced, _window + _pendingPos, n);
+                _pendingPos += n;
+                _pendingLen -= n;
+                produced += n;
+                continue;
+            }
+            if (_status == TINFL_STATUS_DONE) break;
+            if (!_headerDone) {
+                refill();
+                if (!parseHeader()) {
+                    if (_failed) return -1;
+                    break;
+                }
+            }
+            if (_inPos == _inLen && !refill()) break;
+            if (!inflateStep()) return -1;
+        }
+        _outTotal += produced;
+        return (int)produced;
+    }
+
+    // After the caller has read the whole expected output: drains the
+    // end of the deflate stream and the 8-byte trailer (blocking, with
+    // the stream's timeout). False if there is more data than expected,
+    // the stream is cut short or the trailer size disagrees; after a cut
+    // it can be called again once resume() has a new connection.
+    bool finish() {
+        if (_failed || !_headerDone) return false;
+        if (_pendingLen > 0) return false;  // Longer than declared
+
+        // The last block's end marker may still be unread
+        while (_status != TINFL_STATUS_DONE) {
+            if (!inflateStep() || _pendingLen > 0) return false;
+            if (_status != TINFL_STATUS_DONE && !waitForInput()) return false;
+        }
+
+        while (_trailerLen < sizeof(_trailer)) {
+            if (_inPos == _inLen && !waitForInput()) return false;
+            while (_trailerLen < sizeof(_trailer) && _inPos < _inLen) _trailer[_trailerLen++] = _input[_inPos++];
+        }
+
+        uint32_t size = _trailer[4] | (_trailer[5] << 8) | (_trailer[6] << 16) | ((uint32_t)_trailer[7] << 24);
+        return size == (uint32_t)_outTotal;
+    }
+
+    // Compressed bytes taken from the stream so far
+    size_t compressedBytes() const { return _inTotal; }
+
+private:
+    Stream* _stream;
+    tinfl_decompressor* _tinfl;
+    uint8_t* _window;       // TINFL_LZ_DICT_SIZE, used circularly
+    uint8_t* _input;
+    size_t _inPos, _inLen;
+    size_t _windowPos;      // Where the next inflate step writes
+    size_t _pendingPos, _pendingLen;
+    size_t _inTotal, _outTotal;
+    uint8_t _trailer[8];    // CRC32 and ISIZE, collected by finish()
+    size_t _trailerLen;
+    tinfl_status _status;
+    bool _headerDone;
+    bool _failed;
+
+    static void* allocate(size_t size) {
+        void* p = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        return p ? p : heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+
+    void reset() {
+        _inPos = _inLen = 0;
+        _windowPos = 0;
+        _pendingPos = _pendingLen = 0;
+        _inTotal = _outTotal = 0;
+        _trailerLen = 0;
+        _status = TINFL_STATUS_NEEDS_MORE_INPUT;
+        _headerDone = false;
+        _failed = false;
+    }
+
+    // Appends whatever the stream has; keeps unparsed bytes (a header
+    // split across packets) at the front of the buffer
+    bool refill() {
+        if (_inPos > 0) {
+            memmove(_input, _input + _inPos, _inLen - _inPos);
+            _inLen -= _inPos;
+            _inPos = 0;
+        }
+        int available = _stream->available();
+        if (available <= 0 || _inLen == GZIP_INPUT_SIZE) return false;
+        int n = _stream->readBytes(_input + _inLen, min((size_t)available, GZIP_INPUT_SIZE - _inLen));
+        if (n <= 0) return false;
+        _inLen += n;
+        _inTotal += n;
+        return true;
+    }
+
+    bool waitForInput() {
+        unsigned long start = millis();
+        while (!refill()) {
+            if (millis() - start > _stream->getTimeout()) return false;
+            delay(2);
+        }
+        return true;
+    }
+
+    // RFC 1952 member header; false until all of it is buffered
+    bool parseHeader() {
+        const uint8_t* h = _input + _inPos;
+        size_t avail = _inLen - _inPos;
+        if (avail < 10) return false;
+        if (h[0] != 0x1F || h[1] != 0x8B || h[2] != 8) {
+            _failed = true;  // Not gzip, or not deflate
+            return false;
+        }
+        uint8_t flags = h[3];
+        size_t pos = 10;
+        if (flags & 0x04) {  // FEXTRA
+            if (avail < pos + 2) return false;
+            pos += 2 + (h[pos] | (h[pos + 1] << 8));
+        }
+        for (uint8_t field = 0x08; field <= 0x10; field <<= 1) {  // FNAME, FCOMMENT
+            if (!(flags & field)) continue;
+            while (pos < avail && h[pos] != 0) pos++;
+            pos++;  // Past the terminator; beyond 'avail' if it isn't here yet
+        }
+        if (flags & 0x02) pos += 2;  // FHCRC
+        if (pos > avail) {
+            if (_inLen == GZIP_INPUT_SIZE) _failed = true;  // Header can't fit
+            return false;
+        }
+        _inPos += pos;
+        _headerDone = true;
+        return true;
+    }
+
+    // One tinfl call: consumes input, leaves output pending in the window
+    bool inflateStep() {
+        size_t inBytes = _inLen - _inPos;
+        size_t outBytes = TINFL_LZ_DICT_SIZE - _windowPos;
+        _status = tinfl_decompress(_tinfl, _input + _inPos, &inBytes, _window, _window + _windowPos,
+                                   &outBytes, TINFL_FLAG_HAS_MORE_INPUT);
+        if (_status < TINFL_STATUS_DONE) {
+            _failed = true;
+            return false;
+        }
+        _inPos += inBytes;
+        _pendingPos = _windowPos;
+        _pendingLen = outBytes;
+        _windowPos = (_windowPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+        return true;
+    }
+};
+
+#endif // GZIP_STREAM_H
@@ -20,20 +20,33 @@
 #include <FastLED.h>  // MUST be before Arduino_GFX_Library to avoid RED macro conflict
 #include <Arduino_GFX_Library.h>
 #include <WiFi.h>
+#include <esp_wifi.h>
 #include <WebServer.h>
 #include <DNSServer.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <WiFiClientSecure.h>
-#include <UniversalTelegramBot.h>
 #include <time.h>
 #include <Wire.h>
 #include <Preferences.h>
 #include <TAMC_GT911.h>
 #include <JPEGDEC.h>
 #include <Adafruit_ADS1X15.h>
-#include "qr_code.h"  // Embedded QR code image
+#include "qr_encoder.h"  // On-device QR code for the placeholder
 #include "ota_updates.h"  // OTA firmware updates
+#include "gif_player.h"  // Shared GIF playback
+#include "psram_alloc.h"  // PSRAM allocation policy + heap stats
+#include "fixed_string.h"  // Allocation-free text building
+#include "command_table.h"  // Telegram command dispatch
+#include "alloc_counter.h"  // Per-loop heap allocation counter (esp32s3_alloc env)
+#include "telegram_client.h"  // Streaming Telegram Bot API client
+#include "draw_bench.h"  // Widget draw benchmark (native_bench env)
+#include "perf_stats.h"  // Frame-time histograms (esp32s3_perf env)
+#include "trace_buffer.h"  // Event trace for Perfetto (esp32s3_trace env)
+#include "async_log.h"  // Deferred LOG_* logging
+#include "ads_sampler.h"  // Continuous ADS1115 sampling off loop()
+#include "air_quality.h"  // MQ135 / CO2 calibration
+#include "sensor_history.h"  // AQI/CO2 history in PSRAM, mirrored to LittleFS
 
 // ============================================================
 // CONFIGURATION - CHANGE THESE FOR EACH UNIT
@@ -42,6 +55,7 @@
 #define MY_FRIEND_INDEX 0  // 0=NM, 1=ST, 2=GO, 3=TD, 4=MN
 
 #define BOT_TOKEN "8274851974:AAEao868jidxcQEnY8IxPK91ujLmOsA_Alg"
+// #define BOT_USERNAME "my_bot"  // Optional: skips the getMe() lookup for the QR link
 
 struct Friend {
   const char* initials;
@@ -58,6 +72,21 @@ Friend friends[] = {
 };
 #define NUM_FRIENDS 5
 
+// Service endpoints. Override with -D... (see [env:esp32s3_mock]) to run
+// against tools/mock_services.py instead of the public APIs.
+#ifndef TELEGRAM_FILE_URL
+#define TELEGRAM_FILE_URL "https://api.telegram.org/file/bot"
+#endif
+#ifndef OPEN_METEO_URL
+#define OPEN_METEO_URL "https://api.open-meteo.com"
+#endif
+#ifndef SPOTIFY_OEMBED_URL
+#define SPOTIFY_OEMBED_URL "https://open.spotify.com"
+#endif
+#ifndef SPOTIFY_CODE_URL
+#define SPOTIFY_CODE_URL "https://scannables.scdn.co"
+#endif
+
 #define LATITUDE 35.9132
 #define LONGITUDE -79.0558
 
@@ -66,6 +95,15 @@ Friend friends[] = {
 // ============================================================
 #define GFX_BL 2
 #define MQ135_PIN 12
+#define ADS_ALERT_PIN 17      // ADS1115 ALERT/RDY (open-drain, falls per conversion)
+
+// ADS1115 inputs, scanned in turn (slot = index)
+#define ADS_SLOT_MQ135 0
+#define ADS_SLOT_CO2   1
+const AdsChannel ADS_CHANNELS[] = {
+  {0, GAIN_ONE, RATE_ADS1115_128SPS, 4},  // A0: MQ135 module, up to ~4 V
+  {1, GAIN_TWO, RATE_ADS1115_128SPS, 4},  // A1: NDIR CO2 analog out, 0.4-2.0 V
+};
 
 // GT911 Touch
 #define TOUCH_SDA 19
@@ -148,6 +186,8 @@ TAMC_GT911 ts = TAMC_GT911(TOUCH_SDA, TOUCH_SCL, TOUCH_INT, TOUCH_RST, 800, 480)
 #define ART_AREA_Y (SPOT_TOP + SPOT_HEADER_H)
 #define QR_OFFSET_X 22   // v26: Named constant
 #define QR_OFFSET_Y 10   // v26: Named constant
+#define QR_BOX_SIZE 180  // Square reserved for the placeholder QR code
+#define QR_QUIET_ZONE 4  // Light border in modules (spec minimum)
 
 // VU meters
 #define VU_W 38
@@ -200,6 +240,11 @@ TAMC_GT911 ts = TAMC_GT911(TOUCH_SDA, TOUCH_SCL, TOUCH_INT, TOUCH_RST, 800, 480)
 #define MAX_WIFI_NETWORKS 4
 #define MAX_BOUNCES 16
 #define SCANNER_SPEED 8
+#define MAX_IMAGE_BYTES 300000
+#define MSG_MAX_LEN (TG_MAX_TEXT + 16)  // Scrolling message: initials, ": " and a whole Telegram text
+#define REPLY_MAX_LEN 256  // Short command replies; longer ones size their own buffer
+#define MAX_PHOTO_BYTES 1500000
+#define TELEGRAM_MAX_UPDATES 4
 
 // LED breathing timing
 #define BREATH_NORMAL_CYCLE 480   // 8 seconds (4+4)
@@ -253,6 +298,10 @@ bool forecastLoaded = false;
 int aqiLvl = 5;
 int co2Lvl = 5;
 bool adsOK = false;  // v26: Track ADS1115 status
+AirQuality airQuality;
+SensorHistory sensorHistory;
+#define HISTORY_AQI 0  // Tenths of a level
+#define HISTORY_CO2 1  // ppm
 
 // Time
 struct tm tinfo;
@@ -263,7 +312,8 @@ int minLeft = 0;
 int secLeft = 0;
 
 // Messages
-String currMsg = "";
+char currMsg[MSG_MAX_LEN] = "";
+int currMsgLen = 0;
 bool newMsg = false;
 unsigned long msgTime = 0;
 bool showingMsg = false;
@@ -298,8 +348,25 @@ String albumArtUrl = "";
 String spotifyCodeUrl = "";
 String spotifySenderInitials = "";
 bool showingQRCode = false;
+bool qrPending = false;  // Placeholder drawn without its QR: no bot username yet
 JPEGDEC jpeg;
 
+// QR placeholder (encoded once, redrawn from the module bitmap)
+QRCode qrCode;
+char botUsername[33] = "";
+
+// Shared GIFs
+GifPlayer gifPlayer;
+
+// Shared photos
+int photoOffsetX = 0;
+int photoOffsetY = 0;
+uint32_t photoHeapLow = 0;   // Lowest free heap seen while a photo decodes
+uint32_t photoPsramLow = 0;
+
+// Telegram updates, filled in place by bot.getUpdates()
+TelegramUpdate tgUpdates[TELEGRAM_MAX_UPDATES];
+
 // Touch
 enum TouchState { TOUCH_IDLE, TOUCH_PRESSED, TOUCH_HELD };
 int touchX = 0, touchY = 0;
@@ -315,19 +382,25 @@ unsigned long lastDisp = 0;
 unsigned long lastSensor = 0;
 unsigned long lastAnim = 0;
 unsigned long lastQRCheck = 0;
+unsigned long lastHeapSample = 0;
+
+// Heap monitoring
+HeapStats heapStats;
 
 // Network clients
 WiFiClientSecure client;
-UniversalTelegramBot bot(BOT_TOKEN, client);
+TelegramClient bot(BOT_TOKEN, client);
 
 // Hardware
 Adafruit_ADS1115 ads;
+AdsSampler adsSampler;
 CRGB leds[LED_COUNT];
 
 // OTA Updates
 OTAUpdater otaUpdater;
 unsigned long lastOTACheck = 0;
-bool otaInProgress = false;
+bool otaInProgress = false;   // Background download running; owns the timer panel
+int64_t otaChatId = 0;        // Who sent /install, told if it fails
 
 // ============================================================
 // FUNCTION PROTOTYPES
@@ -361,29 +434,46 @@ void doConnect();
 void tryConnect();
 void handleRoot();
 void checkTelegram();
-void showMessage(String msg);
+bool dispatchCommand(int64_t chatId, const char* text, int fIdx);
+String getTelegramFileUrl(const char* fileId);
+void showMessage(const char* msg);
 int getFriendIdx(int64_t id);
-void broadcast(String msg);
-void parseSpotify(String text);
+void broadcast(const char* msg);
+void parseSpotify(const char* text);
 void getWeather();
 void selectDay(int dayIndex);
 void calcWeatherForDay(int dayIndex);
 void fetchSpotifyArt();
 void getSpotifyCode();
-uint8_t* downloadImageFromUrl(String url, int* outLen);
+uint8_t* downloadImageFromUrl(String url, int* outLen, int maxLen = MAX_IMAGE_BYTES);
+void playSharedGif(String url);
+void showSharedPhoto(String url);
+int chooseJpegScale(int width, int height);
 void downloadAndDisplayImage();
 void downloadAndDisplayCode();
 void decodeAndDisplayJpeg(uint8_t *buffer, int size);
 void decodeAndDisplayCode(uint8_t *buffer, int size);
 void checkQRReminder();
 void displayQRPlaceholder();
+void resolveBotUsername();
+bool ensureQRCode();
+void drawQRCode(int x, int y, int boxSize);
+#ifdef DRAW_BENCH
+void runDrawBench();
+#endif
+void startPeerSharing();
+#ifdef TRACE_BUFFER
+void startTraceServer();
+void traceToSerial(void* ctx, const char* data, size_t len);
+#endif
 int jpegDrawCallback(JPEGDRAW *pDraw);
 int jpegDrawCallbackCode(JPEGDRAW *pDraw);
-int jpegDrawCallbackQR(JPEGDRAW *pDraw);
-String sanitizeMessage(String msg);
+int jpegDrawCallbackPhoto(JPEGDRAW *pDraw);
+void samplePhotoHeap();
 void calcWeather();
 int calculateWifiStrength(int rssi);
 void readSensors();
+bool readSensorVolts(float& mq135, float& co2);
 void calcCountdown();
 void checkReset();
 void updateAnimations();
@@ -393,7 +483,8 @@ void updateLedAnimations();
 void updateBreathingLED();
 void updateMorseLED();
 uint16_t getGradientColor(int segment, int maxSegments);
-void otaProgressCallback(int progress);
+void drawOtaProgress(bool full);
+void pollOtaUpdate();
 void checkForOTAUpdates();
 
 // ============================================================
@@ -401,18 +492,22 @@ void checkForOTAUpdates();
 // ============================================================
 
 void initTouch() {
-  Serial.println("   Starting GT911 init...");
+  LOG_I(LOG_TOUCH, "   Starting GT911 init...");
   Wire.begin(TOUCH_SDA, TOUCH_SCL);
   ts.begin();
+  Wire.setClock(400000);  // GT911 and ADS1115 both do fast mode: a quarter of the bus time
   ts.setRotation(ROTATION_NORMAL);
   touchOK = true;
-  Serial.println("   GT911 initialized!");
+  LOG_I(LOG_TOUCH, "   GT911 initialized!");
 }
 
 bool checkTouch() {
   if (!touchOK) return false;
 
-  ts.read();
+  {
+    PERF_SCOPE(PERF_I2C_TOUCH);
+    ts.read();
+  }
   bool currentlyTouched = ts.isTouched;
 
   switch (touchState) {
@@ -428,6 +523,7 @@ bool checkTouch() {
 
         touchState = TOUCH_PRESSED;
         wasTouched = true;
+        TRACE_INSTANT("touch", "down");
       }
       break;
 
@@ -437,7 +533,8 @@ bool checkTouch() {
         touchY = savedTouchY;
         touchState = TOUCH_IDLE;
         wasTouched = false;
-        Serial.printf("[TOUCH] Tap at (%d, %d)\n", touchX, touchY);
+        LOG_I(LOG_TOUCH, "[TOUCH] Tap at (%d, %d)", touchX, touchY);
+        TRACE_INSTANT("touch", "tap");
         return true;
       }
       break;
@@ -460,6 +557,7 @@ bool checkTouch() {
 void setup() {
   Serial.begin(115200);
   delay(500);
+  asyncLog.begin();  // Everything after the banner goes through LOG_*
 
   Serial.println();
   Serial.println("========================================");
@@ -468,60 +566,77 @@ void setup() {
   Serial.println("========================================");
   Serial.printf("Unit owner: %s\n\n", friends[MY_FRIEND_INDEX].initials);
 
+  // Large buffers to PSRAM before anything allocates
+  psramPolicyBegin();
+  allocCounterBegin();
+  perfStatsBegin();
+  traceBegin();
+
+  // Shared photos: pick the smallest size that still covers the art area
+  bot.setPhotoMinSize(ALBUM_ART_W, ALBUM_ART_DISPLAY_H);
+
   // Initialize display
-  Serial.println("[1/5] Init display...");
+  LOG_I(LOG_SYS, "[1/5] Init display...");
   gfx->begin();
   gfx->fillScreen(COL_BLACK);
   pinMode(GFX_BL, OUTPUT);
   digitalWrite(GFX_BL, HIGH);
-  Serial.println("   Display OK");
+  LOG_I(LOG_SYS, "   Display OK");
+
+#ifdef DRAW_BENCH
+  runDrawBench();  // Does not return
+#endif
 
   showSplash();
 
   // Initialize touch
-  Serial.println("[2/5] Init touch...");
+  LOG_I(LOG_SYS, "[2/5] Init touch...");
   initTouch();
 
   // Initialize sensors and hardware
-  Serial.println("[3/5] Init sensors & hardware...");
+  LOG_I(LOG_SYS, "[3/5] Init sensors & hardware...");
   pinMode(MQ135_PIN, INPUT);
   analogReadResolution(12);
 
   // ADS1115 with error handling
   adsOK = ads.begin();
   if (!adsOK) {
-    Serial.println("   ADS1115 FAILED - using fallback");
+    LOG_W(LOG_SYS, "   ADS1115 FAILED - using fallback");
   } else {
-    Serial.println("   ADS1115 initialized OK");
-    ads.setGain(GAIN_ONE);
+    LOG_I(LOG_SYS, "   ADS1115 initialized OK");
+    adsOK = adsSampler.begin(ads, ADS_CHANNELS, sizeof(ADS_CHANNELS) / sizeof(ADS_CHANNELS[0]), ADS_ALERT_PIN);
   }
+  if (!LittleFS.begin(true)) LOG_W(LOG_SYS, "   LittleFS mount failed");
+  sensorHistory.begin();
 
   // LED strip
   FastLED.addLeds<WS2812B, LED_PIN, GRB>(leds, LED_COUNT);
   FastLED.setBrightness(LED_BRIGHTNESS);
   fill_solid(leds, LED_COUNT, CRGB(0, 255, 255));
   FastLED.show();
-  Serial.println("   LED strip OK");
+  LOG_I(LOG_SYS, "   LED strip OK");
 
   // WiFi connection
-  Serial.println("[4/5] Check WiFi...");
+  LOG_I(LOG_SYS, "[4/5] Check WiFi...");
   prefs.begin("friyay", false);
   savedSSID = prefs.getString("ssid", "");
   savedPass = prefs.getString("pass", "");
-  Serial.printf("   Saved SSID: %s\n", savedSSID.c_str());
+  airQuality.setR0(prefs.getUInt("mq135_r0", MQ135_DEFAULT_R0));
+  airQuality.setNdir(prefs.getBool("co2_ndir", false));
+  LOG_I(LOG_SYS, "   Saved SSID: %s", savedSSID.c_str());
 
   if (savedSSID.length() > 0) {
     tryConnect();
   }
 
   if (!wifiOK) {
-    Serial.println("   Starting WiFi setup...");
+    LOG_I(LOG_SYS, "   Starting WiFi setup...");
     startWiFiSetup();
     return;
   }
 
   // Time sync
-  Serial.println("[5/5] Sync time...");
+  LOG_I(LOG_SYS, "[5/5] Sync time...");
   configTime(-5 * 3600, 3600, "pool.ntp.org");
 
   int tries = 0;
@@ -530,7 +645,7 @@ void setup() {
     tries++;
     yield();
   }
-  Serial.println("   Time synced");
+  LOG_I(LOG_SYS, "   Time synced");
 
   getLocalTime(&tinfo);
   dayOfWeek = tinfo.tm_wday;
@@ -540,18 +655,21 @@ void setup() {
   getWeather();
 
   wifiStrength = calculateWifiStrength(WiFi.RSSI());
+  resolveBotUsername();
 
   drawUI();
   displayQRPlaceholder();
 
-  // Initialize OTA updater
-  otaUpdater.setProgressCallback(otaProgressCallback);
-  Serial.printf("[OTA] Firmware version: %s\n", otaUpdater.getCurrentVersion().c_str());
+  LOG_I(LOG_OTA, "[OTA] Firmware version: %s", otaUpdater.getCurrentVersion());
+  startPeerSharing();
 
-  Serial.println();
-  Serial.println("========================================");
-  Serial.println("  READY!");
-  Serial.println("========================================");
+#ifdef TRACE_BUFFER
+  startTraceServer();
+#endif
+
+  LOG_I(LOG_SYS, "\n========================================");
+  LOG_I(LOG_SYS, "  READY!");
+  LOG_I(LOG_SYS, "========================================");
 }
 
 // ============================================================
@@ -567,16 +685,23 @@ void loop() {
     return;
   }
 
+  server.handleClient();  // GET /ota/firmware.bin for siblings, /trace
+
+  allocCounterLoopStart();
+  PERF_SCOPE(PERF_LOOP);
   unsigned long now = millis();
 
   // Animation update (60fps)
   if (now - lastAnim >= 16) {
+    if (lastAnim) PERF_LAG(PERF_ANIM_LAG, now - lastAnim - 16);
     lastAnim = now;
     updateAnimations();
+    if (otaInProgress) pollOtaUpdate();
   }
 
   // 1-second update
   if (now - lastDisp >= 1000) {
+    if (lastDisp) PERF_LAG(PERF_TICK_LAG, now - lastDisp - 1000);
     lastDisp = now;
     getLocalTime(&tinfo);
     dayOfWeek = tinfo.tm_wday;
@@ -605,6 +730,10 @@ void loop() {
   if (now - lastBot >= 15000) {
     lastBot = now;
     checkTelegram();
+    if (qrPending) {
+      resolveBotUsername();  // getMe() failed at startup; retry off the draw path
+      if (botUsername[0] != '\0') displayQRPlaceholder();
+    }
   }
 
   // Weather update (1 hour)
@@ -621,6 +750,12 @@ void loop() {
     drawVUMeters();
   }
 
+  // Heap sample (10 seconds)
+  if (now - lastHeapSample >= 10000) {
+    lastHeapSample = now;
+    heapStats.sample();
+  }
+
   // OTA update check (every 24 hours, but staggered by unit to avoid all checking at once)
   // Each unit checks at a different hour based on MY_FRIEND_INDEX
   if (!otaInProgress && now - lastOTACheck >= 86400000) {  // 24 hours
@@ -641,6 +776,9 @@ void loop() {
     if (!wifiOK) startWiFiSetup();
   }
 
+  allocCounterLoopEnd();
+  PERF_SCOPE_END();
+  perfStatsTick();
   delay(10);
 }
 
@@ -649,10 +787,13 @@ void loop() {
 // ============================================================
 
 void updateAnimations() {
+  PERF_SCOPE(PERF_ANIMATIONS);
+  TRACE_SCOPE("anim", "updateAnimations");
   bool needNotifRedraw = false;
   bool needTimerRedraw = false;
 
   updateLedAnimations();
+  gifPlayer.tick(millis());
 
   // Scanner animation
   if (scannerActive) {
@@ -679,9 +820,9 @@ void updateAnimations() {
   }
 
   // Message scroll
-  if (showingMsg && currMsg.length() > 12) {
+  if (showingMsg && currMsgLen > 12) {
     msgScrollPos += 2;
-    int totalScrollWidth = (int)currMsg.length() * 30 + TIMER_W;
+    int totalScrollWidth = currMsgLen * 30 + TIMER_W;
     if (msgScrollPos > totalScrollWidth) {
       msgScrollPos = -TIMER_W / 2;
     }
@@ -790,6 +931,7 @@ void updateLedAnimations() {
 // ============================================================
 
 void handleTouch() {
+  TRACE_SCOPE("touch", "handleTouch");
   // Friend buttons
   if (touchY >= BTN_Y && touchY <= BTN_Y + BTN_H) {
     int x = MARGIN;
@@ -830,7 +972,7 @@ void toggleCommit() {
   // Debounce: prevent rapid-fire commits (3 second cooldown)
   unsigned long now = millis();
   if (now - lastCommitTime < COMMIT_DEBOUNCE_MS) {
-    Serial.printf("[TOUCH] Commit debounced (too soon, %lums since last)\n", now - lastCommitTime);
+    LOG_I(LOG_TOUCH, "[TOUCH] Commit debounced (too soon, %lums since last)", now - lastCommitTime);
     return;
   }
   lastCommitTime = now;
@@ -838,11 +980,11 @@ void toggleCommit() {
   friends[MY_FRIEND_INDEX].committed = !friends[MY_FRIEND_INDEX].committed;
   drawButtons();
 
-  String msg = friends[MY_FRIEND_INDEX].committed
-    ? "🏂 " + String(friends[MY_FRIEND_INDEX].initials) + " is IN!"
-    : "😢 " + String(friends[MY_FRIEND_INDEX].initials) + " is OUT";
+  FixedString<48> msg;
+  msg.appendf(friends[MY_FRIEND_INDEX].committed ? "🏂 %s is IN!" : "😢 %s is OUT",
+              friends[MY_FRIEND_INDEX].initials);
 
-  broadcast(msg);
+  broadcast(msg.c_str());
   triggerScanner();
 
   if (friends[MY_FRIEND_INDEX].committed) {
@@ -875,6 +1017,8 @@ void showSplash() {
 }
 
 void drawUI() {
+  PERF_SCOPE(PERF_DRAW_UI);
+  TRACE_SCOPE("draw", "drawUI");
   gfx->fillScreen(COL_BLACK);
   drawButtons();
   drawNotificationBox();
@@ -898,6 +1042,8 @@ void drawCyberpunkGrid(int x, int y, int w, int h) {
 }
 
 void drawButtons() {
+  PERF_SCOPE(PERF_DRAW_BUTTONS);
+  TRACE_SCOPE("draw", "drawButtons");
   int x = MARGIN;
 
   for (int i = 0; i < NUM_FRIENDS; i++) {
@@ -928,6 +1074,8 @@ void drawButtons() {
 }
 
 void drawNotificationBox() {
+  PERF_SCOPE(PERF_DRAW_NOTIF);
+  TRACE_SCOPE("draw", "drawNotificationBox");
   gfx->fillRect(NOTIF_X - 2, NOTIF_Y - 2, NOTIF_W + 4, NOTIF_H + 4, COL_BLACK);
   gfx->drawRoundRect(NOTIF_X, NOTIF_Y, NOTIF_W, NOTIF_H, 6, COL_CYAN);
   gfx->fillRect(NOTIF_X + 2, NOTIF_Y + 2, NOTIF_W - 4, NOTIF_H - 4, 0x0011);
@@ -947,6 +1095,8 @@ void drawNotificationBox() {
 }
 
 void drawDays() {
+  PERF_SCOPE(PERF_DRAW_DAYS);
+  TRACE_SCOPE("draw", "drawDays");
   const char* days[] = {"SAT", "SUN", "MON", "TUE", "WED", "THU", "FRI"};
   const int dayMap[] = {6, 0, 1, 2, 3, 4, 5};
 
@@ -986,6 +1136,8 @@ void drawWeatherPanel() {
 }
 
 void drawWeatherBars() {
+  PERF_SCOPE(PERF_DRAW_WEATHER);
+  TRACE_SCOPE("draw", "drawWeatherBars");
   gfx->fillRect(PANEL_X + 3, PANEL_Y + 3, PANEL_W - 6, PANEL_H - 6, COL_BLACK);
   gfx->drawRoundRect(PANEL_X, PANEL_Y, PANEL_W, PANEL_H, 8, COL_YELLOW);
 
@@ -1028,6 +1180,9 @@ void drawWeatherBars() {
 }
 
 void drawTimer() {
+  if (otaInProgress) return;  // drawOtaProgress() has the panel
+  PERF_SCOPE(PERF_DRAW_TIMER);
+  TRACE_SCOPE("draw", "drawTimer");
   gfx->fillRect(TIMER_X - 3, TIMER_Y - 3, TIMER_W + 6, TIMER_H + 6, COL_BLACK);
 
   uint16_t borderCol = (newMsg && (millis() - msgTime < MSG_HIGHLIGHT_TIME_MS)) ? COL_CYAN : COL_YELLOW;
@@ -1054,10 +1209,11 @@ void drawTimer() {
     gfx->print("Lets Ride!");
   }
   // Priority 2: Message
-  else if (showingMsg && currMsg.length() > 0) {
+  else if (showingMsg && currMsgLen > 0) {
     if (millis() - msgTime > MSG_DISPLAY_TIME_MS) {
       showingMsg = false;
-      currMsg = "";
+      currMsg[0] = '\0';
+      currMsgLen = 0;
       msgScrollPos = 0;
       newMsg = false;
       drawTimer();
@@ -1071,8 +1227,8 @@ void drawTimer() {
     int clipLeft = TIMER_X + 10;
     int clipRight = TIMER_X + TIMER_W - 10;
 
-    if (currMsg.length() <= 12) {
-      int tw = currMsg.length() * charWidth;
+    if (currMsgLen <= 12) {
+      int tw = currMsgLen * charWidth;
       int textX = TIMER_X + (TIMER_W - tw) / 2;
       if (textX < clipLeft) textX = clipLeft;
       gfx->setCursor(textX, textY);
@@ -1082,10 +1238,13 @@ void drawTimer() {
       int firstVisibleChar = max(0, (clipLeft - textStartX) / charWidth);
       int visibleStartX = textStartX + firstVisibleChar * charWidth;
       int charsVisible = (clipRight - visibleStartX) / charWidth + 1;
-      int lastVisibleChar = min((int)currMsg.length(), firstVisibleChar + charsVisible);
+      int lastVisibleChar = min(currMsgLen, firstVisibleChar + charsVisible);
 
       if (firstVisibleChar < lastVisibleChar) {
-        String visibleText = currMsg.substring(firstVisibleChar, lastVisibleChar);
+        char visibleText[MSG_MAX_LEN];
+        int visibleLen = lastVisibleChar - firstVisibleChar;
+        memcpy(visibleText, currMsg + firstVisibleChar, visibleLen);
+        visibleText[visibleLen] = '\0';
         int drawX = max(clipLeft, visibleStartX);
         gfx->setCursor(drawX, textY);
         gfx->print(visibleText);
@@ -1120,6 +1279,8 @@ void drawTimer() {
 }
 
 void drawVUMeters() {
+  PERF_SCOPE(PERF_DRAW_METERS);
+  TRACE_SCOPE("draw", "drawVUMeters");
   drawMeter(VU_X, VU_TOP, VU_W, VU_H, aqiLvl, "AQI");
   drawMeter(VU_X + VU_W + VU_GAP, VU_TOP, VU_W, VU_H, co2Lvl, "CO2");
 }
@@ -1163,6 +1324,8 @@ void drawMeter(int x, int y, int w, int h, int level, const char* label) {
 }
 
 void drawHeader() {
+  PERF_SCOPE(PERF_DRAW_HEADER);
+  TRACE_SCOPE("draw", "drawHeader");
   int hx = VU_X + VU_TOTAL_W + 20;
   gfx->fillRect(hx - 5, HEADER_Y - 15, 250, 35, COL_BLACK);
 
@@ -1191,6 +1354,9 @@ void drawProfileIcon(int x, int y) {
 }
 
 void drawSpotifyArea() {
+  PERF_SCOPE(PERF_DRAW_SPOTIFY);
+  TRACE_SCOPE("draw", "drawSpotifyArea");
+  gifPlayer.stop();
   spotifySenderInitials = "";
 
   // Header
@@ -1230,6 +1396,7 @@ void drawSenderBadge() {
 }
 
 void displayQRPlaceholder() {
+  gifPlayer.stop();
   hasSpotify = false;
   trackId = "";
   albumArtUrl = "";
@@ -1239,12 +1406,10 @@ void displayQRPlaceholder() {
   gfx->fillRect(ART_X, ART_AREA_Y, ALBUM_ART_W, ALBUM_ART_H, COL_SPOTIFY_BG);
   drawCyberpunkGrid(ART_X, ART_AREA_Y, ALBUM_ART_W, ALBUM_ART_H);
 
-  if (jpeg.openRAM((uint8_t*)qr_code_data, qr_code_len, jpegDrawCallbackQR)) {
-    jpeg.setPixelType(RGB565_LITTLE_ENDIAN);
-    if (jpeg.decode(0, 0, 0)) {
-      showingQRCode = true;
-    }
-    jpeg.close();
+  qrPending = !ensureQRCode();
+  if (!qrPending) {
+    drawQRCode(ART_X + QR_OFFSET_X, ART_AREA_Y + QR_OFFSET_Y, QR_BOX_SIZE);
+    showingQRCode = true;
   }
 
   gfx->setTextColor(COL_CYAN);
@@ -1253,6 +1418,72 @@ void displayQRPlaceholder() {
   gfx->print("Send Tunes");
 }
 
+// The bot's username for the QR link, from BOT_USERNAME or a getMe() call.
+// getMe() is a blocking HTTPS request, so this runs once WiFi is up and
+// never from the draw path.
+void resolveBotUsername() {
+  if (botUsername[0] != '\0') return;
+#ifdef BOT_USERNAME
+  strlcpy(botUsername, BOT_USERNAME, sizeof(botUsername));
+#else
+  if (WiFi.status() != WL_CONNECTED) return;
+  if (!bot.getMe(botUsername, sizeof(botUsername))) {
+    botUsername[0] = '\0';
+    LOG_W(LOG_TG, "[QR] getMe failed; will retry with the next Telegram poll");
+  }
+#endif
+}
+
+// Build the placeholder QR once: t.me link to the bot, tagged with this unit.
+// No network here: false until resolveBotUsername() has succeeded.
+bool ensureQRCode() {
+  if (qrCode.size() > 0) return true;
+  if (botUsername[0] == '\0') return false;
+
+  char payload[96];
+  snprintf(payload, sizeof(payload), "https://t.me/%s?start=%s",
+           botUsername, friends[MY_FRIEND_INDEX].initials);
+
+  if (!qrCode.encode(payload, QRCode::ECC_MEDIUM)) {
+    LOG_W(LOG_UI, "[QR] Payload too long: %s", payload);
+    return false;
+  }
+  LOG_I(LOG_UI, "[QR] Encoded %s (v%d, %dx%d)", payload,
+        qrCode.version(), qrCode.size(), qrCode.size());
+  return true;
+}
+
+// Draw the cached QR code centered in a boxSize square.
+// Dark modules are emitted as one fillRect per horizontal run.
+void drawQRCode(int x, int y, int boxSize) {
+  PERF_SCOPE(PERF_DRAW_QR);
+  TRACE_SCOPE("draw", "drawQRCode");
+  int n = qrCode.size();
+  int scale = boxSize / (n + QR_QUIET_ZONE * 2);
+  if (scale < 1) return;
+
+  int qrPx = (n + QR_QUIET_ZONE * 2) * scale;
+  int left = x + (boxSize - qrPx) / 2;
+  int top = y + (boxSize - qrPx) / 2;
+  gfx->fillRect(left, top, qrPx, qrPx, COL_WHITE);
+
+  int ox = left + QR_QUIET_ZONE * scale;
+  int oy = top + QR_QUIET_ZONE * scale;
+  for (int my = 0; my < n; my++) {
+    int runStart = -1;
+    for (int mx = 0; mx <= n; mx++) {
+      bool dark = qrCode.module(mx, my);  // mx == n reads light and closes the run
+      if (dark && runStart < 0) {
+        runStart = mx;
+      } else if (!dark && runStart >= 0) {
+        gfx->fillRect(ox + runStart * scale, oy + my * scale,
+                      (mx - runStart) * scale, scale, COL_BLACK);
+        runStart = -1;
+      }
+    }
+  }
+}
+
 // ============================================================
 // JPEG CALLBACKS
 // ============================================================
@@ -1263,9 +1494,29 @@ int jpegDrawCallback(JPEGDRAW *pDraw) {
   return 1;
 }
 
-int jpegDrawCallbackQR(JPEGDRAW *pDraw) {
-  if (pDraw->x >= 180) return 1;
-  gfx->draw16bitRGBBitmap(ART_X + QR_OFFSET_X + pDraw->x, ART_AREA_Y + QR_OFFSET_Y + pDraw->y, pDraw->pPixels, pDraw->iWidth, pDraw->iHeight);
+// Peak use during a photo is before minus the lowest free seen
+void samplePhotoHeap() {
+  photoHeapLow = min(photoHeapLow, (uint32_t)ESP.getFreeHeap());
+  photoPsramLow = min(photoPsramLow, (uint32_t)ESP.getFreePsram());
+}
+
+// Photos are center-cropped: offsets can be negative, so clip per row
+int jpegDrawCallbackPhoto(JPEGDRAW *pDraw) {
+  int x = pDraw->x + photoOffsetX;
+  int y = pDraw->y + photoOffsetY;
+  int skipX = max(0, -x);
+  int w = min(pDraw->iWidth, ALBUM_ART_W - x) - skipX;
+
+  samplePhotoHeap();
+
+  if (w <= 0) return 1;
+  for (int row = 0; row < pDraw->iHeight; row++) {
+    int py = y + row;
+    if (py < 0) continue;
+    if (py >= ALBUM_ART_DISPLAY_H) break;
+    gfx->draw16bitRGBBitmap(ART_X + x + skipX, ART_AREA_Y + py,
+                            pDraw->pPixels + row * pDraw->iWidth + skipX, w, 1);
+  }
   return 1;
 }
 
@@ -1346,8 +1597,10 @@ void drawNetList() {
   gfx->setTextSize(2);
   gfx->setCursor(45, 432);
   if (kbInput.length() > 0) {
-    String stars = "";
-    for (unsigned int i = 0; i < kbInput.length(); i++) stars += "*";
+    char stars[65];
+    int n = min((int)kbInput.length(), (int)sizeof(stars) - 1);
+    memset(stars, '*', n);
+    stars[n] = '\0';
     gfx->print(stars);
   } else {
     gfx->print("Password...");
@@ -1575,9 +1828,14 @@ void doConnect() {
     client.setTimeout(1500);
     getWeather();
     wifiStrength = calculateWifiStrength(WiFi.RSSI());
+    resolveBotUsername();
 
     drawUI();
     displayQRPlaceholder();
+    startPeerSharing();  // The setup portal stopped the server
+#ifdef TRACE_BUFFER
+    startTraceServer();
+#endif
   } else {
     gfx->fillScreen(COL_BLACK);
     gfx->setTextColor(COL_RED);
@@ -1623,158 +1881,428 @@ void handleRoot() {
 // TELEGRAM
 // ============================================================
 
-void checkTelegram() {
-  int n = bot.getUpdates(bot.last_message_received + 1);
+// Resolve a file_id to a download URL via getFile
+String getTelegramFileUrl(const char* fileId) {
+  char path[128];
+  if (!bot.getFile(fileId, path, sizeof(path))) return "";
+  return String(TELEGRAM_FILE_URL BOT_TOKEN "/") + path;
+}
 
-  for (int i = 0; i < n; i++) {
-    String chatId = String(bot.messages[i].chat_id);
-    String text = bot.messages[i].text;
-    String from = bot.messages[i].from_name;
-    int64_t senderId = strtoll(bot.messages[i].chat_id.c_str(), NULL, 10);
+// Buffers are sized for their worst case; log it if one still overflows
+template <size_t N>
+void sendReply(int64_t chatId, const FixedString<N>& reply) {
+  if (reply.truncated()) LOG_W(LOG_TG, "[TG] Reply cut at %u bytes", (unsigned)reply.length());
+  bot.sendMessage(chatId, reply.c_str());
+}
 
-    int fIdx = getFriendIdx(senderId);
+// ---------- Command handlers ----------
 
-    if (fIdx >= 0) {
-      String t = text;
-      t.toLowerCase();
-
-      if (t.indexOf("/commit") >= 0 || t == "in" || t == "commit" || t == "riding") {
-        friends[fIdx].committed = true;
-        broadcast("🏂 " + String(friends[fIdx].initials) + " is IN!");
-        drawButtons();
-        triggerScanner();
-        continue;
-      }
+void cmdCommit(const CommandContext& ctx) {
+  friends[ctx.friendIdx].committed = true;
+  FixedString<48> msg;
+  msg.appendf("🏂 %s is IN!", friends[ctx.friendIdx].initials);
+  broadcast(msg.c_str());
+  drawButtons();
+  triggerScanner();
+}
 
-      if (t.indexOf("/uncommit") >= 0 || t == "out" || t == "bail") {
-        friends[fIdx].committed = false;
-        broadcast("😢 " + String(friends[fIdx].initials) + " is OUT");
-        drawButtons();
-        triggerScanner();
-        continue;
-      }
-    }
+void cmdUncommit(const CommandContext& ctx) {
+  friends[ctx.friendIdx].committed = false;
+  FixedString<48> msg;
+  msg.appendf("😢 %s is OUT", friends[ctx.friendIdx].initials);
+  broadcast(msg.c_str());
+  drawButtons();
+  triggerScanner();
+}
 
-    if (text.indexOf("spotify.com") >= 0 || text.indexOf("open.spotify") >= 0) {
-      if (fIdx >= 0) spotifySenderInitials = String(friends[fIdx].initials);
-      parseSpotify(text);
-      showMessage(from + " shared music!");
-      continue;
+// Deep links from the placeholder QR arrive as "/start <unit>"
+void cmdHelp(const CommandContext& ctx) {
+  bot.sendMessage(ctx.chatId,
+    "🏂 FRIYAY FOREVER\n\n"
+    "/commit - You're in!\n"
+    "/uncommit - Can't make it\n"
+    "/status - Who's riding\n"
+    "/weather - Conditions\n\n"
+    "📱 System:\n"
+    "/version - Firmware info\n"
+    "/update - Check for updates\n"
+    "/install - Install update\n"
+    "/heap - Memory stats\n"
+    "/history - Air quality history\n"
+    "/calibrate - Zero the air sensor outdoors\n"
+    "/co2 - CO2 sensor: ndir or mq135\n"
+    "/log - Log levels\n"
+    "/perf - Frame timing\n"
+    "/trace - Event trace\n\n"
+    "Or just say 'in' or 'out'");
+}
+
+void cmdStatus(const CommandContext& ctx) {
+  FixedString<REPLY_MAX_LEN> reply;
+  reply += "📊 Status:\n\n";
+  for (int j = 0; j < NUM_FRIENDS; j++) {
+    reply.appendf("%s%s\n", friends[j].committed ? "✅ " : "⬜ ", friends[j].initials);
+  }
+  reply.appendf("\n⏱️ %dh %dm to Friday", hrsLeft, minLeft);
+  sendReply(ctx.chatId, reply);
+}
+
+void cmdHeap(const CommandContext& ctx) {
+  char summary[160];
+  heapStats.summary(summary, sizeof(summary));
+  FixedString<REPLY_MAX_LEN> reply;
+  reply.appendf("🧠 Heap\n\n%s", summary);
+  sendReply(ctx.chatId, reply);
+}
+
+// "/perf reset" starts a new window
+void cmdPerf(const CommandContext& ctx) {
+#ifdef PERF_STATS
+  FixedString<768> reply;
+  reply += "⏱️ Perf\n\n";
+  perfStats.summary(reply);
+  sendReply(ctx.chatId, reply);
+  perfStats.print();
+  if (ctx.args.compareNoCase("reset") == 0) perfStats.reset();
+#else
+  bot.sendMessage(ctx.chatId, "⏱️ Perf stats are not in this build (esp32s3_perf env)");
+#endif
+}
+
+// "/trace serial" dumps the JSON to Serial, "/trace clear" empties the buffer
+void cmdTrace(const CommandContext& ctx) {
+#ifdef TRACE_BUFFER
+  FixedString<REPLY_MAX_LEN> reply;
+  if (ctx.args.compareNoCase("clear") == 0) {
+    traceBuffer.clear();
+    bot.sendMessage(ctx.chatId, "🧵 Trace cleared");
+    return;
+  }
+  if (ctx.args.compareNoCase("serial") == 0) {
+    reply.appendf("🧵 Writing %lu events to Serial...", (unsigned long)traceBuffer.available());
+    sendReply(ctx.chatId, reply);
+    Serial.println("[TRACE] BEGIN");
+    traceBuffer.exportJson(traceToSerial, nullptr);
+    Serial.println("[TRACE] END");
+    return;
+  }
+  reply.appendf("🧵 Trace: %lu events\n\nhttp://%s/trace\n\nOpen in ui.perfetto.dev",
+                (unsigned long)traceBuffer.available(), WiFi.localIP().toString().c_str());
+  sendReply(ctx.chatId, reply);
+#else
+  bot.sendMessage(ctx.chatId, "🧵 Tracing is not in this build (esp32s3_trace env)");
+#endif
+}
+
+// "/log <subsystem|all> <level>" sets a level; "/log" lists them
+void cmdLog(const CommandContext& ctx) {
+  FixedString<REPLY_MAX_LEN> reply;
+  if (!ctx.args.empty()) {
+    StrView levelArg;
+    StrView subArg = splitCommand(ctx.args.ptr, &levelArg);  // args run to the end of the message
+    bool all = subArg.compareNoCase("all") == 0;
+    int sub = AsyncLog::subsystemIndex(subArg.ptr, subArg.len);
+    int level = AsyncLog::levelIndex(levelArg.ptr, levelArg.len);
+    if ((!all && sub < 0) || level < 0) {
+      bot.sendMessage(ctx.chatId, "📝 Usage: /log <subsystem|all> <error|warn|info|debug>");
+      return;
+    }
+    for (int i = 0; i < LOG_SUBSYSTEM_COUNT; i++) {
+      if (all || i == sub) asyncLog.setLevel((LogSubsystem)i, (LogLevel)level);
     }
+  }
 
-    if (text == "/start" || text == "/help") {
-      String help = "🏂 FRIYAY FOREVER\n\n";
-      help += "/commit - You're in!\n";
-      help += "/uncommit - Can't make it\n";
-      help += "/status - Who's riding\n";
-      help += "/weather - Conditions\n\n";
-      help += "📱 System:\n";
-      help += "/version - Firmware info\n";
-      help += "/update - Check for updates\n";
-      help += "/install - Install update\n\n";
-      help += "Or just say 'in' or 'out'";
-      bot.sendMessage(chatId, help, "");
-      continue;
+  reply += "📝 Log levels\n\n";
+  for (int i = 0; i < LOG_SUBSYSTEM_COUNT; i++) {
+    reply.appendf("%s: %s\n", LOG_SUBSYSTEM_NAMES[i], LOG_LEVEL_NAMES[asyncLog.level((LogSubsystem)i)]);
+  }
+  reply.appendf("\n%lu dropped", (unsigned long)asyncLog.dropped());
+  sendReply(ctx.chatId, reply);
+}
+
+void cmdWeather(const CommandContext& ctx) {
+  FixedString<REPLY_MAX_LEN> reply;
+  reply.appendf("🌤️ Chapel Hill\n\n🌡️ %d°F\n💧 %.1fmm\n🏂 Score: %d/100",
+                (int)currTemp, precipitation, fukLvl * 10);
+  sendReply(ctx.chatId, reply);
+}
+
+void cmdVersion(const CommandContext& ctx) {
+  wifi_ap_record_t ap;
+  bool haveAp = esp_wifi_sta_get_ap_info(&ap) == ESP_OK;
+  IPAddress ip = WiFi.localIP();
+  FixedString<REPLY_MAX_LEN> reply;
+  reply.appendf("📱 Firmware Info\n\n"
+                "Version: v%s\n"
+                "Board: ESP32-8048S043C\n"
+                "Unit: %s\n"
+                "WiFi: %s\n"
+                "IP: %u.%u.%u.%u",
+                otaUpdater.getCurrentVersion(), friends[MY_FRIEND_INDEX].initials,
+                haveAp ? (const char*)ap.ssid : "-", ip[0], ip[1], ip[2], ip[3]);
+  sendReply(ctx.chatId, reply);
+}
+
+void cmdUpdate(const CommandContext& ctx) {
+  FixedString<512> reply;  // Release notes run to 200 bytes
+  if (otaInProgress) {
+    reply.appendf("⏳ Already installing: %d%%, %lu KB/s", otaUpdater.progressPercent(),
+                  (unsigned long)otaUpdater.kbPerSecond());
+    sendReply(ctx.chatId, reply);
+    return;
+  }
+  bot.sendMessage(ctx.chatId, "🔄 Checking for firmware updates...");
+
+  if (otaUpdater.checkForUpdate()) {
+    reply.appendf("✅ Update available!\n\nCurrent: v%s\nLatest: v%s\n",
+                  otaUpdater.getCurrentVersion(), otaUpdater.getLatestVersion().c_str());
+    if (otaUpdater.getReleaseNotes().length() > 0) {
+      reply.appendf("\n📝 %s\n", otaUpdater.getReleaseNotes().c_str());
+    }
+    if (otaUpdater.isCriticalUpdate()) {
+      reply += "\n⚠️ CRITICAL UPDATE\n";
     }
+    reply += "\nSend /install to update now";
+  } else {
+    reply.appendf("✅ You're up to date!\n\nVersion: v%s", otaUpdater.getCurrentVersion());
+    if (otaUpdater.getLastError().length() > 0) {
+      reply.appendf("\n\n⚠️ %s", otaUpdater.getLastError().c_str());
+    }
+  }
+  sendReply(ctx.chatId, reply);
+}
 
-    if (text == "/status") {
-      String s = "📊 Status:\n\n";
-      for (int j = 0; j < NUM_FRIENDS; j++) {
-        s += friends[j].committed ? "✅ " : "⬜ ";
-        s += friends[j].initials;
-        s += "\n";
-      }
-      s += "\n⏱️ " + String(hrsLeft) + "h " + String(minLeft) + "m to Friday";
-      bot.sendMessage(chatId, s, "");
-      continue;
+void cmdInstall(const CommandContext& ctx) {
+  FixedString<REPLY_MAX_LEN> reply;
+  if (otaInProgress) {
+    reply.appendf("⏳ Already installing: %d%%, %lu KB/s", otaUpdater.progressPercent(),
+                  (unsigned long)otaUpdater.kbPerSecond());
+    sendReply(ctx.chatId, reply);
+    return;
+  }
+  if (!otaUpdater.isUpdateAvailable()) {
+    // Check again in case they haven't run /update recently
+    if (!otaUpdater.checkForUpdate()) {
+      reply.appendf("ℹ️ No update available.\n\nYou're running v%s", otaUpdater.getCurrentVersion());
+      sendReply(ctx.chatId, reply);
+      return;
     }
+  }
 
-    if (text == "/weather") {
-      String w = "🌤️ Chapel Hill\n\n🌡️ " + String((int)currTemp) + "°F\n💧 " + String(precipitation, 1) + "mm\n🏂 Score: " + String(fukLvl * 10) + "/100";
-      bot.sendMessage(chatId, w, "");
-      continue;
+  // Notify everyone that this unit is updating
+  reply.appendf("⚙️ %s's unit is updating to v%s...",
+                friends[MY_FRIEND_INDEX].initials, otaUpdater.getLatestVersion().c_str());
+  broadcast(reply.c_str());
+
+  bot.sendMessage(ctx.chatId, "🚀 Installing update...\n\nDevice will reboot when complete!");
+
+  // Downloads in the background; pollOtaUpdate() reports the outcome
+  if (!otaUpdater.startUpdate()) {
+    reply.clear();
+    reply.appendf("❌ Update failed!\n\n%s", otaUpdater.getLastError().c_str());
+    sendReply(ctx.chatId, reply);
+    return;
+  }
+  otaInProgress = true;
+  otaChatId = ctx.chatId;
+  drawOtaProgress(true);
+}
+
+// Sensor commands change this unit's hardware settings, so only its owner may
+// run them. Anyone else is told whose unit answered rather than ignored.
+bool ownerOnly(const CommandContext& ctx) {
+  if (ctx.friendIdx == MY_FRIEND_INDEX) return true;
+  FixedString<REPLY_MAX_LEN> reply;
+  reply.appendf("⚠️ That reached %s's unit, not yours; send it again",
+                friends[MY_FRIEND_INDEX].initials);
+  sendReply(ctx.chatId, reply);
+  return false;
+}
+
+// Takes the current MQ135 reading as clean air (outdoors, sensor warmed up)
+void cmdCalibrate(const CommandContext& ctx) {
+  if (!ownerOnly(ctx)) return;
+  FixedString<REPLY_MAX_LEN> reply;
+  float mq135, co2;
+  if (!readSensorVolts(mq135, co2)) {
+    bot.sendMessage(ctx.chatId, "⏳ No sensor reading yet, try again in a few seconds");
+    return;
+  }
+  uint32_t oldR0 = airQuality.r0();
+  uint32_t r0 = AirQuality::calibrate(mq135);
+  airQuality.setR0(r0);
+  prefs.putUInt("mq135_r0", r0);
+  airQuality.update(mq135, co2);
+  aqiLvl = airQuality.aqiLevel();
+  co2Lvl = airQuality.co2Level();
+  drawVUMeters();
+
+  reply.appendf("🌬️ Air sensor calibrated\n\nMQ135 %.2f V, R0 %lu → %lu Ω\n", mq135,
+                (unsigned long)oldR0, (unsigned long)r0);
+  reply.appendf("CO2 %.0f ppm (%s)", airQuality.co2Ppm(), airQuality.hasNdir() ? "NDIR" : "MQ135");
+  sendReply(ctx.chatId, reply);
+}
+
+// Whether this unit has an NDIR CO2 sensor: "/co2 ndir" or "/co2 mq135".
+// Owner only, since the hardware differs per unit.
+void cmdCo2(const CommandContext& ctx) {
+  if (!ownerOnly(ctx)) return;
+  if (!ctx.args.empty()) {
+    bool ndir = ctx.args.compareNoCase("ndir") == 0;
+    if (!ndir && ctx.args.compareNoCase("mq135") != 0) {
+      bot.sendMessage(ctx.chatId, "🌬️ Usage: /co2 <ndir|mq135>");
+      return;
     }
+    airQuality.setNdir(ndir);
+    prefs.putBool("co2_ndir", ndir);
+  }
+  FixedString<REPLY_MAX_LEN> reply;
+  reply.appendf("🌬️ %s: CO2 from the %s", friends[MY_FRIEND_INDEX].initials,
+                airQuality.hasNdir() ? "NDIR sensor" : "MQ135 curve");
+  sendReply(ctx.chatId, reply);
+}
 
-    // OTA Update Commands
-    if (text == "/version") {
-      String v = "📱 Firmware Info\n\n";
-      v += "Version: v" + otaUpdater.getCurrentVersion() + "\n";
-      v += "Board: ESP32-8048S043C\n";
-      v += "Unit: " + String(friends[MY_FRIEND_INDEX].initials) + "\n";
-      v += "WiFi: " + WiFi.SSID() + "\n";
-      v += "IP: " + WiFi.localIP().toString();
-      bot.sendMessage(chatId, v, "");
+void cmdHistory(const CommandContext& ctx) {
+  static const struct { const char* name; uint32_t seconds; } WINDOWS[] = {
+    {"Hour", 3600}, {"Day", 86400}, {"Month", 30 * 86400},
+  };
+  time_t now = time(nullptr);
+  FixedString<1024> reply;
+  reply += "📈 Air history\n";
+  for (const auto& w : WINDOWS) {
+    HistoryRollup aqi, co2;
+    if (!sensorHistory.summary(now, w.seconds, HISTORY_AQI, aqi) ||
+        !sensorHistory.summary(now, w.seconds, HISTORY_CO2, co2)) {
+      reply.appendf("\n%s: no data yet", w.name);
       continue;
     }
+    reply.appendf("\n%s: AQI %.1f (%.1f-%.1f), CO2 %d ppm (%d-%d)", w.name, aqi.avg / 10.0f,
+                  aqi.min / 10.0f, aqi.max / 10.0f, co2.avg, co2.min, co2.max);
+  }
+
+  reply += "\n\nCO2, last hour\n";
+  sensorHistory.appendSparkline(reply, now, 3600, HISTORY_CO2, 30);
+  reply += "\nCO2, last day\n";
+  sensorHistory.appendSparkline(reply, now, 86400, HISTORY_CO2, 24);
+  reply += "\nAQI, last day\n";
+  sensorHistory.appendSparkline(reply, now, 86400, HISTORY_AQI, 24);
+
+  reply.appendf("\n\n💾 %u KB PSRAM for 30 days; B per hour kept: raw %u, minute %u, hour %u",
+                (unsigned)(sensorHistory.bytes() / 1024), (unsigned)sensorHistory.bytesPerHour(HISTORY_RAW),
+                (unsigned)sensorHistory.bytesPerHour(HISTORY_MINUTE), (unsigned)sensorHistory.bytesPerHour(HISTORY_HOUR));
+  sendReply(ctx.chatId, reply);
+}
+
+// Commands and aliases, sorted by name (checked at compile time)
+constexpr CommandEntry COMMANDS[] = {
+  {"/calibrate", cmdCalibrate, CMD_FRIENDS_ONLY},
+  {"/co2",      cmdCo2,      CMD_FRIENDS_ONLY},
+  {"/commit",   cmdCommit,   CMD_FRIENDS_ONLY | CMD_ANYWHERE},
+  {"/heap",     cmdHeap,     0},
+  {"/help",     cmdHelp,     0},
+  {"/history",  cmdHistory,  0},
+  {"/install",  cmdInstall,  0},
+  {"/log",      cmdLog,      0},
+  {"/perf",     cmdPerf,     0},
+  {"/start",    cmdHelp,     0},
+  {"/status",   cmdStatus,   0},
+  {"/trace",    cmdTrace,    0},
+  {"/uncommit", cmdUncommit, CMD_FRIENDS_ONLY | CMD_ANYWHERE},
+  {"/update",   cmdUpdate,   0},
+  {"/version",  cmdVersion,  0},
+  {"/weather",  cmdWeather,  0},
+  {"bail",      cmdUncommit, CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+  {"commit",    cmdCommit,   CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+  {"in",        cmdCommit,   CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+  {"out",       cmdUncommit, CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+  {"riding",    cmdCommit,   CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+};
+COMMAND_TABLE_SORTED(COMMANDS);
+#define COMMAND_COUNT (sizeof(COMMANDS) / sizeof(COMMANDS[0]))
+
+// Look up the first word of the message; returns true if a handler ran.
+// "/commit" and "/uncommit" count anywhere in a friend's message, first.
+bool dispatchCommand(int64_t chatId, const char* text, int fIdx) {
+  CommandContext ctx;
+  StrView word = splitCommand(text, &ctx.args);
+  const CommandEntry* cmd = fIdx >= 0 ? findCommandAnywhere(COMMANDS, COMMAND_COUNT, text) : nullptr;
+  if (cmd) ctx.args = StrView();
+  else cmd = findCommand(COMMANDS, COMMAND_COUNT, word);
+  if (!cmd) return false;
+  if ((cmd->flags & CMD_WHOLE_MESSAGE) && !ctx.args.empty()) return false;
+  if ((cmd->flags & CMD_FRIENDS_ONLY) && fIdx < 0) return false;
+
+  ctx.chatId = chatId;
+  ctx.friendIdx = fIdx;
+  cmd->handler(ctx);
+  return true;
+}
 
-    if (text == "/update") {
-      bot.sendMessage(chatId, "🔄 Checking for firmware updates...", "");
+void checkTelegram() {
+  PERF_SCOPE(PERF_TELEGRAM);
+  TRACE_SCOPE("telegram", "checkTelegram");
+  int n = bot.getUpdates(tgUpdates, TELEGRAM_MAX_UPDATES);
 
-      if (otaUpdater.checkForUpdate()) {
-        String msg = "✅ Update available!\n\n";
-        msg += "Current: v" + otaUpdater.getCurrentVersion() + "\n";
-        msg += "Latest: v" + otaUpdater.getLatestVersion() + "\n";
-        if (otaUpdater.getReleaseNotes().length() > 0) {
-          msg += "\n📝 " + otaUpdater.getReleaseNotes() + "\n";
-        }
-        if (otaUpdater.isCriticalUpdate()) {
-          msg += "\n⚠️ CRITICAL UPDATE\n";
-        }
-        msg += "\nSend /install to update now";
-        bot.sendMessage(chatId, msg, "");
-      } else {
-        String msg = "✅ You're up to date!\n\n";
-        msg += "Version: v" + otaUpdater.getCurrentVersion();
-        if (otaUpdater.getLastError().length() > 0) {
-          msg += "\n\n⚠️ " + otaUpdater.getLastError();
-        }
-        bot.sendMessage(chatId, msg, "");
-      }
+  for (int i = 0; i < n; i++) {
+    const TelegramUpdate& u = tgUpdates[i];
+    const char* text = u.text;
+    const char* from = u.fromName;
+
+    int fIdx = getFriendIdx(u.chatId);
+    FixedString<MSG_MAX_LEN> reply;
+
+    // Photos, and JPEGs sent as files, go to the art panel
+    bool isDocument = u.type == TG_UPDATE_DOCUMENT;
+    bool isJpegDoc = isDocument && (endsWithNoCase(u.fileName, ".jpg") || endsWithNoCase(u.fileName, ".jpeg"));
+    if (u.type == TG_UPDATE_PHOTO || isJpegDoc) {
+      if (fIdx >= 0) spotifySenderInitials = friends[fIdx].initials;
+      showSharedPhoto(getTelegramFileUrl(u.fileId));
+      reply.appendf("%s shared a photo!", from);
+      showMessage(reply.c_str());
       continue;
     }
 
-    if (text == "/install") {
-      if (!otaUpdater.isUpdateAvailable()) {
-        // Check again in case they haven't run /update recently
-        if (!otaUpdater.checkForUpdate()) {
-          bot.sendMessage(chatId, "ℹ️ No update available.\n\nYou're running v" + otaUpdater.getCurrentVersion(), "");
-          continue;
-        }
-      }
-
-      // Notify everyone that this unit is updating
-      String initials = String(friends[MY_FRIEND_INDEX].initials);
-      broadcast("⚙️ " + initials + "'s unit is updating to v" + otaUpdater.getLatestVersion() + "...");
-
-      bot.sendMessage(chatId, "🚀 Installing update...\n\nDevice will reboot when complete!", "");
-
-      // Small delay to ensure message is sent
-      delay(1000);
+    // GIFs, as files or as animations Telegram kept as GIF. Most
+    // animations arrive re-encoded to MP4, which there's no decoder for.
+    bool isAnimation = u.type == TG_UPDATE_ANIMATION;
+    bool isGif = !strcmp(u.mimeType, "image/gif") || endsWithNoCase(u.fileName, ".gif");
+    if ((isDocument || isAnimation) && isGif) {
+      if (fIdx >= 0) spotifySenderInitials = friends[fIdx].initials;
+      playSharedGif(getTelegramFileUrl(u.fileId));
+      reply.appendf("%s shared a GIF!", from);
+      showMessage(reply.c_str());
+      continue;
+    }
+    if (isAnimation) {
+      LOG_I(LOG_MEDIA, "[GIF] Skipping a %s animation", u.mimeType[0] ? u.mimeType : "non-GIF");
+      bot.sendMessage(u.chatId, "🎞️ Can't play that animation (Telegram sent it as video). "
+                                "Send the GIF as a file to show it.");
+      continue;
+    }
 
-      // Set flag and perform update
-      otaInProgress = true;
-      otaUpdater.setProgressCallback(otaProgressCallback);
+    // Links never start with a command word, skip the lookup for them
+    if (u.entity != TG_ENTITY_URL && dispatchCommand(u.chatId, text, fIdx)) continue;
 
-      if (!otaUpdater.performUpdate()) {
-        // Update failed (didn't reboot)
-        otaInProgress = false;
-        String errMsg = "❌ Update failed!\n\n";
-        errMsg += otaUpdater.getLastError();
-        bot.sendMessage(chatId, errMsg, "");
-        drawTimer();  // Restore timer display
-      }
-      // If successful, device will have rebooted
+    if (strstr(text, "spotify.com") || strstr(text, "open.spotify")) {
+      if (fIdx >= 0) spotifySenderInitials = friends[fIdx].initials;
+      parseSpotify(text);
+      reply.appendf("%s shared music!", from);
+      showMessage(reply.c_str());
       continue;
     }
 
     if (fIdx >= 0) {
-      showMessage(String(friends[fIdx].initials) + ": " + text);
+      reply.appendf("%s: %s", friends[fIdx].initials, text);
+      if (reply.truncated()) LOG_W(LOG_TG, "[TG] Message cut at %u bytes", (unsigned)reply.length());
+      showMessage(reply.c_str());
     }
   }
 }
 
-void showMessage(String msg) {
-  currMsg = sanitizeMessage(msg);
+// Copies and sanitizes in place; no heap use
+void showMessage(const char* msg) {
+  strlcpy(currMsg, msg, sizeof(currMsg));
+  currMsgLen = sanitizeMessage(currMsg);
   showingMsg = true;
   newMsg = true;
   msgTime = millis();
@@ -1790,50 +2318,56 @@ int getFriendIdx(int64_t id) {
   return -1;
 }
 
-void broadcast(String msg) {
+void broadcast(const char* msg) {
+  PERF_SCOPE(PERF_SEND);
+  TRACE_SCOPE("telegram", "broadcast");
   for (int i = 0; i < NUM_FRIENDS; i++) {
     if (friends[i].telegramId != 0) {
-      bot.sendMessage(String(friends[i].telegramId), msg, "");
+      bot.sendMessage(friends[i].telegramId, msg);
     }
   }
 }
 
-String sanitizeMessage(String msg) {
-  String cleaned = "";
-  for (unsigned int i = 0; i < msg.length(); i++) {
-    char c = msg.charAt(i);
-    if ((c >= 32 && c <= 126) || c == '\n' || c == '\r') {
-      cleaned += c;
-    }
-  }
-  return cleaned;
-}
-
-void parseSpotify(String text) {
-  int idx = text.indexOf("/track/");
-  if (idx >= 0) {
-    int start = idx + 7;
-    int end = text.indexOf("?", start);
-    if (end < 0) end = min((int)text.length(), start + 22);
-    trackId = text.substring(start, end);
+void parseSpotify(const char* text) {
+  const char* track = strstr(text, "/track/");
+  if (track) {
+    const char* start = track + 7;
+    const char* query = strchr(start, '?');
+    size_t len = query ? (size_t)(query - start) : strnlen(start, 22);
+    trackId = "";
+    trackId.concat(start, len);
+    gifPlayer.stop();
     hasSpotify = true;
     showingQRCode = false;
+    qrPending = false;
     fetchSpotifyArt();
   }
 }
 
 void fetchSpotifyArt() {
+  PERF_SCOPE(PERF_SPOTIFY_ART);
+  TRACE_SCOPE("net", "fetchSpotifyArt");
   if (trackId.length() == 0 || WiFi.status() != WL_CONNECTED) return;
 
   HTTPClient http;
-  String url = "https://open.spotify.com/oembed?url=https://open.spotify.com/track/" + trackId;
+  String url = SPOTIFY_OEMBED_URL "/oembed?url=https://open.spotify.com/track/" + trackId;
+  http.useHTTP10(true);  // No chunked encoding, so the body can be parsed straight off the stream
   http.begin(url);
   http.setTimeout(5000);
 
-  if (http.GET() == 200) {
-    String payload = http.getString();
-    StaticJsonDocument<1024> doc;
-    if (!deserializeJson(doc, payload)) {
+  TRACE_BEGIN("net", "oembedGet");
+  int httpCode = http.GET();
+  TRACE_END("net", "oembedGet");
+  if (httpCode == 200) {
+    JsonDocument filter;
+    filter["thumbnail_url"] = true;
+
+    size_t jsonBefore = psramJsonAllocator.inUse();
+    psramJsonAllocator.resetPeak();
+    JsonDocument doc(&psramJsonAllocator);
+    if (!deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter))) {
+      LOG_I(LOG_NET, "[SPOTIFY] oEmbed parsed, document peak %u bytes",
+            (unsigned)(psramJsonAllocator.peak() - jsonBefore));
       const char* thumbUrl = doc["thumbnail_url"];
       if (thumbUrl) {
         albumArtUrl = String(thumbUrl);
@@ -1851,7 +2385,7 @@ void fetchSpotifyArt() {
 // IMAGE DOWNLOADING
 // ============================================================
 
-uint8_t* downloadImageFromUrl(String url, int* outLen) {
+uint8_t* downloadImageFromUrl(String url, int* outLen, int maxLen) {
   *outLen = 0;
   if (WiFi.status() != WL_CONNECTED) return nullptr;
 
@@ -1859,13 +2393,16 @@ uint8_t* downloadImageFromUrl(String url, int* outLen) {
   http.begin(url);
   http.setTimeout(10000);
 
-  if (http.GET() != 200) {
+  TRACE_BEGIN("net", "imageGet");
+  int httpCode = http.GET();
+  TRACE_END("net", "imageGet");
+  if (httpCode != 200) {
     http.end();
     return nullptr;
   }
 
   int len = http.getSize();
-  if (len <= 0 || len > 300000) {
+  if (len <= 0 || len > maxLen) {
     http.end();
     return nullptr;
   }
@@ -1895,6 +2432,101 @@ uint8_t* downloadImageFromUrl(String url, int* outLen) {
   return buffer;
 }
 
+// Download a GIF into PSRAM and hand it to the player (which frees it)
+void playSharedGif(String url) {
+  PERF_SCOPE(PERF_GIF);
+  TRACE_SCOPE("media", "playSharedGif");
+  int len = 0;
+  uint8_t *buffer = downloadImageFromUrl(url, &len, GIF_MAX_FILE_SIZE);
+  if (!buffer) {
+    LOG_W(LOG_MEDIA, "[GIF] Download failed");
+    return;
+  }
+
+  hasSpotify = false;
+  showingQRCode = false;
+  qrPending = false;
+  trackId = "";
+  albumArtUrl = "";
+  spotifyCodeUrl = "";
+
+  gfx->fillRect(ART_X, ART_AREA_Y, ALBUM_ART_W, ALBUM_ART_H, COL_SPOTIFY_BG);
+  drawCyberpunkGrid(ART_X, ART_AREA_Y, ALBUM_ART_W, ALBUM_ART_H);
+
+  if (gifPlayer.start(gfx, buffer, len, ART_X, ART_AREA_Y, ALBUM_ART_W, ALBUM_ART_DISPLAY_H)) {
+    drawSenderBadge();
+  } else {
+    displayQRPlaceholder();
+  }
+}
+
+// Largest JPEGDEC reduction that still covers the art area
+int chooseJpegScale(int width, int height) {
+  const int options[] = {JPEG_SCALE_EIGHTH, JPEG_SCALE_QUARTER, JPEG_SCALE_HALF};
+  const int divisors[] = {8, 4, 2};
+  for (int i = 0; i < 3; i++) {
+    if (width / divisors[i] >= ALBUM_ART_W && height / divisors[i] >= ALBUM_ART_DISPLAY_H) {
+      return options[i];
+    }
+  }
+  return 0;
+}
+
+// Download a shared photo and decode it center-cropped into the art panel.
+// Downscaling happens inside the decoder, so no full-size bitmap is ever built.
+void showSharedPhoto(String url) {
+  PERF_SCOPE(PERF_PHOTO);
+  TRACE_SCOPE("media", "showSharedPhoto");
+  if (url.length() == 0) return;
+
+  uint32_t heapBefore = ESP.getFreeHeap();
+  uint32_t psramBefore = ESP.getFreePsram();
+  photoHeapLow = heapBefore;
+  photoPsramLow = psramBefore;
+
+  int len = 0;
+  uint8_t *buffer = downloadImageFromUrl(url, &len, MAX_PHOTO_BYTES);
+  if (!buffer) {
+    LOG_W(LOG_MEDIA, "[PHOTO] Download failed");
+    return;
+  }
+  samplePhotoHeap();  // The download buffer is the bulk of the PSRAM peak
+
+  gifPlayer.stop();
+  hasSpotify = false;
+  showingQRCode = false;
+  qrPending = false;
+  trackId = "";
+  albumArtUrl = "";
+  spotifyCodeUrl = "";
+  gfx->fillRect(ART_X, ART_AREA_Y, ALBUM_ART_W, ALBUM_ART_H, COL_SPOTIFY_BG);
+
+  if (jpeg.openRAM(buffer, len, jpegDrawCallbackPhoto)) {
+    int w = jpeg.getWidth();
+    int h = jpeg.getHeight();
+    int scale = chooseJpegScale(w, h);
+    int divisor = scale ? scale : 1;
+
+    photoOffsetX = (ALBUM_ART_W - w / divisor) / 2;
+    photoOffsetY = (ALBUM_ART_DISPLAY_H - h / divisor) / 2;
+
+    jpeg.setPixelType(RGB565_LITTLE_ENDIAN);
+    unsigned long t0 = millis();
+    TRACE_BEGIN("jpeg", "decodePhoto");
+    bool ok = jpeg.decode(0, 0, scale);
+    TRACE_END("jpeg", "decodePhoto");
+    unsigned long decodeMs = millis() - t0;
+    jpeg.close();
+
+    LOG_I(LOG_MEDIA, "[PHOTO] %dx%d, %d bytes, scale 1/%d, decode %lu ms%s",
+          w, h, len, divisor, decodeMs, ok ? "" : " (FAILED)");
+    LOG_I(LOG_MEDIA, "[PHOTO] Peak heap: internal %u bytes, PSRAM %u bytes",
+          (unsigned)(heapBefore - photoHeapLow), (unsigned)(psramBefore - photoPsramLow));
+    if (ok) drawSenderBadge();
+  }
+  free(buffer);
+}
+
 void downloadAndDisplayImage() {
   if (albumArtUrl.length() == 0) return;
 
@@ -1926,7 +2558,10 @@ void decodeAndDisplayJpeg(uint8_t *buffer, int size) {
 
     jpeg.setPixelType(RGB565_LITTLE_ENDIAN);
 
-    if (jpeg.decode(offsetX, offsetY, scale)) {
+    TRACE_BEGIN("jpeg", "decodeArt");
+    bool decoded = jpeg.decode(offsetX, offsetY, scale);
+    TRACE_END("jpeg", "decodeArt");
+    if (decoded) {
       drawSenderBadge();
       // Fetch and display Spotify code after successful album art decode
       if (trackId.length() > 0) getSpotifyCode();
@@ -1936,8 +2571,10 @@ void decodeAndDisplayJpeg(uint8_t *buffer, int size) {
 }
 
 void getSpotifyCode() {
+  PERF_SCOPE(PERF_SPOTIFY_CODE);
+  TRACE_SCOPE("net", "getSpotifyCode");
   if (trackId.length() == 0) return;
-  spotifyCodeUrl = "https://scannables.scdn.co/uri/plain/jpeg/000000/white/500/spotify:track:" + trackId;
+  spotifyCodeUrl = SPOTIFY_CODE_URL "/uri/plain/jpeg/000000/white/500/spotify:track:" + trackId;
   downloadAndDisplayCode();
 }
 
@@ -1958,7 +2595,9 @@ void decodeAndDisplayCode(uint8_t *buffer, int size) {
 
   if (jpeg.openRAM(buffer, size, jpegDrawCallbackCode)) {
     jpeg.setPixelType(RGB565_LITTLE_ENDIAN);
+    TRACE_BEGIN("jpeg", "decodeCode");
     jpeg.decode(0, 0, JPEG_SCALE_HALF);
+    TRACE_END("jpeg", "decodeCode");
     jpeg.close();
   }
 }
@@ -1968,12 +2607,14 @@ void decodeAndDisplayCode(uint8_t *buffer, int size) {
 // ============================================================
 
 void getWeather() {
+  PERF_SCOPE(PERF_WEATHER);
+  TRACE_SCOPE("net", "getWeather");
   if (WiFi.status() != WL_CONNECTED) return;
 
   HTTPClient http;
   char url[400];
   snprintf(url, sizeof(url),
-    "https://api.open-meteo.com/v1/forecast?"
+    OPEN_METEO_URL "/v1/forecast?"
     "latitude=%.4f&longitude=%.4f"
     "&current=temperature_2m,precipitation"
     "&daily=temperature_2m_max,precipitation_sum"
@@ -1981,14 +2622,28 @@ void getWeather() {
     "&forecast_days=7",
     LATITUDE, LONGITUDE);
 
+  http.useHTTP10(true);  // No chunked encoding, so the body can be parsed straight off the stream
   http.begin(url);
   http.setTimeout(10000);
 
-  if (http.GET() == 200) {
-    String resp = http.getString();
-    DynamicJsonDocument doc(4096);
-
-    if (!deserializeJson(doc, resp)) {
+  TRACE_BEGIN("net", "weatherGet");
+  int httpCode = http.GET();
+  TRACE_END("net", "weatherGet");
+  if (httpCode == 200) {
+    // Only the fields we use are materialized (hourly units, metadata etc. are skipped)
+    JsonDocument filter;
+    filter["current"]["temperature_2m"] = true;
+    filter["current"]["precipitation"] = true;
+    filter["daily"]["temperature_2m_max"] = true;
+    filter["daily"]["precipitation_sum"] = true;
+
+    size_t jsonBefore = psramJsonAllocator.inUse();
+    psramJsonAllocator.resetPeak();
+    JsonDocument doc(&psramJsonAllocator);
+
+    if (!deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter))) {
+      LOG_I(LOG_NET, "[WEATHER] Forecast parsed, document peak %u bytes",
+            (unsigned)(psramJsonAllocator.peak() - jsonBefore));
       currTemp = doc["current"]["temperature_2m"];
       precipitation = doc["current"]["precipitation"];
       weatherOK = true;
@@ -2066,20 +2721,39 @@ int calculateWifiStrength(int rssi) {
   return 1;
 }
 
-void readSensors() {
+// MQ135 and CO2 output voltages; false until both have a reading
+bool readSensorVolts(float& mq135, float& co2) {
   // v26 FIX: Check if ADS1115 is available
   if (!adsOK) {
-    // Fallback to direct analog read
-    int raw = analogRead(MQ135_PIN);
-    aqiLvl = map(constrain(raw, 0, 4095), 0, 4095, 10, 0);
-    co2Lvl = aqiLvl;
-    return;
+    // Fallback to direct analog read; no CO2 input without the ADS1115
+    mq135 = analogRead(MQ135_PIN) * 3.3f / 4095.0f;
+    co2 = 0;
+    return true;
   }
 
-  int16_t rawADC = ads.readADC_SingleEnded(0);
-  aqiLvl = map(constrain(rawADC, 0, 20000), 0, 20000, 10, 0);
-  aqiLvl = constrain(aqiLvl, 0, 10);
-  co2Lvl = aqiLvl;
+  // Filtered by the sampler task; no I2C here
+  int32_t mqUv, co2Uv;
+  if (!adsSampler.readMicrovolts(ADS_SLOT_MQ135, mqUv) || !adsSampler.readMicrovolts(ADS_SLOT_CO2, co2Uv)) {
+    return false;
+  }
+  mq135 = mqUv / 1e6f;
+  co2 = co2Uv / 1e6f;
+  return true;
+}
+
+void readSensors() {
+  PERF_SCOPE(PERF_SENSORS);
+  TRACE_SCOPE("sensors", "readSensors");
+  float mq135, co2;
+  if (!readSensorVolts(mq135, co2)) return;  // No conversion yet: keep the last levels
+  airQuality.update(mq135, co2);
+  aqiLvl = airQuality.aqiLevel();
+  co2Lvl = airQuality.co2Level();
+
+  int16_t sample[HISTORY_CHANNELS];
+  sample[HISTORY_AQI] = airQuality.aqiTenths();
+  sample[HISTORY_CO2] = (int16_t)min(airQuality.co2Ppm(), 30000.0f);
+  sensorHistory.add(time(nullptr), sample);
 }
 
 // ============================================================
@@ -2132,64 +2806,242 @@ void checkQRReminder() {
 // OTA UPDATE FUNCTIONS
 // ============================================================
 
-void otaProgressCallback(int progress) {
-  // Clear and redraw the timer area with update progress
-  gfx->fillRect(TIMER_X, TIMER_Y, TIMER_W, TIMER_H, COL_BLACK);
-  gfx->drawRoundRect(TIMER_X, TIMER_Y, TIMER_W, TIMER_H, 8, COL_CYAN);
+// Progress panel in the timer area. 'full' draws the frame; after that
+// only the newly filled strip of the bar and changed text are drawn.
+void drawOtaProgress(bool full) {
+  static int lastFillW = 0;
+  static int lastPct = -1;
+  static unsigned long lastRateDraw = 0;
 
   int centerY = TIMER_Y + TIMER_H / 2;
-
-  // Title
-  gfx->setTextColor(COL_CYAN);
-  gfx->setTextSize(2);
-  gfx->setCursor(TIMER_X + 80, centerY - 45);
-  gfx->print("UPDATING FIRMWARE");
-
-  // Progress bar
   int barW = TIMER_W - 60;
   int barH = 30;
   int barX = TIMER_X + 30;
   int barY = centerY - 10;
 
-  // Bar outline
-  gfx->drawRect(barX, barY, barW, barH, COL_YELLOW);
+  if (full) {
+    gfx->fillRect(TIMER_X - 3, TIMER_Y - 3, TIMER_W + 6, TIMER_H + 6, COL_BLACK);
+    gfx->drawRoundRect(TIMER_X, TIMER_Y, TIMER_W, TIMER_H, 8, COL_CYAN);
+    gfx->setTextColor(COL_CYAN);
+    gfx->setTextSize(2);
+    gfx->setCursor(TIMER_X + 80, centerY - 45);
+    gfx->print("UPDATING FIRMWARE");
+    gfx->drawRect(barX, barY, barW, barH, COL_YELLOW);
+    lastFillW = 0;
+    lastPct = -1;
+    lastRateDraw = 0;
+  }
 
-  // Filled portion
-  int fillW = ((barW - 4) * progress) / 100;
-  if (fillW > 0) {
-    gfx->fillRect(barX + 2, barY + 2, fillW, barH - 4, COL_VU_GREEN);
+  int pct = otaUpdater.progressPercent();
+  int fillW = ((barW - 4) * pct) / 100;
+  if (fillW > lastFillW) {
+    gfx->fillRect(barX + 2 + lastFillW, barY + 2, fillW - lastFillW, barH - 4, COL_VU_GREEN);
+    lastFillW = fillW;
   }
 
-  // Percentage text
+  // Percentage and rate under the bar, at most once a second for the rate
+  unsigned long now = millis();
+  if (pct == lastPct && now - lastRateDraw < 1000) return;
+  lastPct = pct;
+  lastRateDraw = now;
+
+  char line[32];
+  snprintf(line, sizeof(line), "%d%%  %lu KB/s", pct, (unsigned long)otaUpdater.kbPerSecond());
+  gfx->fillRect(TIMER_X + 4, centerY + 28, TIMER_W - 8, 26, COL_BLACK);
   gfx->setTextColor(COL_WHITE);
   gfx->setTextSize(3);
-  String pctStr = String(progress) + "%";
-  int tw = pctStr.length() * 18;
+  int tw = strlen(line) * 18;
   gfx->setCursor(TIMER_X + (TIMER_W - tw) / 2, centerY + 30);
-  gfx->print(pctStr);
+  gfx->print(line);
+}
+
+// Called from the animation tick while the download task runs
+void pollOtaUpdate() {
+  switch (otaUpdater.state()) {
+    case OTA_RUNNING:
+      drawOtaProgress(false);
+      break;
 
-  // Keep LED breathing during update
-  updateBreathingLED();
+    case OTA_DONE: {
+      drawOtaProgress(false);
+      FixedString<REPLY_MAX_LEN> reply;
+      reply.appendf("✅ v%s installed at %lu KB/s, rebooting", otaUpdater.getLatestVersion().c_str(),
+                    (unsigned long)otaUpdater.kbPerSecond());
+      sendReply(otaChatId, reply);
+      delay(1000);  // Let the log task drain
+      ESP.restart();
+      break;
+    }
+
+    case OTA_FAILED: {
+      otaInProgress = false;
+      FixedString<REPLY_MAX_LEN> reply;
+      reply.appendf("❌ Update failed!\n\n%s", otaUpdater.getLastError().c_str());
+      sendReply(otaChatId, reply);
+      drawTimer();  // Restore timer display
+      break;
+    }
+
+    default:
+      break;
+  }
 }
 
 void checkForOTAUpdates() {
-  Serial.println("[OTA] Performing scheduled update check...");
+  PERF_SCOPE(PERF_OTA_CHECK);
+  TRACE_SCOPE("ota", "checkForOTAUpdates");
+  LOG_I(LOG_OTA, "[OTA] Performing scheduled update check...");
 
   if (otaUpdater.checkForUpdate()) {
-    Serial.printf("[OTA] Update available: %s -> %s\n",
-                 otaUpdater.getCurrentVersion().c_str(),
-                 otaUpdater.getLatestVersion().c_str());
+    LOG_I(LOG_OTA, "[OTA] Update available: %s -> %s",
+          otaUpdater.getCurrentVersion(),
+          otaUpdater.getLatestVersion().c_str());
 
     // Notify all friends about available update
-    String msg = "📢 Firmware update available!\n\n";
-    msg += "Current: v" + otaUpdater.getCurrentVersion() + "\n";
-    msg += "Latest: v" + otaUpdater.getLatestVersion() + "\n\n";
-    msg += "Send /update for details";
-    broadcast(msg);
+    FixedString<REPLY_MAX_LEN> msg;
+    msg.appendf("📢 Firmware update available!\n\nCurrent: v%s\nLatest: v%s\n\nSend /update for details",
+                otaUpdater.getCurrentVersion(), otaUpdater.getLatestVersion().c_str());
+    broadcast(msg.c_str());
   } else {
-    Serial.println("[OTA] No update available or check failed");
+    LOG_I(LOG_OTA, "[OTA] No update available or check failed");
     if (otaUpdater.getLastError().length() > 0) {
-      Serial.printf("[OTA] Error: %s\n", otaUpdater.getLastError().c_str());
+      LOG_E(LOG_OTA, "[OTA] Error: %s", otaUpdater.getLastError().c_str());
     }
   }
 }
+
+// Serve this unit's image to siblings at friyay-<initials>.local, and
+// (re)start the web server after WiFi setup. The image contains the bot
+// token, so the token is also the secret a sibling must prove it holds.
+void startPeerSharing() {
+  static bool routed = false;
+  if (!routed) {
+    char host[24] = "friyay-";
+    size_t len = strlen(host);
+    for (const char* c = friends[MY_FRIEND_INDEX].initials; *c && len < sizeof(host) - 1; c++) {
+      if (isalnum((unsigned char)*c)) host[len++] = tolower((unsigned char)*c);
+    }
+    host[len] = 0;
+    otaUpdater.startPeerSharing(server, host, BOT_TOKEN);
+    routed = true;
+  }
+  server.begin();
+}
+
+#ifdef TRACE_BUFFER
+// ============================================================
+// TRACE EXPORT (esp32s3_trace env, see trace_buffer.h)
+// ============================================================
+
+void traceToSerial(void* ctx, const char* data, size_t len) {
+  (void)ctx;
+  Serial.write((const uint8_t*)data, len);
+}
+
+void traceToClient(void* ctx, const char* data, size_t len) {
+  (void)ctx;
+  server.sendContent(data, len);
+}
+
+// Streams the buffer; nothing is built in RAM
+void handleTrace() {
+  server.sendHeader("Content-Disposition", "attachment; filename=\"friyay-trace.json\"");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  traceBuffer.exportJson(traceToClient, nullptr);
+  server.sendContent("");  // Ends the chunked response
+}
+
+void startTraceServer() {
+  static bool routed = false;
+  if (!routed) {
+    server.on("/trace", HTTP_GET, handleTrace);
+    routed = true;
+  }
+  server.begin();
+  LOG_I(LOG_SYS, "[TRACE] Export at http://%s/trace", WiFi.localIP().toString().c_str());
+}
+#endif
+
+#ifdef DRAW_BENCH
+// ============================================================
+// DRAW BENCHMARK (native_bench env, see draw_bench.h)
+// ============================================================
+
+// Fixed state so every widget renders the same pixels on every run
+void benchDefaults() {
+  for (int i = 0; i < NUM_FRIENDS; i++) friends[i].committed = (i % 2 == 0);
+  dayOfWeek = 3;
+  selectedDay = -1;
+  wetLvl = 4;
+  tmpLvl = 7;
+  fukLvl = 9;
+  currTemp = 72;
+  aqiLvl = 6;
+  co2Lvl = 9;
+  wifiStrength = 3;
+  scannerActive = true;
+  scannerPos = 120;
+  newMsg = false;
+  showCommitAnim = false;
+  showingMsg = false;
+  currMsgLen = 0;
+  msgScrollPos = 0;
+  secToFri = 3 * 86400L + 4 * 3600L + 5 * 60 + 6;
+  hrsLeft = 76;
+  minLeft = 5;
+  secLeft = 6;
+  zeroTriggered = true;  // No Morse LED side effect in the shutdown case
+}
+
+void runDrawBench() {
+  drawBench.begin(gfx);
+
+  drawBench.measure("drawUI", benchDefaults, drawUI);
+  drawBench.measure("drawButtons", benchDefaults, drawButtons);
+  drawBench.measure("drawNotification", benchDefaults, drawNotificationBox);
+  drawBench.measure("drawDays", benchDefaults, drawDays);
+  drawBench.measure("drawWeatherBars", benchDefaults, drawWeatherBars);
+  drawBench.measure("drawTimer_commit", [] {
+    benchDefaults();
+    showCommitAnim = true;
+    commitAnimStart = millis();
+  }, drawTimer);
+  drawBench.measure("drawTimer_message", [] {
+    benchDefaults();
+    showingMsg = true;
+    currMsgLen = snprintf(currMsg, sizeof(currMsg), "%s", "FRIYAY!!");
+    msgTime = millis();
+  }, drawTimer);
+  drawBench.measure("drawTimer_scroll", [] {
+    benchDefaults();
+    showingMsg = true;
+    currMsgLen = snprintf(currMsg, sizeof(currMsg), "%s", "Wheels up at five, last one out buys");
+    msgScrollPos = 90;
+    msgTime = millis();
+  }, drawTimer);
+  drawBench.measure("drawTimer_shutdown", [] {
+    benchDefaults();
+    secToFri = 0;
+  }, drawTimer);
+  drawBench.measure("drawTimer_countdown", benchDefaults, drawTimer);
+  drawBench.measure("drawVUMeters", benchDefaults, drawVUMeters);
+  drawBench.measure("drawHeader", benchDefaults, drawHeader);
+  drawBench.measure("drawSpotifyArea", benchDefaults, drawSpotifyArea);
+  drawBench.measure("drawKeyboard", [] {
+    benchDefaults();
+    kbInput = "hunter2";
+    capsOn = false;
+  }, drawKeyboard);
+  drawBench.measure("drawNetList", [] {
+    benchDefaults();
+    const char* names[] = {"FriyayHQ", "Garage-5G", "xfinitywifi", "Shed"};
+    netCount = 4;
+    for (int i = 0; i < netCount; i++) networks[i] = names[i];
+    selNetwork = 1;
+    kbInput = "hunter2";
+  }, drawNetList);
+
+  exit(drawBench.finish());
+}
+#endif
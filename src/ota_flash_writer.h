@@ -0,0 +1,203 @@
+/*
+ * =====================================================
+ * OTA PARTITION WRITER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Writes a firmware image into the next OTA partition, like the core's
+ * Update class, but can pick up where an earlier attempt stopped: the
+ * running MD5 is a plain ROM md5_context_t that the caller can save
+ * (with offset()) and hand back to begin() after a dropped connection
+ * or a restart.
+ *
+ * Each chunk is also fed to SHA-256 as it is written. mbedtls runs that
+ * on the S3's SHA accelerator, so checking a fresh image needs no second
+ * pass over flash. The SHA state can't be checkpointed, and a saved MD5
+ * only vouches for what was sent, so a resumed image is instead read
+ * back and hashed before it is made bootable.
+ *
+ * Flash is erased just ahead of the data, in 64 KB blocks where aligned
+ * and 4 KB sectors otherwise, so a resumed write never erases what the
+ * earlier attempt already wrote.
+ *
+ * Usage:
+ * - begin(size) for a new image, or begin(size, offset, &hash) to
+ *   continue one; 'offset' must be a sector boundary
+ * - write(buf, len) in order
+ * - end(md5, sha256) checks length, MD5 and SHA-256 (those given) and
+ *   makes the partition the boot partition; the image is validated
+ *   there too
+ * - errorString() after any false return; hashMicros() for the time
+ *   spent hashing
+ */
+
+#ifndef OTA_FLASH_WRITER_H
+#define OTA_FLASH_WRITER_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
+#include <esp_rom_md5.h>
+#include <mbedtls/sha256.h>
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define OTA_SECTOR_SIZE  4096    // Smallest erase
+#define OTA_BLOCK_SIZE   65536   // Faster erase, used when aligned
+#define OTA_IMAGE_MAGIC  0xE9    // First byte of every app image
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class OTAFlashWriter {
+public:
+    OTAFlashWriter() : _partition(nullptr), _size(0), _offset(0), _erased(0), _resumedAt(0), _hashUs(0), _error("") {
+        mbedtls_sha256_init(&_sha);
+    }
+
+    ~OTAFlashWriter() { mbedtls_sha256_free(&_sha); }
+
+    bool begin(uint32_t size, uint32_t offset = 0, const md5_context_t* hash = nullptr) {
+        _error = "";
+        _partition = esp_ota_get_next_update_partition(nullptr);
+        if (!_partition) return setError("No OTA partition");
+        if (size == 0 || size > _partition->size) return setError("Image doesn't fit the partition");
+        if (offset >= size || offset % OTA_SECTOR_SIZE || (offset && !hash)) {
+            return setError("Bad resume offset");
+        }
+        _size = size;
+        _offset = offset;
+        _erased = offset;  // Everything past it is erased again before use
+        _resumedAt = offset;
+        _hashUs = 0;
+        if (hash) {
+            _hash = *hash;
+        } else {
+            esp_rom_md5_init(&_hash);
+        }
+        mbedtls_sha256_free(&_sha);
+        mbedtls_sha256_init(&_sha);
+        mbedtls_sha256_starts_ret(&_sha, 0);  // Only meaningful from offset 0
+        return true;
+    }
+
+    bool write(const uint8_t* data, size_t len) {
+        if (!_partition || _error.length()) return false;
+        if (_offset + len > _size) return setError("More data than the image size");
+        if (_offset == 0 && len > 0 && data[0] != OTA_IMAGE_MAGIC) return setError("Not a firmware image");
+
+        while (_erased < _offset + len) {
+            uint32_t step = (_erased % OTA_BLOCK_SIZE == 0 && _erased + OTA_BLOCK_SIZE <= _partition->size)
+                                ? OTA_BLOCK_SIZE : OTA_SECTOR_SIZE;
+            esp_err_t err = esp_partition_erase_range(_partition, _erased, step);
+            if (err != ESP_OK) return setError("Flash erase failed", err);
+            _erased += step;
+        }
+        esp_err_t err = esp_partition_write(_partition, _offset, data, len);
+        if (err != ESP_OK) return setError("Flash write failed", err);
+
+        unsigned long t0 = micros();
+        esp_rom_md5_update(&_hash, data, len);
+        if (!_resumedAt) mbedtls_sha256_update_ret(&_sha, data, len);
+        _hashUs += micros() - t0;
+        _offset += len;
+        return true;
+    }
+
+    // Hex digests, each null/empty to skip that check
+    bool end(const char* md5, const char* sha256 = nullptr) {
+        if (!_partition || _error.length()) return false;
+        if (_offset != _size) return setError("Image incomplete");
+
+        bool haveMd5 = md5 && md5[0];
+        bool haveSha = sha256 && sha256[0];
+        unsigned long t0 = micros();
+        if (haveMd5) {
+            md5_context_t hash = _hash;  // Final pads the copy; offset()/hash() stay usable
+            if (!digestMatches(hash, md5)) return setError("MD5 mismatch");
+        }
+        if (_resumedAt) {
+            if ((haveMd5 || haveSha) && !flashMatches(md5, sha256)) return false;
+        } else if (haveSha) {
+            uint8_t digest[32];
+            mbedtls_sha256_finish_ret(&_sha, digest);
+            if (!hexMatches(digest, sizeof(digest), sha256)) return setError("SHA-256 mismatch");
+        }
+        _hashUs += micros() - t0;
+
+        esp_err_t err = esp_ota_set_boot_partition(_partition);
+        if (err != ESP_OK) return setError("Image failed validation", err);
+        return true;
+    }
+
+    // Bytes written so far and their running hash, for a checkpoint
+    uint32_t offset() const { return _offset; }
+    const md5_context_t& hash() const { return _hash; }
+    uint32_t partitionAddress() const { return _partition ? _partition->address : 0; }
+
+    // Time spent in MD5/SHA-256 since begin(), including any read-back
+    uint64_t hashMicros() const { return _hashUs; }
+
+    const String& errorString() const { return _error; }
+
+private:
+    const esp_partition_t* _partition;
+    uint32_t _size;
+    uint32_t _offset;
+    uint32_t _erased;     // Erased up to here (exclusive)
+    uint32_t _resumedAt;  // Offset begin() continued from (0 = fresh)
+    md5_context_t _hash;
+    mbedtls_sha256_context _sha;  // Of the image from offset 0; unused when resumed
+    uint64_t _hashUs;
+    String _error;
+
+    static bool hexMatches(const uint8_t* digest, size_t len, const char* expected) {
+        char hex[65];
+        for (size_t i = 0; i < len; i++) snprintf(hex + i * 2, 3, "%02x", digest[i]);
+        return strcasecmp(hex, expected) == 0;
+    }
+
+    static bool digestMatches(md5_context_t& hash, const char* md5) {
+        uint8_t digest[ESP_ROM_MD5_DIGEST_LEN];
+        esp_rom_md5_final(digest, &hash);
+        return hexMatches(digest, sizeof(digest), md5);
+    }
+
+    // Hashes the image as it is in flash now, against either digest
+    bool flashMatches(const char* md5, const char* sha256) {
+        md5_context_t md5Hash;
+        esp_rom_md5_init(&md5Hash);
+        mbedtls_sha256_context shaHash;
+        mbedtls_sha256_init(&shaHash);
+        mbedtls_sha256_starts_ret(&shaHash, 0);
+
+        uint8_t buf[1024];
+        bool read = true;
+        for (uint32_t pos = 0; read && pos < _size; pos += sizeof(buf)) {
+            uint32_t n = min((uint32_t)sizeof(buf), _size - pos);
+            read = esp_partition_read(_partition, pos, buf, n) == ESP_OK;
+            if (md5 && md5[0]) esp_rom_md5_update(&md5Hash, buf, n);
+            if (sha256 && sha256[0]) mbedtls_sha256_update_ret(&shaHash, buf, n);
+        }
+        uint8_t shaDigest[32];
+        mbedtls_sha256_finish_ret(&shaHash, shaDigest);
+        mbedtls_sha256_free(&shaHash);
+
+        if (!read) return setError("Flash read failed");
+        if (md5 && md5[0] && !digestMatches(md5Hash, md5)) return setError("Flash differs from the image");
+        if (sha256 && sha256[0] && !hexMatches(shaDigest, sizeof(shaDigest), sha256)) {
+            return setError("SHA-256 mismatch");
+        }
+        return true;
+    }
+
+    bool setError(const char* what, esp_err_t err = ESP_OK) {
+        _error = what;
+        if (err != ESP_OK) _error += " (0x" + String(err, HEX) + ")";
+        return false;
+    }
+};
+
+#endif // OTA_FLASH_WRITER_H
@@ -0,0 +1,296 @@
+/*
+ * =====================================================
+ * LAN FIRMWARE SHARING FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Lets the units update each other, so only the first one to install
+ * a release downloads it from GitHub. Every unit serves the image it
+ * is running at GET /ota/firmware.bin on the existing WebServer (with
+ * Range support, so interrupted transfers resume) and advertises it
+ * over mDNS as _friyay-ota._tcp with its version, size and SHA-256.
+ *
+ * A unit about to update asks mDNS for a sibling advertising exactly
+ * the release's version and the SHA-256 from version.json. The flashed
+ * copy is hashed again before it may boot (ota_flash_writer.h), so a
+ * sibling can only ever hand out the image GitHub published.
+ *
+ * The image holds the bot token, so it is only served to units that
+ * know a secret the fleet shares: each GET carries an X-Friyay-Auth
+ * header, "<unix time>:<HMAC-SHA256 of time, path and Range>", and is
+ * refused with 403 unless the MAC matches and the time is within
+ * OTA_PEER_AUTH_WINDOW of this unit's clock. Both units need NTP time.
+ * The body itself is still plain HTTP on the LAN.
+ *
+ * The body is streamed by a task on core 0, one transfer at a time
+ * (others get 503), so handleClient() returns as soon as the headers
+ * are out and loop() keeps running.
+ *
+ * Usage:
+ * - begin(server, hostname, version, secret) once WiFi is up, then keep
+ *   calling server.handleClient() from loop()
+ * - find(version, sha256) from the OTA download task: URL of a sibling
+ *   serving that image, or "" (waits for mDNS answers, ~3 s)
+ * - authorization(path, range): X-Friyay-Auth value for a GET of a
+ *   sibling's image, "" while the clock is unset
+ */
+
+#ifndef OTA_PEER_H
+#define OTA_PEER_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <ESPmDNS.h>
+#include <esp_heap_caps.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <atomic>
+#include <time.h>
+#include "trace_buffer.h"
+#include "async_log.h"
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define OTA_PEER_SERVICE  "friyay-ota"
+#define OTA_PEER_PATH     "/ota/firmware.bin"
+#define OTA_PEER_PORT     80     // The WebServer's port
+#define OTA_PEER_CHUNK    4096   // Image bytes per flash read / TCP write
+#define OTA_PEER_AUTH_HEADER "X-Friyay-Auth"
+#define OTA_PEER_AUTH_WINDOW 300  // Seconds of clock skew (and replay) accepted
+#define OTA_PEER_CLOCK_SET   1700000000  // Earlier than this, NTP hasn't synced
+#define OTA_PEER_TASK_STACK  4096
+#define OTA_PEER_TASK_PRIORITY 1
+#define OTA_PEER_TASK_CORE   0
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class OTAPeer {
+public:
+    OTAPeer() : _server(nullptr), _size(0), _first(0), _last(0), _serving(false) { _sha256[0] = 0; }
+
+    bool begin(WebServer& server, const char* hostname, const char* version, const char* secret) {
+        _server = &server;
+        _size = ESP.getSketchSize();
+        _secret = secret;
+        if (_secret.length() == 0) {
+            LOG_W(LOG_OTA, "[OTA] No peer secret; not sharing the image");
+            return false;
+        }
+
+        unsigned long t0 = millis();
+        if (!hashRunning()) {
+            LOG_W(LOG_OTA, "[OTA] Could not hash the running image; not sharing it");
+            return false;
+        }
+        LOG_I(LOG_OTA, "[OTA] Running image hashed in %lu ms", millis() - t0);
+
+        static const char* headers[] = {"Range", OTA_PEER_AUTH_HEADER};
+        server.collectHeaders(headers, 2);
+        server.on(OTA_PEER_PATH, HTTP_GET, [this]() { handleImage(); });
+
+        if (!MDNS.begin(hostname)) {
+            LOG_W(LOG_OTA, "[OTA] mDNS start failed; not advertising the image");
+            return false;
+        }
+        _hostname = hostname;
+        MDNS.addService(OTA_PEER_SERVICE, "tcp", OTA_PEER_PORT);
+        MDNS.addServiceTxt(OTA_PEER_SERVICE, "tcp", "version", version);
+        MDNS.addServiceTxt(OTA_PEER_SERVICE, "tcp", "size", String(_size).c_str());
+        MDNS.addServiceTxt(OTA_PEER_SERVICE, "tcp", "sha256", _sha256);
+        LOG_I(LOG_OTA, "[OTA] Sharing v%s as %s.local", version, hostname);
+        return true;
+    }
+
+    // A sibling (not this unit) serving exactly this image
+    String find(const String& version, const String& sha256) {
+        if (_hostname.length() == 0) return "";  // mDNS not running
+
+        TRACE_BEGIN("ota", "mdnsQuery");
+        int found = MDNS.queryService(OTA_PEER_SERVICE, "tcp");
+        TRACE_END("ota", "mdnsQuery");
+
+        for (int i = 0; i < found; i++) {
+            if (MDNS.hostname(i) == _hostname) continue;
+            if (MDNS.txt(i, "version") != version || !MDNS.txt(i, "sha256").equalsIgnoreCase(sha256)) continue;
+            LOG_I(LOG_OTA, "[OTA] %s has v%s", MDNS.hostname(i).c_str(), version.c_str());
+            return "http://" + MDNS.IP(i).toString() + ":" + String(MDNS.port(i)) + OTA_PEER_PATH;
+        }
+        LOG_I(LOG_OTA, "[OTA] No sibling has v%s (%d units answered)", version.c_str(), found);
+        return "";
+    }
+
+    // "<time>:<mac>" proving this unit knows the secret, or "" before
+    // NTP has set the clock
+    String authorization(const String& path, const String& range) const {
+        time_t now = time(nullptr);
+        if (now < OTA_PEER_CLOCK_SET || _secret.length() == 0) return "";
+        char mac[65];
+        String stamp = String((unsigned long)now);
+        sign(stamp, path, range, mac);
+        return stamp + ":" + mac;
+    }
+
+    const char* sha256() const { return _sha256; }
+    bool serving() const { return _serving.load(); }  // A transfer is streaming
+
+private:
+    WebServer* _server;
+    String _hostname;
+    String _secret;
+    uint32_t _size;
+    char _sha256[65];
+    WiFiClient _client;            // The transfer in progress, owned by the task
+    uint32_t _first, _last;
+    std::atomic<bool> _serving;
+
+    // SHA-256 of the running image: the bytes of its firmware.bin
+    bool hashRunning() {
+        const esp_partition_t* running = esp_ota_get_running_partition();
+        uint8_t* buf = (uint8_t*)heap_caps_malloc(OTA_PEER_CHUNK, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        bool ok = running && buf && _size > 0;
+
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_starts_ret(&ctx, 0);
+        for (uint32_t pos = 0; ok && pos < _size; pos += OTA_PEER_CHUNK) {
+            uint32_t n = min((uint32_t)OTA_PEER_CHUNK, _size - pos);
+            ok = esp_partition_read(running, pos, buf, n) == ESP_OK;
+            if (ok) mbedtls_sha256_update_ret(&ctx, buf, n);
+        }
+        uint8_t digest[32];
+        mbedtls_sha256_finish_ret(&ctx, digest);
+        mbedtls_sha256_free(&ctx);
+        heap_caps_free(buf);
+
+        for (int i = 0; i < 32; i++) snprintf(_sha256 + i * 2, 3, "%02x", digest[i]);
+        if (!ok) _sha256[0] = 0;
+        return ok;
+    }
+
+    // HMAC-SHA256 (RFC 2104) of "time path range" under the secret, as hex
+    void sign(const String& stamp, const String& path, const String& range, char hex[65]) const {
+        uint8_t key[64] = {0};
+        if (_secret.length() > sizeof(key)) {
+            sha256Of((const uint8_t*)_secret.c_str(), _secret.length(), nullptr, 0, key);
+        } else {
+            memcpy(key, _secret.c_str(), _secret.length());
+        }
+        String message = stamp + " " + path + " " + range;
+        uint8_t pad[64], inner[32], digest[32];
+        for (int i = 0; i < 64; i++) pad[i] = key[i] ^ 0x36;
+        sha256Of(pad, sizeof(pad), (const uint8_t*)message.c_str(), message.length(), inner);
+        for (int i = 0; i < 64; i++) pad[i] = key[i] ^ 0x5c;
+        sha256Of(pad, sizeof(pad), inner, sizeof(inner), digest);
+        for (int i = 0; i < 32; i++) snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+
+    static void sha256Of(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, uint8_t out[32]) {
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_starts_ret(&ctx, 0);
+        mbedtls_sha256_update_ret(&ctx, a, aLen);
+        if (bLen) mbedtls_sha256_update_ret(&ctx, b, bLen);
+        mbedtls_sha256_finish_ret(&ctx, out);
+        mbedtls_sha256_free(&ctx);
+    }
+
+    // The request's X-Friyay-Auth: signed with the secret, recently
+    bool authorized(const String& range) const {
+        String auth = _server->header(OTA_PEER_AUTH_HEADER);
+        int colon = auth.indexOf(':');
+        if (colon <= 0 || auth.length() != (unsigned)colon + 65) return false;
+        String stamp = auth.substring(0, colon);
+        long skew = (long)(time(nullptr) - (time_t)strtoul(stamp.c_str(), nullptr, 10));
+        if (time(nullptr) < OTA_PEER_CLOCK_SET || labs(skew) > OTA_PEER_AUTH_WINDOW) return false;
+
+        char mac[65];
+        sign(stamp, OTA_PEER_PATH, range, mac);
+        uint8_t diff = 0;  // Constant time
+        for (int i = 0; i < 64; i++) diff |= (uint8_t)(mac[i] ^ tolower((unsigned char)auth[colon + 1 + i]));
+        return diff == 0;
+    }
+
+    // GET /ota/firmware.bin, whole or "Range: bytes=N-[M]". Sends the
+    // headers and leaves the body to serveTask.
+    void handleImage() {
+        String range = _server->header("Range");
+        if (!authorized(range)) {
+            LOG_W(LOG_OTA, "[OTA] Refused the image: bad or missing " OTA_PEER_AUTH_HEADER);
+            _server->send(403, "text/plain", "Forbidden");
+            return;
+        }
+
+        uint32_t first = 0, last = _size - 1;
+        int code = 200;
+        if (range.startsWith("bytes=")) {
+            int dash = range.indexOf('-');
+            first = range.substring(6, dash).toInt();
+            String end = dash > 0 ? range.substring(dash + 1) : String();
+            if (end.length()) last = min((uint32_t)end.toInt(), _size - 1);
+            if (dash < 0 || first > last) {
+                _server->sendHeader("Content-Range", "bytes */" + String(_size));
+                _server->send(416, "text/plain", "Range not satisfiable");
+                return;
+            }
+            code = 206;
+        }
+
+        bool idle = false;
+        if (!_serving.compare_exchange_strong(idle, true)) {
+            _server->send(503, "text/plain", "Busy");
+            return;
+        }
+        LOG_I(LOG_OTA, "[OTA] Serving bytes %lu-%lu to a sibling", (unsigned long)first, (unsigned long)last);
+        if (code == 206) {
+            _server->sendHeader("Content-Range",
+                                "bytes " + String(first) + "-" + String(last) + "/" + String(_size));
+        }
+        _server->sendHeader("Accept-Ranges", "bytes");
+        _server->sendHeader("X-Firmware-SHA256", _sha256);
+        _server->setContentLength(last - first + 1);
+        _server->send(code, "application/octet-stream", "");
+
+        // The copy keeps the socket open after the server lets go of it
+        _client = _server->client();
+        _first = first;
+        _last = last;
+        if (xTaskCreatePinnedToCore(serveTask, "ota_serve", OTA_PEER_TASK_STACK, this, OTA_PEER_TASK_PRIORITY,
+                                    nullptr, OTA_PEER_TASK_CORE) != pdPASS) {
+            _client.stop();
+            _serving = false;
+        }
+    }
+
+    static void serveTask(void* arg) {
+        OTAPeer* self = (OTAPeer*)arg;
+        traceThreadName("ota_serve");
+        self->serve();
+        vTaskDelete(nullptr);
+    }
+
+    void serve() {
+        TRACE_BEGIN("ota", "serveImage");
+        uint8_t* buf = (uint8_t*)heap_caps_malloc(OTA_PEER_CHUNK, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        const esp_partition_t* running = esp_ota_get_running_partition();
+        uint32_t pos = _first;
+        while (buf && pos <= _last) {
+            uint32_t n = min((uint32_t)OTA_PEER_CHUNK, _last + 1 - pos);
+            if (esp_partition_read(running, pos, buf, n) != ESP_OK) break;
+            if (_client.write(buf, n) != n) break;
+            pos += n;
+        }
+        if (pos <= _last) {
+            LOG_W(LOG_OTA, "[OTA] Sibling transfer stopped at %lu of %lu", (unsigned long)pos,
+                  (unsigned long)_last + 1);
+        }
+        heap_caps_free(buf);
+        _client.stop();
+        TRACE_END("ota", "serveImage");
+        _serving = false;
+    }
+};
+
+#endif // OTA_PEER_H
@@ -7,26 +7,57 @@
  * via GitHub Releases (works with private repos!).
  *
  * How it works:
- * 1. Device queries GitHub Releases API for latest release
+ * 1. Device queries GitHub Releases API for latest release, with the
+ *    ETag of the last one it saw; an unchanged release is a bodyless
+ *    304 and its metadata comes from NVS instead
  * 2. Downloads version.json from release assets
  * 3. Compares with compiled-in FIRMWARE_VERSION
- * 4. If newer version available, downloads firmware.bin
- * 5. Uses ESP32 Update library to flash new firmware
+ * 4. If newer version available, downloads it from a sibling unit on
+ *    the LAN that already runs it (ota_peer.h), else a delta from the
+ *    running version (firmware-<version>.delta.gz, applied against the
+ *    running partition), else firmware.bin.gz, else firmware.bin
+ * 5. Writes it into the next OTA partition (ota_flash_writer.h) and
+ *    checks it against the MD5 and SHA-256 in version.json
  * 6. Device reboots with new firmware
  *
  * Security considerations:
- * - Uses HTTPS for all downloads
+ * - Uses HTTPS for all GitHub downloads
  * - Release assets are public even for private repos
  * - Validates firmware size before flashing
+ * - Checks the flashed image against the MD5 and SHA-256 in
+ *   version.json, hashed as it is written; the boot partition is only
+ *   switched when they match
+ * - Takes an image from a sibling only if version.json (fetched over
+ *   HTTPS) has its SHA-256; a sibling whose image fails is not asked
+ *   again
  * - Checks available space before download
  * - Provides rollback info in case of issues
  *
  * Usage:
  * 1. Set GITHUB_USER and GITHUB_REPO below
  * 2. Create GitHub Release with firmware.bin and version.json
+ *    (tools/make_release.py adds firmware.bin.gz, deltas from older
+ *    builds, and the sizes/hash version.json needs)
  * 3. Create OTAUpdater instance
  * 4. Call checkForUpdate() to check for new versions
- * 5. Call performUpdate() to download and install
+ * 5. Call startUpdate() to download and install in the background,
+ *    then poll state()/progressPercent() and restart once OTA_DONE
+ * 6. Optionally call startPeerSharing(server, hostname, secret) after
+ *    WiFi connects, so siblings holding the same secret can update from
+ *    this unit
+ *
+ * The download runs in two tasks on core 0 so loop() keeps running:
+ * one reads the network into one of two buffers while the other
+ * writes the previous buffer to flash. A gzip image is inflated on the
+ * network side (gzip_stream.h), so only about 60% of the bytes cross
+ * the uplink.
+ *
+ * Interrupted downloads continue instead of starting over. A dropped
+ * or stalled connection is reopened with an HTTP Range request from the
+ * last byte received. The flash task also checkpoints the written
+ * offset and the running MD5 to NVS every OTA_CHECKPOINT_INTERVAL, so
+ * the next startUpdate() after a failure or a restart fetches only the
+ * rest of firmware.bin when that is less than a fresh download.
  */
 
 #ifndef OTA_UPDATES_H
@@ -36,8 +67,18 @@
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
-#include <Update.h>
+#include <Preferences.h>
 #include <ArduinoJson.h>
+#include <atomic>
+#include "psram_alloc.h"
+#include "gzip_stream.h"
+#include "delta_patch.h"
+#include "ota_flash_writer.h"
+#include "ota_peer.h"
+#include <esp_ota_ops.h>
+#include "trace_buffer.h"
+#include "async_log.h"
+#include "fixed_string.h"
 
 // ============================================================
 // CONFIGURATION - UPDATE THESE FOR YOUR GITHUB REPO
@@ -46,8 +87,11 @@
 #define GITHUB_USER "squid-baby"
 #define GITHUB_REPO "friyay-forever"
 
-// GitHub API URL for latest release
-#define GITHUB_API_URL "https://api.github.com/repos/" GITHUB_USER "/" GITHUB_REPO "/releases/latest"
+// GitHub API URL for latest release (base overridable for a local mock)
+#ifndef GITHUB_API_BASE
+#define GITHUB_API_BASE "https://api.github.com"
+#endif
+#define GITHUB_API_URL GITHUB_API_BASE "/repos/" GITHUB_USER "/" GITHUB_REPO "/releases/latest"
 
 // Timeouts and limits
 #define OTA_HTTP_TIMEOUT      15000   // 15 seconds for API/version check
@@ -55,90 +99,196 @@
 #define OTA_MAX_FIRMWARE_SIZE 3000000 // 3MB max firmware size
 #define OTA_MIN_FREE_SPACE    500000  // 500KB minimum free space
 
+// Background download
+#define OTA_BUFFER_SIZE       16384   // Each ping-pong buffer (4 flash sectors)
+#define OTA_BUFFER_COUNT      2
+#define OTA_TASK_STACK        8192    // TLS reads need the room
+#define OTA_TASK_PRIORITY     1
+#define OTA_TASK_CORE         0
+
+// Resuming
+#define OTA_RESUME_RETRIES      5       // Reconnects per outage before giving up
+#define OTA_RESUME_BACKOFF_MS   1000    // Doubles with each attempt
+#define OTA_CHECKPOINT_INTERVAL 65536   // Written offset saved to NVS this often
+#define OTA_RESUME_NAMESPACE    "ota_resume"
+
+// Release checks
+#define OTA_RELEASE_NAMESPACE   "ota_release"   // ETag and metadata of the last release
+#define OTA_RATE_LIMIT_WARN     5       // Report the API quota once this few are left
+
+// Where the image being flashed comes from
+enum OTAImageSource {
+    IMAGE_RAW,     // firmware.bin, from GitHub or a sibling
+    IMAGE_GZIP,    // firmware.bin.gz
+    IMAGE_DELTA,   // firmware-<running version>.delta.gz applied to the running image
+};
+
+enum OTAState {
+    OTA_IDLE,
+    OTA_RUNNING,
+    OTA_DONE,     // Flashed and verified: restart to boot it
+    OTA_FAILED,   // See getLastError()
+};
+
 // ============================================================
 // OTA UPDATER CLASS
 // ============================================================
 
 class OTAUpdater {
 public:
-    // Callback type for progress updates (0-100)
-    typedef void (*ProgressCallback)(int percent);
-
     OTAUpdater() :
-        _progressCallback(nullptr),
         _updateAvailable(false),
         _lastError(""),
         _latestVersion(""),
         _releaseNotes(""),
         _firmwareUrl(""),
         _firmwareSize(0),
-        _isCritical(false) {
-    }
-
-    // Set callback for progress updates during download
-    void setProgressCallback(ProgressCallback callback) {
-        _progressCallback = callback;
+        _firmwareGzSize(0),
+        _imageSize(0),
+        _jobImageSize(0),
+        _isCritical(false),
+        _compressed(false),
+        _deltaSize(0),
+        _source(IMAGE_RAW),
+        _peerFailed(false),
+        _fromPeer(false),
+        _streamPos(0),
+        _resumeFrom(0),
+        _checkpointAt(0),
+        _reconnects(0),
+        _rateRemaining(-1),
+        _freeQueue(nullptr),
+        _filledQueue(nullptr),
+        _state(OTA_IDLE),
+        _received(0),
+        _flashed(0),
+        _total(0),
+        _writeFailed(false),
+        _flashUs(0),
+        _startMs(0),
+        _endMs(0) {
+        for (int i = 0; i < OTA_BUFFER_COUNT; i++) _buffers[i] = nullptr;
+        _jobMd5[0] = 0;
+        _jobSha256[0] = 0;
     }
 
     // Get the currently running firmware version
-    String getCurrentVersion() {
+    const char* getCurrentVersion() {
         #ifdef FIRMWARE_VERSION
-            return String(FIRMWARE_VERSION);
+            return FIRMWARE_VERSION;
         #else
             return "unknown";
         #endif
     }
 
+    // Serve the running image to siblings and advertise it over mDNS;
+    // also lets this unit find siblings to update from. Only requests
+    // signed with 'secret' get the image (see ota_peer.h).
+    bool startPeerSharing(WebServer& server, const char* hostname, const char* secret) {
+        return _peer.begin(server, hostname, getCurrentVersion(), secret);
+    }
+
     // Check GitHub Releases for available updates
     // Returns true if a newer version is available
     bool checkForUpdate() {
+        // The download tasks still read the release this would clear
+        if (state() == OTA_RUNNING) {
+            _lastError = "Update in progress";
+            return false;
+        }
+
         _updateAvailable = false;
         _lastError = "";
         _latestVersion = "";
         _releaseNotes = "";
         _firmwareUrl = "";
         _firmwareSize = 0;
+        _firmwareGzUrl = "";
+        _firmwareGzSize = 0;
+        _deltaUrl = "";
+        _deltaSize = 0;
+        _imageSize = 0;
+        _firmwareMd5 = "";
+        _firmwareSha256 = "";
         _isCritical = false;
 
         if (WiFi.status() != WL_CONNECTED) {
             _lastError = "WiFi not connected";
-            Serial.println("[OTA] Error: WiFi not connected");
+            LOG_E(LOG_OTA, "[OTA] Error: WiFi not connected");
             return false;
         }
 
-        Serial.println("[OTA] Checking GitHub Releases for updates...");
-        Serial.print("[OTA] API URL: ");
-        Serial.println(GITHUB_API_URL);
+        LOG_I(LOG_OTA, "[OTA] Checking GitHub Releases for updates...");
+        LOG_I(LOG_OTA, "[OTA] API URL: %s", GITHUB_API_URL);
 
         // Use WiFiClientSecure for HTTPS
         WiFiClientSecure client;
         client.setInsecure();  // Skip certificate verification for simplicity
 
         HTTPClient http;
+        http.useHTTP10(true);  // No chunked encoding, so we can parse straight off the stream
         http.begin(client, GITHUB_API_URL);
         http.setTimeout(OTA_HTTP_TIMEOUT);
         http.addHeader("Accept", "application/vnd.github.v3+json");
         http.addHeader("User-Agent", "ESP32-OTA-Updater");
+        const char* headers[] = {"ETag", "X-RateLimit-Limit", "X-RateLimit-Remaining", "X-RateLimit-Reset"};
+        http.collectHeaders(headers, 4);
+
+        // GitHub answers 304 while the release is unchanged, and a 304
+        // doesn't count against the unauthenticated 60/hour
+        String cachedEtag = savedEtag();
+        if (cachedEtag.length()) http.addHeader("If-None-Match", cachedEtag);
 
+        TRACE_BEGIN("ota", "releaseGet");
         int httpCode = http.GET();
+        TRACE_END("ota", "releaseGet");
+        String quota = rateLimit(http);
+
+        if (httpCode == HTTP_CODE_NOT_MODIFIED && cachedEtag.length()) {
+            http.end();
+            if (loadRelease()) {
+                LOG_I(LOG_OTA, "[OTA] Release unchanged (304)%s%s", quota.length() ? ", " : "",
+                      quota.c_str());
+                return compareVersions(quota);
+            }
+            _lastError = "Saved release unreadable";
+            LOG_E(LOG_OTA, "[OTA] Error: saved release unreadable");
+            clearRelease();  // The next check fetches it again
+            return false;
+        }
 
         if (httpCode != 200) {
             _lastError = "GitHub API error: " + String(httpCode);
-            Serial.printf("[OTA] GitHub API error: %d\n", httpCode);
+            if (quota.length()) _lastError += " (" + quota + ")";
+            LOG_E(LOG_OTA, "[OTA] GitHub API error: %d %s", httpCode, quota.c_str());
             http.end();
             return false;
         }
-
-        String payload = http.getString();
+        String etag = http.header("ETag");
+
+        // Parse GitHub release JSON directly from the stream, keeping only
+        // the fields we need (the full payload is several KB of URLs and
+        // uploader info per asset)
+        JsonDocument filter;
+        filter["tag_name"] = true;
+        filter["body"] = true;
+        JsonObject assetFilter = filter["assets"].add<JsonObject>();
+        assetFilter["name"] = true;
+        assetFilter["browser_download_url"] = true;
+        assetFilter["size"] = true;
+
+        size_t jsonBefore = psramJsonAllocator.inUse();
+        psramJsonAllocator.resetPeak();
+        JsonDocument doc(&psramJsonAllocator);
+        DeserializationError jsonError = deserializeJson(doc, http.getStream(),
+                                                         DeserializationOption::Filter(filter));
+        LOG_I(LOG_OTA, "[OTA] Release parsed, document peak %u bytes",
+              (unsigned)(psramJsonAllocator.peak() - jsonBefore));
         http.end();
 
-        // Parse GitHub release JSON
-        DynamicJsonDocument doc(8192);
-        DeserializationError jsonError = deserializeJson(doc, payload);
-
         if (jsonError) {
             _lastError = "JSON parse error: " + String(jsonError.c_str());
-            Serial.printf("[OTA] JSON error: %s\n", jsonError.c_str());
+            LOG_E(LOG_OTA, "[OTA] JSON error: %s", jsonError.c_str());
             return false;
         }
 
@@ -146,7 +296,7 @@ public:
         const char* tagName = doc["tag_name"];
         if (!tagName) {
             _lastError = "No tag_name in release";
-            Serial.println("[OTA] Error: No tag_name");
+            LOG_E(LOG_OTA, "[OTA] Error: No tag_name");
             return false;
         }
 
@@ -161,12 +311,13 @@ public:
             _releaseNotes = doc["body"].as<String>();
             // Truncate if too long
             if (_releaseNotes.length() > 200) {
-                _releaseNotes = _releaseNotes.substring(0, 197) + "...";
+                _releaseNotes = _releaseNotes.substring(0, utf8Trim(_releaseNotes.c_str(), 197)) + "...";
             }
         }
 
-        // Find firmware.bin and version.json in assets
+        // Find firmware.bin, version.json and a delta from this version
         String versionJsonUrl = "";
+        String deltaName = "firmware-" + String(getCurrentVersion()) + ".delta.gz";
         JsonArray assets = doc["assets"];
 
         for (JsonObject asset : assets) {
@@ -177,39 +328,39 @@ public:
             if (name == "firmware.bin") {
                 _firmwareUrl = downloadUrl;
                 _firmwareSize = size;
-                Serial.printf("[OTA] Found firmware.bin: %d bytes\n", size);
+                LOG_I(LOG_OTA, "[OTA] Found firmware.bin: %d bytes", size);
+            }
+            if (name == "firmware.bin.gz") {
+                _firmwareGzUrl = downloadUrl;
+                _firmwareGzSize = size;
+                LOG_I(LOG_OTA, "[OTA] Found firmware.bin.gz: %d bytes", size);
+            }
+            if (name == deltaName) {
+                _deltaUrl = downloadUrl;
+                _deltaSize = size;
+                LOG_I(LOG_OTA, "[OTA] Found %s: %d bytes", deltaName.c_str(), size);
             }
             if (name == "version.json") {
                 versionJsonUrl = downloadUrl;
-                Serial.println("[OTA] Found version.json");
+                LOG_I(LOG_OTA, "[OTA] Found version.json");
             }
         }
 
-        if (_firmwareUrl.length() == 0) {
+        if (_firmwareUrl.length() == 0 && _firmwareGzUrl.length() == 0) {
             _lastError = "No firmware.bin in release";
-            Serial.println("[OTA] Error: No firmware.bin asset");
+            LOG_E(LOG_OTA, "[OTA] Error: No firmware.bin asset");
             return false;
         }
 
         // Optionally fetch version.json for extra metadata (critical flag, etc.)
+        bool complete = true;
         if (versionJsonUrl.length() > 0) {
-            fetchVersionJson(versionJsonUrl);
+            complete = fetchVersionJson(versionJsonUrl);
         }
 
-        // Compare versions
-        String currentVer = getCurrentVersion();
-        Serial.printf("[OTA] Current: %s, Latest: %s\n",
-                     currentVer.c_str(), _latestVersion.c_str());
-
-        if (isNewerVersion(_latestVersion, currentVer)) {
-            _updateAvailable = true;
-            Serial.println("[OTA] Update available!");
-            Serial.printf("[OTA] Firmware URL: %s\n", _firmwareUrl.c_str());
-            return true;
-        }
-
-        Serial.println("[OTA] Already up to date");
-        return false;
+        // Without all of it the next check must see a 200 again
+        if (complete && etag.length()) saveRelease(etag);
+        return compareVersions(quota);
     }
 
     // Check if an update is available (call checkForUpdate first)
@@ -218,12 +369,12 @@ public:
     }
 
     // Get the latest version string
-    String getLatestVersion() {
+    const String& getLatestVersion() {
         return _latestVersion;
     }
 
     // Get release notes for the latest version
-    String getReleaseNotes() {
+    const String& getReleaseNotes() {
         return _releaseNotes;
     }
 
@@ -233,20 +384,34 @@ public:
     }
 
     // Get the last error message
-    String getLastError() {
+    const String& getLastError() {
         return _lastError;
     }
 
-    // Download and install the update
-    // Returns true on success (device will reboot)
-    // Returns false on failure (check getLastError())
-    bool performUpdate() {
+    // Start downloading and flashing the update in the background.
+    // Returns false if it could not start (check getLastError()); after
+    // that, poll state() until OTA_DONE (restart to boot it) or OTA_FAILED.
+    bool startUpdate() {
+        if (state() == OTA_RUNNING) {
+            _lastError = "Update already running";
+            return false;
+        }
+
         if (!_updateAvailable) {
             _lastError = "No update available";
             return false;
         }
 
-        if (_firmwareUrl.length() == 0) {
+        _jobImageSize = _imageSize;
+        snprintf(_jobMd5, sizeof(_jobMd5), "%s", _firmwareMd5.length() == 32 ? _firmwareMd5.c_str() : "");
+        snprintf(_jobSha256, sizeof(_jobSha256), "%s", _firmwareSha256.length() == 64 ? _firmwareSha256.c_str() : "");
+
+        // The compressed image and the delta need the size and hash from
+        // version.json to be checked; without them use the raw image
+        bool verifiable = _jobImageSize > 0 && strlen(_jobMd5) == 32;
+        _compressed = _firmwareGzUrl.length() > 0 && verifiable;
+        if (!verifiable) _deltaUrl = "";
+        if (!_compressed && _firmwareUrl.length() == 0) {
             _lastError = "No firmware URL";
             return false;
         }
@@ -256,181 +421,764 @@ public:
             return false;
         }
 
-        Serial.println("[OTA] Starting firmware download...");
-        Serial.print("[OTA] URL: ");
-        Serial.println(_firmwareUrl);
-
         // Check available space
         size_t freeSpace = ESP.getFreeSketchSpace();
-        Serial.printf("[OTA] Free sketch space: %d bytes\n", freeSpace);
+        LOG_I(LOG_OTA, "[OTA] Free sketch space: %d bytes", freeSpace);
 
         if (freeSpace < OTA_MIN_FREE_SPACE) {
             _lastError = "Insufficient space for update";
-            Serial.println("[OTA] Error: Not enough space");
+            LOG_E(LOG_OTA, "[OTA] Error: Not enough space");
             return false;
         }
 
-        // Use WiFiClientSecure for HTTPS GitHub download
-        WiFiClientSecure client;
-        client.setInsecure();
+        // Continue an image an earlier attempt left half-written, if the
+        // rest of firmware.bin is smaller than a fresh download
+        _resumeFrom = 0;
+        Checkpoint saved;
+        if (_firmwareUrl.length() && loadCheckpoint(saved)) {
+            uint32_t rest = _jobImageSize - saved.offset;
+            uint32_t fresh = _deltaUrl.length() ? _deltaSize : _compressed ? _firmwareGzSize : _jobImageSize;
+            if (rest < fresh) {
+                _resumeFrom = saved.offset;
+                _resumeHash = saved.hash;
+            }
+        }
+
+        // Internal DMA-capable RAM, so flash writes need no bounce copy
+        for (int i = 0; i < OTA_BUFFER_COUNT; i++) {
+            _buffers[i] = (uint8_t*)heap_caps_malloc(OTA_BUFFER_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+            if (!_buffers[i]) _buffers[i] = (uint8_t*)heap_caps_malloc(OTA_BUFFER_SIZE, MALLOC_CAP_8BIT);
+        }
+        _freeQueue = xQueueCreate(OTA_BUFFER_COUNT, sizeof(Chunk));
+        _filledQueue = xQueueCreate(OTA_BUFFER_COUNT + 1, sizeof(Chunk));  // + end marker
+        bool allocated = _freeQueue && _filledQueue;
+        for (int i = 0; i < OTA_BUFFER_COUNT; i++) allocated = allocated && _buffers[i];
+        if (!allocated) {
+            _lastError = "Out of memory for download buffers";
+            LOG_E(LOG_OTA, "[OTA] Error: no memory for download buffers");
+            releaseBuffers();
+            return false;
+        }
+        for (int i = 0; i < OTA_BUFFER_COUNT; i++) {
+            Chunk slot = {(uint8_t)i, false, 0};
+            xQueueSend(_freeQueue, &slot, 0);
+        }
+
+        _lastError = "";
+        _received = 0;
+        _flashed = 0;
+        _total = 0;
+        _flashUs = 0;
+        _reconnects = 0;
+        _writeFailed = false;
+        _startMs = millis();
+        _endMs = 0;
+        _state = OTA_RUNNING;
+
+        // Both on core 0 with the WiFi stack; loop() keeps core 1
+        xTaskCreatePinnedToCore(downloadTask, "ota_dl", OTA_TASK_STACK, this, OTA_TASK_PRIORITY,
+                                nullptr, OTA_TASK_CORE);
+        return true;
+    }
+
+    OTAState state() const { return (OTAState)_state.load(); }
+
+    // Bytes written to flash so far, and the image size (0 until known)
+    uint32_t bytesFlashed() const { return _flashed.load(); }
+    uint32_t totalBytes() const { return _total.load(); }
+
+    int progressPercent() const {
+        uint32_t total = totalBytes();
+        return total ? (int)((uint64_t)bytesFlashed() * 100 / total) : 0;
+    }
+
+    // Average throughput since the download started (or until it ended)
+    uint32_t kbPerSecond() const {
+        unsigned long end = _endMs ? _endMs : millis();
+        unsigned long ms = end - _startMs;
+        return ms ? (uint32_t)((uint64_t)(bytesFlashed() - _resumeFrom) * 1000 / 1024 / ms) : 0;
+    }
 
+private:
+    // A filled (or free) buffer handed between the two tasks
+    struct Chunk {
+        uint8_t index;
+        bool last;     // No more data: finish (len 0) or abort
+        uint32_t len;
+    };
+
+    // What NVS keeps of a half-written image
+    struct Checkpoint {
+        uint32_t partition;    // Address of the OTA partition written
+        uint32_t imageSize;
+        char md5[33];          // Of the image being written, from version.json
+        uint32_t offset;       // Bytes written, a sector multiple
+        md5_context_t hash;    // MD5 state after them
+    };
+
+    bool _updateAvailable;
+    String _lastError;
+    String _latestVersion;
+    String _releaseNotes;
+    String _firmwareUrl;
+    int _firmwareSize;
+    String _firmwareGzUrl;
+    int _firmwareGzSize;
+    uint32_t _imageSize;    // Uncompressed, from version.json (0 if not given)
+    String _firmwareMd5;    // Of the uncompressed image, from version.json
+    String _firmwareSha256; // Likewise; needed to take the image from a sibling
+    uint32_t _jobImageSize; // The above as startUpdate() found them: the
+    char _jobMd5[33];       // tasks read only these ("" when not given)
+    char _jobSha256[65];
+    bool _isCritical;
+    bool _compressed;       // The full image comes from firmware.bin.gz
+    String _deltaUrl;       // Patch from the running version, if released
+    int _deltaSize;
+    OTAImageSource _source;
+    GzipStream _gzip;
+    DeltaPatch _delta;      // Reads through _gzip
+    OTAFlashWriter _writer;
+    OTAPeer _peer;
+    bool _peerFailed;       // A sibling's image failed verification: GitHub only
+    bool _fromPeer;         // This download comes from a sibling
+    WiFiClientSecure _tls;  // GitHub
+    WiFiClient _lan;        // Siblings
+    String _url;            // Asset being downloaded, for reconnects
+    uint32_t _streamPos;    // Raw image: offset of the next byte from the stream
+    uint32_t _resumeFrom;   // Checkpointed offset this download continues from
+    md5_context_t _resumeHash;
+    uint32_t _checkpointAt; // Writer offset at the last checkpoint
+    int _reconnects;
+    int _rateRemaining;     // GitHub API requests left this hour (-1 unknown)
+
+    // Background download state, shared with the tasks
+    uint8_t* _buffers[OTA_BUFFER_COUNT];
+    QueueHandle_t _freeQueue;
+    QueueHandle_t _filledQueue;
+    std::atomic<uint8_t> _state;
+    std::atomic<uint32_t> _received;
+    std::atomic<uint32_t> _flashed;
+    std::atomic<uint32_t> _total;
+    std::atomic<bool> _writeFailed;
+    uint64_t _flashUs;
+    unsigned long _startMs;
+    volatile unsigned long _endMs;
+
+    // Network side: GET, then fill free buffers and pass them on.
+    // Runs while the flash task writes the other buffer.
+    static void downloadTask(void* arg) {
+        OTAUpdater* self = (OTAUpdater*)arg;
+        traceThreadName("ota_dl");
+        self->download();
+        vTaskDelete(nullptr);
+    }
+
+    void download() {
+        LOG_I(LOG_OTA, "[OTA] Starting firmware download...");
+
+        _tls.setInsecure();
         HTTPClient http;
-        http.begin(client, _firmwareUrl);
-        http.setTimeout(OTA_DOWNLOAD_TIMEOUT);
-        http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);  // GitHub redirects to CDN
 
-        int httpCode = http.GET();
+        // A sibling already running the release, if version.json says
+        // what its image must hash to
+        String peerUrl;
+        if (strlen(_jobSha256) == 64 && _jobImageSize > 0 && !_peerFailed) {
+            peerUrl = _peer.find(_latestVersion, _jobSha256);
+        }
 
-        if (httpCode != 200) {
-            _lastError = "Download failed: HTTP " + String(httpCode);
-            Serial.printf("[OTA] Download failed: %d\n", httpCode);
+        // The rest of a checkpointed image, else the image from a sibling,
+        // else a delta against the running image if the release has one
+        // that fits, else the full image
+        int imageSize = _resumeFrom ? openResume(http, peerUrl.length() ? peerUrl : _firmwareUrl) : 0;
+        if (!imageSize && peerUrl.length()) imageSize = openPeer(http, peerUrl);
+        if (!imageSize && _deltaUrl.length()) imageSize = openDelta(http);
+        if (!imageSize) imageSize = openImage(http);
+        if (!imageSize) return;  // fail() has the reason
+        _fromPeer = _url == peerUrl;
+
+        // Starting over rewrites what an old checkpoint vouches for
+        if (!_resumeFrom) clearCheckpoint();
+        if (!_writer.begin(imageSize, _resumeFrom, _resumeFrom ? &_resumeHash : nullptr)) {
             http.end();
-            return false;
+            _gzip.end();
+            fail("Flash begin failed: " + _writer.errorString());
+            return;
+        }
+
+        _received = _resumeFrom;
+        _flashed = _resumeFrom;
+        _checkpointAt = _resumeFrom;
+        _total = imageSize;
+        LOG_I(LOG_OTA, "[OTA] Update started, downloading...");
+        xTaskCreatePinnedToCore(flashTask, "ota_flash", OTA_TASK_STACK, this, OTA_TASK_PRIORITY,
+                                nullptr, OTA_TASK_CORE);
+
+        WiFiClient* stream = http.getStreamPtr();
+        String error;
+        Chunk chunk = {0, false, 0};
+        unsigned long lastData = millis();
+
+        while (_received < (uint32_t)imageSize && error.length() == 0) {
+            if (millis() - _startMs > OTA_DOWNLOAD_TIMEOUT) {
+                error = "Download timeout";
+                break;
+            }
+            if (_writeFailed) break;  // The flash task has the reason
+            if (xQueueReceive(_freeQueue, &chunk, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+
+            // Fill the whole buffer: big writes keep flash programming efficient
+            uint8_t* buf = _buffers[chunk.index];
+            uint32_t want = min((uint32_t)OTA_BUFFER_SIZE, (uint32_t)imageSize - _received);
+            chunk.len = 0;
+            TRACE_BEGIN("ota", "recv");
+            while (chunk.len < want) {
+                int n = readImage(stream, buf + chunk.len, want - chunk.len);
+                if (n > 0) {
+                    chunk.len += n;
+                    lastData = millis();
+                } else if (n < 0) {
+                    error = _source == IMAGE_DELTA ? "Corrupt delta patch" : "Corrupt compressed image";
+                    break;
+                } else if (millis() - _startMs > OTA_DOWNLOAD_TIMEOUT) {
+                    error = "Download timeout";
+                    break;
+                } else if (!stream->connected() || millis() - lastData > OTA_HTTP_TIMEOUT) {
+                    if (!reconnect(http)) {
+                        error = "Connection lost";
+                        break;
+                    }
+                    stream = http.getStreamPtr();
+                    lastData = millis();
+                } else {
+                    vTaskDelay(pdMS_TO_TICKS(2));
+                }
+            }
+            TRACE_END("ota", "recv");
+
+            if (error.length()) {
+                xQueueSend(_freeQueue, &chunk, 0);  // Give it back unused
+                break;
+            }
+            _received += chunk.len;
+            chunk.last = false;
+            xQueueSend(_filledQueue, &chunk, portMAX_DELAY);
+        }
+
+        // The gzip trailer must follow the last image byte
+        if (_source != IMAGE_RAW && !error.length() && !_writeFailed) {
+            bool finished = _gzip.finish();
+            while (!finished && !http.getStreamPtr()->connected() && reconnect(http)) {
+                finished = _gzip.finish();
+            }
+            if (!finished) error = "Download doesn't end where declared";
+        }
+        uint32_t downloaded = _source == IMAGE_RAW ? _streamPos - _resumeFrom : _gzip.compressedBytes();
+        LOG_I(LOG_OTA, "[OTA] Downloaded %u KB for a %u KB image from %s, %d reconnects",
+              (unsigned)(downloaded / 1024), (unsigned)(imageSize / 1024),
+              _fromPeer ? "a sibling" : "GitHub", _reconnects);
+        _gzip.end();
+        http.end();
+
+        // The flash task finishes (or aborts) and cleans up
+        if (error.length()) {
+            _lastError = error;
+            LOG_E(LOG_OTA, "[OTA] Error: %s", error.c_str());
+        }
+        Chunk end = {0, true, 0};
+        end.len = (_received == (uint32_t)imageSize && !error.length()) ? 0 : 1;
+        xQueueSend(_filledQueue, &end, portMAX_DELAY);
+    }
+
+    // GETs the delta and checks its header against the running image.
+    // Returns the image size, or 0 (cleaned up) to use the full image.
+    int openDelta(HTTPClient& http) {
+        LOG_I(LOG_OTA, "[OTA] Delta URL: %s", _deltaUrl.c_str());
+        int httpCode;
+        if (!request(http, _deltaUrl, 0, httpCode)) {
+            LOG_W(LOG_OTA, "[OTA] Delta download failed (HTTP %d), using the full image", httpCode);
+            return 0;
+        }
+
+        const char* problem = nullptr;
+        if (http.getSize() != _deltaSize) {
+            problem = "size differs from the release asset";
+        } else if (!_gzip.begin(http.getStreamPtr())) {
+            problem = "out of memory";
+        } else {
+            _delta.begin(&_gzip, readRunning, (void*)esp_ota_get_running_partition());
+            int header = 0;
+            unsigned long start = millis();
+            while ((header = _delta.header()) == 0 && millis() - start < OTA_HTTP_TIMEOUT) {
+                vTaskDelay(pdMS_TO_TICKS(2));
+            }
+            if (header != 1) {
+                problem = "bad header";
+            } else if (_delta.targetSize() != _jobImageSize) {
+                problem = "target size differs from version.json";
+            } else if (_delta.sourceSize() != ESP.getSketchSize() || !sourceMatches()) {
+                problem = "made for a different build of this version";
+            }
+        }
+
+        if (problem) {
+            LOG_W(LOG_OTA, "[OTA] Delta not usable (%s), using the full image", problem);
+            _gzip.end();
+            http.end();
+            return 0;
+        }
+        LOG_I(LOG_OTA, "[OTA] Applying a %d byte delta to the running image", _deltaSize);
+        _source = IMAGE_DELTA;
+        return _delta.targetSize();
+    }
+
+    // GETs firmware.bin.gz or firmware.bin. Returns the image size, or
+    // 0 after fail().
+    int openImage(HTTPClient& http) {
+        if (!_compressed && _firmwareUrl.length() == 0) {
+            fail("No firmware URL");
+            return 0;
+        }
+        const String& url = _compressed ? _firmwareGzUrl : _firmwareUrl;
+        LOG_I(LOG_OTA, "[OTA] URL: %s", url.c_str());
+
+        int httpCode;
+        if (!request(http, url, 0, httpCode)) {
+            fail("Download failed: HTTP " + String(httpCode));
+            return 0;
         }
 
         int contentLength = http.getSize();
-        Serial.printf("[OTA] Firmware size: %d bytes\n", contentLength);
+        LOG_I(LOG_OTA, "[OTA] Download size: %d bytes", contentLength);
 
         if (contentLength <= 0) {
-            _lastError = "Invalid content length";
-            Serial.println("[OTA] Error: Invalid content length");
             http.end();
-            return false;
+            fail("Invalid content length");
+            return 0;
         }
 
-        if (contentLength > OTA_MAX_FIRMWARE_SIZE) {
-            _lastError = "Firmware too large";
-            Serial.println("[OTA] Error: Firmware exceeds max size");
+        // Compressed: the download must be the declared asset, and the
+        // image size comes from version.json
+        int imageSize = contentLength;
+        if (_compressed) {
+            if (contentLength != _firmwareGzSize) {
+                http.end();
+                fail("Compressed size mismatch");
+                return 0;
+            }
+            imageSize = _jobImageSize;
+        } else if (_jobImageSize > 0 && (uint32_t)contentLength != _jobImageSize) {
             http.end();
-            return false;
+            fail("Firmware size mismatch");
+            return 0;
         }
 
-        // Begin OTA update
-        if (!Update.begin(contentLength)) {
-            _lastError = "Update.begin failed: " + String(Update.errorString());
-            Serial.printf("[OTA] Update.begin failed: %s\n", Update.errorString());
+        if (imageSize > OTA_MAX_FIRMWARE_SIZE) {
             http.end();
-            return false;
+            fail("Firmware too large");
+            return 0;
         }
 
-        Serial.println("[OTA] Update started, downloading...");
+        if (_compressed && !_gzip.begin(http.getStreamPtr())) {
+            http.end();
+            fail("Out of memory for decompression");
+            return 0;
+        }
+        _source = _compressed ? IMAGE_GZIP : IMAGE_RAW;
+        _streamPos = 0;
+        return imageSize;
+    }
 
-        WiFiClient* stream = http.getStreamPtr();
+    // GETs a sibling's image. Returns the image size, or 0 (cleaned up)
+    // to use GitHub.
+    int openPeer(HTTPClient& http, const String& url) {
+        LOG_I(LOG_OTA, "[OTA] Sibling URL: %s", url.c_str());
+        int httpCode;
+        if (!request(http, url, 0, httpCode)) {
+            LOG_W(LOG_OTA, "[OTA] Sibling download failed (HTTP %d), using GitHub", httpCode);
+            return 0;
+        }
+        if ((uint32_t)http.getSize() != _jobImageSize) {
+            LOG_W(LOG_OTA, "[OTA] Sibling image size differs from version.json, using GitHub");
+            http.end();
+            return 0;
+        }
+        _source = IMAGE_RAW;
+        _streamPos = 0;
+        return _jobImageSize;
+    }
 
-        // Download and write in chunks
-        uint8_t buffer[1024];
-        int bytesWritten = 0;
-        int lastProgress = -1;
-        unsigned long startTime = millis();
-
-        while (bytesWritten < contentLength) {
-            // Check for timeout
-            if (millis() - startTime > OTA_DOWNLOAD_TIMEOUT) {
-                _lastError = "Download timeout";
-                Serial.println("[OTA] Error: Download timeout");
-                Update.abort();
-                http.end();
-                return false;
+    // GETs the rest of firmware.bin after the checkpoint, from 'url'
+    // (GitHub or a sibling). Returns the image size, or 0 (cleaned up)
+    // to start over.
+    int openResume(HTTPClient& http, const String& url) {
+        LOG_I(LOG_OTA, "[OTA] Resuming at %lu of %lu bytes",
+              (unsigned long)_resumeFrom, (unsigned long)_jobImageSize);
+        int httpCode;
+        if (!request(http, url, _resumeFrom, httpCode)) {
+            LOG_W(LOG_OTA, "[OTA] Resume refused (HTTP %d), starting over", httpCode);
+            _resumeFrom = 0;
+            return 0;
+        }
+        if ((uint32_t)http.getSize() != _jobImageSize - _resumeFrom) {
+            LOG_W(LOG_OTA, "[OTA] Resume length differs, starting over");
+            http.end();
+            _resumeFrom = 0;
+            return 0;
+        }
+        _source = IMAGE_RAW;
+        _streamPos = _resumeFrom;
+        return _jobImageSize;
+    }
+
+    // GETs 'url', from byte 'offset' on with a Range request. True if the
+    // body starts there (200, or 206 with a matching Content-Range);
+    // otherwise the connection is closed and 'httpCode' says why.
+    bool request(HTTPClient& http, const String& url, uint32_t offset, int& httpCode) {
+        _url = url;
+        http.begin(url.startsWith("https:") ? (WiFiClient&)_tls : _lan, url);
+        http.setTimeout(OTA_HTTP_TIMEOUT);  // Per read; the whole download has OTA_DOWNLOAD_TIMEOUT
+        http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);  // GitHub redirects to CDN
+        const char* headers[] = {"Content-Range"};
+        http.collectHeaders(headers, 1);
+        String range = offset ? "bytes=" + String(offset) + "-" : String();
+        if (offset) http.addHeader("Range", range);
+        if (url.endsWith(OTA_PEER_PATH)) http.addHeader(OTA_PEER_AUTH_HEADER, _peer.authorization(OTA_PEER_PATH, range));
+
+        TRACE_BEGIN("ota", "firmwareGet");
+        httpCode = http.GET();
+        TRACE_END("ota", "firmwareGet");
+
+        // A server that ignores Range answers 200 with the whole file
+        bool ok = offset ? httpCode == HTTP_CODE_PARTIAL_CONTENT &&
+                               http.header("Content-Range").startsWith("bytes " + String(offset) + "-")
+                         : httpCode == HTTP_CODE_OK;
+        if (!ok) http.end();
+        return ok;
+    }
+
+    // After the connection drops or stalls: asks for the rest of the
+    // same asset from the first byte not yet taken off the stream,
+    // backing off between attempts. False once out of attempts.
+    bool reconnect(HTTPClient& http) {
+        uint32_t offset = _source == IMAGE_RAW ? _streamPos : _gzip.compressedBytes();
+        http.end();
+        for (int attempt = 0; attempt < OTA_RESUME_RETRIES; attempt++) {
+            unsigned long wait = (unsigned long)OTA_RESUME_BACKOFF_MS << attempt;
+            LOG_W(LOG_OTA, "[OTA] Connection lost at %lu, retry in %lu ms", (unsigned long)offset, wait);
+            vTaskDelay(pdMS_TO_TICKS(wait));
+            if (WiFi.status() != WL_CONNECTED) continue;
+
+            int httpCode;
+            if (request(http, _url, offset, httpCode)) {
+                if (_source != IMAGE_RAW) _gzip.resume(http.getStreamPtr());
+                _reconnects++;
+                return true;
             }
+            LOG_W(LOG_OTA, "[OTA] Range request failed: HTTP %d", httpCode);
+        }
+        return false;
+    }
 
-            // Read available data
-            size_t available = stream->available();
-            if (available > 0) {
-                int toRead = min((size_t)sizeof(buffer), available);
-                int bytesRead = stream->readBytes(buffer, toRead);
-
-                if (bytesRead > 0) {
-                    // Write to flash
-                    size_t written = Update.write(buffer, bytesRead);
-                    if (written != (size_t)bytesRead) {
-                        _lastError = "Write error: " + String(Update.errorString());
-                        Serial.printf("[OTA] Write error: %s\n", Update.errorString());
-                        Update.abort();
-                        http.end();
-                        return false;
-                    }
+    // The delta's source MD5 against the running image's
+    bool sourceMatches() {
+        String running = ESP.getSketchMD5();
+        char expected[33];
+        for (int i = 0; i < 16; i++) snprintf(expected + i * 2, 3, "%02x", _delta.sourceMd5()[i]);
+        return running.equalsIgnoreCase(expected);
+    }
+
+    static bool readRunning(void* ctx, uint32_t offset, uint8_t* buf, size_t len) {
+        return esp_partition_read((const esp_partition_t*)ctx, offset, buf, len) == ESP_OK;
+    }
 
-                    bytesWritten += bytesRead;
+    // Next bytes of the image: from the stream, inflated, or patched.
+    // 0 if nothing has arrived yet, -1 if the download is corrupt.
+    int readImage(WiFiClient* stream, uint8_t* out, size_t len) {
+        if (_source == IMAGE_DELTA) return _delta.read(out, len);
+        if (_source == IMAGE_GZIP) return _gzip.read(out, len);
+        size_t available = stream->available();
+        if (available == 0) return 0;
+        int n = stream->readBytes(out, min(len, available));
+        if (n > 0) _streamPos += n;
+        return n;
+    }
 
-                    // Update progress
-                    int progress = (bytesWritten * 100) / contentLength;
-                    if (progress != lastProgress) {
-                        lastProgress = progress;
-                        Serial.printf("[OTA] Progress: %d%%\n", progress);
+    // Flash side: write each filled buffer, then hand it back
+    static void flashTask(void* arg) {
+        OTAUpdater* self = (OTAUpdater*)arg;
+        traceThreadName("ota_flash");
+        self->flash();
+        vTaskDelete(nullptr);
+    }
 
-                        if (_progressCallback) {
-                            _progressCallback(progress);
-                        }
-                    }
+    void flash() {
+        Chunk chunk;
+        while (true) {
+            xQueueReceive(_filledQueue, &chunk, portMAX_DELAY);
+            if (chunk.last) break;
+
+            if (!_writeFailed) {
+                unsigned long t0 = micros();
+                TRACE_BEGIN("ota", "flashWrite");
+                bool written = _writer.write(_buffers[chunk.index], chunk.len);
+                TRACE_END("ota", "flashWrite");
+                _flashUs += micros() - t0;
+                if (!written) {
+                    _lastError = "Write error: " + _writer.errorString();
+                    LOG_E(LOG_OTA, "[OTA] Write error: %s", _writer.errorString().c_str());
+                    _writeFailed = true;
+                } else {
+                    _flashed += chunk.len;
+                    if (_writer.offset() - _checkpointAt >= OTA_CHECKPOINT_INTERVAL) saveCheckpoint();
+                    int progress = progressPercent();
+                    LOG_D(LOG_OTA, "[OTA] Progress: %d%%", progress);
                 }
-            } else {
-                // No data available, small delay
-                delay(10);
             }
+            xQueueSend(_freeQueue, &chunk, portMAX_DELAY);
+        }
+        _endMs = millis();
+
+        // len 0: everything arrived; anything else: download gave up
+        bool ok = chunk.len == 0 && !_writeFailed;
+        if (!ok) {
+            // Keep what was written for the next attempt
+            if (!_writeFailed) saveCheckpoint();
+            finish(OTA_FAILED);
+            return;
+        }
 
-            // Keep watchdog happy
-            yield();
+        unsigned long ms = _endMs - _startMs;
+        LOG_I(LOG_OTA, "[OTA] %lu KB in %lu.%lu s, %lu KB/s, flash busy %lu%%",
+              (unsigned long)(_flashed / 1024), ms / 1000, (ms % 1000) / 100,
+              (unsigned long)kbPerSecond(), ms ? (unsigned long)(_flashUs / 10 / ms) : 0UL);
+
+        // Verify and make it the boot image; either way the checkpoint
+        // is spent (a bad image has to be downloaded again in full)
+        bool verified = _writer.end(_jobMd5, _jobSha256);
+        clearCheckpoint();
+        LOG_I(LOG_OTA, "[OTA] Hashing took %lu ms, against %lu ms for the download",
+              (unsigned long)(_writer.hashMicros() / 1000), ms);
+        if (!verified) {
+            _lastError = "Verification failed: " + _writer.errorString();
+            LOG_E(LOG_OTA, "[OTA] Verification failed: %s", _writer.errorString().c_str());
+            if (_fromPeer) {
+                _peerFailed = true;
+                LOG_W(LOG_OTA, "[OTA] Not taking images from siblings until restart");
+            }
+            finish(OTA_FAILED);
+            return;
         }
 
-        http.end();
+        LOG_I(LOG_OTA, "[OTA] Update successful, ready to reboot");
+        finish(OTA_DONE);
+    }
 
-        // Verify and finish update
-        if (!Update.end(true)) {
-            _lastError = "Update.end failed: " + String(Update.errorString());
-            Serial.printf("[OTA] Update.end failed: %s\n", Update.errorString());
-            return false;
+    // Before the flash task exists: no buffers in flight
+    void fail(const String& error) {
+        _lastError = error;
+        LOG_E(LOG_OTA, "[OTA] Error: %s", error.c_str());
+        _endMs = millis();
+        finish(OTA_FAILED);
+    }
+
+    // A checkpoint for this release's image in the partition that would
+    // be written now
+    bool loadCheckpoint(Checkpoint& saved) {
+        if (_jobImageSize == 0 || strlen(_jobMd5) != 32) return false;
+        const esp_partition_t* partition = esp_ota_get_next_update_partition(nullptr);
+        Preferences prefs;
+        if (!partition || !prefs.begin(OTA_RESUME_NAMESPACE, true)) return false;
+        size_t len = prefs.getBytes("state", &saved, sizeof(saved));
+        prefs.end();
+        saved.md5[32] = 0;
+        return len == sizeof(saved) && saved.partition == partition->address &&
+               saved.imageSize == _jobImageSize && strcasecmp(_jobMd5, saved.md5) == 0 &&
+               saved.offset > 0 && saved.offset < _jobImageSize && saved.offset % OTA_SECTOR_SIZE == 0;
+    }
+
+    // Flash task: records what the writer has done so far. Only images
+    // with an MD5 to check can be continued safely.
+    void saveCheckpoint() {
+        uint32_t offset = _writer.offset();
+        if (strlen(_jobMd5) != 32 || offset == 0 || offset % OTA_SECTOR_SIZE) return;
+        Checkpoint cp = {};
+        cp.partition = _writer.partitionAddress();
+        cp.imageSize = _jobImageSize;
+        memcpy(cp.md5, _jobMd5, 33);
+        cp.offset = offset;
+        cp.hash = _writer.hash();
+
+        TRACE_BEGIN("ota", "checkpoint");
+        Preferences prefs;
+        if (prefs.begin(OTA_RESUME_NAMESPACE)) {
+            prefs.putBytes("state", &cp, sizeof(cp));
+            prefs.end();
         }
+        TRACE_END("ota", "checkpoint");
+        _checkpointAt = offset;
+    }
 
-        if (!Update.isFinished()) {
-            _lastError = "Update not finished properly";
-            Serial.println("[OTA] Error: Update not finished");
-            return false;
+    void clearCheckpoint() {
+        Preferences prefs;
+        if (prefs.begin(OTA_RESUME_NAMESPACE)) {
+            prefs.remove("state");
+            prefs.end();
         }
+    }
 
-        Serial.println("[OTA] Update successful! Rebooting...");
-        delay(1000);
-        ESP.restart();
+    void finish(OTAState result) {
+        releaseBuffers();
+        _state = result;  // Last: the loop may start another update now
+    }
 
-        // Should never reach here
-        return true;
+    void releaseBuffers() {
+        for (int i = 0; i < OTA_BUFFER_COUNT; i++) {
+            heap_caps_free(_buffers[i]);
+            _buffers[i] = nullptr;
+        }
+        if (_freeQueue) vQueueDelete(_freeQueue);
+        if (_filledQueue) vQueueDelete(_filledQueue);
+        _freeQueue = nullptr;
+        _filledQueue = nullptr;
     }
 
-private:
-    ProgressCallback _progressCallback;
-    bool _updateAvailable;
-    String _lastError;
-    String _latestVersion;
-    String _releaseNotes;
-    String _firmwareUrl;
-    int _firmwareSize;
-    bool _isCritical;
+    // The release (fetched or saved) against the running version.
+    // 'quota' is the API rate limit, reported when nearly used up.
+    bool compareVersions(const String& quota) {
+        String currentVer = getCurrentVersion();
+        LOG_I(LOG_OTA, "[OTA] Current: %s, Latest: %s",
+              currentVer.c_str(), _latestVersion.c_str());
+
+        if (_rateRemaining >= 0 && _rateRemaining <= OTA_RATE_LIMIT_WARN) {
+            _lastError = "GitHub " + quota;
+            LOG_W(LOG_OTA, "[OTA] GitHub %s", quota.c_str());
+        }
 
-    // Fetch version.json from release assets for extra metadata
-    void fetchVersionJson(const String& url) {
-        Serial.println("[OTA] Fetching version.json for metadata...");
+        if (isNewerVersion(_latestVersion, currentVer)) {
+            _updateAvailable = true;
+            LOG_I(LOG_OTA, "[OTA] Update available!");
+            LOG_I(LOG_OTA, "[OTA] Firmware URL: %s", _firmwareUrl.c_str());
+            return true;
+        }
+
+        LOG_I(LOG_OTA, "[OTA] Already up to date");
+        return false;
+    }
+
+    // "rate limit 57/60, resets in 42 min" from GitHub's headers, or ""
+    String rateLimit(HTTPClient& http) {
+        _rateRemaining = -1;
+        if (!http.hasHeader("X-RateLimit-Remaining")) return "";
+        _rateRemaining = http.header("X-RateLimit-Remaining").toInt();
+        String quota = "rate limit " + String(_rateRemaining) + "/" + http.header("X-RateLimit-Limit");
+        time_t reset = (time_t)http.header("X-RateLimit-Reset").toInt();
+        time_t now = time(nullptr);
+        if (reset > now && now > 1600000000) {  // Needs the clock set by NTP
+            quota += ", resets in " + String((long)(reset - now + 59) / 60) + " min";
+        }
+        return quota;
+    }
+
+    // ETag of the saved release, if it was saved by this firmware version
+    // (the delta asset chosen depends on it)
+    String savedEtag() {
+        Preferences prefs;
+        if (!prefs.begin(OTA_RELEASE_NAMESPACE, true)) return "";
+        String etag;
+        if (prefs.getString("running") == getCurrentVersion()) etag = prefs.getString("etag");
+        prefs.end();
+        return etag;
+    }
+
+    // What checkForUpdate() parsed from the release and version.json;
+    // the ETag goes in last, so a partial save is never used
+    void saveRelease(const String& etag) {
+        clearRelease();
+        Preferences prefs;
+        if (!prefs.begin(OTA_RELEASE_NAMESPACE)) return;
+        // putString() returns 0 for ""; empty fields are left out instead
+        auto put = [&prefs](const char* key, const String& value) {
+            return value.length() == 0 || prefs.putString(key, value) > 0;
+        };
+        bool ok = put("running", getCurrentVersion()) && put("version", _latestVersion) &&
+                  put("notes", _releaseNotes) && prefs.putBool("critical", _isCritical) &&
+                  put("bin_url", _firmwareUrl) && prefs.putInt("bin_size", _firmwareSize) &&
+                  put("gz_url", _firmwareGzUrl) && prefs.putInt("gz_size", _firmwareGzSize) &&
+                  put("delta_url", _deltaUrl) && prefs.putInt("delta_size", _deltaSize) &&
+                  prefs.putUInt("image_size", _imageSize) && put("md5", _firmwareMd5) &&
+                  put("sha256", _firmwareSha256) && put("etag", etag);
+        prefs.end();
+        if (!ok) {
+            LOG_W(LOG_OTA, "[OTA] Could not save the release; the next check fetches it again");
+        }
+    }
+
+    bool loadRelease() {
+        Preferences prefs;
+        if (!prefs.begin(OTA_RELEASE_NAMESPACE, true)) return false;
+        _latestVersion = prefs.getString("version");
+        _releaseNotes = prefs.getString("notes");
+        _isCritical = prefs.getBool("critical");
+        _firmwareUrl = prefs.getString("bin_url");
+        _firmwareSize = prefs.getInt("bin_size");
+        _firmwareGzUrl = prefs.getString("gz_url");
+        _firmwareGzSize = prefs.getInt("gz_size");
+        _deltaUrl = prefs.getString("delta_url");
+        _deltaSize = prefs.getInt("delta_size");
+        _imageSize = prefs.getUInt("image_size");
+        _firmwareMd5 = prefs.getString("md5");
+        _firmwareSha256 = prefs.getString("sha256");
+        prefs.end();
+        return _latestVersion.length() > 0 && (_firmwareUrl.length() > 0 || _firmwareGzUrl.length() > 0);
+    }
+
+    void clearRelease() {
+        Preferences prefs;
+        if (prefs.begin(OTA_RELEASE_NAMESPACE)) {
+            prefs.clear();
+            prefs.end();
+        }
+    }
+
+    // Fetch version.json from release assets for extra metadata.
+    // False if it couldn't be read.
+    bool fetchVersionJson(const String& url) {
+        LOG_I(LOG_OTA, "[OTA] Fetching version.json for metadata...");
 
         WiFiClientSecure client;
         client.setInsecure();
 
         HTTPClient http;
+        http.useHTTP10(true);
         http.begin(client, url);
         http.setTimeout(OTA_HTTP_TIMEOUT);
         http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
 
+        TRACE_BEGIN("ota", "versionGet");
         int httpCode = http.GET();
+        TRACE_END("ota", "versionGet");
         if (httpCode != 200) {
-            Serial.printf("[OTA] version.json fetch failed: %d\n", httpCode);
+            LOG_W(LOG_OTA, "[OTA] version.json fetch failed: %d", httpCode);
             http.end();
-            return;
+            return false;
         }
 
-        String payload = http.getString();
+        JsonDocument filter;
+        filter["critical"] = true;
+        filter["release_notes"] = true;
+        filter["firmware_size"] = true;
+        filter["firmware_gz_size"] = true;
+        filter["firmware_md5"] = true;
+        filter["firmware_sha256"] = true;
+
+        JsonDocument doc(&psramJsonAllocator);
+        DeserializationError jsonError = deserializeJson(doc, http.getStream(),
+                                                         DeserializationOption::Filter(filter));
         http.end();
 
-        StaticJsonDocument<1024> doc;
-        if (deserializeJson(doc, payload)) {
-            Serial.println("[OTA] version.json parse failed");
-            return;
+        if (jsonError) {
+            LOG_W(LOG_OTA, "[OTA] version.json parse failed");
+            return false;
         }
 
         // Extract optional fields
@@ -441,7 +1189,21 @@ private:
             _releaseNotes = doc["release_notes"].as<String>();
         }
 
-        Serial.printf("[OTA] Metadata: critical=%d\n", _isCritical);
+        // Image sizes and hash; a compressed asset that doesn't match its
+        // declared size is ignored
+        _imageSize = doc["firmware_size"].as<uint32_t>();
+        _firmwareMd5 = doc["firmware_md5"].as<String>();
+        _firmwareSha256 = doc["firmware_sha256"].as<String>();
+        uint32_t gzSize = doc["firmware_gz_size"].as<uint32_t>();
+        if (_firmwareGzUrl.length() && gzSize != (uint32_t)_firmwareGzSize) {
+            LOG_W(LOG_OTA, "[OTA] firmware.bin.gz is %d bytes, version.json says %lu; not using it",
+                  _firmwareGzSize, (unsigned long)gzSize);
+            _firmwareGzUrl = "";
+        }
+
+        LOG_I(LOG_OTA, "[OTA] Metadata: critical=%d, image %lu bytes, md5 %s", _isCritical,
+              (unsigned long)_imageSize, _firmwareMd5.length() ? _firmwareMd5.c_str() : "none");
+        return true;
     }
 
     // Compare semantic versions (e.g., "1.2.3" vs "1.2.4")
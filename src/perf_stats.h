@@ -0,0 +1,261 @@
+/*
+ * =====================================================
+ * FRAME-TIME & LOOP-LAG STATS FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Times loop(), the animation and countdown ticks, and every draw and
+ * network call into fixed-bucket histograms, so blocking HTTPS calls
+ * that drop animation frames show up as numbers.
+ *
+ * Enabled only in the esp32s3_perf environment (-DPERF_STATS). In
+ * normal builds the PERF_* macros compile to nothing.
+ *
+ * Usage:
+ * - PERF_SCOPE(PERF_X) at the top of a function times the rest of it;
+ *   PERF_SCOPE_END() stops the timer early (e.g. before a delay())
+ * - PERF_LAG(PERF_X, lateMs) records how late a periodic tick ran
+ * - perfStatsTick() in loop() dumps the table over Serial every
+ *   PERF_REPORT_INTERVAL ms; /perf in Telegram returns it on demand
+ *
+ * The busy column is each probe's total time over the window, e.g. the
+ * share of the I2C bus the touch and ADC reads hold (i2cTouch, i2cAds).
+ *
+ * Timing uses the CPU cycle counter (one read per edge), falling back
+ * to micros() for spans long enough to wrap it (~17 s at 240 MHz).
+ * Buckets are log-linear: 4 per power of two, so a percentile is
+ * reported as its bucket's upper bound, at most 25% high.
+ */
+
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "fixed_string.h"
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define PERF_REPORT_INTERVAL  600000  // Serial dump every 10 minutes
+#define PERF_FRAME_MS         16      // Animation tick period
+#define PERF_MAX_EXPONENT     24      // Largest bucket ~33 s
+#define PERF_BUCKETS          (4 * PERF_MAX_EXPONENT)
+
+enum PerfProbe {
+    PERF_LOOP,
+    PERF_ANIM_LAG,
+    PERF_TICK_LAG,
+    PERF_ANIMATIONS,
+    PERF_DRAW_UI,
+    PERF_DRAW_BUTTONS,
+    PERF_DRAW_NOTIF,
+    PERF_DRAW_DAYS,
+    PERF_DRAW_WEATHER,
+    PERF_DRAW_TIMER,
+    PERF_DRAW_METERS,
+    PERF_DRAW_HEADER,
+    PERF_DRAW_SPOTIFY,
+    PERF_DRAW_QR,
+    PERF_TELEGRAM,
+    PERF_SEND,
+    PERF_WEATHER,
+    PERF_SENSORS,
+    PERF_SPOTIFY_ART,
+    PERF_SPOTIFY_CODE,
+    PERF_PHOTO,
+    PERF_GIF,
+    PERF_OTA_CHECK,
+    PERF_I2C_TOUCH,
+    PERF_I2C_ADS,
+    PERF_HISTORY,
+    PERF_PROBE_COUNT
+};
+
+#ifdef PERF_STATS
+
+static const char* const PERF_PROBE_NAMES[PERF_PROBE_COUNT] = {
+    "loop", "animLag", "tickLag", "animations",
+    "drawUI", "drawButtons", "drawNotif", "drawDays", "drawWeather", "drawTimer",
+    "drawMeters", "drawHeader", "drawSpotify", "drawQR",
+    "telegram", "send", "weather", "sensors", "spotifyArt", "spotifyCode",
+    "photo", "gif", "otaCheck", "i2cTouch", "i2cAds", "history",
+};
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class PerfStats {
+public:
+    PerfStats() : _hist(nullptr), _droppedFrames(0), _since(0), _lastReport(0) {}
+
+    void begin() {
+        // ~9 KB of counters: keep them out of internal RAM
+        _hist = (Histogram*)heap_caps_calloc(PERF_PROBE_COUNT, sizeof(Histogram),
+                                             MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!_hist) _hist = (Histogram*)calloc(PERF_PROBE_COUNT, sizeof(Histogram));
+        _since = millis();
+        _lastReport = _since;
+        Serial.printf("[PERF] Histograms for %d probes\n", PERF_PROBE_COUNT);
+    }
+
+    void record(PerfProbe probe, uint32_t us) {
+        if (!_hist) return;
+        Histogram& h = _hist[probe];
+        h.buckets[bucketFor(us)]++;
+        h.count++;
+        h.totalUs += us;
+        if (us > h.maxUs) h.maxUs = us;
+    }
+
+    void recordLag(PerfProbe probe, unsigned long lateMs) {
+        record(probe, lateMs * 1000UL);
+        if (probe == PERF_ANIM_LAG) _droppedFrames += lateMs / PERF_FRAME_MS;
+    }
+
+    // Percentile (0-100) in microseconds: upper bound of its bucket
+    uint32_t percentile(PerfProbe probe, uint8_t pct) const {
+        const Histogram& h = _hist[probe];
+        if (h.count == 0) return 0;
+        uint32_t rank = (uint32_t)(((uint64_t)h.count * pct + 99) / 100);
+        if (rank == 0) rank = 1;
+        uint32_t seen = 0;
+        for (int b = 0; b < PERF_BUCKETS; b++) {
+            seen += h.buckets[b];
+            if (seen >= rank) return min(bucketUpper(b), h.maxUs);
+        }
+        return h.maxUs;
+    }
+
+    // One line per probe with samples: count, p50/p95/p99/max in ms,
+    // and the share of the window spent in it
+    void print() {
+        if (!_hist) return;
+        unsigned long windowMs = millis() - _since;
+        Serial.printf("[PERF] %lus window, %lu dropped frames\n",
+                      windowMs / 1000UL, (unsigned long)_droppedFrames);
+        Serial.printf("[PERF] %-12s %8s %8s %8s %8s %8s %8s %7s\n",
+                      "probe", "count", "mean", "p50", "p95", "p99", "max", "busy");
+        for (int p = 0; p < PERF_PROBE_COUNT; p++) {
+            const Histogram& h = _hist[p];
+            if (h.count == 0) continue;
+            PerfProbe probe = (PerfProbe)p;
+            Serial.printf("[PERF] %-12s %8lu %8.2f %8.2f %8.2f %8.2f %8.2f %6.2f%%\n", PERF_PROBE_NAMES[p],
+                          (unsigned long)h.count, h.totalUs / 1000.0 / h.count,
+                          percentile(probe, 50) / 1000.0, percentile(probe, 95) / 1000.0,
+                          percentile(probe, 99) / 1000.0, h.maxUs / 1000.0,
+                          windowMs ? h.totalUs / 10.0 / windowMs : 0.0);
+        }
+    }
+
+    // Compact form for a chat reply (ms, p50/p95/p99/max)
+    template <size_t N>
+    void summary(FixedString<N>& out) {
+        if (!_hist) return;
+        out.appendf("%lus, %lu dropped frames\nms p50/p95/p99/max\n",
+                    (millis() - _since) / 1000UL, (unsigned long)_droppedFrames);
+        for (int p = 0; p < PERF_PROBE_COUNT; p++) {
+            if (_hist[p].count == 0) continue;
+            PerfProbe probe = (PerfProbe)p;
+            out.appendf("%s %lu: %.1f/%.1f/%.1f/%.1f\n", PERF_PROBE_NAMES[p],
+                        (unsigned long)_hist[p].count, percentile(probe, 50) / 1000.0,
+                        percentile(probe, 95) / 1000.0, percentile(probe, 99) / 1000.0,
+                        _hist[p].maxUs / 1000.0);
+        }
+    }
+
+    void reset() {
+        if (_hist) memset(_hist, 0, PERF_PROBE_COUNT * sizeof(Histogram));
+        _droppedFrames = 0;
+        _since = millis();
+    }
+
+    void tick() {
+        unsigned long now = millis();
+        if (now - _lastReport >= PERF_REPORT_INTERVAL) {
+            _lastReport = now;
+            print();
+        }
+    }
+
+private:
+    struct Histogram {
+        uint32_t buckets[PERF_BUCKETS];
+        uint32_t count;
+        uint32_t maxUs;
+        uint64_t totalUs;
+    };
+
+    Histogram* _hist;
+    uint32_t _droppedFrames;
+    unsigned long _since;
+    unsigned long _lastReport;
+
+    // 0-3 us exact, then 4 buckets per power of two
+    static int bucketFor(uint32_t us) {
+        if (us < 4) return (int)us;
+        int exp = 31 - __builtin_clz(us);
+        if (exp > PERF_MAX_EXPONENT) return PERF_BUCKETS - 1;
+        int b = (exp - 1) * 4 + (int)((us >> (exp - 2)) & 3);
+        return b < PERF_BUCKETS ? b : PERF_BUCKETS - 1;
+    }
+
+    static uint32_t bucketUpper(int b) {
+        if (b < 4) return (uint32_t)b;
+        int exp = b / 4 + 1;
+        uint32_t step = 1UL << (exp - 2);
+        return ((uint32_t)(4 + b % 4) << (exp - 2)) + step - 1;
+    }
+};
+
+static PerfStats perfStats;
+
+// Times one scope; reads the cycle counter at both ends
+class PerfScope {
+public:
+    explicit PerfScope(PerfProbe probe) :
+        _probe(probe),
+        _startCycles(ESP.getCycleCount()),
+        _startMicros(micros()),
+        _done(false) {
+    }
+
+    ~PerfScope() { end(); }
+
+    void end() {
+        if (_done) return;
+        _done = true;
+        uint32_t cycles = ESP.getCycleCount() - _startCycles;
+        unsigned long us = micros() - _startMicros;
+        // The cycle counter wraps after 2^32 cycles, micros() doesn't
+        if (us < 10000000UL) us = cycles / ESP.getCpuFreqMHz();
+        perfStats.record(_probe, us);
+    }
+
+private:
+    PerfProbe _probe;
+    uint32_t _startCycles;
+    unsigned long _startMicros;
+    bool _done;
+};
+
+inline void perfStatsBegin() { perfStats.begin(); }
+inline void perfStatsTick() { perfStats.tick(); }
+
+#define PERF_SCOPE(probe)        PerfScope _perfScope(probe)
+#define PERF_SCOPE_END()         _perfScope.end()
+#define PERF_LAG(probe, lateMs)  perfStats.recordLag(probe, lateMs)
+
+#else
+
+inline void perfStatsBegin() {}
+inline void perfStatsTick() {}
+
+#define PERF_SCOPE(probe)
+#define PERF_SCOPE_END()
+#define PERF_LAG(probe, lateMs)
+
+#endif // PERF_STATS
+
+#endif // PERF_STATS_H
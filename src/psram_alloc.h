@@ -0,0 +1,183 @@
+/*
+ * =====================================================
+ * PSRAM ALLOCATION POLICY FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Keeps large, short-lived buffers out of internal SRAM so WiFi,
+ * mbedTLS and DMA (the RGB panel, I2C) always have contiguous
+ * internal memory to work with.
+ *
+ * Policy (size based):
+ * - Requests >= PSRAM_ALLOC_THRESHOLD bytes go to PSRAM first,
+ *   falling back to internal RAM if PSRAM is exhausted
+ * - Smaller requests stay in internal RAM (fast, low overhead)
+ *
+ * Pieces:
+ * - psramPolicyBegin(): applies the threshold to plain malloc(), so
+ *   Arduino Strings (e.g. HTTPClient responses) follow it
+ * - PsramJsonAllocator: ArduinoJson allocator with the same policy,
+ *   pass &psramJsonAllocator to JsonDocument. Counts the bytes it has
+ *   handed out, so a parse can report its own peak wherever the
+ *   memory came from (resetPeak() before, peak() after)
+ * - HeapStats: tracks internal free heap and largest free block so
+ *   fragmentation can be followed over a long soak
+ */
+
+#ifndef PSRAM_ALLOC_H
+#define PSRAM_ALLOC_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+#include <atomic>
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define PSRAM_ALLOC_THRESHOLD  512       // Bytes; at or above goes to PSRAM
+#define HEAP_REPORT_INTERVAL   3600000   // Log a heap summary every hour
+
+// ============================================================
+// ALLOCATION POLICY
+// ============================================================
+
+inline void* psramPolicyMalloc(size_t size) {
+    void* p = nullptr;
+    if (size >= PSRAM_ALLOC_THRESHOLD) {
+        p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (!p) p = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return p;
+}
+
+inline void* psramPolicyRealloc(void* ptr, size_t size) {
+    // heap_caps_realloc moves the block if it is not in a matching region
+    void* p = nullptr;
+    if (size >= PSRAM_ALLOC_THRESHOLD) {
+        p = heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (!p) p = heap_caps_realloc(ptr, size, MALLOC_CAP_8BIT);
+    return p;
+}
+
+// Route large plain malloc() calls (Strings, library buffers) to PSRAM.
+// Call once at the start of setup().
+inline void psramPolicyBegin() {
+    if (!psramFound()) {
+        Serial.println("[HEAP] No PSRAM, policy disabled");
+        return;
+    }
+    heap_caps_malloc_extmem_enable(PSRAM_ALLOC_THRESHOLD);
+    Serial.printf("[HEAP] malloc >= %d bytes prefers PSRAM (%u bytes free)\n",
+                  PSRAM_ALLOC_THRESHOLD, (unsigned)ESP.getFreePsram());
+}
+
+// ============================================================
+// ARDUINOJSON ALLOCATOR
+// ============================================================
+
+// Each block carries its size in a header so frees can be counted
+#define JSON_ALLOC_HEADER  8    // Keeps the payload 8-byte aligned
+
+class PsramJsonAllocator : public ArduinoJson::Allocator {
+public:
+    PsramJsonAllocator() : _inUse(0), _peak(0) {}
+
+    void* allocate(size_t size) override {
+        uint8_t* block = (uint8_t*)psramPolicyMalloc(size + JSON_ALLOC_HEADER);
+        if (!block) return nullptr;
+        *(size_t*)block = size;
+        count(size, 0);
+        return block + JSON_ALLOC_HEADER;
+    }
+
+    void deallocate(void* ptr) override {
+        if (!ptr) return;
+        uint8_t* block = (uint8_t*)ptr - JSON_ALLOC_HEADER;
+        count(0, *(size_t*)block);
+        heap_caps_free(block);
+    }
+
+    void* reallocate(void* ptr, size_t newSize) override {
+        if (!ptr) return allocate(newSize);
+        uint8_t* block = (uint8_t*)ptr - JSON_ALLOC_HEADER;
+        size_t oldSize = *(size_t*)block;
+        block = (uint8_t*)psramPolicyRealloc(block, newSize + JSON_ALLOC_HEADER);
+        if (!block) return nullptr;
+        *(size_t*)block = newSize;
+        count(newSize, oldSize);
+        return block + JSON_ALLOC_HEADER;
+    }
+
+    // Bytes held by documents now, and the most since resetPeak(). Shared
+    // by every task's documents, so overlapping parses add up.
+    size_t inUse() const { return _inUse.load(); }
+    size_t peak() const { return _peak.load(); }
+    void resetPeak() { _peak = _inUse.load(); }
+
+private:
+    std::atomic<size_t> _inUse;
+    std::atomic<size_t> _peak;
+
+    void count(size_t added, size_t removed) {
+        size_t now = _inUse.fetch_add(added - removed) + added - removed;
+        size_t peak = _peak.load();
+        while (now > peak && !_peak.compare_exchange_weak(peak, now)) {}
+    }
+};
+
+static PsramJsonAllocator psramJsonAllocator;
+
+// ============================================================
+// HEAP STATISTICS
+// ============================================================
+
+class HeapStats {
+public:
+    HeapStats() :
+        _minFree(UINT32_MAX),
+        _minLargest(UINT32_MAX),
+        _samples(0),
+        _lastReport(0) {
+    }
+
+    // Sample the internal heap; logs a summary every HEAP_REPORT_INTERVAL
+    void sample() {
+        uint32_t freeInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+        if (freeInternal < _minFree) _minFree = freeInternal;
+        if (largest < _minLargest) _minLargest = largest;
+        _samples++;
+
+        unsigned long now = millis();
+        if (now - _lastReport >= HEAP_REPORT_INTERVAL) {
+            _lastReport = now;
+            print();
+        }
+    }
+
+    void print() {
+        Serial.printf("[HEAP] Internal free %u (min %u), largest block %u (min %u), PSRAM free %u, %lu samples\n",
+                      (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL), (unsigned)_minFree,
+                      (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL), (unsigned)_minLargest,
+                      (unsigned)ESP.getFreePsram(), _samples);
+    }
+
+    // Multi-line summary for chat replies
+    void summary(char* buf, size_t len) {
+        snprintf(buf, len,
+                 "Internal: %u free (min %u)\nLargest block: %u (min %u)\nPSRAM: %u free\nUptime: %luh",
+                 (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL), (unsigned)_minFree,
+                 (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL), (unsigned)_minLargest,
+                 (unsigned)ESP.getFreePsram(), millis() / 3600000UL);
+    }
+
+private:
+    uint32_t _minFree;
+    uint32_t _minLargest;
+    unsigned long _samples;
+    unsigned long _lastReport;
+};
+
+#endif // PSRAM_ALLOC_H
@@ -0,0 +1,482 @@
+/*
+ * =====================================================
+ * QR CODE ENCODER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Small on-device QR Code Model 2 encoder (ISO/IEC 18004).
+ * Replaces the embedded 63KB QR JPEG: the placeholder payload
+ * (bot link + unit tag) is encoded once into a module bitmap
+ * and drawn with run-length fillRects, so redraws cost a few
+ * dozen primitive calls instead of a full JPEG decode.
+ *
+ * Supported:
+ * - Byte mode only (UTF-8 / ASCII payloads, e.g. URLs)
+ * - Versions 1..QR_MAX_VERSION (default 10 = 57x57 modules)
+ * - All four error correction levels
+ * - Automatic mask selection using the standard penalty rules
+ *
+ * Plain C++ with no Arduino dependencies.
+ *
+ * Usage:
+ *   QRCode qr;
+ *   if (qr.encode("https://t.me/some_bot")) {
+ *     for (int y = 0; y < qr.size(); y++)
+ *       for (int x = 0; x < qr.size(); x++)
+ *         if (qr.module(x, y)) ...draw dark module...
+ *   }
+ */
+
+#ifndef QR_ENCODER_H
+#define QR_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#ifndef QR_MAX_VERSION
+#define QR_MAX_VERSION 10   // 57x57 modules, up to 213 bytes at ECC_MEDIUM
+#endif
+
+#if QR_MAX_VERSION < 1 || QR_MAX_VERSION > 10
+#error "QR_MAX_VERSION must be between 1 and 10"
+#endif
+
+#define QR_MAX_SIZE       (QR_MAX_VERSION * 4 + 17)
+#define QR_MAX_BITMAP     ((QR_MAX_SIZE * QR_MAX_SIZE + 7) / 8)
+#define QR_MAX_CODEWORDS  ((((16 * QR_MAX_VERSION + 128) * QR_MAX_VERSION) + 64) / 8)
+#define QR_MAX_ECC_BLOCK  30
+
+// ============================================================
+// QR CODE CLASS
+// ============================================================
+
+class QRCode {
+public:
+    enum Ecc { ECC_LOW = 0, ECC_MEDIUM, ECC_QUARTILE, ECC_HIGH };
+
+    QRCode() : _version(0), _size(0) {
+        memset(_modules, 0, sizeof(_modules));
+        memset(_function, 0, sizeof(_function));
+    }
+
+    // Encode a NUL-terminated string
+    bool encode(const char* text, Ecc ecc = ECC_MEDIUM) {
+        return encode((const uint8_t*)text, strlen(text), ecc);
+    }
+
+    // Encode raw bytes in byte mode, picking the smallest version that fits.
+    // Returns false if the payload does not fit in QR_MAX_VERSION.
+    bool encode(const uint8_t* data, size_t len, Ecc ecc = ECC_MEDIUM) {
+        _version = 0;
+        _size = 0;
+
+        int ver;
+        for (ver = 1; ver <= QR_MAX_VERSION; ver++) {
+            int countBits = (ver <= 9) ? 8 : 16;
+            size_t capacityBits = (size_t)numDataCodewords(ver, ecc) * 8;
+            if (4 + countBits + len * 8 <= capacityBits) break;
+        }
+        if (ver > QR_MAX_VERSION) return false;
+
+        _version = ver;
+        _size = ver * 4 + 17;
+
+        // Build the data codeword stream
+        uint8_t codewords[QR_MAX_CODEWORDS];
+        int dataLen = numDataCodewords(ver, ecc);
+        memset(codewords, 0, sizeof(codewords));
+
+        int bitLen = 0;
+        appendBits(codewords, bitLen, 0x4, 4);                       // Byte mode
+        appendBits(codewords, bitLen, (uint32_t)len, (ver <= 9) ? 8 : 16);
+        for (size_t i = 0; i < len; i++) {
+            appendBits(codewords, bitLen, data[i], 8);
+        }
+
+        int capacityBits = dataLen * 8;
+        int terminator = capacityBits - bitLen;
+        if (terminator > 4) terminator = 4;
+        appendBits(codewords, bitLen, 0, terminator);
+        appendBits(codewords, bitLen, 0, (8 - bitLen % 8) % 8);
+
+        for (uint8_t pad = 0xEC; bitLen < capacityBits; pad ^= 0xEC ^ 0x11) {
+            appendBits(codewords, bitLen, pad, 8);
+        }
+
+        uint8_t interleaved[QR_MAX_CODEWORDS];
+        addEccAndInterleave(codewords, ver, ecc, interleaved);
+
+        // Lay out function patterns and data
+        memset(_modules, 0, sizeof(_modules));
+        memset(_function, 0, sizeof(_function));
+        drawFunctionPatterns();
+        drawCodewords(interleaved, numRawDataModules(ver) / 8);
+
+        // Pick the mask with the lowest penalty score
+        int bestMask = 0;
+        long bestPenalty = -1;
+        for (int mask = 0; mask < 8; mask++) {
+            applyMask(mask);
+            drawFormatBits(ecc, mask);
+            long penalty = penaltyScore();
+            if (bestPenalty < 0 || penalty < bestPenalty) {
+                bestPenalty = penalty;
+                bestMask = mask;
+            }
+            applyMask(mask);  // XOR undoes the mask
+        }
+
+        applyMask(bestMask);
+        drawFormatBits(ecc, bestMask);
+        return true;
+    }
+
+    // Symbol version (1..QR_MAX_VERSION), 0 if nothing has been encoded
+    int version() const {
+        return _version;
+    }
+
+    // Width/height in modules, 0 if nothing has been encoded
+    int size() const {
+        return _size;
+    }
+
+    // True if the module at (x, y) is dark; out-of-range reads as light
+    bool module(int x, int y) const {
+        if (x < 0 || y < 0 || x >= _size || y >= _size) return false;
+        return getBit(_modules, x, y);
+    }
+
+private:
+    int _version;
+    int _size;
+    uint8_t _modules[QR_MAX_BITMAP];
+    uint8_t _function[QR_MAX_BITMAP];
+
+    // ECC codewords per block and block count, indexed [ecc][version]
+    static int eccPerBlock(int ver, Ecc ecc) {
+        static const int8_t table[4][11] = {
+            {-1,  7, 10, 15, 20, 26, 18, 20, 24, 30, 18},  // Low
+            {-1, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26},  // Medium
+            {-1, 13, 22, 18, 26, 18, 24, 18, 22, 20, 24},  // Quartile
+            {-1, 17, 28, 22, 16, 22, 28, 26, 26, 24, 28},  // High
+        };
+        return table[ecc][ver];
+    }
+
+    static int numBlocks(int ver, Ecc ecc) {
+        static const int8_t table[4][11] = {
+            {-1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 4},
+            {-1, 1, 1, 1, 2, 2, 4, 4, 4, 5, 5},
+            {-1, 1, 1, 2, 2, 4, 4, 6, 6, 8, 8},
+            {-1, 1, 1, 2, 4, 4, 4, 5, 6, 8, 8},
+        };
+        return table[ecc][ver];
+    }
+
+    // Modules available for data+ECC after function patterns are placed
+    static int numRawDataModules(int ver) {
+        int result = (16 * ver + 128) * ver + 64;
+        if (ver >= 2) {
+            int numAlign = ver / 7 + 2;
+            result -= (25 * numAlign - 10) * numAlign - 55;
+            if (ver >= 7) result -= 36;
+        }
+        return result;
+    }
+
+    static int numDataCodewords(int ver, Ecc ecc) {
+        return numRawDataModules(ver) / 8 - eccPerBlock(ver, ecc) * numBlocks(ver, ecc);
+    }
+
+    static void appendBits(uint8_t* buf, int& bitLen, uint32_t val, int count) {
+        for (int i = count - 1; i >= 0; i--, bitLen++) {
+            if ((val >> i) & 1) buf[bitLen >> 3] |= 0x80 >> (bitLen & 7);
+        }
+    }
+
+    // ---------- Reed-Solomon over GF(2^8), polynomial 0x11D ----------
+
+    static uint8_t gfMultiply(uint8_t x, uint8_t y) {
+        int z = 0;
+        for (int i = 7; i >= 0; i--) {
+            z = (z << 1) ^ ((z >> 7) * 0x11D);
+            z ^= ((y >> i) & 1) * x;
+        }
+        return (uint8_t)z;
+    }
+
+    static void rsDivisor(int degree, uint8_t* result) {
+        memset(result, 0, degree);
+        result[degree - 1] = 1;
+        uint8_t root = 1;
+        for (int i = 0; i < degree; i++) {
+            for (int j = 0; j < degree; j++) {
+                result[j] = gfMultiply(result[j], root);
+                if (j + 1 < degree) result[j] ^= result[j + 1];
+            }
+            root = gfMultiply(root, 0x02);
+        }
+    }
+
+    static void rsRemainder(const uint8_t* data, int len, const uint8_t* divisor,
+                            int degree, uint8_t* result) {
+        memset(result, 0, degree);
+        for (int i = 0; i < len; i++) {
+            uint8_t factor = data[i] ^ result[0];
+            memmove(result, result + 1, degree - 1);
+            result[degree - 1] = 0;
+            for (int j = 0; j < degree; j++) {
+                result[j] ^= gfMultiply(divisor[j], factor);
+            }
+        }
+    }
+
+    // Split data into blocks, append ECC to each and interleave the result
+    static void addEccAndInterleave(const uint8_t* data, int ver, Ecc ecc, uint8_t* out) {
+        int blocks = numBlocks(ver, ecc);
+        int eccLen = eccPerBlock(ver, ecc);
+        int rawCodewords = numRawDataModules(ver) / 8;
+        int numShort = blocks - rawCodewords % blocks;
+        int shortLen = rawCodewords / blocks - eccLen;  // Data bytes in a short block
+
+        uint8_t divisor[QR_MAX_ECC_BLOCK];
+        uint8_t eccBytes[QR_MAX_ECC_BLOCK];
+        rsDivisor(eccLen, divisor);
+
+        int dataOffset = 0;
+        for (int b = 0; b < blocks; b++) {
+            int datLen = shortLen + (b < numShort ? 0 : 1);
+            const uint8_t* block = data + dataOffset;
+
+            // Data bytes: column i of every block, short blocks skip the last column
+            for (int i = 0; i < datLen; i++) {
+                int pos = i * blocks + b;
+                if (i == shortLen) pos = shortLen * blocks + (b - numShort);
+                out[pos] = block[i];
+            }
+
+            rsRemainder(block, datLen, divisor, eccLen, eccBytes);
+            int eccBase = rawCodewords - eccLen * blocks;
+            for (int i = 0; i < eccLen; i++) {
+                out[eccBase + i * blocks + b] = eccBytes[i];
+            }
+            dataOffset += datLen;
+        }
+    }
+
+    // ---------- Module bitmap helpers ----------
+
+    bool getBit(const uint8_t* bits, int x, int y) const {
+        int idx = y * _size + x;
+        return (bits[idx >> 3] >> (idx & 7)) & 1;
+    }
+
+    void setBit(uint8_t* bits, int x, int y, bool on) {
+        int idx = y * _size + x;
+        if (on) bits[idx >> 3] |= 1 << (idx & 7);
+        else bits[idx >> 3] &= ~(1 << (idx & 7));
+    }
+
+    void setFunction(int x, int y, bool dark) {
+        setBit(_modules, x, y, dark);
+        setBit(_function, x, y, true);
+    }
+
+    // ---------- Function patterns ----------
+
+    void drawFunctionPatterns() {
+        // Timing patterns
+        for (int i = 0; i < _size; i++) {
+            setFunction(6, i, i % 2 == 0);
+            setFunction(i, 6, i % 2 == 0);
+        }
+
+        // Finder patterns with separators
+        drawFinder(3, 3);
+        drawFinder(_size - 4, 3);
+        drawFinder(3, _size - 4);
+
+        // Alignment patterns
+        int positions[7];
+        int numAlign = alignmentPositions(positions);
+        for (int i = 0; i < numAlign; i++) {
+            for (int j = 0; j < numAlign; j++) {
+                bool nearFinder = (i == 0 && j == 0) ||
+                                  (i == 0 && j == numAlign - 1) ||
+                                  (i == numAlign - 1 && j == 0);
+                if (!nearFinder) drawAlignment(positions[i], positions[j]);
+            }
+        }
+
+        // Reserve format areas (real bits are drawn per mask) and version info
+        drawFormatBits(ECC_LOW, 0);
+        drawVersion();
+    }
+
+    void drawFinder(int cx, int cy) {
+        for (int dy = -4; dy <= 4; dy++) {
+            for (int dx = -4; dx <= 4; dx++) {
+                int dist = max2(abs(dx), abs(dy));
+                int x = cx + dx, y = cy + dy;
+                if (x >= 0 && x < _size && y >= 0 && y < _size) {
+                    setFunction(x, y, dist != 2 && dist != 4);
+                }
+            }
+        }
+    }
+
+    void drawAlignment(int cx, int cy) {
+        for (int dy = -2; dy <= 2; dy++) {
+            for (int dx = -2; dx <= 2; dx++) {
+                setFunction(cx + dx, cy + dy, max2(abs(dx), abs(dy)) != 1);
+            }
+        }
+    }
+
+    int alignmentPositions(int* result) const {
+        if (_version == 1) return 0;
+        int numAlign = _version / 7 + 2;
+        int step = (_version * 4 + numAlign * 2 + 1) / (numAlign * 2 - 2) * 2;
+        result[0] = 6;
+        for (int i = numAlign - 1, pos = _size - 7; i >= 1; i--, pos -= step) {
+            result[i] = pos;
+        }
+        return numAlign;
+    }
+
+    void drawFormatBits(Ecc ecc, int mask) {
+        static const int eccFormat[4] = {1, 0, 3, 2};  // L, M, Q, H
+        int data = eccFormat[ecc] << 3 | mask;
+        int rem = data;
+        for (int i = 0; i < 10; i++) rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+        int bits = (data << 10 | rem) ^ 0x5412;
+
+        // First copy, around the top-left finder
+        for (int i = 0; i <= 5; i++) setFunction(8, i, (bits >> i) & 1);
+        setFunction(8, 7, (bits >> 6) & 1);
+        setFunction(8, 8, (bits >> 7) & 1);
+        setFunction(7, 8, (bits >> 8) & 1);
+        for (int i = 9; i < 15; i++) setFunction(14 - i, 8, (bits >> i) & 1);
+
+        // Second copy, split between the other two finders
+        for (int i = 0; i < 8; i++) setFunction(_size - 1 - i, 8, (bits >> i) & 1);
+        for (int i = 8; i < 15; i++) setFunction(8, _size - 15 + i, (bits >> i) & 1);
+        setFunction(8, _size - 8, true);  // Always-dark module
+    }
+
+    void drawVersion() {
+        if (_version < 7) return;
+        int rem = _version;
+        for (int i = 0; i < 12; i++) rem = (rem << 1) ^ ((rem >> 11) * 0x1F25);
+        long bits = (long)_version << 12 | rem;
+        for (int i = 0; i < 18; i++) {
+            bool bit = (bits >> i) & 1;
+            int a = _size - 11 + i % 3;
+            int b = i / 3;
+            setFunction(a, b, bit);
+            setFunction(b, a, bit);
+        }
+    }
+
+    // ---------- Data placement and masking ----------
+
+    void drawCodewords(const uint8_t* data, int len) {
+        int i = 0;
+        for (int right = _size - 1; right >= 1; right -= 2) {
+            if (right == 6) right = 5;  // Skip the vertical timing column
+            for (int vert = 0; vert < _size; vert++) {
+                for (int j = 0; j < 2; j++) {
+                    int x = right - j;
+                    bool upward = ((right + 1) & 2) == 0;
+                    int y = upward ? _size - 1 - vert : vert;
+                    if (!getBit(_function, x, y) && i < len * 8) {
+                        setBit(_modules, x, y, (data[i >> 3] >> (7 - (i & 7))) & 1);
+                        i++;
+                    }
+                }
+            }
+        }
+    }
+
+    void applyMask(int mask) {
+        for (int y = 0; y < _size; y++) {
+            for (int x = 0; x < _size; x++) {
+                if (getBit(_function, x, y)) continue;
+                bool invert;
+                switch (mask) {
+                    case 0:  invert = (x + y) % 2 == 0; break;
+                    case 1:  invert = y % 2 == 0; break;
+                    case 2:  invert = x % 3 == 0; break;
+                    case 3:  invert = (x + y) % 3 == 0; break;
+                    case 4:  invert = (x / 3 + y / 2) % 2 == 0; break;
+                    case 5:  invert = x * y % 2 + x * y % 3 == 0; break;
+                    case 6:  invert = (x * y % 2 + x * y % 3) % 2 == 0; break;
+                    default: invert = ((x + y) % 2 + x * y % 3) % 2 == 0; break;
+                }
+                if (invert) setBit(_modules, x, y, !getBit(_modules, x, y));
+            }
+        }
+    }
+
+    // Standard penalty rules N1..N4, evaluated on rows and columns
+    long penaltyScore() const {
+        long result = 0;
+        int dark = 0;
+
+        for (int pass = 0; pass < 2; pass++) {
+            for (int a = 0; a < _size; a++) {
+                int run = 0;
+                bool runColor = false;
+                uint16_t window = 0;  // Last 11 modules, newest in bit 0
+                for (int b = 0; b < _size; b++) {
+                    bool c = pass == 0 ? getBit(_modules, b, a) : getBit(_modules, a, b);
+                    if (pass == 0 && c) dark++;
+
+                    // N1: runs of five or more same-coloured modules
+                    if (b > 0 && c == runColor) {
+                        run++;
+                        if (run == 5) result += 3;
+                        else if (run > 5) result++;
+                    } else {
+                        run = 1;
+                        runColor = c;
+                    }
+
+                    // N3: 1:1:3:1:1 finder-like pattern with four light modules
+                    window = ((window << 1) | c) & 0x7FF;
+                    if (b >= 10 && (window == 0x5D0 || window == 0x05D)) result += 40;
+                }
+            }
+        }
+
+        // N2: 2x2 blocks of one colour
+        for (int y = 0; y < _size - 1; y++) {
+            for (int x = 0; x < _size - 1; x++) {
+                bool c = getBit(_modules, x, y);
+                if (c == getBit(_modules, x + 1, y) &&
+                    c == getBit(_modules, x, y + 1) &&
+                    c == getBit(_modules, x + 1, y + 1)) {
+                    result += 3;
+                }
+            }
+        }
+
+        // N4: dark/light balance
+        long total = (long)_size * _size;
+        long k = (labs(dark * 20L - total * 10L) + total - 1) / total - 1;
+        result += k * 10;
+        return result;
+    }
+
+    static int max2(int a, int b) {
+        return a > b ? a : b;
+    }
+};
+
+#endif // QR_ENCODER_H
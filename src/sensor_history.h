@@ -0,0 +1,391 @@
+/*
+ * =====================================================
+ * SENSOR HISTORY FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Keeps the sensor readings at three resolutions in PSRAM:
+ *
+ *   raw      one sample every 5 s     for the last hour
+ *   minute   min/avg/max per minute   for the last day
+ *   hour     min/avg/max per hour     for the last 30 days
+ *
+ * Each tier is a ring indexed by time (epoch / period), so finding a
+ * slot is arithmetic and a gap (power cut, clock not set) just leaves
+ * empty slots. When a minute ends its raw samples are rolled up into the
+ * minute tier, and when an hour ends its minutes into the hour tier -
+ * 12 and 60 records read, however much history is kept.
+ *
+ * Every tier mirrors to its own file on LittleFS. Only the slots that
+ * changed since the last flush are rewritten, once a minute (raw and
+ * minute tiers) or once an hour, so a restart loses at most the minute
+ * in progress. LittleFS spreads the rewrites across the partition.
+ *
+ * Values are int16 per channel, in whatever units the caller picks.
+ *
+ * Usage:
+ * - begin() after LittleFS.begin(); runs RAM-only if the files can't
+ *   be used
+ * - add(now, values) per reading; ignored until the clock is set
+ * - summary(now, seconds, channel, out): min/avg/max over that window
+ * - sparkline(now, seconds, channel, out, points): one rollup per
+ *   point, read straight from the tier that suits the step (constant
+ *   work per point); appendSparkline() draws it as block characters
+ * - bytes()/bytesPerHour(tier) for the memory cost
+ */
+
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "psram_alloc.h"
+#include "fixed_string.h"
+#include "perf_stats.h"
+#include "trace_buffer.h"
+#include "async_log.h"
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define HISTORY_CHANNELS      2           // Values per sample (main.cpp: AQI, CO2)
+#define HISTORY_RAW_PERIOD    5           // Seconds
+#define HISTORY_RAW_SLOTS     720         // 1 hour
+#define HISTORY_MINUTE_SLOTS  1440        // 1 day
+#define HISTORY_HOUR_SLOTS    720         // 30 days
+#define HISTORY_DIR           "/history"
+#define HISTORY_MAGIC         0x31545348  // "HST1"
+#define HISTORY_MIN_EPOCH     1600000000  // Earlier means NTP hasn't answered
+#define HISTORY_EMPTY         INT16_MIN   // First value of an unused slot
+#define HISTORY_SPARK_MAX     48          // Points in a text sparkline
+
+enum HistoryTierId { HISTORY_RAW, HISTORY_MINUTE, HISTORY_HOUR, HISTORY_TIERS };
+
+struct HistoryRollup {
+    int16_t min;
+    int16_t avg;
+    int16_t max;
+};
+
+// ============================================================
+// TIER
+// ============================================================
+
+// One time-indexed ring of fixed-size records, mirrored to a file
+class HistoryTier {
+public:
+    HistoryTier() :
+        _data(nullptr), _path(nullptr), _period(0), _slots(0), _recordSize(0),
+        _last(0), _dirtyFrom(0), _dirtyTo(0), _dirty(false), _persist(false) {}
+
+    bool begin(const char* path, uint32_t period, uint32_t slots, uint16_t recordSize, bool persist) {
+        _path = path;
+        _period = period;
+        _slots = slots;
+        _recordSize = recordSize;
+        _data = (uint8_t*)psramPolicyMalloc(bytes());
+        if (!_data) return false;
+        for (uint32_t i = 0; i < slots; i++) clearSlot(i);
+
+        _persist = persist && (load() || create());
+        return true;
+    }
+
+    uint32_t period() const { return _period; }
+    uint32_t slots() const { return _slots; }
+    uint32_t last() const { return _last; }  // Newest index written, 0 if none
+    size_t bytes() const { return (size_t)_slots * _recordSize; }
+
+    // Record for a period index, or null if it was never written or has
+    // been overwritten since
+    const uint8_t* get(uint32_t index) const {
+        if (!_last || index > _last || _last - index >= _slots) return nullptr;
+        const uint8_t* rec = slot(index);
+        return *(const int16_t*)rec == HISTORY_EMPTY ? nullptr : rec;
+    }
+
+    void put(uint32_t index, const void* record) {
+        if (_last && index + _slots <= _last) return;  // Already rotated out
+        if (index > _last) {
+            // Slots skipped since the last write hold older data: empty them
+            uint32_t from = !_last ? index : (index - _last < _slots ? _last + 1 : index - _slots + 1);
+            for (uint32_t i = from; i < index; i++) clearSlot(i % _slots);
+            markDirty(from);
+            _last = index;
+        }
+        memcpy(slot(index), record, _recordSize);
+        markDirty(index);
+    }
+
+    // Writes the changed slots and the header
+    bool flush() {
+        if (!_persist || !_dirty) return true;
+        File f = LittleFS.open(_path, "r+");
+        if (!f) return false;
+        uint32_t count = _dirtyTo - _dirtyFrom + 1;
+        bool ok;
+        if (count >= _slots) {
+            ok = writeAt(f, 0, _slots);
+        } else {
+            uint32_t first = _dirtyFrom % _slots;
+            uint32_t run = min(count, _slots - first);
+            ok = writeAt(f, first, run) && (run == count || writeAt(f, 0, count - run));
+        }
+        ok = ok && writeHeader(f);
+        _dirty = !ok;
+        return ok;
+    }
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t period;
+        uint32_t slots;
+        uint32_t recordSize;
+        uint32_t last;
+    };
+
+    uint8_t* _data;
+    const char* _path;
+    uint32_t _period;
+    uint32_t _slots;
+    uint16_t _recordSize;
+    uint32_t _last;
+    uint32_t _dirtyFrom;   // Index range changed since the last flush
+    uint32_t _dirtyTo;
+    bool _dirty;
+    bool _persist;
+
+    uint8_t* slot(uint32_t index) const { return _data + (size_t)(index % _slots) * _recordSize; }
+    void clearSlot(uint32_t i) { *(int16_t*)(_data + (size_t)i * _recordSize) = HISTORY_EMPTY; }
+
+    void markDirty(uint32_t index) {
+        if (!_dirty) {
+            _dirtyFrom = _dirtyTo = index;
+            _dirty = true;
+        } else {
+            _dirtyFrom = min(_dirtyFrom, index);
+            _dirtyTo = max(_dirtyTo, index);
+        }
+    }
+
+    bool load() {
+        File f = LittleFS.open(_path, "r");
+        if (!f) return false;
+        Header h;
+        if (f.read((uint8_t*)&h, sizeof(h)) != sizeof(h) || h.magic != HISTORY_MAGIC || h.period != _period ||
+            h.slots != _slots || h.recordSize != _recordSize || f.size() != sizeof(h) + bytes()) {
+            LOG_W(LOG_SYS, "[HIST] %s doesn't match this build; starting it over", _path);
+            return false;
+        }
+        if (f.read(_data, bytes()) != bytes()) return false;
+        _last = h.last;
+        return true;
+    }
+
+    bool create() {
+        File f = LittleFS.open(_path, "w");
+        if (!f) return false;
+        for (uint32_t i = 0; i < _slots; i++) clearSlot(i);  // A failed load may have filled some
+        _last = 0;
+        _dirty = false;
+        return writeAt(f, 0, _slots) && writeHeader(f);
+    }
+
+    bool writeAt(File& f, uint32_t first, uint32_t count) {
+        size_t len = (size_t)count * _recordSize;
+        return f.seek(sizeof(Header) + (size_t)first * _recordSize) &&
+               f.write(_data + (size_t)first * _recordSize, len) == len;
+    }
+
+    bool writeHeader(File& f) {
+        Header h = {HISTORY_MAGIC, _period, _slots, _recordSize, _last};
+        return f.seek(0) && f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h);
+    }
+};
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class SensorHistory {
+public:
+    SensorHistory() : _minute(0), _persist(false) {}
+
+    bool begin() {
+        _persist = LittleFS.exists(HISTORY_DIR) || LittleFS.mkdir(HISTORY_DIR);
+        if (!_persist) LOG_W(LOG_SYS, "[HIST] No LittleFS; history kept in RAM only");
+
+        bool ok = _tiers[HISTORY_RAW].begin(HISTORY_DIR "/raw.bin", HISTORY_RAW_PERIOD, HISTORY_RAW_SLOTS,
+                                            sizeof(int16_t) * HISTORY_CHANNELS, _persist) &&
+                  _tiers[HISTORY_MINUTE].begin(HISTORY_DIR "/minute.bin", 60, HISTORY_MINUTE_SLOTS,
+                                               sizeof(HistoryRollup) * HISTORY_CHANNELS, _persist) &&
+                  _tiers[HISTORY_HOUR].begin(HISTORY_DIR "/hour.bin", 3600, HISTORY_HOUR_SLOTS,
+                                             sizeof(HistoryRollup) * HISTORY_CHANNELS, _persist);
+        if (!ok) {
+            LOG_E(LOG_SYS, "[HIST] Out of memory");
+            return false;
+        }
+        // Picks up the minute a restart interrupted
+        _minute = _tiers[HISTORY_RAW].last() * HISTORY_RAW_PERIOD / 60;
+        LOG_I(LOG_SYS, "[HIST] %u bytes for %u h: %u B/h raw, %u B/h by minute, %u B/h by hour",
+              (unsigned)bytes(), HISTORY_HOUR_SLOTS, (unsigned)bytesPerHour(HISTORY_RAW),
+              (unsigned)bytesPerHour(HISTORY_MINUTE), (unsigned)bytesPerHour(HISTORY_HOUR));
+        return true;
+    }
+
+    void add(time_t now, const int16_t* values) {
+        if (now < HISTORY_MIN_EPOCH) return;
+        uint32_t minute = now / 60;
+        if (_minute && minute != _minute) {
+            TRACE_SCOPE("history", "rollup");
+            rollMinute(_minute);
+            if (minute / 60 != _minute / 60) rollHour(_minute / 60);
+            flush();
+        }
+        _minute = minute;
+        _tiers[HISTORY_RAW].put(now / HISTORY_RAW_PERIOD, values);
+    }
+
+    // Min/avg/max of one channel over the last 'seconds', from the finest
+    // tier that reaches back that far
+    bool summary(time_t now, uint32_t seconds, uint8_t channel, HistoryRollup& out) const {
+        int t = HISTORY_RAW;
+        while (t < HISTORY_HOUR && _tiers[t].period() * _tiers[t].slots() < seconds) t++;
+        const HistoryTier& tier = _tiers[t];
+        uint32_t end = now / tier.period();
+        uint32_t count = min(seconds / tier.period(), tier.slots());
+        Accumulator acc;
+        for (uint32_t i = end - count + 1; i <= end; i++) {
+            const uint8_t* rec = tier.get(i);
+            if (rec) acc.add(rollup(t, rec, channel));
+        }
+        return acc.result(out);
+    }
+
+    // 'points' rollups ending now, 'seconds' apart in total. Each point
+    // is one slot of the coarsest tier no coarser than the step; empty
+    // points have avg HISTORY_EMPTY. Returns the tier used.
+    int sparkline(time_t now, uint32_t seconds, uint8_t channel, HistoryRollup* out, int points) const {
+        uint32_t step = max(seconds / points, (uint32_t)1);
+        int t = HISTORY_HOUR;
+        while (t > HISTORY_RAW && _tiers[t].period() > step) t--;
+        while (t < HISTORY_HOUR && _tiers[t].period() * _tiers[t].slots() < seconds) t++;
+        const HistoryTier& tier = _tiers[t];
+
+        uint32_t stride = max(step / tier.period(), (uint32_t)1);
+        uint32_t end = now / tier.period() - (t == HISTORY_RAW ? 0 : 1);  // Last finished rollup
+        for (int i = 0; i < points; i++) {
+            uint32_t back = (uint32_t)(points - 1 - i) * stride;
+            const uint8_t* rec = back <= end ? tier.get(end - back) : nullptr;
+            out[i] = rec ? rollup(t, rec, channel) : HistoryRollup{HISTORY_EMPTY, HISTORY_EMPTY, HISTORY_EMPTY};
+        }
+        return t;
+    }
+
+    // The averages as block characters, scaled to their own range; a
+    // space where nothing was recorded
+    template <size_t N>
+    void appendSparkline(FixedString<N>& out, time_t now, uint32_t seconds, uint8_t channel, int points) const {
+        static const char* const BARS[] = {"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+        HistoryRollup pts[HISTORY_SPARK_MAX];
+        points = min(points, HISTORY_SPARK_MAX);
+        sparkline(now, seconds, channel, pts, points);
+
+        int16_t lo = INT16_MAX, hi = INT16_MIN;
+        for (int i = 0; i < points; i++) {
+            if (pts[i].avg == HISTORY_EMPTY) continue;
+            lo = min(lo, pts[i].avg);
+            hi = max(hi, pts[i].avg);
+        }
+        for (int i = 0; i < points; i++) {
+            if (pts[i].avg == HISTORY_EMPTY) {
+                out += ' ';
+            } else {
+                out += BARS[hi > lo ? (pts[i].avg - lo) * 7 / (hi - lo) : 3];
+            }
+        }
+    }
+
+    bool flush() {
+        if (!_persist) return true;
+        PERF_SCOPE(PERF_HISTORY);  // LittleFS writes, from loop() once a minute
+        TRACE_SCOPE("history", "flush");
+        bool ok = true;
+        for (int t = 0; t < HISTORY_TIERS; t++) ok = _tiers[t].flush() && ok;
+        if (!ok) LOG_W(LOG_SYS, "[HIST] Writing history to LittleFS failed");
+        return ok;
+    }
+
+    size_t bytes() const {
+        size_t total = 0;
+        for (int t = 0; t < HISTORY_TIERS; t++) total += _tiers[t].bytes();
+        return total;
+    }
+
+    // What each hour of history costs in that tier
+    size_t bytesPerHour(int tier) const {
+        return _tiers[tier].bytes() / (_tiers[tier].slots() * _tiers[tier].period() / 3600);
+    }
+
+private:
+    // Min of mins, max of maxes, mean of the averages
+    struct Accumulator {
+        int32_t sum = 0;
+        int32_t count = 0;
+        int16_t lo = INT16_MAX;
+        int16_t hi = INT16_MIN;
+
+        void add(const HistoryRollup& r) {
+            sum += r.avg;
+            count++;
+            lo = min(lo, r.min);
+            hi = max(hi, r.max);
+        }
+
+        bool result(HistoryRollup& out) const {
+            if (!count) return false;
+            out.min = lo;
+            out.max = hi;
+            out.avg = (int16_t)((sum + (sum >= 0 ? count / 2 : -count / 2)) / count);
+            return true;
+        }
+    };
+
+    HistoryTier _tiers[HISTORY_TIERS];
+    uint32_t _minute;  // Minute the latest raw sample fell in
+    bool _persist;
+
+    static HistoryRollup rollup(int tier, const uint8_t* rec, uint8_t channel) {
+        if (tier == HISTORY_RAW) {
+            int16_t v = ((const int16_t*)rec)[channel];
+            return {v, v, v};
+        }
+        return ((const HistoryRollup*)rec)[channel];
+    }
+
+    // Rolls 'index' of the finer tier's 'per' slots into one coarser slot
+    void roll(int from, uint32_t first, uint32_t per, int to, uint32_t index) {
+        HistoryRollup out[HISTORY_CHANNELS];
+        for (uint8_t c = 0; c < HISTORY_CHANNELS; c++) {
+            Accumulator acc;
+            for (uint32_t i = first; i < first + per; i++) {
+                const uint8_t* rec = _tiers[from].get(i);
+                if (rec) acc.add(rollup(from, rec, c));
+            }
+            if (!acc.result(out[c])) return;  // Nothing recorded in that period
+        }
+        _tiers[to].put(index, out);
+    }
+
+    void rollMinute(uint32_t minute) {
+        const uint32_t per = 60 / HISTORY_RAW_PERIOD;
+        roll(HISTORY_RAW, minute * per, per, HISTORY_MINUTE, minute);
+    }
+
+    void rollHour(uint32_t hour) {
+        roll(HISTORY_MINUTE, hour * 60, 60, HISTORY_HOUR, hour);
+    }
+};
+
+#endif // SENSOR_HISTORY_H
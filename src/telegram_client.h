@@ -0,0 +1,466 @@
+/*
+ * =====================================================
+ * TELEGRAM BOT CLIENT FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Lean replacement for UniversalTelegramBot covering the subset this
+ * firmware uses: getUpdates, sendMessage, getFile and getMe.
+ *
+ * How it works:
+ * - One TLS connection to the Bot API is kept alive between calls
+ *   (requests are HTTP/1.0 + keep-alive, so bodies are never chunked)
+ * - Responses are read straight off the TLS stream, bounded by
+ *   Content-Length; nothing is buffered into a String
+ * - getUpdates walks the "result" array one update at a time with a
+ *   filtered ArduinoJson parse, copying just the fields we need into a
+ *   fixed-size TelegramUpdate (ids as int64, text in a fixed buffer)
+ * - Oversized text is truncated, extra updates are skipped but still
+ *   acknowledged via the offset
+ *
+ * Usage:
+ * 1. TelegramClient bot(BOT_TOKEN, wifiClientSecure);
+ * 2. n = bot.getUpdates(updates, max)
+ * 3. bot.sendMessage(chatId, "text")
+ */
+
+#ifndef TELEGRAM_CLIENT_H
+#define TELEGRAM_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <ArduinoJson.h>
+#include "trace_buffer.h"
+#include "async_log.h"
+#include "fixed_string.h"
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#ifndef TELEGRAM_API_HOST
+#define TELEGRAM_API_HOST      "api.telegram.org"
+#endif
+#ifndef TELEGRAM_API_PORT
+#define TELEGRAM_API_PORT      443
+#endif
+#define TELEGRAM_READ_TIMEOUT  3000   // ms per response
+#define TG_MAX_TEXT            512    // Message text, truncated (and logged) beyond this
+#define TG_MAX_NAME            32
+#define TG_MAX_FILE_ID         100
+#define TG_MAX_FILE_NAME       64
+#define TG_MAX_MIME            32
+#define TG_MAX_BODY            1024   // sendMessage JSON body
+
+// ============================================================
+// UPDATE STRUCT
+// ============================================================
+
+enum TelegramUpdateType : uint8_t {
+    TG_UPDATE_TEXT,
+    TG_UPDATE_PHOTO,
+    TG_UPDATE_DOCUMENT,
+    TG_UPDATE_ANIMATION,   // GIFs; usually re-encoded to MP4 by Telegram
+    TG_UPDATE_OTHER
+};
+
+// Type of the first message entity, if any
+enum TelegramEntityType : uint8_t {
+    TG_ENTITY_NONE,
+    TG_ENTITY_BOT_COMMAND,
+    TG_ENTITY_URL,
+    TG_ENTITY_OTHER
+};
+
+struct TelegramUpdate {
+    int64_t updateId;
+    int64_t chatId;
+    TelegramUpdateType type;
+    TelegramEntityType entity;
+    uint16_t textLen;
+    char text[TG_MAX_TEXT];
+    char fromName[TG_MAX_NAME];
+    char fileId[TG_MAX_FILE_ID];     // Best-fit PhotoSize or document
+    char fileName[TG_MAX_FILE_NAME]; // Documents and animations only
+    char mimeType[TG_MAX_MIME];      // Likewise
+};
+
+// ============================================================
+// BOUNDED STREAM
+// ============================================================
+
+// Exposes at most 'limit' bytes of another stream, so a parser can
+// never read into the next keep-alive response
+class BoundedStream : public Stream {
+public:
+    BoundedStream(Stream& inner, long limit) : _inner(inner), _remaining(limit) {}
+
+    int available() override {
+        if (_remaining <= 0) return 0;
+        int n = _inner.available();
+        return (n > _remaining) ? (int)_remaining : n;
+    }
+
+    int read() override {
+        if (_remaining <= 0) return -1;
+        int c = _inner.read();
+        if (c >= 0) _remaining--;
+        return c;
+    }
+
+    int peek() override {
+        return (_remaining > 0) ? _inner.peek() : -1;
+    }
+
+    size_t write(uint8_t) override {
+        return 0;
+    }
+
+    void flush() override {}
+
+    // Read and discard whatever is left of the body
+    void drain() {
+        unsigned long start = millis();
+        while (_remaining > 0 && millis() - start < TELEGRAM_READ_TIMEOUT) {
+            if (read() < 0) delay(1);
+        }
+    }
+
+    long remaining() const {
+        return _remaining;
+    }
+
+private:
+    Stream& _inner;
+    long _remaining;
+};
+
+// ============================================================
+// TELEGRAM CLIENT CLASS
+// ============================================================
+
+class TelegramClient {
+public:
+    TelegramClient(const char* token, WiFiClientSecure& client) :
+        _token(token),
+        _client(client),
+        _lastUpdateId(0),
+        _closeAfter(false),
+        _photoMinW(0),
+        _photoMinH(0) {
+    }
+
+    // Photo sizes smaller than this are skipped when a larger one exists
+    void setPhotoMinSize(int w, int h) {
+        _photoMinW = w;
+        _photoMinH = h;
+    }
+
+    // Fetch pending updates (offset = last seen + 1). Returns the number
+    // stored in 'out', at most 'max'.
+    int getUpdates(TelegramUpdate* out, int max) {
+        TRACE_SCOPE("telegram", "getUpdates");
+        char path[96];
+        snprintf(path, sizeof(path), "getUpdates?offset=%lld&limit=%d",
+                 (long long)(_lastUpdateId + 1), max);
+
+        long contentLength;
+        if (!request("GET", path, nullptr, 0, contentLength)) return 0;
+
+        BoundedStream body(_client, contentLength);
+        body.setTimeout(TELEGRAM_READ_TIMEOUT);
+
+        JsonDocument filter;
+        filter["update_id"] = true;
+        JsonObject m = filter["message"].to<JsonObject>();
+        m["chat"]["id"] = true;
+        m["from"]["first_name"] = true;
+        m["text"] = true;
+        m["entities"][0]["type"] = true;
+        m["photo"][0]["file_id"] = true;
+        m["photo"][0]["width"] = true;
+        m["photo"][0]["height"] = true;
+        m["document"]["file_id"] = true;
+        m["document"]["file_name"] = true;
+        m["document"]["mime_type"] = true;
+        m["animation"]["file_id"] = true;
+        m["animation"]["file_name"] = true;
+        m["animation"]["mime_type"] = true;
+
+        // Walk {"ok":true,"result":[{...},{...}]} one element at a time
+        int n = 0;
+        if (body.find("\"result\":[")) {
+            JsonDocument doc;
+            do {
+                if (deserializeJson(doc, body, DeserializationOption::Filter(filter))) break;
+
+                int64_t updateId = doc["update_id"].as<int64_t>();
+                if (updateId > _lastUpdateId) _lastUpdateId = updateId;
+
+                JsonObject message = doc["message"];
+                if (n < max && !message.isNull()) {
+                    fillUpdate(out[n], updateId, message);
+                    n++;
+                }
+            } while (body.findUntil(",", "]"));
+        }
+
+        endResponse(body);
+        return n;
+    }
+
+    bool sendMessage(int64_t chatId, const char* text) {
+        TRACE_SCOPE("telegram", "sendMessage");
+        JsonDocument doc;
+        doc["chat_id"] = chatId;
+        doc["text"] = text;
+
+        char body[TG_MAX_BODY];
+        size_t len = serializeJson(doc, body, sizeof(body));
+        if (len == 0 || len >= sizeof(body) - 1) {
+            LOG_W(LOG_TG, "[TG] sendMessage body too large");
+            return false;
+        }
+
+        long contentLength;
+        if (!request("POST", "sendMessage", body, len, contentLength)) return false;
+
+        BoundedStream resp(_client, contentLength);
+        endResponse(resp);
+        return true;
+    }
+
+    // Resolve a file_id to its file_path (relative to the file endpoint)
+    bool getFile(const char* fileId, char* pathOut, size_t pathLen) {
+        TRACE_SCOPE("telegram", "getFile");
+        char path[160];
+        snprintf(path, sizeof(path), "getFile?file_id=%s", fileId);
+
+        long contentLength;
+        if (!request("GET", path, nullptr, 0, contentLength)) return false;
+
+        BoundedStream body(_client, contentLength);
+        body.setTimeout(TELEGRAM_READ_TIMEOUT);
+
+        JsonDocument filter;
+        filter["result"]["file_path"] = true;
+        JsonDocument doc;
+        DeserializationError err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+        endResponse(body);
+
+        const char* filePath = doc["result"]["file_path"];
+        if (err || !filePath) return false;
+        strlcpy(pathOut, filePath, pathLen);
+        return true;
+    }
+
+    // Fetch the bot's username (without '@')
+    bool getMe(char* usernameOut, size_t len) {
+        long contentLength;
+        if (!request("GET", "getMe", nullptr, 0, contentLength)) return false;
+
+        BoundedStream body(_client, contentLength);
+        body.setTimeout(TELEGRAM_READ_TIMEOUT);
+
+        JsonDocument filter;
+        filter["result"]["username"] = true;
+        JsonDocument doc;
+        DeserializationError err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+        endResponse(body);
+
+        const char* username = doc["result"]["username"];
+        if (err || !username) return false;
+        strlcpy(usernameOut, username, len);
+        return true;
+    }
+
+    int64_t lastUpdateId() const {
+        return _lastUpdateId;
+    }
+
+private:
+    const char* _token;
+    WiFiClientSecure& _client;
+    int64_t _lastUpdateId;
+    bool _closeAfter;      // Server won't keep the connection open
+    int _photoMinW;
+    int _photoMinH;
+
+    // Consume the rest of a response so the connection can be reused
+    void endResponse(BoundedStream& body) {
+        if (_closeAfter) {
+            _client.stop();
+            _closeAfter = false;
+            return;
+        }
+        body.drain();
+    }
+
+    bool ensureConnected() {
+        if (_client.connected()) return true;
+        _client.stop();
+        TRACE_BEGIN("net", "tlsHandshake");
+        bool ok = _client.connect(TELEGRAM_API_HOST, TELEGRAM_API_PORT);
+        TRACE_END("net", "tlsHandshake");
+        if (!ok) {
+            LOG_W(LOG_TG, "[TG] Connect failed");
+            return false;
+        }
+        return true;
+    }
+
+    // Send a request on the kept-alive connection and read the response
+    // headers. On success the body (contentLength bytes) is next on _client.
+    bool request(const char* method, const char* path, const char* body, size_t bodyLen,
+                 long& contentLength) {
+        // A stale keep-alive socket only shows up on first use: retry once,
+        // but only if the server can't have acted on the request. A failed
+        // write never reached it whole; a GET the socket closed on without
+        // a byte of response is safe to repeat. A POST that went out in
+        // full is never sent twice.
+        bool idempotent = body == nullptr;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (!ensureConnected()) return false;
+
+            char header[320];
+            int n = snprintf(header, sizeof(header),
+                             "%s /bot%s/%s HTTP/1.0\r\n"
+                             "Host: " TELEGRAM_API_HOST "\r\n"
+                             "Connection: keep-alive\r\n",
+                             method, _token, path);
+            if (body) {
+                n += snprintf(header + n, sizeof(header) - n,
+                              "Content-Type: application/json\r\n"
+                              "Content-Length: %u\r\n", (unsigned)bodyLen);
+            }
+            n += snprintf(header + n, sizeof(header) - n, "\r\n");
+            if (n >= (int)sizeof(header)) return false;
+
+            bool sent = _client.write((const uint8_t*)header, n) == (size_t)n;
+            if (sent && body) sent = _client.write((const uint8_t*)body, bodyLen) == bodyLen;
+            if (!sent) {
+                _client.stop();
+                continue;
+            }
+
+            int status = 0;
+            bool responded = false;
+            if (readHeaders(status, contentLength, responded)) {
+                if (status == 200) return true;
+                LOG_W(LOG_TG, "[TG] %s -> HTTP %d", path, status);
+                BoundedStream rest(_client, contentLength);
+                endResponse(rest);
+                return false;
+            }
+            bool closed = !_client.connected();
+            _client.stop();
+            if (responded || !closed || !idempotent) {
+                LOG_W(LOG_TG, "[TG] %s: no valid response%s", path, closed ? "" : " (timeout)");
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // One line without its CR/LF. A line longer than the buffer is read
+    // to its end and flagged, so its tail can't pose as the next line.
+    static size_t readLine(Stream& in, char* line, size_t size, bool& overlong) {
+        size_t len = in.readBytesUntil('\n', line, size - 1);
+        overlong = len == size - 1;
+        if (overlong) in.find("\n");
+        line[len] = '\0';
+        if (len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+        return len;
+    }
+
+    // 'responded' is set once any byte of the status line has arrived
+    bool readHeaders(int& status, long& contentLength, bool& responded) {
+        char line[128];
+        status = 0;
+        contentLength = -1;
+        bool keepAlive = false;
+        bool overlong;
+
+        // Through Stream: WiFiClient::setTimeout() takes seconds, not ms
+        Stream& in = _client;
+        unsigned long oldTimeout = in.getTimeout();
+        in.setTimeout(TELEGRAM_READ_TIMEOUT);
+
+        size_t len = readLine(in, line, sizeof(line), overlong);
+        responded = len > 0 || overlong;
+        if (len == 0 || sscanf(line, "HTTP/%*d.%*d %d", &status) != 1) {
+            in.setTimeout(oldTimeout);
+            return false;
+        }
+
+        while (true) {
+            len = readLine(in, line, sizeof(line), overlong);
+            if (overlong) continue;  // Nothing we parse is that long
+            if (len == 0) break;     // End of headers
+
+            if (strncasecmp(line, "Content-Length:", 15) == 0) {
+                contentLength = atol(line + 15);
+            } else if (strncasecmp(line, "Connection:", 11) == 0) {
+                keepAlive = strcasestr(line + 11, "keep-alive") != nullptr;
+            }
+        }
+        in.setTimeout(oldTimeout);
+
+        if (contentLength < 0) {
+            // No length: body runs to connection close, don't reuse the socket
+            contentLength = 0x7FFFFFFF;
+            keepAlive = false;
+        }
+        if (!keepAlive) _closeAfter = true;
+        return true;
+    }
+
+    void fillUpdate(TelegramUpdate& u, int64_t updateId, JsonObject message) {
+        u.updateId = updateId;
+        u.chatId = message["chat"]["id"].as<int64_t>();
+        strlcpy(u.fromName, message["from"]["first_name"] | "", sizeof(u.fromName));
+        const char* text = message["text"] | "";
+        size_t textLen = strlen(text);
+        if (textLen >= sizeof(u.text)) {
+            LOG_W(LOG_TG, "[TG] Message text cut from %u bytes", (unsigned)textLen);
+            textLen = utf8Trim(text, sizeof(u.text) - 1);
+        }
+        memcpy(u.text, text, textLen);
+        u.text[textLen] = '\0';
+        u.textLen = textLen;
+        u.fileId[0] = '\0';
+        u.fileName[0] = '\0';
+        u.mimeType[0] = '\0';
+
+        const char* entity = message["entities"][0]["type"];
+        if (!entity) u.entity = TG_ENTITY_NONE;
+        else if (!strcmp(entity, "bot_command")) u.entity = TG_ENTITY_BOT_COMMAND;
+        else if (!strcmp(entity, "url") || !strcmp(entity, "text_link")) u.entity = TG_ENTITY_URL;
+        else u.entity = TG_ENTITY_OTHER;
+
+        // Photo sizes come smallest first: take the first that covers the
+        // requested size, otherwise the largest available
+        JsonArray photos = message["photo"];
+        if (photos.size() > 0) {
+            u.type = TG_UPDATE_PHOTO;
+            strlcpy(u.fileId, photos[photos.size() - 1]["file_id"] | "", sizeof(u.fileId));
+            for (JsonObject size : photos) {
+                if (size["width"].as<int>() >= _photoMinW && size["height"].as<int>() >= _photoMinH) {
+                    strlcpy(u.fileId, size["file_id"] | "", sizeof(u.fileId));
+                    break;
+                }
+            }
+        } else if (!message["animation"].isNull() || !message["document"].isNull()) {
+            // Animations also carry a copy as "document"; the animation wins
+            bool animation = !message["animation"].isNull();
+            JsonObject file = message[animation ? "animation" : "document"];
+            u.type = animation ? TG_UPDATE_ANIMATION : TG_UPDATE_DOCUMENT;
+            strlcpy(u.fileId, file["file_id"] | "", sizeof(u.fileId));
+            strlcpy(u.fileName, file["file_name"] | "", sizeof(u.fileName));
+            strlcpy(u.mimeType, file["mime_type"] | "", sizeof(u.mimeType));
+        } else {
+            u.type = message["text"].isNull() ? TG_UPDATE_OTHER : TG_UPDATE_TEXT;
+        }
+    }
+};
+
+#endif // TELEGRAM_CLIENT_H
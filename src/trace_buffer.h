@@ -0,0 +1,306 @@
+/*
+ * =====================================================
+ * EVENT TRACE BUFFER FOR FRIYAY FOREVER
+ * =====================================================
+ *
+ * Records begin/end events for drawing, JPEG decode, TLS handshakes,
+ * Telegram polling, OTA writes and touch into a binary ring buffer in
+ * PSRAM, and exports the most recent ones as Chrome trace JSON. Load
+ * the file in https://ui.perfetto.dev (or chrome://tracing) to see how
+ * the subsystems interleave.
+ *
+ * Enabled only in the esp32s3_trace environment (-DTRACE_BUFFER). In
+ * normal builds the TRACE_* macros compile to nothing.
+ *
+ * Usage:
+ * - TRACE_SCOPE("cat", "name") at the top of a block traces the rest
+ *   of it; TRACE_BEGIN/TRACE_END for spans that don't fit a scope
+ * - TRACE_INSTANT("cat", "name") marks a single moment
+ * - traceThreadName("name") once in a task labels its track; a task
+ *   re-created under the same name (the OTA workers) reuses its slot
+ *
+ * Export:
+ * - GET http://<device ip>/trace streams the JSON (WebServer in loop())
+ * - /trace in Telegram replies with that URL; "/trace serial" writes
+ *   the JSON to Serial between "[TRACE] BEGIN" / "[TRACE] END" lines
+ *
+ * Writers never block or lock: each event claims a slot with one
+ * atomic increment, so any task (or core) can trace. A slot is stamped
+ * with its sequence number last; the exporter skips slots that are
+ * being rewritten while it reads them. Names and categories must be
+ * string literals: only the pointers are stored.
+ */
+
+#ifndef TRACE_BUFFER_H
+#define TRACE_BUFFER_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <stdarg.h>
+#include <atomic>
+
+// ============================================================
+// CONFIGURATION
+// ============================================================
+
+#define TRACE_CAPACITY     16384  // Events kept (power of two), 24 B each on device
+#define TRACE_MAX_THREADS  8      // Named tracks
+#define TRACE_CHUNK        1024   // Export write size
+
+#ifdef TRACE_BUFFER
+
+// ============================================================
+// CLASS
+// ============================================================
+
+class TraceBuffer {
+public:
+    // Receives export output; 'ctx' is passed through
+    typedef void (*Sink)(void* ctx, const char* data, size_t len);
+
+    TraceBuffer() : _events(nullptr), _head(0), _paused(false) {}
+
+    void begin() {
+        _events = (Event*)heap_caps_calloc(TRACE_CAPACITY, sizeof(Event),
+                                           MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!_events) {
+            Serial.println("[TRACE] No PSRAM for the trace buffer, tracing off");
+            return;
+        }
+        nameThread("loop");
+        Serial.printf("[TRACE] %d events, %u KB PSRAM\n", TRACE_CAPACITY,
+                      (unsigned)(TRACE_CAPACITY * sizeof(Event) / 1024));
+    }
+
+    void record(char phase, const char* cat, const char* name) {
+        if (!_events || _paused) return;
+        uint32_t seq = _head.fetch_add(1, std::memory_order_relaxed);
+        Event& e = _events[seq & (TRACE_CAPACITY - 1)];
+
+        // Invalidate, fill, then publish the stamp
+        e.stamp.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        e.us = micros();
+        e.cat = cat;
+        e.name = name;
+        e.thread = xTaskGetCurrentTaskHandle();
+        e.phase = phase;
+        e.stamp.store(seq + 1, std::memory_order_release);
+    }
+
+    // Labels the calling task's track; call once per task. Slots are
+    // keyed by name and claimed with a CAS, so tasks can register
+    // concurrently and a re-created task takes over its old slot.
+    void nameThread(const char* name) {
+        TaskHandle_t self = xTaskGetCurrentTaskHandle();
+        for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+            Thread& t = _threads[i];
+            const char* owner = t.name.load(std::memory_order_acquire);
+            if (!owner && t.name.compare_exchange_strong(owner, name, std::memory_order_acq_rel)) {
+                owner = name;
+            }
+            if (owner == name || strcmp(owner, name) == 0) {
+                t.handle.store(self, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    uint32_t recorded() const { return _head.load(std::memory_order_relaxed); }
+    uint32_t available() const { return min(recorded(), (uint32_t)TRACE_CAPACITY); }
+
+    // Writes the buffered events as Chrome trace JSON, oldest first.
+    // Recording pauses meanwhile so the export doesn't trace itself.
+    void exportJson(Sink sink, void* ctx) {
+        if (!_events) return;
+        _paused = true;
+
+        Writer out(sink, ctx);
+        out.printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        out.printf("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"friyay\"}}");
+        for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+            const char* name = _threads[i].name.load(std::memory_order_acquire);
+            TaskHandle_t handle = _threads[i].handle.load(std::memory_order_acquire);
+            if (!name || !handle) continue;  // Free, or claimed but not yet bound
+            out.printf(",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%lu,"
+                       "\"args\":{\"name\":\"%s\"}}",
+                       threadId(handle), name);
+        }
+
+        // A full buffer has lost the begin of some spans: per track,
+        // drop ends that have no begin left
+        TaskHandle_t tracks[TRACE_MAX_THREADS];
+        int depth[TRACE_MAX_THREADS];
+        int trackCount = 0;
+
+        uint32_t head = recorded();
+        uint32_t first = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+        uint64_t clock = 0;
+        uint32_t lastUs = 0;
+        bool started = false;
+        uint32_t written = 0, skipped = 0;
+
+        for (uint32_t seq = first; seq != head; seq++) {
+            Event copy;
+            if (!read(seq, copy)) {
+                skipped++;
+                continue;
+            }
+
+            // micros() wraps every ~71 minutes; events from other tasks
+            // can also land slightly out of order, hence the signed step
+            if (!started) {
+                started = true;
+                lastUs = copy.us;
+            }
+            clock += (int64_t)(int32_t)(copy.us - lastUs);
+            lastUs = copy.us;
+
+            int t = 0;
+            while (t < trackCount && tracks[t] != copy.thread) t++;
+            if (t == trackCount) {
+                if (trackCount == TRACE_MAX_THREADS) {
+                    skipped++;
+                    continue;
+                }
+                tracks[t] = copy.thread;
+                depth[t] = 0;
+                trackCount++;
+            }
+            if (copy.phase == 'B') depth[t]++;
+            if (copy.phase == 'E') {
+                if (depth[t] == 0) {
+                    skipped++;
+                    continue;
+                }
+                depth[t]--;
+            }
+
+            out.printf(",\n{\"ph\":\"%c\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":1,\"tid\":%lu,"
+                       "\"ts\":%llu%s}",
+                       copy.phase, copy.cat, copy.name, threadId(copy.thread),
+                       (unsigned long long)clock, copy.phase == 'i' ? ",\"s\":\"t\"" : "");
+            written++;
+        }
+
+        out.printf("\n],\"otherData\":{\"events\":%lu,\"skipped\":%lu,\"recorded\":%lu}}\n",
+                   (unsigned long)written, (unsigned long)skipped, (unsigned long)head);
+        out.flush();
+        _paused = false;
+    }
+
+    void clear() {
+        _head.store(0, std::memory_order_relaxed);
+        if (_events) {
+            for (uint32_t i = 0; i < TRACE_CAPACITY; i++) {
+                _events[i].stamp.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Event {
+        std::atomic<uint32_t> stamp;  // Sequence + 1 once complete, 0 while written
+        uint32_t us;
+        const char* cat;
+        const char* name;
+        TaskHandle_t thread;
+        char phase;  // 'B', 'E' or 'i'
+    };
+
+    struct Thread {
+        std::atomic<const char*> name;       // Set once, by the first claimer
+        std::atomic<TaskHandle_t> handle;    // Latest task with that name
+    };
+
+    // Batches small writes into TRACE_CHUNK-sized sink calls
+    class Writer {
+    public:
+        Writer(Sink sink, void* ctx) : _sink(sink), _ctx(ctx), _len(0) {}
+
+        void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+            char line[256];
+            va_list args;
+            va_start(args, fmt);
+            int n = vsnprintf(line, sizeof(line), fmt, args);
+            va_end(args);
+            if (n <= 0) return;
+            if (n >= (int)sizeof(line)) n = sizeof(line) - 1;
+            if (_len + n > sizeof(_buf)) flush();
+            memcpy(_buf + _len, line, n);
+            _len += n;
+        }
+
+        void flush() {
+            if (_len) _sink(_ctx, _buf, _len);
+            _len = 0;
+        }
+
+    private:
+        Sink _sink;
+        void* _ctx;
+        char _buf[TRACE_CHUNK];
+        size_t _len;
+    };
+
+    Event* _events;
+    std::atomic<uint32_t> _head;
+    volatile bool _paused;
+    Thread _threads[TRACE_MAX_THREADS] = {};
+
+    // Copies one slot; false if it was overwritten or is mid-write
+    bool read(uint32_t seq, Event& copy) const {
+        const Event& e = _events[seq & (TRACE_CAPACITY - 1)];
+        if (e.stamp.load(std::memory_order_acquire) != seq + 1) return false;
+        copy.us = e.us;
+        copy.cat = e.cat;
+        copy.name = e.name;
+        copy.thread = e.thread;
+        copy.phase = e.phase;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return e.stamp.load(std::memory_order_relaxed) == seq + 1;
+    }
+
+    static unsigned long threadId(TaskHandle_t handle) {
+        return (unsigned long)((uintptr_t)handle & 0xFFFFFFFFUL);
+    }
+};
+
+static TraceBuffer traceBuffer;
+
+// Traces one scope as a begin/end pair
+class TraceScope {
+public:
+    TraceScope(const char* cat, const char* name) : _cat(cat), _name(name) {
+        traceBuffer.record('B', cat, name);
+    }
+    ~TraceScope() { traceBuffer.record('E', _cat, _name); }
+
+private:
+    const char* _cat;
+    const char* _name;
+};
+
+inline void traceBegin() { traceBuffer.begin(); }
+inline void traceThreadName(const char* name) { traceBuffer.nameThread(name); }
+
+#define TRACE_CONCAT_(a, b)          a##b
+#define TRACE_CONCAT(a, b)           TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(cat, name)       TraceScope TRACE_CONCAT(_traceScope, __LINE__)(cat, name)
+#define TRACE_BEGIN(cat, name)       traceBuffer.record('B', cat, name)
+#define TRACE_END(cat, name)         traceBuffer.record('E', cat, name)
+#define TRACE_INSTANT(cat, name)     traceBuffer.record('i', cat, name)
+
+#else
+
+inline void traceBegin() {}
+inline void traceThreadName(const char* name) { (void)name; }
+
+#define TRACE_SCOPE(cat, name)
+#define TRACE_BEGIN(cat, name)
+#define TRACE_END(cat, name)
+#define TRACE_INSTANT(cat, name)
+
+#endif // TRACE_BUFFER
+
+#endif // TRACE_BUFFER_H
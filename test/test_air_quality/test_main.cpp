@@ -0,0 +1,80 @@
+/*
+ * AirQuality: calibrating on a reading puts that reading at outdoor CO2,
+ * and both meter levels stay 0-10 whatever the inputs do.
+ *
+ *   pio test -e native_test -f test_air_quality
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "air_quality.h"
+
+// Volts from a dead input to past the rails
+static const float EXTREMES[] = {-1.0f, 0.0f, 0.01f, 0.5f, 2.5f, 4.99f, 5.0f, 12.0f};
+#define EXTREME_COUNT (sizeof(EXTREMES) / sizeof(EXTREMES[0]))
+
+void test_calibrated_reading_is_outdoor_co2() {
+    static const float VOLTS[] = {0.3f, 1.0f, 2.2f, 4.0f};
+    for (float v : VOLTS) {
+        AirQuality aq;
+        aq.setNdir(false);
+        aq.setR0(AirQuality::calibrate(v));
+        aq.update(v, 0.0f);
+        TEST_ASSERT_FLOAT_WITHIN(2.0f, CO2_OUTDOOR_PPM, aq.co2Ppm());
+        TEST_ASSERT_EQUAL_INT(10, aq.co2Level());
+        TEST_ASSERT_EQUAL_INT(10, aq.aqiLevel());
+    }
+}
+
+void test_uncalibrated_keeps_default_r0() {
+    AirQuality aq;
+    aq.setR0(0);
+    TEST_ASSERT_EQUAL_UINT32(MQ135_DEFAULT_R0, aq.r0());
+}
+
+void test_mq135_levels_clamped() {
+    for (size_t i = 0; i < EXTREME_COUNT; i++) {
+        AirQuality aq;
+        aq.update(EXTREMES[i], 0.0f);
+        TEST_ASSERT_INT_WITHIN(5, 5, aq.aqiLevel());
+        TEST_ASSERT_INT_WITHIN(5, 5, aq.co2Level());
+        TEST_ASSERT_INT_WITHIN(50, 50, aq.aqiTenths());
+    }
+    AirQuality aq;
+    aq.update(MQ135_SUPPLY_V, 0.0f);  // Rs = 0
+    TEST_ASSERT_EQUAL_INT(0, aq.aqiLevel());
+    TEST_ASSERT_EQUAL_INT(0, aq.co2Level());
+}
+
+void test_ndir_levels_clamped() {
+    for (size_t i = 0; i < EXTREME_COUNT; i++) {
+        AirQuality aq;
+        aq.setNdir(true);
+        aq.update(1.0f, EXTREMES[i]);
+        TEST_ASSERT_INT_WITHIN(5, 5, aq.co2Level());
+        TEST_ASSERT_FLOAT_WITHIN(CO2_RANGE_PPM / 2, CO2_RANGE_PPM / 2, aq.co2Ppm());
+    }
+}
+
+void test_ndir_mapping() {
+    AirQuality aq;
+    aq.setNdir(true);
+    aq.update(1.0f, CO2_ZERO_V + CO2_SPAN_V * CO2_OUTDOOR_PPM / CO2_RANGE_PPM);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, CO2_OUTDOOR_PPM, aq.co2Ppm());
+    TEST_ASSERT_EQUAL_INT(10, aq.co2Level());
+    aq.update(1.0f, CO2_ZERO_V + CO2_SPAN_V);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, CO2_RANGE_PPM, aq.co2Ppm());
+    TEST_ASSERT_EQUAL_INT(0, aq.co2Level());
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_calibrated_reading_is_outdoor_co2);
+    RUN_TEST(test_uncalibrated_keeps_default_r0);
+    RUN_TEST(test_mq135_levels_clamped);
+    RUN_TEST(test_ndir_levels_clamped);
+    RUN_TEST(test_ndir_mapping);
+    exit(UNITY_END());
+}
+
+void loop() {}
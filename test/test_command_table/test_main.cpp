@@ -0,0 +1,168 @@
+/*
+ * Command table: parsing and lookup, plus a dispatch throughput
+ * micro-benchmark against the toLowerCase()/strstr() chain it replaced.
+ * The table mirrors COMMANDS in main.cpp; the numbers are printed, not
+ * asserted, since they depend on the host.
+ *
+ *   pio test -e native_test -f test_command_table -v
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "command_table.h"
+
+static int hits[8];
+static void onCommit(const CommandContext&) { hits[0]++; }
+static void onUncommit(const CommandContext&) { hits[1]++; }
+static void onHelp(const CommandContext&) { hits[2]++; }
+static void onStatus(const CommandContext&) { hits[3]++; }
+static void onOther(const CommandContext&) { hits[4]++; }
+
+constexpr CommandEntry TABLE[] = {
+    {"/calibrate", onOther,    CMD_FRIENDS_ONLY},
+    {"/commit",    onCommit,   CMD_FRIENDS_ONLY | CMD_ANYWHERE},
+    {"/heap",      onOther,    0},
+    {"/help",      onHelp,     0},
+    {"/history",   onOther,    0},
+    {"/install",   onOther,    0},
+    {"/log",       onOther,    0},
+    {"/perf",      onOther,    0},
+    {"/start",     onHelp,     0},
+    {"/status",    onStatus,   0},
+    {"/trace",     onOther,    0},
+    {"/uncommit",  onUncommit, CMD_FRIENDS_ONLY | CMD_ANYWHERE},
+    {"/update",    onOther,    0},
+    {"/version",   onOther,    0},
+    {"/weather",   onOther,    0},
+    {"bail",       onUncommit, CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+    {"commit",     onCommit,   CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+    {"in",         onCommit,   CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+    {"out",        onUncommit, CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+    {"riding",     onCommit,   CMD_FRIENDS_ONLY | CMD_WHOLE_MESSAGE},
+};
+COMMAND_TABLE_SORTED(TABLE);
+#define TABLE_COUNT (sizeof(TABLE) / sizeof(TABLE[0]))
+
+// Same steps as dispatchCommand() in main.cpp
+static bool dispatch(const char* text, int fIdx) {
+    CommandContext ctx;
+    StrView word = splitCommand(text, &ctx.args);
+    const CommandEntry* cmd = fIdx >= 0 ? findCommandAnywhere(TABLE, TABLE_COUNT, text) : nullptr;
+    if (cmd) ctx.args = StrView();
+    else cmd = findCommand(TABLE, TABLE_COUNT, word);
+    if (!cmd) return false;
+    if ((cmd->flags & CMD_WHOLE_MESSAGE) && !ctx.args.empty()) return false;
+    if ((cmd->flags & CMD_FRIENDS_ONLY) && fIdx < 0) return false;
+    ctx.chatId = 1;
+    ctx.friendIdx = fIdx;
+    cmd->handler(ctx);
+    return true;
+}
+
+// The pre-table chain: lowercase copy, then one compare per command
+static bool dispatchChain(const char* text, int fIdx) {
+    char t[256];
+    snprintf(t, sizeof(t), "%s", text);
+    for (char* p = t; *p; p++) *p = tolower(*p);
+    if (fIdx >= 0) {
+        if (strstr(t, "/commit") || !strcmp(t, "in") || !strcmp(t, "commit") || !strcmp(t, "riding")) return true;
+        if (strstr(t, "/uncommit") || !strcmp(t, "out") || !strcmp(t, "bail")) return true;
+    }
+    static const char* const EXACT[] = {"/help", "/status", "/heap", "/perf", "/trace", "/log", "/weather",
+                                        "/version", "/update", "/install", "/calibrate", "/history"};
+    if (!strncmp(t, "/start", 6)) return true;
+    for (const char* c : EXACT) {
+        if (!strcmp(t, c)) return true;
+    }
+    return false;
+}
+
+static void resetHits() {
+    memset(hits, 0, sizeof(hits));
+}
+
+// ============================================================
+// TESTS
+// ============================================================
+
+void test_split_trims_crlf() {
+    StrView args;
+    StrView word = splitCommand("\r\n /log\r\ntg debug\r\n", &args);
+    TEST_ASSERT_EQUAL_INT(0, word.compareNoCase("/log"));
+    TEST_ASSERT_EQUAL_INT(0, args.compareNoCase("tg debug"));
+}
+
+void test_whole_message_alias_with_cr() {
+    resetHits();
+    TEST_ASSERT_TRUE(dispatch("In\r\n", 0));
+    TEST_ASSERT_FALSE(dispatch("in later", 0));
+    TEST_ASSERT_FALSE(dispatch("in", -1));
+    TEST_ASSERT_EQUAL_INT(1, hits[0]);
+}
+
+void test_bot_suffix_and_case() {
+    resetHits();
+    TEST_ASSERT_TRUE(dispatch("/STATUS@friyay_bot", -1));
+    TEST_ASSERT_TRUE(dispatch("/start unit3", -1));
+    TEST_ASSERT_EQUAL_INT(1, hits[3]);
+    TEST_ASSERT_EQUAL_INT(1, hits[2]);
+}
+
+void test_commit_anywhere() {
+    resetHits();
+    TEST_ASSERT_TRUE(dispatch("see you there /Commit", 0));
+    TEST_ASSERT_TRUE(dispatch("sorry /uncommit", 0));
+    TEST_ASSERT_TRUE(dispatch("/status /commit", 0));  // Commit first, like the old chain
+    TEST_ASSERT_FALSE(dispatch("see you there /commit", -1));
+    TEST_ASSERT_EQUAL_INT(2, hits[0]);
+    TEST_ASSERT_EQUAL_INT(1, hits[1]);
+    TEST_ASSERT_EQUAL_INT(0, hits[3]);
+}
+
+void test_not_a_command() {
+    TEST_ASSERT_FALSE(dispatch("", 0));
+    TEST_ASSERT_FALSE(dispatch("   ", 0));
+    TEST_ASSERT_FALSE(dispatch("/nope", 0));
+    TEST_ASSERT_FALSE(dispatch("commitment issues", 0));
+}
+
+void test_dispatch_throughput() {
+    static const char* const MESSAGES[] = {
+        "/status", "/help", "in", "out", "/weather", "/commit", "/update@friyay_bot",
+        "See everyone at the lift at 9!", "https://open.spotify.com/track/4uLU6hMCjMI75M1A2tKUQC",
+        "/log tg debug", "riding", "anyone up for night skiing friday? /commit",
+    };
+    const int count = sizeof(MESSAGES) / sizeof(MESSAGES[0]);
+    const int rounds = 200000;
+    char line[96];
+
+    typedef bool (*Dispatch)(const char*, int);
+    const Dispatch impls[] = {dispatch, dispatchChain};
+    const char* const names[] = {"table", "chain"};
+    for (int k = 0; k < 2; k++) {
+        int matched = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            for (int m = 0; m < count; m++) matched += impls[k](MESSAGES[m], m & 1 ? 0 : -1);
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        snprintf(line, sizeof(line), "%s: %.2f M messages/s, %.1f ns each (%d matched)", names[k],
+                 rounds * count / s / 1e6, s * 1e9 / ((double)rounds * count), matched / rounds);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_GREATER_THAN(0, matched);
+    }
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_split_trims_crlf);
+    RUN_TEST(test_whole_message_alias_with_cr);
+    RUN_TEST(test_bot_suffix_and_case);
+    RUN_TEST(test_commit_anywhere);
+    RUN_TEST(test_not_a_command);
+    RUN_TEST(test_dispatch_throughput);
+    exit(UNITY_END());
+}
+
+void loop() {}
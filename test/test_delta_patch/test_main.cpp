@@ -0,0 +1,240 @@
+/*
+ * Delta OTA end to end on the host: patches made by tools/make_delta.py
+ * are inflated by GzipStream and applied by DeltaPatch, the way
+ * OTAUpdater does while flashing, and compared byte for byte with the
+ * target image. The compressed patch arrives in uneven pieces to cover
+ * headers and records split across network reads.
+ *
+ * The suite runs make_delta.py itself and is ignored if python3 can't:
+ *
+ *   pio test -e native_test -f test_delta_patch
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <MD5Builder.h>
+#include <vector>
+#include "gzip_stream.h"
+#include "delta_patch.h"
+
+#define DELTA_DIR  "/tmp/friyay_delta_test"
+
+typedef std::vector<uint8_t> Bytes;
+
+// ============================================================
+// HELPERS
+// ============================================================
+
+// Serves a buffer at most 'step' bytes per available(), like packets
+class PieceStream : public Stream {
+public:
+    PieceStream(const Bytes& data, size_t step) : _data(data), _pos(0), _step(step), _window(0) {}
+
+    int available() override {
+        if (_window == 0) _window = min(_step, _data.size() - _pos);
+        return (int)_window;
+    }
+    int read() override {
+        if (available() == 0) return -1;
+        _window--;
+        return _data[_pos++];
+    }
+    int peek() override { return available() ? _data[_pos] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    const Bytes& _data;
+    size_t _pos;
+    size_t _step;
+    size_t _window;
+};
+
+// Firmware-ish bytes: repeated words and noise, from a fixed seed
+static Bytes firmwareLike(size_t size, uint32_t seed) {
+    uint32_t x = seed * 2654435761u + 1;
+    auto next = [&x]() { x ^= x << 13; x ^= x >> 17; x ^= x << 5; return x; };
+    uint8_t words[32][16];
+    for (auto& w : words) {
+        for (auto& b : w) b = (uint8_t)next();
+    }
+    Bytes out;
+    while (out.size() < size) {
+        uint32_t r = next();
+        for (int i = 0; i < 16; i++) out.push_back(r & 1 ? words[(r >> 1) % 32][i] : (uint8_t)next());
+    }
+    out.resize(size);
+    return out;
+}
+
+// The next build: shifted addresses, an inserted block, scattered edits
+static Bytes edited(const Bytes& source) {
+    Bytes out = source;
+    for (size_t i = 1000; i < 3000 && i < out.size(); i += 4) out[i] += 4;
+    Bytes inserted = firmwareLike(600, 99);
+    out.insert(out.begin() + min((size_t)5000, out.size()), inserted.begin(), inserted.end());
+    for (size_t i = 7; i < out.size(); i += 997) out[i] ^= 0x5A;
+    return out;
+}
+
+static bool writeFile(const char* path, const Bytes& data) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static bool readFile(const char* path, Bytes& data) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[4096];
+    size_t n;
+    data.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+// Runs tools/make_delta.py; false if it could not
+static bool makeDelta(const Bytes& source, const Bytes& target, Bytes& patch) {
+    if (system("mkdir -p " DELTA_DIR) != 0) return false;
+    if (!writeFile(DELTA_DIR "/old.bin", source) || !writeFile(DELTA_DIR "/new.bin", target)) return false;
+    if (system("python3 tools/make_delta.py " DELTA_DIR "/old.bin " DELTA_DIR "/new.bin -o " DELTA_DIR
+               "/patch.gz > /dev/null") != 0) {
+        return false;
+    }
+    return readFile(DELTA_DIR "/patch.gz", patch);
+}
+
+static bool readSource(void* ctx, uint32_t offset, uint8_t* buf, size_t len) {
+    const Bytes* source = (const Bytes*)ctx;
+    if ((size_t)offset + len > source->size()) return false;
+    memcpy(buf, source->data() + offset, len);
+    return true;
+}
+
+static void md5(const Bytes& data, uint8_t out[16]) {
+    MD5Builder md;
+    md.begin();
+    md.add(data.data(), data.size());
+    md.calculate();
+    md.getBytes(out);
+}
+
+// Applies the patch as OTAUpdater does, reading 'chunk' bytes at a time
+static void applyAndCompare(const Bytes& source, const Bytes& target, size_t step, size_t chunk) {
+    Bytes patch;
+    if (!makeDelta(source, target, patch)) TEST_IGNORE_MESSAGE("tools/make_delta.py did not run (python3?)");
+
+    PieceStream net(patch, step);
+    net.setTimeout(100);
+    GzipStream gzip;
+    TEST_ASSERT_TRUE(gzip.begin(&net));
+    DeltaPatch delta;
+    delta.begin(&gzip, readSource, (void*)&source);
+
+    int header;
+    while ((header = delta.header()) == 0) {}
+    TEST_ASSERT_EQUAL_INT(1, header);
+    TEST_ASSERT_EQUAL_UINT32(source.size(), delta.sourceSize());
+    TEST_ASSERT_EQUAL_UINT32(target.size(), delta.targetSize());
+    uint8_t digest[16];
+    md5(source, digest);
+    TEST_ASSERT_EQUAL_MEMORY(digest, delta.sourceMd5(), 16);
+
+    Bytes out;
+    std::vector<uint8_t> buf(chunk);
+    int idle = 0;
+    while (!delta.done() && idle < 1000) {
+        int n = delta.read(buf.data(), buf.size());
+        TEST_ASSERT_TRUE_MESSAGE(n >= 0, "DeltaPatch rejected the patch");
+        out.insert(out.end(), buf.begin(), buf.begin() + n);
+        idle = n ? 0 : idle + 1;
+    }
+    TEST_ASSERT_TRUE(delta.done());
+    TEST_ASSERT_TRUE(gzip.finish());
+    TEST_ASSERT_EQUAL_UINT32(target.size(), out.size());
+    if (!target.empty()) TEST_ASSERT_EQUAL_MEMORY(target.data(), out.data(), target.size());
+    gzip.end();
+}
+
+// ============================================================
+// TESTS
+// ============================================================
+
+void test_next_build() {
+    Bytes source = firmwareLike(40000, 1);
+    applyAndCompare(source, edited(source), 1460, 4096);
+}
+
+void test_small_pieces() {
+    Bytes source = firmwareLike(12000, 2);
+    applyAndCompare(source, edited(source), 7, 333);
+}
+
+void test_unrelated_image() {
+    applyAndCompare(firmwareLike(9000, 3), firmwareLike(11000, 4), 512, 1000);
+}
+
+void test_short_targets() {
+    Bytes source = firmwareLike(3000, 5);
+    applyAndCompare(source, Bytes(), 64, 64);
+    applyAndCompare(source, Bytes(source.begin() + 100, source.begin() + 107), 64, 64);
+    applyAndCompare(source, Bytes(source.begin() + 100, source.begin() + 140), 3, 5);
+}
+
+// The device compares sourceMd5() with the running image before flashing
+void test_wrong_source_detected() {
+    Bytes source = firmwareLike(8000, 6);
+    Bytes patch;
+    if (!makeDelta(source, edited(source), patch)) TEST_IGNORE_MESSAGE("tools/make_delta.py did not run (python3?)");
+
+    PieceStream net(patch, 1460);
+    GzipStream gzip;
+    TEST_ASSERT_TRUE(gzip.begin(&net));
+    DeltaPatch delta;
+    delta.begin(&gzip, readSource, (void*)&source);
+    while (delta.header() == 0) {}
+
+    Bytes other = source;
+    other[100] ^= 0xFF;
+    uint8_t digest[16];
+    md5(other, digest);
+    TEST_ASSERT_TRUE(memcmp(digest, delta.sourceMd5(), 16) != 0);
+    gzip.end();
+}
+
+void test_not_a_patch() {
+    Bytes source = firmwareLike(2000, 7);
+    Bytes patch;
+    if (!makeDelta(source, source, patch)) TEST_IGNORE_MESSAGE("tools/make_delta.py did not run (python3?)");
+    // A plain gzip of an image: inflates fine but has no FYD1 magic
+    Bytes plain;
+    TEST_ASSERT_EQUAL_INT(0, system("gzip -c " DELTA_DIR "/new.bin > " DELTA_DIR "/plain.gz"));
+    TEST_ASSERT_TRUE(readFile(DELTA_DIR "/plain.gz", plain));
+
+    PieceStream net(plain, 1460);
+    GzipStream gzip;
+    TEST_ASSERT_TRUE(gzip.begin(&net));
+    DeltaPatch delta;
+    delta.begin(&gzip, readSource, (void*)&source);
+    int header;
+    while ((header = delta.header()) == 0) {}
+    TEST_ASSERT_EQUAL_INT(-1, header);
+    gzip.end();
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_next_build);
+    RUN_TEST(test_small_pieces);
+    RUN_TEST(test_unrelated_image);
+    RUN_TEST(test_short_targets);
+    RUN_TEST(test_wrong_source_detected);
+    RUN_TEST(test_not_a_patch);
+    int failures = UNITY_END();
+    int rc = system("rm -rf " DELTA_DIR);
+    (void)rc;
+    exit(failures);
+}
+
+void loop() {}
@@ -0,0 +1,79 @@
+/*
+ * FixedString truncation: a cut never splits a UTF-8 sequence, and the
+ * truncated flag sticks so later appends can't land after the gap.
+ *
+ *   pio test -e native_test -f test_fixed_string
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "fixed_string.h"
+
+// "✅" is 3 bytes, "🏂" is 4
+static const char* CHECK = "\xE2\x9C\x85";
+static const char* BOARD = "\xF0\x9F\x8F\x82";
+
+void test_fits_untouched() {
+    FixedString<8> s;
+    s.append(BOARD);
+    s.append("ab");
+    TEST_ASSERT_EQUAL_STRING("\xF0\x9F\x8F\x82" "ab", s.c_str());
+    TEST_ASSERT_FALSE(s.truncated());
+}
+
+void test_append_drops_split_code_point() {
+    for (size_t pad = 0; pad < 4; pad++) {
+        FixedString<8> s;  // 7 bytes of text
+        for (size_t i = 0; i < pad + 1; i++) s += 'x';
+        s.append(BOARD);
+        s.append(BOARD);
+        TEST_ASSERT_TRUE(s.truncated());
+        size_t expect = pad + 1 + (pad + 1 + 4 <= 7 ? 4 : 0);
+        TEST_ASSERT_EQUAL_UINT32(expect, s.length());
+        TEST_ASSERT_EQUAL_UINT32(expect, utf8Trim(s.c_str(), s.length()));
+    }
+}
+
+void test_appendf_drops_split_code_point() {
+    FixedString<6> s;  // 5 bytes: "a" + ✅ fits, the next ✅ doesn't
+    s.appendf("a%s%s", CHECK, CHECK);
+    TEST_ASSERT_TRUE(s.truncated());
+    TEST_ASSERT_EQUAL_STRING("a\xE2\x9C\x85", s.c_str());
+}
+
+void test_char_appends_drop_split_code_point() {
+    FixedString<4> s;
+    s += 'a';
+    for (const char* p = BOARD; *p; p++) s += *p;
+    TEST_ASSERT_TRUE(s.truncated());
+    TEST_ASSERT_EQUAL_STRING("a", s.c_str());
+}
+
+void test_truncation_sticks() {
+    FixedString<4> s;
+    s.append("ab");
+    s.append(CHECK);
+    s.append("c");
+    TEST_ASSERT_EQUAL_STRING("ab", s.c_str());
+}
+
+void test_utf8_trim() {
+    TEST_ASSERT_EQUAL_UINT32(0, utf8Trim("", 0));
+    TEST_ASSERT_EQUAL_UINT32(3, utf8Trim("abc", 3));
+    TEST_ASSERT_EQUAL_UINT32(1, utf8Trim("a\xE2\x9C", 3));
+    TEST_ASSERT_EQUAL_UINT32(4, utf8Trim("a\xE2\x9C\x85", 4));
+    TEST_ASSERT_EQUAL_UINT32(0, utf8Trim("\xF0\x9F\x8F", 3));
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fits_untouched);
+    RUN_TEST(test_append_drops_split_code_point);
+    RUN_TEST(test_appendf_drops_split_code_point);
+    RUN_TEST(test_char_appends_drop_split_code_point);
+    RUN_TEST(test_truncation_sticks);
+    RUN_TEST(test_utf8_trim);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,154 @@
+/*
+ * OTAFlashWriter verification: a fresh image is checked against MD5 and
+ * the SHA-256 hashed as it was written; a resumed one is read back from
+ * flash. A wrong digest on either path must keep the image from boot.
+ * Writes the native update slot (NATIVE_UPDATE_FILE, set here).
+ *
+ *   pio test -e native_test -f test_ota_flash_writer
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <MD5Builder.h>
+#include <vector>
+#include "ota_flash_writer.h"
+
+#define WRITER_SLOT   "/tmp/friyay_ota_writer.bin"
+#define WRITER_IMAGE  (3 * OTA_SECTOR_SIZE + 1000)
+#define WRITER_CHUNK  1500   // Not a sector multiple
+
+static std::vector<uint8_t> image;
+static String imageMd5, imageSha;
+static const char* WRONG_SHA = "0000000000000000000000000000000000000000000000000000000000000000";
+
+// ============================================================
+// HELPERS
+// ============================================================
+
+static String shaHex(const uint8_t* data, size_t len) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    mbedtls_sha256_update_ret(&ctx, data, len);
+    uint8_t digest[32];
+    mbedtls_sha256_finish_ret(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    char hex[65];
+    for (int i = 0; i < 32; i++) snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    return String(hex);
+}
+
+// Writes image[from, to) in WRITER_CHUNK pieces
+static bool writeRange(OTAFlashWriter& w, const std::vector<uint8_t>& data, uint32_t from, uint32_t to) {
+    for (uint32_t pos = from; pos < to; pos += WRITER_CHUNK) {
+        if (!w.write(data.data() + pos, min((uint32_t)WRITER_CHUNK, to - pos))) return false;
+    }
+    return true;
+}
+
+// Leaves the slot holding 'written' up to the second sector and returns
+// the checkpoint a caller would have saved there
+static md5_context_t writeFirstPart(const std::vector<uint8_t>& written) {
+    OTAFlashWriter w;
+    TEST_ASSERT_TRUE(w.begin(image.size()));
+    TEST_ASSERT_TRUE(writeRange(w, written, 0, 2 * OTA_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(2 * OTA_SECTOR_SIZE, w.offset());
+    return w.hash();
+}
+
+// ============================================================
+// TESTS
+// ============================================================
+
+void test_fresh_image_verifies() {
+    OTAFlashWriter w;
+    TEST_ASSERT_TRUE(w.begin(image.size()));
+    TEST_ASSERT_TRUE(writeRange(w, image, 0, image.size()));
+    TEST_ASSERT_TRUE_MESSAGE(w.end(imageMd5.c_str(), imageSha.c_str()), w.errorString().c_str());
+}
+
+void test_fresh_sha256_mismatch_fails() {
+    OTAFlashWriter w;
+    TEST_ASSERT_TRUE(w.begin(image.size()));
+    TEST_ASSERT_TRUE(writeRange(w, image, 0, image.size()));
+    TEST_ASSERT_FALSE(w.end(imageMd5.c_str(), WRONG_SHA));
+    TEST_ASSERT_EQUAL_STRING("SHA-256 mismatch", w.errorString().c_str());
+}
+
+void test_fresh_md5_mismatch_fails() {
+    OTAFlashWriter w;
+    TEST_ASSERT_TRUE(w.begin(image.size()));
+    TEST_ASSERT_TRUE(writeRange(w, image, 0, image.size()));
+    TEST_ASSERT_FALSE(w.end("00000000000000000000000000000000", imageSha.c_str()));
+    TEST_ASSERT_EQUAL_STRING("MD5 mismatch", w.errorString().c_str());
+}
+
+void test_resumed_image_verifies_from_flash() {
+    md5_context_t saved = writeFirstPart(image);
+    OTAFlashWriter w;
+    TEST_ASSERT_TRUE(w.begin(image.size(), 2 * OTA_SECTOR_SIZE, &saved));
+    TEST_ASSERT_TRUE(writeRange(w, image, 2 * OTA_SECTOR_SIZE, image.size()));
+    TEST_ASSERT_TRUE_MESSAGE(w.end(imageMd5.c_str(), imageSha.c_str()), w.errorString().c_str());
+}
+
+void test_resumed_sha256_mismatch_fails() {
+    md5_context_t saved = writeFirstPart(image);
+    OTAFlashWriter w;
+    TEST_ASSERT_TRUE(w.begin(image.size(), 2 * OTA_SECTOR_SIZE, &saved));
+    TEST_ASSERT_TRUE(writeRange(w, image, 2 * OTA_SECTOR_SIZE, image.size()));
+    TEST_ASSERT_FALSE(w.end(imageMd5.c_str(), WRONG_SHA));
+    TEST_ASSERT_EQUAL_STRING("SHA-256 mismatch", w.errorString().c_str());
+}
+
+// The checkpoint vouches for bytes the flash no longer holds
+void test_resumed_over_other_flash_fails() {
+    md5_context_t saved = writeFirstPart(image);
+    std::vector<uint8_t> other = image;
+    other[100] ^= 0xFF;
+    writeFirstPart(other);
+
+    OTAFlashWriter w;
+    TEST_ASSERT_TRUE(w.begin(image.size(), 2 * OTA_SECTOR_SIZE, &saved));
+    TEST_ASSERT_TRUE(writeRange(w, image, 2 * OTA_SECTOR_SIZE, image.size()));
+    TEST_ASSERT_FALSE(w.end(imageMd5.c_str(), imageSha.c_str()));
+    TEST_ASSERT_EQUAL_STRING("Flash differs from the image", w.errorString().c_str());
+}
+
+void test_incomplete_image_fails() {
+    OTAFlashWriter w;
+    TEST_ASSERT_TRUE(w.begin(image.size()));
+    TEST_ASSERT_TRUE(writeRange(w, image, 0, image.size() - 1));
+    TEST_ASSERT_FALSE(w.end(imageMd5.c_str(), imageSha.c_str()));
+    TEST_ASSERT_EQUAL_STRING("Image incomplete", w.errorString().c_str());
+}
+
+void setup() {
+    setenv("NATIVE_UPDATE_FILE", WRITER_SLOT, 1);
+    image.resize(WRITER_IMAGE);
+    uint32_t x = 1;
+    for (size_t i = 0; i < image.size(); i++) {
+        x = x * 1664525u + 1013904223u;
+        image[i] = x >> 24;
+    }
+    image[0] = OTA_IMAGE_MAGIC;
+    MD5Builder md5;
+    md5.begin();
+    md5.add(image.data(), image.size());
+    md5.calculate();
+    imageMd5 = md5.toString();
+    imageSha = shaHex(image.data(), image.size());
+
+    UNITY_BEGIN();
+    RUN_TEST(test_fresh_image_verifies);
+    RUN_TEST(test_fresh_sha256_mismatch_fails);
+    RUN_TEST(test_fresh_md5_mismatch_fails);
+    RUN_TEST(test_resumed_image_verifies_from_flash);
+    RUN_TEST(test_resumed_sha256_mismatch_fails);
+    RUN_TEST(test_resumed_over_other_flash_fails);
+    RUN_TEST(test_incomplete_image_fails);
+    int failures = UNITY_END();
+    remove(WRITER_SLOT);
+    exit(failures);
+}
+
+void loop() {}
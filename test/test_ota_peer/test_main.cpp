@@ -0,0 +1,174 @@
+/*
+ * Sibling image sharing: GET /ota/firmware.bin is served only with an
+ * X-Friyay-Auth header signed with the shared secret (HMAC-SHA256 of
+ * time, path and Range) and stamped within OTA_PEER_AUTH_WINDOW of now.
+ * The MACs here come from a separate HMAC, itself checked against the
+ * RFC 4231 vectors. Listens on 127.0.0.1, port 80 + PEER_PORT_OFFSET.
+ *
+ *   pio test -e native_test -f test_ota_peer
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <WiFi.h>
+#include <vector>
+#include "ota_peer.h"
+
+#define PEER_DIR          "/tmp/friyay_ota_peer"
+#define PEER_PORT_OFFSET  9100
+#define PEER_SECRET       "1234567890:test-bot-token"
+#define PEER_IMAGE        20000
+
+static WebServer server(OTA_PEER_PORT);
+static OTAPeer peer;
+static std::vector<uint8_t> image;
+
+// ============================================================
+// HELPERS
+// ============================================================
+
+static void sha256(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, uint8_t out[32]) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    mbedtls_sha256_update_ret(&ctx, a, aLen);
+    mbedtls_sha256_update_ret(&ctx, b, bLen);
+    mbedtls_sha256_finish_ret(&ctx, out);
+    mbedtls_sha256_free(&ctx);
+}
+
+static String hmacHex(const char* key, const char* msg) {
+    uint8_t k[64] = {0}, pad[64], inner[32], mac[32];
+    size_t keyLen = strlen(key);
+    if (keyLen > sizeof(k)) sha256((const uint8_t*)key, keyLen, nullptr, 0, k);
+    else memcpy(k, key, keyLen);
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x36;
+    sha256(pad, 64, (const uint8_t*)msg, strlen(msg), inner);
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x5c;
+    sha256(pad, 64, inner, 32, mac);
+    char hex[65];
+    for (int i = 0; i < 32; i++) snprintf(hex + i * 2, 3, "%02x", mac[i]);
+    return String(hex);
+}
+
+// X-Friyay-Auth for a request 'age' seconds old
+static String auth(const char* secret, long age, const char* range) {
+    String stamp = String((unsigned long)(time(nullptr) - age));
+    String msg = stamp + " " OTA_PEER_PATH " " + range;
+    return stamp + ":" + hmacHex(secret, msg.c_str());
+}
+
+// One GET against the peer; returns the status, body in 'body'
+static int get(const String& authValue, const char* range, std::vector<uint8_t>* body = nullptr) {
+    WiFiClient c;
+    if (!c.connect("127.0.0.1", OTA_PEER_PORT + PEER_PORT_OFFSET)) return -1;
+    String req = "GET " OTA_PEER_PATH " HTTP/1.1\r\nHost: peer\r\n";
+    if (*range) req += String("Range: ") + range + "\r\n";
+    if (authValue.length()) req += "X-Friyay-Auth: " + authValue + "\r\n";
+    req += "\r\n";
+    c.write((const uint8_t*)req.c_str(), req.length());
+    server.handleClient();
+
+    static_cast<Stream&>(c).setTimeout(2000);
+    String status = c.readStringUntil('\n');
+    while (c.readStringUntil('\n').length() > 1) {}  // Headers, to the blank "\r"
+    uint8_t buf[1024];
+    unsigned long start = millis();
+    while (body && millis() - start < 5000 && (c.connected() || c.available())) {
+        int n = c.read(buf, sizeof(buf));
+        if (n > 0) body->insert(body->end(), buf, buf + n);
+        else delay(1);
+    }
+    return status.substring(9, 12).toInt();
+}
+
+// The server streams from a task: wait for it to let go
+static void waitIdle() {
+    for (int i = 0; i < 500 && peer.serving(); i++) delay(10);
+}
+
+// ============================================================
+// TESTS
+// ============================================================
+
+void test_hmac_matches_rfc4231() {
+    TEST_ASSERT_EQUAL_STRING("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+                             hmacHex("Jefe", "what do ya want for nothing?").c_str());
+    String longKey;
+    for (int i = 0; i < 131; i++) longKey += (char)0xaa;
+    TEST_ASSERT_EQUAL_STRING("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+                             hmacHex(longKey.c_str(), "Test Using Larger Than Block-Size Key - Hash Key First").c_str());
+}
+
+void test_signed_request_gets_image() {
+    std::vector<uint8_t> body;
+    TEST_ASSERT_EQUAL_INT(200, get(auth(PEER_SECRET, 0, ""), "", &body));
+    TEST_ASSERT_TRUE(body == image);
+}
+
+void test_own_authorization_accepted() {
+    std::vector<uint8_t> body;
+    waitIdle();
+    TEST_ASSERT_EQUAL_INT(206, get(peer.authorization(OTA_PEER_PATH, "bytes=1000-"), "bytes=1000-", &body));
+    TEST_ASSERT_EQUAL_UINT32(PEER_IMAGE - 1000, body.size());
+    TEST_ASSERT_TRUE(std::equal(body.begin(), body.end(), image.begin() + 1000));
+}
+
+void test_unsigned_or_wrong_secret_refused() {
+    waitIdle();
+    TEST_ASSERT_EQUAL_INT(403, get("", ""));
+    TEST_ASSERT_EQUAL_INT(403, get(auth("some other token", 0, ""), ""));
+    TEST_ASSERT_EQUAL_INT(403, get("garbage", ""));
+}
+
+void test_mac_covers_range() {
+    waitIdle();
+    TEST_ASSERT_EQUAL_INT(403, get(auth(PEER_SECRET, 0, "bytes=1000-"), "bytes=0-"));
+    TEST_ASSERT_EQUAL_INT(403, get(auth(PEER_SECRET, 0, ""), "bytes=1000-"));
+}
+
+void test_time_window() {
+    std::vector<uint8_t> body;
+    waitIdle();
+    TEST_ASSERT_EQUAL_INT(206, get(auth(PEER_SECRET, OTA_PEER_AUTH_WINDOW - 5, "bytes=19000-"), "bytes=19000-", &body));
+    waitIdle();
+    TEST_ASSERT_EQUAL_INT(206, get(auth(PEER_SECRET, -(OTA_PEER_AUTH_WINDOW - 5), "bytes=19000-"), "bytes=19000-", &body));
+    waitIdle();
+    TEST_ASSERT_EQUAL_INT(403, get(auth(PEER_SECRET, OTA_PEER_AUTH_WINDOW + 5, ""), ""));
+    TEST_ASSERT_EQUAL_INT(403, get(auth(PEER_SECRET, -(OTA_PEER_AUTH_WINDOW + 5), ""), ""));
+}
+
+void setup() {
+    int rc = system("mkdir -p " PEER_DIR);
+    (void)rc;
+    image.resize(PEER_IMAGE);
+    for (size_t i = 0; i < image.size(); i++) image[i] = (uint8_t)(i * 7 + (i >> 8));
+    image[0] = 0xE9;
+    FILE* f = fopen(PEER_DIR "/image.bin", "wb");
+    fwrite(image.data(), 1, image.size(), f);
+    fclose(f);
+    setenv("NATIVE_RUNNING_IMAGE", PEER_DIR "/image.bin", 1);
+    setenv("NATIVE_MDNS_FILE", PEER_DIR "/mdns", 1);
+    setenv("NATIVE_PORT_OFFSET", String(PEER_PORT_OFFSET).c_str(), 1);
+
+    asyncLog.begin();
+    WiFi.begin("native", "");
+    while (WiFi.status() != WL_CONNECTED) delay(10);
+    bool shared = peer.begin(server, "friyay-test", "1.0.0", PEER_SECRET);
+    server.begin();
+
+    UNITY_BEGIN();
+    if (shared) {
+        RUN_TEST(test_hmac_matches_rfc4231);
+        RUN_TEST(test_signed_request_gets_image);
+        RUN_TEST(test_own_authorization_accepted);
+        RUN_TEST(test_unsigned_or_wrong_secret_refused);
+        RUN_TEST(test_mac_covers_range);
+        RUN_TEST(test_time_window);
+    }
+    int failures = UNITY_END() + (shared ? 0 : 1);
+    rc = system("rm -rf " PEER_DIR);
+    exit(failures);
+}
+
+void loop() {}
@@ -0,0 +1,204 @@
+/*
+ * OTA over a flaky network: tools/mock_services.py cuts firmware
+ * downloads partway through, OTAUpdater resumes each one with a Range
+ * request, and the mock's byte count shows that every resume fetched
+ * only the remainder: the asset's bytes go over the wire exactly once.
+ * Runs for the raw image and for firmware.bin.gz (which resumes at a
+ * compressed offset). A checkForUpdate() during the download must be
+ * refused without disturbing it.
+ *
+ * The suite starts the mock itself on the GITHUB_API_BASE port (so stop
+ * any mock already there) and is ignored if python3 can't run it. Each
+ * cut costs an OTA_RESUME_BACKOFF_MS wait:
+ *
+ *   pio test -e native_test -f test_ota_resume
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <WiFi.h>
+#include <MD5Builder.h>
+#include <vector>
+#include "ota_updates.h"
+
+#define RESUME_DIR       "/tmp/friyay_ota_resume"
+#define RESUME_IMAGE     (300 * 1024)
+#define RESUME_CUT_RATE  "0.8"   // Of firmware requests, resumes included
+#define RESUME_SEED      "4"     // Same cuts every run
+
+typedef std::vector<uint8_t> Bytes;
+
+// ============================================================
+// HELPERS
+// ============================================================
+
+static bool writeFile(const char* path, const void* data, size_t len) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+static long fileSize(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+// Code-like image: compresses, but not to nothing
+static Bytes makeImage() {
+    Bytes image(RESUME_IMAGE);
+    uint32_t x = 12345;
+    for (size_t i = 0; i < image.size(); i++) {
+        x = x * 1103515245u + 12345u;
+        image[i] = (x >> 16) & ((i & 64) ? 0xFF : 0x0F);
+    }
+    image[0] = 0xE9;  // ESP image magic, checked on the first write
+    return image;
+}
+
+// Fixtures for the mock: the image, optionally its .gz, and version.json
+static bool writeFixtures(const Bytes& image, bool gzip) {
+    if (system("rm -rf " RESUME_DIR " && mkdir -p " RESUME_DIR "/fixtures") != 0) return false;
+    if (!writeFile(RESUME_DIR "/fixtures/firmware.bin", image.data(), image.size())) return false;
+    long gzSize = 0;
+    if (gzip) {
+        if (system("gzip -9 -n -c " RESUME_DIR "/fixtures/firmware.bin > " RESUME_DIR "/fixtures/firmware.bin.gz") != 0) {
+            return false;
+        }
+        gzSize = fileSize(RESUME_DIR "/fixtures/firmware.bin.gz");
+    }
+
+    MD5Builder md5;
+    md5.begin();
+    md5.add(image.data(), image.size());
+    md5.calculate();
+    char json[256];
+    int n = snprintf(json, sizeof(json),
+                     "{\"version\":\"9.9.9\",\"min_version\":\"1.0.0\",\"critical\":false,"
+                     "\"firmware_size\":%u,%s%.0ld%s\"firmware_md5\":\"%s\"}",
+                     (unsigned)image.size(), gzip ? "\"firmware_gz_size\":" : "", gzSize, gzip ? "," : "",
+                     md5.toString().c_str());
+    if (!writeFile(RESUME_DIR "/fixtures/version.json", json, n)) return false;
+
+    const char* script = "{\"routes\":{\"/assets/firmware\":{\"cut\":" RESUME_CUT_RATE "}}}";
+    return writeFile(RESUME_DIR "/script.json", script, strlen(script));
+}
+
+static int mockPort() {
+    int port = 0;
+    sscanf(GITHUB_API_BASE, "http://%*[^:]:%d", &port);
+    return port;
+}
+
+static bool startMock() {
+    char cmd[320];
+    snprintf(cmd, sizeof(cmd),
+             "python3 tools/mock_services.py --port %d --fixtures " RESUME_DIR "/fixtures --script " RESUME_DIR
+             "/script.json --seed " RESUME_SEED " --quiet > " RESUME_DIR "/mock.out 2>&1 & echo $! > " RESUME_DIR
+             "/mock.pid", mockPort());
+    if (system(cmd) != 0) return false;
+    for (int i = 0; i < 50; i++) {
+        WiFiClient probe;
+        if (probe.connect("127.0.0.1", mockPort())) {
+            probe.stop();
+            return true;
+        }
+        delay(100);
+    }
+    return false;
+}
+
+// Stops the mock and reads the totals it prints on exit
+static bool stopMock(long& downloads, long& cuts, long& bodyBytes) {
+    if (system("kill $(cat " RESUME_DIR "/mock.pid) 2>/dev/null") != 0) return false;
+    for (int i = 0; i < 50; i++) {
+        FILE* f = fopen(RESUME_DIR "/mock.out", "r");
+        char line[160];
+        while (f && fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "[MOCK] %ld file downloads, %ld cut, %ld body bytes sent", &downloads, &cuts,
+                       &bodyBytes) == 3) {
+                fclose(f);
+                return true;
+            }
+        }
+        if (f) fclose(f);
+        delay(100);
+    }
+    return false;
+}
+
+static void updateThroughCuts(bool gzip) {
+    Bytes image = makeImage();
+    TEST_ASSERT_TRUE(writeFixtures(image, gzip));
+    if (!startMock()) TEST_IGNORE_MESSAGE("mock_services.py did not start (python3, or port in use)");
+
+    // Fresh NVS (no checkpoint from an earlier run) and update slot
+    writeFile(RESUME_DIR "/prefs", "", 0);
+    setenv("NATIVE_PREFS", RESUME_DIR "/prefs", 1);
+    setenv("NATIVE_UPDATE_FILE", RESUME_DIR "/update.bin", 1);
+
+    OTAUpdater ota;
+    bool available = ota.checkForUpdate();
+    bool started = available && ota.startUpdate();
+
+    // A check mid-download is refused and leaves the running job alone
+    bool recheck = started && ota.state() == OTA_RUNNING && ota.checkForUpdate();
+    String recheckError = ota.getLastError();
+
+    while (started && ota.state() == OTA_RUNNING) delay(20);
+    OTAState state = ota.state();
+    String error = ota.getLastError();
+
+    long downloads = 0, cuts = 0, bodyBytes = 0;
+    bool counted = stopMock(downloads, cuts, bodyBytes);
+    TEST_ASSERT_TRUE_MESSAGE(available, error.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(started, error.c_str());
+    TEST_ASSERT_FALSE(recheck);
+    TEST_ASSERT_EQUAL_STRING("Update in progress", recheckError.c_str());
+    TEST_ASSERT_EQUAL_INT_MESSAGE(OTA_DONE, state, error.c_str());
+    TEST_ASSERT_EQUAL_UINT32(image.size(), ota.bytesFlashed());
+    TEST_ASSERT_TRUE(counted);
+
+    // Every cut was resumed, and nothing was fetched twice
+    long asset = fileSize(gzip ? RESUME_DIR "/fixtures/firmware.bin.gz" : RESUME_DIR "/fixtures/firmware.bin");
+    long versionJson = fileSize(RESUME_DIR "/fixtures/version.json");
+    char line[160];
+    snprintf(line, sizeof(line), "%s: %ld requests, %ld cut, %ld of %ld asset bytes sent",
+             gzip ? "firmware.bin.gz" : "firmware.bin", downloads - 1, cuts, bodyBytes - versionJson, asset);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(0, cuts);
+    TEST_ASSERT_EQUAL_INT(cuts + 2, downloads);  // version.json, first GET, one Range GET per cut
+    TEST_ASSERT_EQUAL_INT(asset + versionJson, bodyBytes);
+}
+
+// ============================================================
+// TESTS
+// ============================================================
+
+void test_raw_image_resumes() {
+    updateThroughCuts(false);
+}
+
+void test_gzip_image_resumes() {
+    updateThroughCuts(true);
+}
+
+void setup() {
+    asyncLog.begin();
+    WiFi.begin("native", "");
+    while (WiFi.status() != WL_CONNECTED) delay(10);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_raw_image_resumes);
+    RUN_TEST(test_gzip_image_resumes);
+    int failures = UNITY_END();
+    int rc = system("kill $(cat " RESUME_DIR "/mock.pid) 2>/dev/null; rm -rf " RESUME_DIR);
+    (void)rc;
+    exit(failures);
+}
+
+void loop() {}
@@ -0,0 +1,285 @@
+/*
+ * QR encoder round trip: encodes payloads with src/qr_encoder.h and reads
+ * them back with a small decoder written from the spec (ISO/IEC 18004)
+ * rather than from the encoder. It works on the module matrix, so it
+ * checks layout, masking, interleaving and Reed-Solomon, not optics.
+ *
+ *   pio test -e native_test -f test_qr_encoder
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include <string>
+#include "qr_encoder.h"
+
+// ============================================================
+// DECODER
+// ============================================================
+
+// Per version 1-10 and level L, M, Q, H (spec table 9)
+static const int TOTAL_CODEWORDS[11] = {0, 26, 44, 70, 100, 134, 172, 196, 242, 292, 346};
+static const int ECC_PER_BLOCK[4][11] = {
+    {0, 7, 10, 15, 20, 26, 18, 20, 24, 30, 18},
+    {0, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26},
+    {0, 13, 22, 18, 26, 18, 24, 18, 22, 20, 24},
+    {0, 17, 28, 22, 16, 22, 28, 26, 26, 24, 28},
+};
+static const int NUM_BLOCKS[4][11] = {
+    {0, 1, 1, 1, 1, 1, 2, 2, 2, 2, 4},
+    {0, 1, 1, 1, 2, 2, 4, 4, 4, 5, 5},
+    {0, 1, 1, 2, 2, 4, 4, 6, 6, 8, 8},
+    {0, 1, 1, 2, 4, 4, 4, 5, 6, 8, 8},
+};
+// Alignment pattern centres (spec annex E)
+static const int ALIGN[11][3] = {
+    {0}, {0}, {6, 18}, {6, 22}, {6, 26}, {6, 30}, {6, 34}, {6, 22, 38}, {6, 24, 42}, {6, 26, 46}, {6, 28, 50},
+};
+
+struct Decoded {
+    bool ok = false;
+    const char* error = "";
+    int version = 0;
+    int level = -1;  // Index into the tables above (0 = L)
+    std::string data;
+};
+
+static uint8_t gfMul(uint8_t a, uint8_t b) {
+    uint8_t r = 0;
+    while (b) {
+        if (b & 1) r ^= a;
+        a = (a << 1) ^ ((a & 0x80) ? 0x1D : 0);
+        b >>= 1;
+    }
+    return r;
+}
+
+// BCH code of 'data' with generator 'poly' (degree 'deg')
+static int bch(int data, int poly, int deg) {
+    int v = data << deg;
+    for (int i = 31; i >= deg; i--) {
+        if (v & (1 << i)) v ^= poly << (i - deg);
+    }
+    return data << deg | v;
+}
+
+static bool isFunction(int x, int y, int size, int ver) {
+    if ((x < 9 && y < 9) || (x >= size - 8 && y < 9) || (x < 9 && y >= size - 8)) return true;
+    if (x == 6 || y == 6) return true;
+    if (ver >= 7 && ((x >= size - 11 && x < size - 8 && y < 6) || (y >= size - 11 && y < size - 8 && x < 6))) {
+        return true;
+    }
+    int n = ver == 1 ? 0 : ver / 7 + 2;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            if ((i == 0 && j == 0) || (i == 0 && j == n - 1) || (i == n - 1 && j == 0)) continue;
+            if (abs(x - ALIGN[ver][i]) <= 2 && abs(y - ALIGN[ver][j]) <= 2) return true;
+        }
+    }
+    return false;
+}
+
+static bool masked(int mask, int x, int y) {
+    switch (mask) {
+        case 0: return (x + y) % 2 == 0;
+        case 1: return y % 2 == 0;
+        case 2: return x % 3 == 0;
+        case 3: return (x + y) % 3 == 0;
+        case 4: return (x / 3 + y / 2) % 2 == 0;
+        case 5: return x * y % 2 + x * y % 3 == 0;
+        case 6: return (x * y % 2 + x * y % 3) % 2 == 0;
+        default: return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    }
+}
+
+static Decoded decode(const QRCode& qr) {
+    Decoded d;
+    int size = qr.size();
+    int ver = (size - 17) / 4;
+    if (size < 21 || (size - 17) % 4 || ver > 10) return d.error = "bad size", d;
+    d.version = ver;
+
+    // Finders and timing
+    static const int FINDER_CORNERS[3][2] = {{0, 0}, {1, 0}, {0, 1}};
+    for (auto& c : FINDER_CORNERS) {
+        int ox = c[0] ? size - 7 : 0, oy = c[1] ? size - 7 : 0;
+        for (int y = 0; y < 7; y++) {
+            for (int x = 0; x < 7; x++) {
+                int ring = max(abs(x - 3), abs(y - 3));
+                if (qr.module(ox + x, oy + y) != (ring != 2)) return d.error = "finder", d;
+            }
+        }
+    }
+    for (int i = 8; i < size - 8; i++) {
+        if (qr.module(i, 6) != (i % 2 == 0) || qr.module(6, i) != (i % 2 == 0)) return d.error = "timing", d;
+    }
+    if (!qr.module(8, size - 8)) return d.error = "dark module", d;
+
+    // Format: both copies must be the same valid code
+    int first = 0, second = 0;
+    for (int i = 0; i <= 5; i++) first |= qr.module(8, i) << i;
+    first |= qr.module(8, 7) << 6 | qr.module(8, 8) << 7 | qr.module(7, 8) << 8;
+    for (int i = 9; i < 15; i++) first |= qr.module(14 - i, 8) << i;
+    for (int i = 0; i < 8; i++) second |= qr.module(size - 1 - i, 8) << i;
+    for (int i = 8; i < 15; i++) second |= qr.module(8, size - 15 + i) << i;
+    if (first != second) return d.error = "format copies differ", d;
+    int format = -1;
+    for (int f = 0; f < 32; f++) {
+        if ((bch(f, 0x537, 10) ^ 0x5412) == first) format = f;
+    }
+    if (format < 0) return d.error = "format code", d;
+    static const int LEVEL_FROM_BITS[4] = {1, 0, 3, 2};  // 00 = M, 01 = L, 10 = H, 11 = Q
+    d.level = LEVEL_FROM_BITS[format >> 3];
+    int mask = format & 7;
+
+    if (ver >= 7) {
+        int a = 0, b = 0;
+        for (int i = 0; i < 18; i++) {
+            a |= qr.module(size - 11 + i % 3, i / 3) << i;
+            b |= qr.module(i / 3, size - 11 + i % 3) << i;
+        }
+        if (a != bch(ver, 0x1F25, 12) || b != a) return d.error = "version info", d;
+    }
+
+    // Codewords in zigzag order, unmasked
+    int total = TOTAL_CODEWORDS[ver];
+    std::vector<uint8_t> raw(total, 0);
+    int bit = 0;
+    for (int right = size - 1; right >= 1; right -= 2) {
+        if (right == 6) right = 5;
+        bool upward = ((right + 1) & 2) == 0;
+        for (int v = 0; v < size; v++) {
+            int y = upward ? size - 1 - v : v;
+            for (int j = 0; j < 2; j++) {
+                int x = right - j;
+                if (isFunction(x, y, size, ver) || bit >= total * 8) continue;
+                if (qr.module(x, y) ^ masked(mask, x, y)) raw[bit >> 3] |= 0x80 >> (bit & 7);
+                bit++;
+            }
+        }
+    }
+    if (bit != total * 8) return d.error = "codeword count", d;
+
+    // De-interleave, check every block's syndromes
+    int blocks = NUM_BLOCKS[d.level][ver];
+    int ecc = ECC_PER_BLOCK[d.level][ver];
+    int shortLen = total / blocks;
+    int numShort = blocks - total % blocks;
+    std::vector<std::vector<uint8_t>> data(blocks), check(blocks);
+    int pos = 0;
+    for (int i = 0; i < shortLen - ecc + 1; i++) {
+        for (int b = 0; b < blocks; b++) {
+            if (i == shortLen - ecc && b < numShort) continue;
+            data[b].push_back(raw[pos++]);
+        }
+    }
+    for (int i = 0; i < ecc; i++) {
+        for (int b = 0; b < blocks; b++) check[b].push_back(raw[pos++]);
+    }
+    std::vector<uint8_t> stream;
+    for (int b = 0; b < blocks; b++) {
+        std::vector<uint8_t> cw = data[b];
+        cw.insert(cw.end(), check[b].begin(), check[b].end());
+        uint8_t root = 1;
+        for (int i = 0; i < ecc; i++, root = gfMul(root, 2)) {
+            uint8_t s = 0;
+            for (uint8_t c : cw) s = gfMul(s, root) ^ c;
+            if (s) return d.error = "Reed-Solomon syndrome", d;
+        }
+        stream.insert(stream.end(), data[b].begin(), data[b].end());
+    }
+
+    // Byte-mode segment, terminator, pad codewords
+    size_t at = 0;
+    auto take = [&](int n) {
+        int v = 0;
+        for (int i = 0; i < n; i++, at++) v = v << 1 | ((stream[at >> 3] >> (7 - (at & 7))) & 1);
+        return v;
+    };
+    size_t bits = stream.size() * 8;
+    if (take(4) != 0x4) return d.error = "not byte mode", d;
+    int count = take(ver <= 9 ? 8 : 16);
+    if (at + count * 8 > bits) return d.error = "count past the data", d;
+    for (int i = 0; i < count; i++) d.data += (char)take(8);
+    if (bits - at >= 4 && take(4) != 0) return d.error = "terminator", d;
+    if (bits - at < 4) at = bits;
+    at = (at + 7) & ~(size_t)7;
+    for (int i = 0; at < bits; i++) {
+        if (take(8) != (i % 2 ? 0x11 : 0xEC)) return d.error = "padding", d;
+    }
+    d.ok = true;
+    return d;
+}
+
+// Byte-mode payload capacity of a version and level
+static int capacity(int ver, int level) {
+    int dataCodewords = TOTAL_CODEWORDS[ver] - ECC_PER_BLOCK[level][ver] * NUM_BLOCKS[level][ver];
+    return (dataCodewords * 8 - 4 - (ver <= 9 ? 8 : 16)) / 8;
+}
+
+static void checkRoundTrip(const std::string& payload, QRCode::Ecc ecc) {
+    QRCode qr;
+    TEST_ASSERT_TRUE(qr.encode((const uint8_t*)payload.data(), payload.size(), ecc));
+    Decoded d = decode(qr);
+    TEST_ASSERT_TRUE_MESSAGE(d.ok, d.error);
+    TEST_ASSERT_EQUAL_INT(qr.version(), d.version);
+    TEST_ASSERT_EQUAL_INT((int)ecc, d.level);
+    TEST_ASSERT_EQUAL_INT(payload.size(), d.data.size());
+    TEST_ASSERT_TRUE(d.data == payload);
+}
+
+// ============================================================
+// TESTS
+// ============================================================
+
+void test_placeholder_link() {
+    checkRoundTrip("https://t.me/friyay_forever_bot?start=AB", QRCode::ECC_MEDIUM);
+}
+
+void test_every_level() {
+    for (int ecc = QRCode::ECC_LOW; ecc <= QRCode::ECC_HIGH; ecc++) {
+        checkRoundTrip("", (QRCode::Ecc)ecc);
+        checkRoundTrip("A", (QRCode::Ecc)ecc);
+        checkRoundTrip("Friyay 🏂 forever", (QRCode::Ecc)ecc);
+    }
+}
+
+void test_binary_bytes() {
+    std::string all;
+    for (int i = 0; i < 256; i++) all += (char)i;
+    checkRoundTrip(all, QRCode::ECC_LOW);  // 271 bytes fit v10-L
+}
+
+// At capacity a version is used; one byte more moves to the next
+void test_version_boundaries() {
+    for (int level = 0; level < 4; level++) {
+        for (int ver = 1; ver <= QR_MAX_VERSION; ver++) {
+            std::string payload(capacity(ver, level), 'a' + ver);
+            QRCode qr;
+            TEST_ASSERT_TRUE(qr.encode((const uint8_t*)payload.data(), payload.size(), (QRCode::Ecc)level));
+            TEST_ASSERT_EQUAL_INT(ver, qr.version());
+            checkRoundTrip(payload, (QRCode::Ecc)level);
+
+            payload += 'z';
+            bool fits = qr.encode((const uint8_t*)payload.data(), payload.size(), (QRCode::Ecc)level);
+            if (ver < QR_MAX_VERSION) {
+                TEST_ASSERT_TRUE(fits);
+                TEST_ASSERT_EQUAL_INT(ver + 1, qr.version());
+            } else {
+                TEST_ASSERT_FALSE(fits);
+                TEST_ASSERT_EQUAL_INT(0, qr.size());
+            }
+        }
+    }
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_placeholder_link);
+    RUN_TEST(test_every_level);
+    RUN_TEST(test_binary_bytes);
+    RUN_TEST(test_version_boundaries);
+    exit(UNITY_END());
+}
+
+void loop() {}
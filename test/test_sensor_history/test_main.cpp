@@ -0,0 +1,171 @@
+/*
+ * SensorHistory in RAM (NATIVE_FS points where LittleFS can't mkdir):
+ * raw samples roll up into minutes and hours at the boundaries, a gap
+ * leaves empty slots rather than stale ones, the raw ring wraps after
+ * an hour, and summary()/sparkline() read the right tier.
+ *
+ *   pio test -e native_test -f test_sensor_history
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "sensor_history.h"
+
+#define T0        1699999200  // On an hour boundary
+#define CH_A      0
+#define CH_B      1
+
+// ============================================================
+// HELPERS
+// ============================================================
+
+static SensorHistory* fresh() {
+    SensorHistory* h = new SensorHistory();
+    TEST_ASSERT_TRUE(h->begin());
+    return h;
+}
+
+// Channel B is channel A + 1000, so a mixed-up channel shows
+static void addAt(SensorHistory* h, time_t t, int16_t v) {
+    int16_t values[HISTORY_CHANNELS] = {v, (int16_t)(v + 1000)};
+    h->add(t, values);
+}
+
+// One raw sample per period over [from, to), each valued by 'value(t)'
+template <typename F>
+static void fill(SensorHistory* h, time_t from, time_t to, F value) {
+    for (time_t t = from; t < to; t += HISTORY_RAW_PERIOD) addAt(h, t, value(t));
+}
+
+static void assertRollup(int16_t min, int16_t avg, int16_t max, const HistoryRollup& r) {
+    TEST_ASSERT_EQUAL_INT(min, r.min);
+    TEST_ASSERT_EQUAL_INT(avg, r.avg);
+    TEST_ASSERT_EQUAL_INT(max, r.max);
+}
+
+// ============================================================
+// TESTS
+// ============================================================
+
+void test_empty_history_has_no_summary() {
+    SensorHistory* h = fresh();
+    HistoryRollup r;
+    TEST_ASSERT_FALSE(h->summary(T0, 3600, CH_A, r));
+    TEST_ASSERT_FALSE(h->summary(T0, 30 * 86400, CH_A, r));
+    addAt(h, HISTORY_MIN_EPOCH - 1, 5);  // Clock not set yet
+    TEST_ASSERT_FALSE(h->summary(T0, 3600, CH_A, r));
+    delete h;
+}
+
+void test_minute_rollup() {
+    SensorHistory* h = fresh();
+    fill(h, T0, T0 + 60, [](time_t t) { return (int16_t)((t - T0) / HISTORY_RAW_PERIOD); });  // 0..11
+    HistoryRollup r;
+    TEST_ASSERT_FALSE(h->summary(T0 + 60, 86400, CH_A, r));  // Minute still open
+
+    addAt(h, T0 + 60, 100);
+    TEST_ASSERT_TRUE(h->summary(T0 + 60, 86400, CH_A, r));
+    assertRollup(0, 6, 11, r);  // 5.5 rounds up
+    TEST_ASSERT_TRUE(h->summary(T0 + 60, 86400, CH_B, r));
+    assertRollup(1000, 1006, 1011, r);
+    delete h;
+}
+
+void test_hour_rollup() {
+    SensorHistory* h = fresh();
+    fill(h, T0, T0 + 3600, [](time_t t) { return (int16_t)((t - T0) / 60); });  // Minute number
+    HistoryRollup r;
+    TEST_ASSERT_FALSE(h->summary(T0 + 3600, 30 * 86400, CH_A, r));  // Hour still open
+
+    addAt(h, T0 + 3600, 100);
+    TEST_ASSERT_TRUE(h->summary(T0 + 3600, 30 * 86400, CH_A, r));
+    assertRollup(0, 30, 59, r);  // 29.5 rounds up
+    TEST_ASSERT_TRUE(h->summary(T0 + 3600, 86400, CH_A, r));
+    assertRollup(0, 30, 59, r);
+    delete h;
+}
+
+// Hours 1-3 have no samples: their slots stay empty in every tier
+void test_gap_leaves_empty_slots() {
+    SensorHistory* h = fresh();
+    fill(h, T0, T0 + 3600, [](time_t) { return (int16_t)10; });
+    fill(h, T0 + 4 * 3600, T0 + 5 * 3600, [](time_t) { return (int16_t)40; });
+    time_t now = T0 + 5 * 3600 + 30;
+    addAt(h, now, 70);
+
+    HistoryRollup pts[6];
+    TEST_ASSERT_EQUAL_INT(HISTORY_HOUR, h->sparkline(now, 6 * 3600, CH_A, pts, 6));
+    TEST_ASSERT_EQUAL_INT(HISTORY_EMPTY, pts[0].avg);  // Before the first sample
+    assertRollup(10, 10, 10, pts[1]);
+    for (int i = 2; i <= 4; i++) TEST_ASSERT_EQUAL_INT(HISTORY_EMPTY, pts[i].avg);
+    assertRollup(40, 40, 40, pts[5]);
+
+    HistoryRollup r;
+    TEST_ASSERT_TRUE(h->summary(now, 3 * 3600, CH_A, r));  // Minute tier: hour 4 only
+    assertRollup(40, 40, 40, r);
+    TEST_ASSERT_TRUE(h->summary(now, 3600, CH_A, r));  // Raw: nothing from hour 0
+    assertRollup(40, 40, 70, r);
+    delete h;
+}
+
+void test_raw_ring_wraps() {
+    SensorHistory* h = fresh();
+    const int n = HISTORY_RAW_SLOTS + 280;
+    fill(h, T0, T0 + n * HISTORY_RAW_PERIOD, [](time_t t) { return (int16_t)((t - T0) / HISTORY_RAW_PERIOD); });
+    time_t now = T0 + (n - 1) * HISTORY_RAW_PERIOD;
+
+    HistoryRollup r;
+    TEST_ASSERT_TRUE(h->summary(now, 3600, CH_A, r));
+    assertRollup(n - HISTORY_RAW_SLOTS, (n - HISTORY_RAW_SLOTS + n - 1 + 1) / 2, n - 1, r);
+    TEST_ASSERT_TRUE(h->summary(now, 600, CH_A, r));
+    assertRollup(n - 120, (n - 120 + n - 1 + 1) / 2, n - 1, r);
+    delete h;
+}
+
+// Each window reads its own tier: raw for 1 h, minutes for 1 d, hours
+// for 30 d, none of which holds the minute or hour still in progress
+void test_summary_windows() {
+    SensorHistory* h = fresh();
+    fill(h, T0, T0 + 3600, [](time_t) { return (int16_t)10; });
+    fill(h, T0 + 3600, T0 + 7200, [](time_t) { return (int16_t)20; });
+    fill(h, T0 + 7200, T0 + 7230, [](time_t) { return (int16_t)30; });
+    time_t now = T0 + 7225;
+
+    HistoryRollup r;
+    TEST_ASSERT_TRUE(h->summary(now, 3600, CH_A, r));
+    assertRollup(20, 20, 30, r);
+    TEST_ASSERT_TRUE(h->summary(now, 86400, CH_A, r));
+    assertRollup(10, 15, 20, r);
+    TEST_ASSERT_TRUE(h->summary(now, 30 * 86400, CH_A, r));
+    assertRollup(10, 15, 20, r);
+    TEST_ASSERT_TRUE(h->summary(now, 30 * 86400, CH_B, r));
+    assertRollup(1010, 1015, 1020, r);
+    delete h;
+}
+
+void test_sparkline_blanks_empty_points() {
+    SensorHistory* h = fresh();
+    fill(h, T0, T0 + 3600, [](time_t) { return (int16_t)10; });
+    fill(h, T0 + 4 * 3600, T0 + 5 * 3600, [](time_t) { return (int16_t)40; });
+    addAt(h, T0 + 5 * 3600, 40);
+
+    FixedString<64> line;
+    h->appendSparkline(line, T0 + 5 * 3600, 6 * 3600, CH_A, 6);
+    TEST_ASSERT_EQUAL_STRING(" \xE2\x96\x81   \xE2\x96\x88", line.c_str());  // " ▁   █"
+    delete h;
+}
+
+void setup() {
+    setenv("NATIVE_FS", "/nonexistent/friyay_history", 1);
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_history_has_no_summary);
+    RUN_TEST(test_minute_rollup);
+    RUN_TEST(test_hour_rollup);
+    RUN_TEST(test_gap_leaves_empty_slots);
+    RUN_TEST(test_raw_ring_wraps);
+    RUN_TEST(test_summary_windows);
+    RUN_TEST(test_sparkline_blanks_empty_points);
+    exit(UNITY_END());
+}
+
+void loop() {}
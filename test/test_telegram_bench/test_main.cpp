@@ -0,0 +1,193 @@
+/*
+ * TelegramClient throughput: drains large getUpdates batches from
+ * tools/mock_services.py and reports updates/s and peak heap per batch
+ * size. The streaming parse should keep the heap flat as batches grow.
+ *
+ * The suite starts the mock itself on TELEGRAM_API_PORT (so stop any
+ * mock already on that port) and is ignored if python3 can't run it.
+ * The numbers are printed, not asserted:
+ *
+ *   pio test -e native_test -f test_telegram_bench -v
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <malloc.h>
+#include "telegram_client.h"
+
+#define BENCH_ROUNDS     20      // getUpdates calls per batch size
+#define BENCH_MAX_BATCH  100     // Bot API limit
+#define BENCH_SCRIPT     "/tmp/friyay_tg_bench.json"
+#define BENCH_PID        "/tmp/friyay_tg_bench.pid"
+
+static const int BATCHES[] = {1, 10, 25, 50, BENCH_MAX_BATCH};
+#define BATCH_COUNT (sizeof(BATCHES) / sizeof(BATCHES[0]))
+
+// ============================================================
+// HEAP ACCOUNTING
+// ============================================================
+
+// glibc lets the program interpose malloc; count live bytes and the peak
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+static std::atomic<size_t> heapLive(0);
+static std::atomic<size_t> heapPeak(0);
+
+static void heapAdd(void* p) {
+    if (!p) return;
+    size_t live = heapLive += malloc_usable_size(p);
+    size_t peak = heapPeak.load();
+    while (live > peak && !heapPeak.compare_exchange_weak(peak, live)) {}
+}
+
+static void heapSub(void* p) {
+    if (p) heapLive -= malloc_usable_size(p);
+}
+
+extern "C" {
+void* malloc(size_t size) {
+    void* p = __libc_malloc(size);
+    heapAdd(p);
+    return p;
+}
+
+void* calloc(size_t n, size_t size) {
+    void* p = __libc_calloc(n, size);
+    heapAdd(p);
+    return p;
+}
+
+void* realloc(void* ptr, size_t size) {
+    heapSub(ptr);
+    void* p = __libc_realloc(ptr, size);
+    heapAdd(p ? p : ptr);
+    return p;
+}
+
+void free(void* ptr) {
+    heapSub(ptr);
+    __libc_free(ptr);
+}
+}
+
+// ============================================================
+// MOCK
+// ============================================================
+
+static bool mockRunning = false;
+
+// A mix of what the group sends: short replies, long text, photos
+static void writeUpdate(FILE* f, int i) {
+    switch (i % 3) {
+        case 0:
+            fprintf(f, "{\"message\":{\"chat\":{\"id\":%d},\"from\":{\"first_name\":\"Friend %d\"},"
+                       "\"text\":\"in\"}}", 1000 + i % 4, i % 4);
+            break;
+        case 1:
+            fprintf(f, "{\"message\":{\"chat\":{\"id\":%d},\"from\":{\"first_name\":\"Friend %d\"},"
+                       "\"text\":\"Fresh snow overnight \\ud83c\\udfc2 ", 1000 + i % 4, i % 4);
+            for (int k = 0; k < 8; k++) fprintf(f, "lift line is short, see everyone at the top %d. ", k);
+            fprintf(f, "\",\"entities\":[{\"type\":\"bold\",\"offset\":0,\"length\":5}]}}");
+            break;
+        default:
+            fprintf(f, "{\"message\":{\"chat\":{\"id\":%d},\"from\":{\"first_name\":\"Friend %d\"},\"photo\":[",
+                    1000 + i % 4, i % 4);
+            for (int k = 0; k < 4; k++) {
+                fprintf(f, "%s{\"file_id\":\"AgACAgEAAxkBAAIB%06d_%d\",\"file_unique_id\":\"AQAD%06d\","
+                           "\"file_size\":%d,\"width\":%d,\"height\":%d}",
+                        k ? "," : "", i, k, i, 1000 * (k + 1), 90 << k, 60 << k);
+            }
+            fprintf(f, "]}}");
+            break;
+    }
+}
+
+static bool startMock(int total) {
+    FILE* f = fopen(BENCH_SCRIPT, "w");
+    if (!f) return false;
+    fprintf(f, "{\"updates\":[");
+    for (int i = 0; i < total; i++) {
+        if (i) fputc(',', f);
+        writeUpdate(f, i);
+    }
+    fprintf(f, "]}\n");
+    fclose(f);
+
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "python3 tools/mock_services.py --port %d --script " BENCH_SCRIPT
+             " --quiet > /dev/null 2>&1 & echo $! > " BENCH_PID, TELEGRAM_API_PORT);
+    if (system(cmd) != 0) return false;
+
+    // Wait for the listener
+    for (int i = 0; i < 50; i++) {
+        WiFiClient probe;
+        if (probe.connect(TELEGRAM_API_HOST, TELEGRAM_API_PORT)) {
+            probe.stop();
+            mockRunning = true;
+            return true;
+        }
+        delay(100);
+    }
+    return false;
+}
+
+static void stopMock() {
+    int rc = system("kill $(cat " BENCH_PID ") 2>/dev/null; rm -f " BENCH_PID " " BENCH_SCRIPT);
+    (void)rc;
+    mockRunning = false;
+}
+
+// ============================================================
+// TESTS
+// ============================================================
+
+static TelegramUpdate updates[BENCH_MAX_BATCH];
+
+void test_update_batches() {
+    int total = 0;
+    for (size_t b = 0; b < BATCH_COUNT; b++) total += BATCHES[b] * BENCH_ROUNDS;
+    if (!startMock(total)) {
+        stopMock();
+        TEST_IGNORE_MESSAGE("mock_services.py did not start (python3, or port in use)");
+    }
+
+    WiFiClientSecure net;
+    TelegramClient bot("bench-token", net);
+    char line[128];
+    for (size_t b = 0; b < BATCH_COUNT; b++) {
+        int batch = BATCHES[b];
+        int received = 0;
+        size_t peakAbove = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < BENCH_ROUNDS; r++) {
+            size_t before = heapLive.load();
+            heapPeak = before;
+            int n = bot.getUpdates(updates, batch);
+            size_t above = heapPeak.load() - before;
+            if (above > peakAbove) peakAbove = above;
+            TEST_ASSERT_EQUAL_INT(batch, n);
+            received += n;
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        snprintf(line, sizeof(line), "batch %3d: %7.0f updates/s, %6.2f ms per call, peak heap +%u B",
+                 batch, received / s, s * 1000.0 / BENCH_ROUNDS, (unsigned)peakAbove);
+        TEST_MESSAGE(line);
+    }
+    stopMock();
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_update_batches);
+    if (mockRunning) stopMock();
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+=====================================================
+DELTA OTA PATCHES FOR FRIYAY FOREVER
+=====================================================
+
+Builds a binary patch that turns one firmware.bin into another, so a
+unit running the old version downloads only what changed. The device
+applies it while flashing, reading the old image from its running app
+partition (src/delta_patch.h).
+
+Patch format (little-endian), gzip-compressed as a whole:
+
+  "FYD1"                magic
+  u32 source_size       old image length
+  16 bytes source_md5   MD5 of the old image (what ESP.getSketchMD5() returns)
+  u32 target_size       new image length
+  records until target_size bytes are produced:
+    u32 diff_len        new[i] = old[pos + i] + diff[i] (mod 256)
+    u32 extra_len       bytes copied as-is
+    i32 seek            added to pos after the diff
+    diff_len bytes, then extra_len bytes
+
+Like bsdiff, matched regions are stored as byte differences rather than
+copies: code that moved keeps its instructions but not the addresses in
+them, and the differences are mostly zeros, which gzip packs well.
+
+Usage:
+  python3 tools/make_delta.py old/firmware.bin new/firmware.bin -o firmware-1.0.1.delta.gz
+  python3 tools/make_delta.py --apply old/firmware.bin firmware-1.0.1.delta.gz -o new.bin
+
+Every generated patch is applied again and compared before it is
+written. tools/make_release.py --delta-from builds them for a release.
+"""
+
+import argparse
+import gzip
+import hashlib
+import struct
+import sys
+
+MAGIC = b"FYD1"
+HEADER = struct.Struct("<4sI16sI")
+RECORD = struct.Struct("<IIi")
+
+SEED = 8          # Bytes that must match exactly to try an alignment
+MIN_MATCH = 32    # Shorter regions are stored as literal bytes
+MAX_CANDIDATES = 8
+GIVE_UP = 32      # Stop extending once this far below the best score
+
+
+def index_source(source):
+    index = {}
+    for i in range(len(source) - SEED + 1):
+        key = source[i:i + SEED]
+        offsets = index.get(key)
+        if offsets is None:
+            index[key] = [i]
+        elif len(offsets) < MAX_CANDIDATES:
+            offsets.append(i)
+    return index
+
+
+def extend(source, target, s, t):
+    """Length of the approximate match at (s, t): the one that maximizes
+    matches minus mismatches, bsdiff's scoring."""
+    limit = min(len(source) - s, len(target) - t)
+    score = best_score = best_len = 0
+    i = 0
+    while i < limit:
+        score += 1 if source[s + i] == target[t + i] else -1
+        i += 1
+        if score > best_score:
+            best_score, best_len = score, i
+        elif score < best_score - GIVE_UP:
+            break
+    return best_len
+
+
+def generate(source, target):
+    """Uncompressed patch bytes."""
+    index = index_source(source)
+    out = bytearray(HEADER.pack(MAGIC, len(source), hashlib.md5(source).digest(), len(target)))
+
+    # The pending diff region: target[prev_t:prev_t + prev_len] against
+    # source[prev_s:...]; its record is written once the next one is found
+    prev_s = prev_t = prev_len = 0
+    t = 0
+    while t + SEED <= len(target):
+        candidates = list(index.get(bytes(target[t:t + SEED]), ()))
+        predicted = prev_s + (t - prev_t)  # The previous alignment, resumed
+        if 0 <= predicted < len(source) and predicted not in candidates:
+            candidates.insert(0, predicted)
+
+        best_s, best_len = 0, 0
+        for s in candidates:
+            length = extend(source, target, s, t)
+            if length > best_len:
+                best_s, best_len = s, length
+        if best_len < MIN_MATCH:
+            t += 1
+            continue
+
+        emit(out, source, target, prev_s, prev_t, prev_len, t, best_s - (prev_s + prev_len))
+        prev_s, prev_t, prev_len = best_s, t, best_len
+        t += best_len
+
+    # A reader stops once target_size bytes are out: an empty last record
+    # would be left unread (and fail the device's gzip end check)
+    if prev_len or prev_t + prev_len < len(target):
+        emit(out, source, target, prev_s, prev_t, prev_len, len(target), 0)
+    return bytes(out)
+
+
+def emit(out, source, target, s, t, length, extra_end, seek):
+    extra = target[t + length:extra_end]
+    out += RECORD.pack(length, len(extra), seek)
+    out += bytes((target[t + i] - source[s + i]) & 0xFF for i in range(length))
+    out += extra
+
+
+def apply(source, patch):
+    """Rebuilds the target from the source and uncompressed patch bytes,
+    checking it the way the device does."""
+    magic, source_size, source_md5, target_size = HEADER.unpack_from(patch, 0)
+    if magic != MAGIC:
+        raise ValueError("not a delta patch")
+    if source_size != len(source) or source_md5 != hashlib.md5(source).digest():
+        raise ValueError("patch is for a different source image")
+
+    out = bytearray()
+    pos, at = 0, HEADER.size
+    while len(out) < target_size:
+        diff_len, extra_len, seek = RECORD.unpack_from(patch, at)
+        at += RECORD.size
+        if pos + diff_len > len(source) or len(out) + diff_len + extra_len > target_size:
+            raise ValueError("record out of range")
+        out += bytes((source[pos + i] + patch[at + i]) & 0xFF for i in range(diff_len))
+        at += diff_len
+        out += patch[at:at + extra_len]
+        at += extra_len
+        pos += diff_len + seek
+    return bytes(out)
+
+
+def make_delta(source, target):
+    """Compressed patch, verified by applying it."""
+    patch = generate(source, target)
+    if apply(source, patch) != target:
+        raise RuntimeError("delta does not reproduce the target image")
+    # mtime=0 keeps the output byte-identical for the same inputs
+    return gzip.compress(patch, compresslevel=9, mtime=0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build or apply a delta OTA patch")
+    parser.add_argument("old", help="firmware.bin the device is running")
+    parser.add_argument("new", help="new firmware.bin (or the patch, with --apply)")
+    parser.add_argument("-o", "--out", required=True)
+    parser.add_argument("--apply", action="store_true", help="apply the patch 'new' to 'old'")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    if args.apply:
+        result = apply(old, gzip.decompress(new))
+        with open(args.out, "wb") as f:
+            f.write(result)
+        print("%s: %d bytes, md5 %s" % (args.out, len(result), hashlib.md5(result).hexdigest()))
+        return
+
+    delta = make_delta(old, new)
+    with open(args.out, "wb") as f:
+        f.write(delta)
+    full = len(gzip.compress(new, compresslevel=9, mtime=0))
+    print("%s: %d bytes (full image %d, gzip %d)" % (args.out, len(delta), len(new), full))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
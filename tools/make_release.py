@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+=====================================================
+RELEASE ASSETS FOR FRIYAY FOREVER
+=====================================================
+
+Builds the OTA assets for a GitHub Release from a compiled firmware.bin:
+
+  firmware.bin.gz   gzip -9 of the image; the device inflates it while
+                    flashing (src/gzip_stream.h)
+  firmware-<old version>.delta.gz
+                    one per --delta-from: a patch from that version's
+                    image (tools/make_delta.py), used by units running it
+  version.json      updated in place with the fields OTAUpdater checks:
+                      firmware_size      uncompressed image bytes
+                      firmware_gz_size   firmware.bin.gz bytes
+                      firmware_md5       MD5 of the uncompressed image
+                      firmware_sha256    SHA-256 of it; units only take the
+                                         image from a sibling (src/ota_peer.h)
+                                         when this is present
+
+Upload everything in --out-dir to the release. Devices use a delta or
+the compressed image only when all three fields are present and match,
+and fall back to firmware.bin otherwise.
+
+Usage:
+  python3 tools/make_release.py .pio/build/esp32s3/firmware.bin \
+      --version-json version.json --out-dir release/ \
+      --delta-from 1.0.0=old/1.0.0/firmware.bin
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import os
+import shutil
+
+from make_delta import make_delta
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build compressed OTA release assets")
+    parser.add_argument("firmware", help="firmware.bin from the build")
+    parser.add_argument("--version-json", default="version.json", help="updated in place")
+    parser.add_argument("--out-dir", default="release", help="where the assets are written")
+    parser.add_argument("--delta-from", action="append", default=[], metavar="VERSION=FIRMWARE",
+                        help="also build a delta from an older release's firmware.bin")
+    args = parser.parse_args()
+
+    with open(args.firmware, "rb") as f:
+        image = f.read()
+
+    # mtime=0 keeps the output byte-identical for the same image
+    compressed = gzip.compress(image, compresslevel=9, mtime=0)
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    shutil.copyfile(args.firmware, os.path.join(args.out_dir, "firmware.bin"))
+    with open(os.path.join(args.out_dir, "firmware.bin.gz"), "wb") as f:
+        f.write(compressed)
+
+    with open(args.version_json) as f:
+        version = json.load(f)
+    version["firmware_size"] = len(image)
+    version["firmware_gz_size"] = len(compressed)
+    version["firmware_md5"] = hashlib.md5(image).hexdigest()
+    version["firmware_sha256"] = hashlib.sha256(image).hexdigest()
+    with open(args.version_json, "w") as f:
+        json.dump(version, f, indent=2)
+        f.write("\n")
+    shutil.copyfile(args.version_json, os.path.join(args.out_dir, "version.json"))
+
+    print("firmware.bin     %8d bytes" % len(image))
+    print("firmware.bin.gz  %8d bytes (%.0f%%)" % (len(compressed), 100.0 * len(compressed) / len(image)))
+    print("md5              %s" % version["firmware_md5"])
+    print("sha256           %s" % version["firmware_sha256"])
+
+    for spec in args.delta_from:
+        old_version, _, old_path = spec.partition("=")
+        with open(old_path, "rb") as f:
+            old = f.read()
+        delta = make_delta(old, image)
+        name = "firmware-%s.delta.gz" % old_version
+        with open(os.path.join(args.out_dir, name), "wb") as f:
+            f.write(delta)
+        print("%-16s %8d bytes (%.1f%%)" % (name, len(delta), 100.0 * len(delta) / len(image)))
+
+
+if __name__ == "__main__":
+    main()
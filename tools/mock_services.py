@@ -0,0 +1,380 @@
+#!/usr/bin/env python3
+"""
+=====================================================
+MOCK SERVICES FOR FRIYAY FOREVER
+=====================================================
+
+Local stand-in for every service the firmware talks to, so latency and
+throughput work can run offline and deterministically:
+
+  Telegram     /bot<token>/getUpdates, sendMessage, getFile, getMe
+               /file/bot<token>/<path>         (photo / GIF downloads)
+  open-meteo   /v1/forecast
+  Spotify      /oembed                          (album art lookup)
+               /uri/plain/jpeg/...              (scannables code JPEG)
+               /art/<name>                      (thumbnail_url target)
+  GitHub       /repos/<user>/<repo>/releases/latest
+               /assets/<name>                   (firmware.bin[.gz], deltas, version.json)
+
+Faults can be injected globally or per route:
+  --latency MS     fixed delay before each response
+  --jitter MS      extra random delay, 0..MS
+  --drop RATE      fraction of requests answered by closing the socket
+  --429-every N    every Nth request gets 429 + Retry-After
+  --cut RATE       fraction of file downloads closed partway through the body
+
+File downloads honour "Range: bytes=N-" (206 + Content-Range), as GitHub's
+asset CDN does. Body bytes sent are totalled and printed on exit.
+
+The release endpoint behaves like GitHub's unauthenticated API: it sends
+an ETag, answers a matching If-None-Match with 304 (which doesn't count
+against the quota), and reports X-RateLimit-Limit/Remaining/Reset. Once
+--rate-limit requests have been used it answers 403 until the hour is
+up.
+
+Usage:
+  python3 tools/mock_services.py --port 8443 --cert mock.pem --key mock.key \
+      --fixtures ./fixtures --script scenario.json --seed 1
+
+  Then build the esp32s3_mock environment with its host address set to
+  this machine (see platformio.ini). With --cert/--key the server speaks TLS,
+  which the firmware accepts (it does not verify certificates).
+
+Script file (all keys optional):
+  {
+    "updates":  [ {"message": {"chat": {"id": 1}, "text": "in"}} ],
+    "forecast": { ...open-meteo response... },
+    "release":  { ...GitHub release response... },
+    "routes":   { "/v1/forecast": {"latency": 800, "status": 500} }
+  }
+
+Updates are queued and handed out by getUpdates honouring offset/limit;
+update_id is assigned if missing. Sent messages are logged to stdout.
+Binary responses (JPEGs, firmware) are served from --fixtures.
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import random
+import re
+import signal
+import ssl
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+
+DEFAULT_FORECAST = {
+    "current": {"temperature_2m": 41.0, "precipitation": 0.0},
+    "daily": {
+        "temperature_2m_max": [41.0, 38.5, 35.2, 30.1, 33.0, 36.4, 40.2],
+        "precipitation_sum": [0.0, 0.1, 0.8, 1.2, 0.0, 0.0, 0.3],
+    },
+}
+
+
+class MockState:
+    def __init__(self, args, script):
+        self.args = args
+        self.lock = threading.Lock()
+        self.rng = random.Random(args.seed)
+        self.request_count = 0
+        self.updates = []
+        self.next_update_id = 1
+        self.sent = []
+        self.body_bytes = 0      # Fixture body bytes written, across all requests
+        self.fixture_count = 0
+        self.cut_count = 0
+        self.api_used = 0        # GitHub API requests counted against the quota
+        self.api_not_modified = 0
+        self.api_reset = int(time.time()) + 3600
+        for update in script.get("updates", []):
+            self.queue_update(update)
+        self.forecast = script.get("forecast", DEFAULT_FORECAST)
+        self.release = script.get("release")
+        self.routes = script.get("routes", {})
+
+    def queue_update(self, update):
+        with self.lock:
+            update_id = update.get("update_id", self.next_update_id)
+            self.next_update_id = update_id + 1
+            self.updates.append(dict(update_id=update_id, **update))
+
+    def route_option(self, path, key, default):
+        for prefix, opts in self.routes.items():
+            if path.startswith(prefix) and key in opts:
+                return opts[key]
+        return default
+
+
+class MockHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"   # Keep-alive, like the real APIs
+    server_version = "FriyayMock/1.0"
+
+    # ---------- Fault injection ----------
+
+    def inject_faults(self, path):
+        state = self.server.state
+        args = state.args
+        with state.lock:
+            state.request_count += 1
+            count = state.request_count
+            jitter = state.rng.uniform(0, args.jitter) if args.jitter else 0
+            dropped = state.rng.random() < state.route_option(path, "drop", args.drop)
+
+        latency = state.route_option(path, "latency", args.latency) + jitter
+        if latency > 0:
+            time.sleep(latency / 1000.0)
+
+        if dropped:
+            self.log_message("drop %s", path)
+            self.close_connection = True
+            self.connection.shutdown(2)
+            return True
+
+        every = state.route_option(path, "429_every", args.rate_limit_every)
+        if every and count % every == 0:
+            self.send_json({"ok": False, "error_code": 429,
+                            "description": "Too Many Requests: retry after 5",
+                            "parameters": {"retry_after": 5}},
+                           status=429, headers={"Retry-After": "5",
+                                                "X-RateLimit-Remaining": "0"})
+            return True
+
+        status = state.route_option(path, "status", None)
+        if status:
+            self.send_json({"ok": False, "error_code": status}, status=status)
+            return True
+        return False
+
+    # ---------- Responses ----------
+
+    def send_body(self, body, content_type, status=200, headers=None, limit=None):
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        for key, value in (headers or {}).items():
+            self.send_header(key, value)
+        if self.request_version == "HTTP/1.0" and \
+                self.headers.get("Connection", "").lower() == "keep-alive":
+            self.send_header("Connection", "keep-alive")
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body if limit is None else body[:limit])
+
+    def send_json(self, obj, status=200, headers=None):
+        body = json.dumps(obj, separators=(",", ":")).encode()
+        self.send_body(body, "application/json", status, headers)
+
+    def send_fixture(self, name, content_type):
+        state = self.server.state
+        path = os.path.join(state.args.fixtures, os.path.basename(name))
+        if not os.path.isfile(path):
+            self.send_json({"error": "no fixture " + name}, status=404)
+            return
+        with open(path, "rb") as f:
+            data = f.read()
+
+        status, headers, body = 200, {"Accept-Ranges": "bytes"}, data
+        match = re.match(r"bytes=(\d+)-(\d*)$", self.headers.get("Range", ""))
+        if match:
+            start = int(match.group(1))
+            end = int(match.group(2)) if match.group(2) else len(data) - 1
+            if start >= len(data) or end < start:
+                self.send_body(b"", content_type, status=416,
+                               headers={"Content-Range": "bytes */%d" % len(data)})
+                return
+            end = min(end, len(data) - 1)
+            status, body = 206, data[start:end + 1]
+            headers["Content-Range"] = "bytes %d-%d/%d" % (start, end, len(data))
+
+        # A cut sends the headers and part of the body, then drops the
+        # connection, like a WiFi blip mid-download
+        with state.lock:
+            cut = len(body) > 1 and state.rng.random() < state.route_option(self.path, "cut", state.args.cut)
+            cut_at = state.rng.randrange(1, len(body)) if cut else len(body)
+            state.fixture_count += 1
+            state.cut_count += cut
+            state.body_bytes += cut_at if self.command != "HEAD" else 0
+        if not cut:
+            self.send_body(body, content_type, status=status, headers=headers)
+            return
+        self.log_message("cut %s after %d of %d bytes", self.path, cut_at, len(body))
+        self.send_body(body, content_type, status=status, headers=headers, limit=cut_at)
+        self.close_connection = True
+        self.connection.shutdown(2)
+
+    def base_url(self):
+        scheme = "https" if self.server.state.args.cert else "http"
+        return "%s://%s" % (scheme, self.headers.get("Host", "localhost"))
+
+    # ---------- Routes ----------
+
+    def do_GET(self):
+        self.handle_request(None)
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        self.handle_request(self.rfile.read(length) if length else b"")
+
+    def handle_request(self, body):
+        url = urlparse(self.path)
+        path = url.path
+        query = {k: v[0] for k, v in parse_qs(url.query).items()}
+        if self.inject_faults(path):
+            return
+
+        if path.startswith("/bot"):
+            self.telegram(path.split("/", 2)[2], query, body)
+        elif path.startswith("/file/bot"):
+            self.send_fixture(path.rsplit("/", 1)[1], "application/octet-stream")
+        elif path == "/v1/forecast":
+            self.send_json(self.server.state.forecast)
+        elif path == "/oembed":
+            track = query.get("url", "").rsplit("/", 1)[-1]
+            self.send_json({"title": "Mock Track " + track,
+                            "thumbnail_url": self.base_url() + "/art/art.jpg"})
+        elif path.startswith("/art/"):
+            self.send_fixture(path[5:], "image/jpeg")
+        elif path.startswith("/uri/plain/jpeg/"):
+            self.send_fixture("code.jpg", "image/jpeg")
+        elif path.startswith("/repos/") and path.endswith("/releases/latest"):
+            self.github_api(self.release_json())
+        elif path.startswith("/assets/"):
+            self.send_fixture(path[8:], "application/octet-stream")
+        else:
+            self.send_json({"error": "not found"}, status=404)
+
+    def telegram(self, method, query, body):
+        state = self.server.state
+        if method == "getUpdates":
+            offset = int(query.get("offset", 0))
+            limit = int(query.get("limit", 100))
+            with state.lock:
+                state.updates = [u for u in state.updates if u["update_id"] >= offset]
+                result = state.updates[:limit]
+            self.send_json({"ok": True, "result": result})
+        elif method == "sendMessage":
+            msg = json.loads(body or b"{}")
+            with state.lock:
+                state.sent.append(msg)
+            print("[MOCK] sendMessage %s: %s" % (msg.get("chat_id"), msg.get("text")), flush=True)
+            self.send_json({"ok": True, "result": {"message_id": len(state.sent)}})
+        elif method == "getFile":
+            file_id = query.get("file_id", "")
+            self.send_json({"ok": True, "result": {"file_id": file_id,
+                                                   "file_path": "photos/" + file_id}})
+        elif method == "getMe":
+            self.send_json({"ok": True, "result": {"id": 1, "is_bot": True,
+                                                   "username": "friyay_mock_bot"}})
+        else:
+            self.send_json({"ok": False, "error_code": 404}, status=404)
+
+    def github_api(self, obj):
+        state = self.server.state
+        body = json.dumps(obj, separators=(",", ":")).encode()
+        etag = 'W/"%s"' % hashlib.md5(body).hexdigest()
+        with state.lock:
+            if time.time() >= state.api_reset:
+                state.api_used = 0
+                state.api_reset = int(time.time()) + 3600
+            not_modified = self.headers.get("If-None-Match") == etag
+            limited = not not_modified and state.api_used >= state.args.rate_limit
+            if not_modified:
+                state.api_not_modified += 1
+            elif not limited:
+                state.api_used += 1
+            headers = {"X-RateLimit-Limit": str(state.args.rate_limit),
+                       "X-RateLimit-Remaining": str(state.args.rate_limit - state.api_used),
+                       "X-RateLimit-Reset": str(state.api_reset)}
+
+        if limited:
+            self.send_json({"message": "API rate limit exceeded"}, status=403, headers=headers)
+        elif not_modified:
+            headers["ETag"] = etag
+            self.send_body(b"", "application/json", status=304, headers=headers)
+        else:
+            headers["ETag"] = etag
+            self.send_body(body, "application/json", headers=headers)
+
+    def release_json(self):
+        release = self.server.state.release
+        if release:
+            return release
+        fixtures = self.server.state.args.fixtures
+        firmware = os.path.join(fixtures, "firmware.bin")
+        size = os.path.getsize(firmware) if os.path.isfile(firmware) else 0
+        base = self.base_url() + "/assets/"
+        assets = [
+            {"name": "firmware.bin", "size": size,
+             "browser_download_url": base + "firmware.bin"},
+            {"name": "version.json", "size": 0,
+             "browser_download_url": base + "version.json"},
+        ]
+        # Listed only if present (see tools/make_release.py)
+        extras = sorted(n for n in os.listdir(fixtures)
+                        if n == "firmware.bin.gz" or n.endswith(".delta.gz")) if os.path.isdir(fixtures) else []
+        for name in extras:
+            assets.append({"name": name, "size": os.path.getsize(os.path.join(fixtures, name)),
+                           "browser_download_url": base + name})
+        return {"tag_name": "v9.9.9", "body": "Mock release", "assets": assets}
+
+    def log_message(self, fmt, *args):
+        if not self.server.state.args.quiet:
+            super().log_message(fmt, *args)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local mock of the Friyay Forever cloud services")
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8443)
+    parser.add_argument("--cert", help="TLS certificate (PEM); plain HTTP if omitted")
+    parser.add_argument("--key", help="TLS private key (PEM)")
+    parser.add_argument("--fixtures", default="fixtures", help="directory of JPEG/GIF/firmware files")
+    parser.add_argument("--script", help="JSON scenario file")
+    parser.add_argument("--latency", type=float, default=0, help="ms added to every response")
+    parser.add_argument("--jitter", type=float, default=0, help="random extra ms, 0..N")
+    parser.add_argument("--drop", type=float, default=0, help="fraction of requests dropped")
+    parser.add_argument("--cut", type=float, default=0,
+                        help="fraction of file downloads cut off mid-body")
+    parser.add_argument("--429-every", dest="rate_limit_every", type=int, default=0,
+                        help="answer every Nth request with 429")
+    parser.add_argument("--rate-limit", type=int, default=60,
+                        help="GitHub API requests allowed per hour (unauthenticated: 60)")
+    parser.add_argument("--seed", type=int, default=None, help="RNG seed for repeatable faults")
+    parser.add_argument("--quiet", action="store_true")
+    args = parser.parse_args()
+
+    script = {}
+    if args.script:
+        with open(args.script) as f:
+            script = json.load(f)
+
+    server = ThreadingHTTPServer((args.bind, args.port), MockHandler)
+    server.state = MockState(args, script)
+    if args.cert:
+        ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        ctx.load_cert_chain(args.cert, args.key)
+        server.socket = ctx.wrap_socket(server.socket, server_side=True)
+
+    print("[MOCK] Listening on %s:%d (%s)" % (args.bind, args.port,
+                                             "TLS" if args.cert else "plain HTTP"), flush=True)
+    def stop(signum, frame):
+        raise KeyboardInterrupt
+    signal.signal(signal.SIGTERM, stop)  # kill prints the totals too
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    state = server.state
+    print("[MOCK] %d file downloads, %d cut, %d body bytes sent" %
+          (state.fixture_count, state.cut_count, state.body_bytes), flush=True)
+    print("[MOCK] GitHub API: %d counted, %d not modified" %
+          (state.api_used, state.api_not_modified), flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+Unit tests for tools/make_delta.py:
+
+  python3 -m unittest discover -s tools -p "test_*.py"
+
+The device side has its own test: test/test_delta_patch feeds a patch
+made here through GzipStream and DeltaPatch.
+"""
+
+import gzip
+import os
+import random
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import make_delta  # noqa: E402
+
+
+def firmware_like(size, seed):
+    """Pseudo-random bytes with repeats, so there is something to match."""
+    rng = random.Random(seed)
+    words = [bytes(rng.getrandbits(8) for _ in range(16)) for _ in range(64)]
+    out = bytearray()
+    while len(out) < size:
+        out += rng.choice(words) if rng.random() < 0.5 else bytes(rng.getrandbits(8) for _ in range(16))
+    return bytes(out[:size])
+
+
+def edited(source, seed):
+    """A later build: patched bytes, shifted code, an inserted and a moved block."""
+    rng = random.Random(seed)
+    out = bytearray(source)
+    for _ in range(40):
+        out[rng.randrange(len(out))] = rng.getrandbits(8)
+    # Addresses in moved code change by a constant
+    for i in range(1000, 3000, 4):
+        out[i] = (out[i] + 4) & 0xFF
+    out[5000:5000] = bytes(rng.getrandbits(8) for _ in range(700))
+    block = out[9000:10000]
+    del out[9000:10000]
+    out[2000:2000] = block
+    return bytes(out)
+
+
+def roundtrip(source, target):
+    return make_delta.apply(source, gzip.decompress(make_delta.make_delta(source, target)))
+
+
+class MakeDeltaTest(unittest.TestCase):
+    def test_round_trip(self):
+        source = firmware_like(20000, 1)
+        target = edited(source, 2)
+        delta = make_delta.make_delta(source, target)
+        self.assertEqual(make_delta.apply(source, gzip.decompress(delta)), target)
+        # The point of the exercise
+        self.assertLess(len(delta), len(gzip.compress(target, compresslevel=9)) // 2)
+
+    def test_identical_images(self):
+        source = firmware_like(8000, 3)
+        self.assertEqual(roundtrip(source, source), source)
+
+    def test_unrelated_images(self):
+        source, target = firmware_like(4000, 4), firmware_like(5000, 5)
+        self.assertEqual(roundtrip(source, target), target)
+
+    def test_deterministic(self):
+        source = firmware_like(6000, 6)
+        target = edited(source, 7)
+        self.assertEqual(make_delta.make_delta(source, target), make_delta.make_delta(source, target))
+
+    def test_wrong_source_rejected(self):
+        source = firmware_like(12000, 8)
+        patch = gzip.decompress(make_delta.make_delta(source, edited(source, 9)))
+
+        other = bytearray(source)
+        other[100] ^= 0xFF  # Same size, different MD5
+        with self.assertRaisesRegex(ValueError, "different source"):
+            make_delta.apply(bytes(other), patch)
+        with self.assertRaisesRegex(ValueError, "different source"):
+            make_delta.apply(source[:-1], patch)
+
+    def test_not_a_patch(self):
+        with self.assertRaisesRegex(ValueError, "not a delta patch"):
+            make_delta.apply(b"", b"FYD0" + bytes(make_delta.HEADER.size - 4))
+
+    def test_empty_target(self):
+        source = firmware_like(3000, 10)
+        self.assertEqual(roundtrip(source, b""), b"")
+        # Header only: the device never reads records past target_size
+        self.assertEqual(len(make_delta.generate(source, b"")), make_delta.HEADER.size)
+
+    def test_short_targets(self):
+        # Shorter than SEED (no lookup) and MIN_MATCH (no diff region)
+        source = firmware_like(3000, 11)
+        for size in (1, make_delta.SEED - 1, make_delta.SEED, make_delta.MIN_MATCH - 1, make_delta.MIN_MATCH):
+            target = source[500:500 + size]
+            self.assertEqual(roundtrip(source, target), target, size)
+
+    def test_empty_source(self):
+        target = firmware_like(2000, 12)
+        self.assertEqual(roundtrip(b"", target), target)
+        self.assertEqual(roundtrip(b"", b""), b"")
+
+
+if __name__ == "__main__":
+    unittest.main()